@@ -72,6 +72,9 @@
 #include "backend_get.h"
 #include "backend_client.h"
 
+/* Max size of queued notifications moved to the output buffer of a client at once */
+#define CLIENT_NOTIFY_WRITE_BYTES 65536
+
 /*! Find client by session-id 
  * @param[in] ce_list   List of clients
  * @param[in] id        Session id
@@ -88,9 +91,130 @@ ce_find_byid(struct client_entry *ce_list,
     return NULL;
 }
 
+/*! Free a queued client notification
+ */
+static int
+client_notification_free(struct client_notification *cn)
+{
+    if (cn->cn_buf)
+        free(cn->cn_buf);
+    if (cn->cn_key)
+        free(cn->cn_key);
+    free(cn);
+    return 0;
+}
+
+/*! Free the notification output queue of a client
+ * @param[in]  ce   Client entry
+ */
+static int
+backend_client_notify_free(struct client_entry *ce)
+{
+    struct client_notification *cn;
+
+    while ((cn = ce->ce_notifyq) != NULL){
+        DELQ(cn, ce->ce_notifyq, struct client_notification *);
+        client_notification_free(cn);
+    }
+    ce->ce_notifyq_len = 0;
+    return 0;
+}
+
+/*! Queue a notification to be written to a client
+ *
+ * The queue is bounded by CLICON_NOTIFICATION_QUEUE_MAX. If it is full,
+ * CLICON_NOTIFICATION_QUEUE_POLICY determines if the oldest notification is dropped, a
+ * notification of the same event is replaced, or the client is disconnected.
+ * @param[in]  h      Clicon handle
+ * @param[in]  ce     Client entry
+ * @param[in]  event  Notification as XML, used for coalescing
+ * @param[in]  msg    Encoded notification message, copied
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+backend_client_notify_queue(clicon_handle        h,
+                            struct client_entry *ce,
+                            cxobj               *event,
+                            struct clicon_msg   *msg)
+{
+    int                         retval = -1;
+    struct client_notification *cn = NULL;
+    int                         max;
+    char                       *policy;
+    char                       *key = NULL;
+    cxobj                      *x = NULL;
+
+    max = clicon_option_int(h, "CLICON_NOTIFICATION_QUEUE_MAX");
+    if ((policy = clicon_option_str(h, "CLICON_NOTIFICATION_QUEUE_POLICY")) == NULL)
+        policy = "drop-oldest";
+    if (strcmp(policy, "coalesce") == 0){
+        /* Event is the first element after eventTime */
+        while ((x = xml_child_each(event, x, CX_ELMNT)) != NULL)
+            if (strcmp(xml_name(x), "eventTime") != 0){
+                key = xml_name(x);
+                break;
+            }
+    }
+    if (max > 0 && ce->ce_notifyq_len >= max){
+        if (strcmp(policy, "disconnect") == 0){
+            clicon_log(LOG_WARNING, "client %d notification queue full, disconnecting", ce->ce_nr);
+            ce->ce_out_notifications_dropped += ce->ce_notifyq_len + 1;
+            backend_client_notify_free(ce);
+            /* Pending output fails and the client is removed when eof is read */
+            shutdown(ce->ce_s, SHUT_RDWR);
+            goto ok;
+        }
+        if (key && (cn = ce->ce_notifyq) != NULL){
+            do {
+                if (clicon_strcmp(cn->cn_key, key) == 0)
+                    break;
+                cn = NEXTQ(struct client_notification *, cn);
+            } while (cn != ce->ce_notifyq);
+            if (clicon_strcmp(cn->cn_key, key) != 0)
+                cn = NULL;
+        }
+        if (cn == NULL)
+            cn = ce->ce_notifyq;
+        DELQ(cn, ce->ce_notifyq, struct client_notification *);
+        client_notification_free(cn);
+        ce->ce_notifyq_len--;
+        ce->ce_out_notifications_dropped++;
+    }
+    if ((cn = malloc(sizeof(*cn))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(cn, 0, sizeof(*cn));
+    cn->cn_len = ntohl(msg->op_len);
+    if ((cn->cn_buf = malloc(cn->cn_len)) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        client_notification_free(cn);
+        goto done;
+    }
+    memcpy(cn->cn_buf, msg, cn->cn_len);
+    if (key && (cn->cn_key = strdup(key)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        client_notification_free(cn);
+        goto done;
+    }
+    ADDQ(cn, ce->ce_notifyq);
+    ce->ce_notifyq_len++;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+static int from_client_output(clicon_handle h, struct client_entry *ce);
+
 /*! Stream callback for netconf stream notification (RFC 5277)
+ *
+ * A notification is queued, and queued notifications are written on flush when all events
+ * of a dispatch are delivered, or when the client socket is writable. A slow subscriber
+ * does not block the backend.
  * @param[in]  h     Clicon handle
- * @param[in]  op    0:event, 1:rm
+ * @param[in]  op    0:event, 1:rm, 2:flush
  * @param[in]  event Event as XML
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @see stream_ss_add
@@ -102,6 +226,7 @@ ce_event_cb(clicon_handle h,
             void         *arg)
 {
     struct client_entry *ce = (struct client_entry *)arg;
+    struct clicon_msg   *msg = NULL;
     
     clicon_debug(1, "%s op:%d", __FUNCTION__, op);
     switch (op){
@@ -110,16 +235,20 @@ ce_event_cb(clicon_handle h,
         if (ce->ce_s)
             backend_client_rm(h, ce);
         break;
+    case 2:
+        /* Write queued notifications unless waiting for socket or a chunked reply is
+         * being created */
+        if (!ce->ce_out_wait && ce->ce_chunk == NULL &&
+            from_client_output(h, ce) < 0)
+            clicon_log(LOG_WARNING, "client %d notification: %s", ce->ce_nr, clicon_err_reason);
+        break;
     default:
-        if (send_msg_notify_xml(h, ce->ce_s, event) < 0){
-            if (errno == ECONNRESET || errno == EPIPE){
-                clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
-            }
-            break;
-        }
-        /* note there may be other notifications than RFC5277 streams */
-        ce->ce_out_notifications++;
-        netconf_monitoring_counter_inc(h, "out-notifications");
+        /* The event is serialized once and shared by all subscribers */
+        if (stream_event_cache(h, event, NULL, &msg) < 0)
+            return -1;
+        if (backend_client_notify_queue(h, ce, event, msg) < 0)
+            return -1;
+        break;
     }
     return 0;
 }
@@ -222,6 +351,10 @@ backend_monitoring_state_get(clicon_handle h,
         cprintf(cb, "<in-bad-rpcs>%u</in-bad-rpcs>", ce->ce_in_bad_rpcs);
         cprintf(cb, "<out-rpc-errors>%u</out-rpc-errors>", ce->ce_out_rpc_errors);
         cprintf(cb, "<out-notifications>%u</out-notifications>", ce->ce_out_notifications);
+        cprintf(cb, "<out-notifications-queued xmlns=\"%s\">%u</out-notifications-queued>",
+                CLIXON_LIB_NS, ce->ce_notifyq_len);
+        cprintf(cb, "<out-notifications-dropped xmlns=\"%s\">%u</out-notifications-dropped>",
+                CLIXON_LIB_NS, ce->ce_out_notifications_dropped);
         cprintf(cb, "</session>");
     }
     cprintf(cb, "</sessions>");
@@ -241,6 +374,244 @@ backend_monitoring_state_get(clicon_handle h,
     goto done;
 }
 
+/*! Free chunked reply state of a client
+ * @param[in]  ce   Client entry
+ */
+static int
+backend_client_output_free(struct client_entry *ce)
+{
+    if (ce->ce_chunk){
+        clixon_xml_chunk_free(ce->ce_chunk);
+        ce->ce_chunk = NULL;
+    }
+    if (ce->ce_chunk_xt){
+        xml_free(ce->ce_chunk_xt);
+        ce->ce_chunk_xt = NULL;
+    }
+    if (ce->ce_cursors){
+        clixon_state_cursor_streams_free(ce->ce_cursors);
+        ce->ce_cursors = NULL;
+    }
+    if (ce->ce_outbuf){
+        cbuf_free(ce->ce_outbuf);
+        ce->ce_outbuf = NULL;
+    }
+    ce->ce_outpos = 0;
+    backend_client_notify_free(ce);
+    return 0;
+}
+
+/*! Register a chunked reply to be written to a client when the current rpc is done
+ *
+ * Instead of encoding a (large) result tree into the rpc reply buffer, the tree is
+ * encoded and written a chunk at a time to the client socket after the rpc callback
+ * returns. The reply buffer contains the start of the reply, eg <rpc-reply>, and
+ * </rpc-reply> is added after the tree.
+ * Entries of streamed state lists are requested from their providers while the tree is
+ * encoded.
+ * @param[in]  ce      Client entry
+ * @param[in]  xt      XML tree to encode, freed by this module when written
+ * @param[in]  depth   Nr of levels to print, -1 is all
+ * @param[in]  streams State lists attached to xt, freed by this module, or NULL
+ * @retval     0       OK, xt and streams are freed by this module
+ * @retval    -1       Error, xt and streams are not taken over
+ * @see get_nacm_and_reply
+ */
+int
+backend_client_chunked_reply(struct client_entry *ce,
+                             cxobj               *xt,
+                             int32_t              depth,
+                             state_cursor_stream *streams)
+{
+    clixon_xml_chunk    *xc;
+    state_cursor_stream *cs;
+
+    if (ce->ce_chunk != NULL){
+        clicon_err(OE_NETCONF, EINVAL, "Chunked reply already registered");
+        return -1;
+    }
+    if ((xc = clixon_xml_chunk_new(xt, depth, 0)) == NULL)
+        return -1;
+    if ((cs = streams) != NULL){
+        do {
+            if (clixon_xml_chunk_fill(xc, clixon_state_cursor_xparent(cs),
+                                      clixon_state_cursor_fill, cs) < 0){
+                clixon_xml_chunk_free(xc);
+                return -1;
+            }
+            cs = NEXTQ(state_cursor_stream *, cs);
+        } while (cs && cs != streams);
+    }
+    ce->ce_chunk = xc;
+    ce->ce_chunk_xt = xt;
+    ce->ce_cursors = streams;
+    return 0;
+}
+
+static int from_client_output_cb(int s, void *arg);
+
+/*! Drop pending output of a client after an error writing or encoding it
+ *
+ * The error only concerns this client, not the backend. The socket is shut down so that
+ * the client is removed when eof is read, as when the client closes the connection.
+ * @param[in]  ce     Client entry
+ * @param[in]  reason Reason logged
+ */
+static int
+from_client_output_abort(struct client_entry *ce,
+                         const char          *reason)
+{
+    clicon_log(LOG_WARNING, "client %d output: %s, closing", ce->ce_nr, reason);
+    backend_client_output_free(ce);
+    shutdown(ce->ce_s, SHUT_RDWR);
+    return 0;
+}
+
+/*! Write pending output to a client without blocking
+ *
+ * Write framed output, encode the next chunk of a chunked reply, and repeat until the reply
+ * and queued messages are written or the socket would block. In the latter case, stop reading
+ * requests from the client and resume when the socket is writable.
+ * An error writing to or encoding output for the client closes that client only.
+ * @param[in]  h    Clicon handle
+ * @param[in]  ce   Client entry
+ * @retval     0    OK, written, waiting for socket, or client closed
+ * @retval    -1    Fatal error
+ */
+static int
+from_client_output(clicon_handle        h,
+                   struct client_entry *ce)
+{
+    int      retval = -1;
+    ssize_t  n;
+    uint32_t chunksize;
+    int      ret;
+    struct client_notification *cn;
+
+    chunksize = clicon_option_int(h, "CLICON_BACKEND_REPLY_CHUNK");
+    while (1){
+        if (ce->ce_outbuf && ce->ce_outpos < cbuf_len(ce->ce_outbuf)){
+            if ((n = send(ce->ce_s, cbuf_get(ce->ce_outbuf) + ce->ce_outpos,
+                          cbuf_len(ce->ce_outbuf) - ce->ce_outpos,
+                          MSG_DONTWAIT)) < 0){
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                if (errno == EPIPE || errno == ECONNRESET){
+                    /* Client closed, eof will be read on socket */
+                    clicon_log(LOG_WARNING, "client rpc reset");
+                    backend_client_output_free(ce);
+                    continue;
+                }
+                from_client_output_abort(ce, strerror(errno));
+                continue;
+            }
+            ce->ce_outpos += n;
+            continue;
+        }
+        if (ce->ce_outbuf == NULL &&
+            (ce->ce_outbuf = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        cbuf_reset(ce->ce_outbuf);
+        ce->ce_outpos = 0;
+        if (ce->ce_chunk){ /* Encode next chunk of reply */
+            if (clicon_msg_chunk_begin(ce->ce_outbuf) < 0 ||
+                (ret = clixon_xml_chunk_next(ce->ce_chunk, ce->ce_outbuf, chunksize)) < 0){
+                from_client_output_abort(ce, clicon_err_reason);
+                continue;
+            }
+            if (ret == 0){
+                cprintf(ce->ce_outbuf, "</rpc-reply>");
+                clixon_xml_chunk_free(ce->ce_chunk);
+                ce->ce_chunk = NULL;
+                xml_free(ce->ce_chunk_xt);
+                ce->ce_chunk_xt = NULL;
+                if (ce->ce_cursors){
+                    clixon_state_cursor_streams_free(ce->ce_cursors);
+                    ce->ce_cursors = NULL;
+                }
+            }
+            if (clicon_msg_chunk_end(ce->ce_outbuf, ret) < 0)
+                from_client_output_abort(ce, clicon_err_reason);
+            continue;
+        }
+        if (ce->ce_notifyq != NULL){ /* Queued notifications, write several at once */
+            while ((cn = ce->ce_notifyq) != NULL &&
+                   cbuf_len(ce->ce_outbuf) < CLIENT_NOTIFY_WRITE_BYTES){
+                DELQ(cn, ce->ce_notifyq, struct client_notification *);
+                ce->ce_notifyq_len--;
+                cbuf_append_buf(ce->ce_outbuf, cn->cn_buf, cn->cn_len);
+                client_notification_free(cn);
+                /* note there may be other notifications than RFC5277 streams */
+                ce->ce_out_notifications++;
+                netconf_monitoring_counter_inc(h, "out-notifications");
+            }
+            continue;
+        }
+        /* All written */
+        backend_client_output_free(ce);
+        if (ce->ce_out_wait){
+            ce->ce_out_wait = 0;
+            clixon_event_unreg_fd(ce->ce_s, from_client_output_cb);
+            if (clixon_event_reg_fd(ce->ce_s, from_client, (void*)ce, "local netconf client socket") < 0)
+                goto done;
+        }
+        goto ok;
+    }
+    /* Socket would block */
+    if (!ce->ce_out_wait){
+        ce->ce_out_wait = 1;
+        clixon_event_unreg_fd(ce->ce_s, from_client);
+        if (clixon_event_reg_fd_write(ce->ce_s, from_client_output_cb, (void*)ce, "local netconf client output") < 0)
+            goto done;
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Client socket is writable, continue writing pending output
+ * @param[in]   s    Socket
+ * @param[in]   arg  Client entry
+ */
+static int
+from_client_output_cb(int   s,
+                      void *arg)
+{
+    struct client_entry *ce = (struct client_entry *)arg;
+
+    return from_client_output(ce->ce_handle, ce);
+}
+
+/*! Start writing a chunked reply registered with backend_client_chunked_reply
+ * @param[in]  h      Clicon handle
+ * @param[in]  ce     Client entry
+ * @param[in]  cbret  Start of reply
+ */
+static int
+from_client_chunked_start(clicon_handle        h,
+                          struct client_entry *ce,
+                          cbuf                *cbret)
+{
+    if (ce->ce_outbuf == NULL &&
+        (ce->ce_outbuf = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        return -1;
+    }
+    cbuf_reset(ce->ce_outbuf);
+    ce->ce_outpos = 0;
+    if (clicon_msg_chunk_begin(ce->ce_outbuf) < 0)
+        return -1;
+    cbuf_append_str(ce->ce_outbuf, cbuf_get(cbret));
+    if (clicon_msg_chunk_end(ce->ce_outbuf, 1) < 0)
+        return -1;
+    return from_client_output(h, ce);
+}
+
 /*! Remove client entry state
  * Close down everything wrt clients (eg sockets, subscriptions)
  * Finally actually remove client struct in handle
@@ -292,7 +663,10 @@ backend_client_rm(clicon_handle        h,
     for (c = *ce_prev; c; c = c->ce_next){
         if (c == ce){
             if (ce->ce_s){
-                clixon_event_unreg_fd(ce->ce_s, from_client);
+                if (ce->ce_out_wait)
+                    clixon_event_unreg_fd(ce->ce_s, from_client_output_cb);
+                else
+                    clixon_event_unreg_fd(ce->ce_s, from_client);
                 close(ce->ce_s);
                 ce->ce_s = 0;
                 if (release_all_dbs(h, ce->ce_id) < 0)
@@ -302,6 +676,7 @@ backend_client_rm(clicon_handle        h,
         }
         ce_prev = &c->ce_next;
     }
+    backend_client_output_free(ce);
     retval = backend_client_delete(h, ce); /* actually purge it */
  done:
     return retval;
@@ -1070,6 +1445,7 @@ from_client_create_subscription(clicon_handle h,
     struct timeval       start;
     struct timeval       stop;
     cvec                *nsc = NULL;
+    xpath_tree          *xpt = NULL;
     
     /* XXX should use prefix cf edit_config */
     if ((nsc = xml_nsctx_init(NULL, EVENT_RFC5277_NAMESPACE)) == NULL)
@@ -1109,10 +1485,18 @@ from_client_create_subscription(clicon_handle h,
             goto done;
         goto ok;
     }
+    /* Filter is compiled when the subscription is added, check it first */
+    if (selector && strlen(selector)){
+        if (xpath_parse(selector, &xpt) < 0){
+            if (netconf_invalid_value(cbret, "application", "Invalid filter select xpath") < 0)
+                goto done;
+            goto ok;
+        }
+    }
     /* Add subscriber to stream - to make notifications for this client */
     if (stream_ss_add(h, stream, selector,
                       starttime?&start:NULL, stoptime?&stop:NULL,
-                      ce_event_cb, (void*)ce) < 0)
+                      ce_event_cb, (void*)ce) == NULL)
         goto done;
     /* Replay of this stream to specific subscription according to start and 
      * stop (if present). 
@@ -1128,6 +1512,8 @@ from_client_create_subscription(clicon_handle h,
  ok:
     retval = 0;
   done:
+    if (xpt)
+        xpath_tree_free(xpt);
     if (nsc)
         xml_nsctx_free(nsc);
     return retval;
@@ -1364,6 +1750,8 @@ from_client_stats(clicon_handle h,
         if (clixon_stats_module_get(h, ym, cbret) < 0)
             goto done;
     }
+    if (clixon_statedata_cache_stats(h, cbret) < 0)
+        goto done;
     cprintf(cbret, "</rpc-reply>");
     retval = 0;
  done:
@@ -1725,7 +2113,11 @@ from_client_msg(clicon_handle        h,
     // XXX    clicon_debug(CLIXON_DBG_MSG, "Reply:%s", cbuf_get(cbret));
     /* XXX problem here is that cbret has not been parsed so may contain 
        parse errors */
-    if (send_msg_reply(ce->ce_s, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
+    if (ce->ce_chunk){ /* Chunked reply, cbret is start of reply */
+        if (from_client_chunked_start(h, ce, cbret) < 0)
+            goto done;
+    }
+    else if (send_msg_reply(ce->ce_s, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
         switch (errno){
         case EPIPE:
             /* man (2) write: 
@@ -45,6 +45,16 @@
  * Keep state about every connected client.
  * References from RFC 6022, ietf-netconf-monitoring.yang sessions container
  */
+/* Notification waiting to be written to a client
+ * @see backend_client_notify_queue
+ */
+struct client_notification{
+    qelem_t               cn_q;       /* queue header */
+    char                 *cn_buf;     /* Encoded notification message */
+    size_t                cn_len;     /* Length of cn_buf */
+    char                 *cn_key;     /* Event name used for coalescing, or NULL */
+};
+
 struct client_entry{
     struct client_entry  *ce_next;    /* The clients linked list */
     struct sockaddr       ce_addr;    /* The clients (UNIX domain) address */
@@ -63,6 +73,15 @@ struct client_entry{
     uint32_t              ce_in_bad_rpcs;    /* Not correct <rpc> messages */
     uint32_t              ce_out_rpc_errors; /*  <rpc-error> messages*/
     uint32_t              ce_out_notifications; /* Outgoing notifications */
+    clixon_xml_chunk     *ce_chunk;   /* Chunked reply being written, or NULL */
+    cxobj                *ce_chunk_xt;/* Tree of chunked reply, freed when written */
+    struct state_cursor_stream *ce_cursors; /* State lists streamed in chunked reply */
+    cbuf                 *ce_outbuf;  /* Framed output not yet written to ce_s */
+    size_t                ce_outpos;  /* Bytes of ce_outbuf written */
+    struct client_notification *ce_notifyq; /* Notifications waiting to be written */
+    uint32_t              ce_notifyq_len;   /* Length of ce_notifyq */
+    uint32_t              ce_out_notifications_dropped; /* Dropped due to full ce_notifyq */
+    int                   ce_out_wait;/* Output blocked, waiting for ce_s to be writable */
 };
 
 /*
@@ -71,6 +90,8 @@ struct client_entry{
 int backend_monitoring_state_get(clicon_handle h, yang_stmt *yspec, char *xpath, cvec *nsc, cxobj **xret, cxobj **xerr);
 int backend_client_rm(clicon_handle h, struct client_entry *ce);
 int from_client(int fd, void *arg);
+int backend_client_chunked_reply(struct client_entry *ce, cxobj *xt, int32_t depth,
+                                 struct state_cursor_stream *streams);
 int backend_rpc_init(clicon_handle h);
 
 #endif  /* _BACKEND_CLIENT_H_ */
@@ -440,30 +440,41 @@ filter_xpath_again(clicon_handle h,
 
 /*! Help function for NACM access and returnmessage
  *
- * @param[in]  h        Clicon handle 
- * @param[in]  xret     Result XML tree
- * @param[in]  xvec    xpath lookup result on xret
- * @param[in]  xlen    length of xvec
- * @param[in]  xpath    XPath point to object to get
- * @param[in]  nsc      Namespace context of xpath
- * @param[in]  username User name for NACM access
- * @param[in]  depth    Nr of levels to print, -1 is all, 0 is none
- * @param[out] cbret    Return xml tree, eg <rpc-reply>..., <rpc-error.. 
- * @retval     0        OK
- * @retval    -1        Error
+ * If CLICON_BACKEND_REPLY_CHUNK is set, the result tree is not encoded into cbret. Instead
+ * cbret contains the start of the reply and the tree is handed over to the client entry
+ * which writes it in chunks when the rpc is done.
+ * @param[in]     h        Clicon handle 
+ * @param[in]     ce       Client entry
+ * @param[in,out] xretp    Result XML tree, set to NULL if handed over to client
+ * @param[in]     xvec     xpath lookup result on xret
+ * @param[in]     xlen     length of xvec
+ * @param[in]     xpath    XPath point to object to get
+ * @param[in]     nsc      Namespace context of xpath
+ * @param[in]     username User name for NACM access
+ * @param[in]     depth    Nr of levels to print, -1 is all, 0 is none
+ * @param[in,out] streamsp State lists streamed in chunked reply, set to NULL if handed over
+ * @param[in]     next     Cursor token of next list pagination page, or NULL
+ * @param[out]    cbret    Return xml tree, eg <rpc-reply>..., <rpc-error.. 
+ * @retval        0        OK
+ * @retval       -1        Error
+ * @see backend_client_chunked_reply
  */
 static int
-get_nacm_and_reply(clicon_handle h,
-                   cxobj        *xret,
-                   cxobj       **xvec,
-                   size_t        xlen,
-                   char         *xpath,
-                   cvec         *nsc,
-                   char         *username,
-                   int32_t       depth,
-                   cbuf         *cbret)
+get_nacm_and_reply(clicon_handle        h,
+                   struct client_entry *ce,
+                   cxobj              **xretp,
+                   cxobj              **xvec,
+                   size_t               xlen,
+                   char                *xpath,
+                   cvec                *nsc,
+                   char                *username,
+                   int32_t              depth,
+                   state_cursor_stream **streamsp,
+                   char                *next,
+                   cbuf                *cbret)
 {
     int     retval = -1;
+    cxobj  *xret = *xretp;
     cxobj  *xnacm = NULL;
 
     /* Pre-NACM access step */
@@ -473,17 +484,32 @@ get_nacm_and_reply(clicon_handle h,
         if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
             goto done;
     }
-    cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);     /* OK */
+    cprintf(cbret, "<rpc-reply xmlns=\"%s\"", NETCONF_BASE_NAMESPACE);     /* OK */
+    if (next)
+        cprintf(cbret, " %s:next-cursor=\"%s\" xmlns:%s=\"%s\"",
+                CLIXON_LIB_PREFIX, next, CLIXON_LIB_PREFIX, CLIXON_LIB_NS);
+    cprintf(cbret, ">");
     if (xret==NULL)
         cprintf(cbret, "<data/>");
     else{
         if (xml_name_set(xret, NETCONF_OUTPUT_DATA) < 0)
             goto done;
+        if (ce != NULL && clicon_option_int(h, "CLICON_BACKEND_REPLY_CHUNK") > 0){
+            /* Add ancestors of streamed state lists after NACM and filtering */
+            if (*streamsp && clixon_state_cursor_attach(*streamsp, xret) < 0)
+                goto done;
+            if (backend_client_chunked_reply(ce, xret, depth>0?depth+1:depth, *streamsp) < 0)
+                goto done;
+            *xretp = NULL; /* Freed by client when written */
+            *streamsp = NULL;
+            goto ok;
+        }
         /* Top level is data, so add 1 to depth if significant */
         if (clixon_xml2cbuf(cbret, xret, 0, 0, depth>0?depth+1:depth, 0) < 0)
             goto done;
     }
     cprintf(cbret, "</rpc-reply>");
+ ok:
     retval = 0;
  done:
     return retval;
@@ -550,6 +576,469 @@ list_pagination_hdr(clicon_handle h,
     return retval;
 }
 
+/*! Snapshot of a config list for cursor-based list pagination
+ *
+ * Pages following the first page are read from the snapshot using a cursor token
+ * referencing the snapshot and a position, so they are stable even if the list is changed
+ * and cost is proportional to the page, not to the list.
+ */
+struct pagination_snapshot {
+    qelem_t           ps_qelem;    /* List header */
+    uint32_t          ps_id;       /* Snapshot identifier, part of cursor token */
+    uint32_t          ps_nonce;    /* Random part of cursor token */
+    char             *ps_db;       /* Datastore of snapshot */
+    char             *ps_xpath;    /* Canonical xpath of list */
+    char             *ps_username; /* Cursor is only valid for same user */
+    withdefaults_type ps_wdef;     /* Cursor is only valid for same with-defaults */
+    struct timeval    ps_expire;   /* Snapshot is removed when expired */
+    cxobj            *ps_xt;       /* Copy of datastore pruned to list entries */
+    cxobj           **ps_vec;      /* List entries of snapshot in order */
+    size_t            ps_len;      /* Length of ps_vec */
+};
+typedef struct pagination_snapshot pagination_snapshot;
+
+/*! Free list pagination snapshot
+ */
+static int
+pagination_snapshot_free(pagination_snapshot *ps)
+{
+    if (ps->ps_db)
+        free(ps->ps_db);
+    if (ps->ps_xpath)
+        free(ps->ps_xpath);
+    if (ps->ps_username)
+        free(ps->ps_username);
+    if (ps->ps_xt)
+        xml_free(ps->ps_xt);
+    if (ps->ps_vec)
+        free(ps->ps_vec);
+    free(ps);
+    return 0;
+}
+
+/*! Remove snapshot from list of list pagination snapshots and free it
+ */
+static int
+pagination_snapshot_rm(clicon_handle        h,
+                       pagination_snapshot *ps)
+{
+    pagination_snapshot *ps_list = NULL;
+
+    clicon_ptr_get(h, "pagination-snapshots", (void**)&ps_list);
+    DELQ(ps, ps_list, pagination_snapshot *);
+    if (ps_list)
+        clicon_ptr_set(h, "pagination-snapshots", ps_list);
+    else
+        clicon_ptr_del(h, "pagination-snapshots");
+    return pagination_snapshot_free(ps);
+}
+
+/*! Remove expired list pagination snapshots
+ *
+ * Snapshots are ordered with the least recently used first, so expired snapshots are first
+ * @param[in]  h    Clixon handle
+ * @param[in]  now  Current time
+ * @retval     n    Number of remaining snapshots
+ */
+static int
+pagination_snapshots_purge(clicon_handle   h,
+                           struct timeval *now)
+{
+    pagination_snapshot *ps_list = NULL;
+    pagination_snapshot *ps;
+    int                  n = 0;
+
+    while (1){
+        ps_list = NULL;
+        clicon_ptr_get(h, "pagination-snapshots", (void**)&ps_list);
+        if (ps_list == NULL || !timercmp(&ps_list->ps_expire, now, <))
+            break;
+        pagination_snapshot_rm(h, ps_list);
+    }
+    if ((ps = ps_list) != NULL)
+        do {
+            n++;
+            ps = NEXTQ(pagination_snapshot *, ps);
+        } while (ps != ps_list);
+    return n;
+}
+
+/*! Set expiry time of snapshot and move it last, so that the first is least recently used
+ *
+ * @param[in]  h    Clixon handle
+ * @param[in]  ps   Snapshot, not in list if new
+ * @param[in]  now  Current time
+ * @param[in]  new  Snapshot is new and not yet in list
+ */
+static int
+pagination_snapshot_touch(clicon_handle        h,
+                          pagination_snapshot *ps,
+                          struct timeval      *now,
+                          int                  new)
+{
+    pagination_snapshot *ps_list = NULL;
+    struct timeval       t;
+
+    t.tv_sec = clicon_option_int(h, "CLICON_BACKEND_PAGINATION_CURSOR_TTL");
+    t.tv_usec = 0;
+    timeradd(now, &t, &ps->ps_expire);
+    clicon_ptr_get(h, "pagination-snapshots", (void**)&ps_list);
+    if (!new){
+        DELQ(ps, ps_list, pagination_snapshot *);
+    }
+    ADDQ(ps, ps_list);
+    return clicon_ptr_set(h, "pagination-snapshots", ps_list);
+}
+
+/*! Create a snapshot of the entries of a config list
+ *
+ * If the max number of snapshots is reached, the least recently used is removed.
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Datastore
+ * @param[in]  xpath    Canonical xpath of list
+ * @param[in]  nsc      Namespace context of xpath
+ * @param[in]  username User name
+ * @param[in]  wdef     With-defaults parameter, see RFC 6243
+ * @param[in]  now      Current time
+ * @param[out] psp      Snapshot
+ * @retval     1        OK
+ * @retval     0        Failed to read datastore, netconf error in cbret
+ * @retval    -1        Error
+ */
+static int
+pagination_snapshot_new(clicon_handle         h,
+                        char                 *db,
+                        char                 *xpath,
+                        cvec                 *nsc,
+                        char                 *username,
+                        withdefaults_type     wdef,
+                        struct timeval       *now,
+                        pagination_snapshot **psp,
+                        cbuf                 *cbret)
+{
+    int                  retval = -1;
+    pagination_snapshot *ps = NULL;
+    pagination_snapshot *ps_list = NULL;
+    static uint32_t      id = 0;
+    cbuf                *cbmsg = NULL;
+    uint32_t             max;
+
+    max = clicon_option_int(h, "CLICON_BACKEND_PAGINATION_CURSORS");
+    if (pagination_snapshots_purge(h, now) >= max){
+        clicon_ptr_get(h, "pagination-snapshots", (void**)&ps_list);
+        if (ps_list)
+            pagination_snapshot_rm(h, ps_list);
+    }
+    if ((ps = malloc(sizeof(*ps))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(ps, 0, sizeof(*ps));
+    ps->ps_id = ++id;
+    ps->ps_wdef = wdef;
+    ps->ps_nonce = random();
+    if ((ps->ps_db = strdup(db)) == NULL ||
+        (ps->ps_xpath = strdup(xpath)) == NULL ||
+        (username && (ps->ps_username = strdup(username)) == NULL)){
+        clicon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    if (xmldb_get0(h, db, YB_MODULE, nsc, xpath, 1, wdef, &ps->ps_xt, NULL, NULL) < 0) {
+        if ((cbmsg = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        cprintf(cbmsg, "Get %s datastore: %s", db, clicon_err_reason);
+        if (netconf_operation_failed(cbret, "application", cbuf_get(cbmsg)) < 0)
+            goto done;
+        goto fail;
+    }
+    if (xpath_vec(ps->ps_xt, nsc, "%s", &ps->ps_vec, &ps->ps_len, xpath) < 0)
+        goto done;
+    if (pagination_snapshot_touch(h, ps, now, 1) < 0)
+        goto done;
+    *psp = ps;
+    ps = NULL;
+    retval = 1;
+ done:
+    if (cbmsg)
+        cbuf_free(cbmsg);
+    if (ps)
+        pagination_snapshot_free(ps);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Find list pagination snapshot and position from cursor token
+ *
+ * @param[in]  h        Clixon handle
+ * @param[in]  cursor   Cursor token on the form <id>.<nonce>.<position>
+ * @param[in]  db       Datastore, must be same as snapshot
+ * @param[in]  xpath    Canonical xpath, must be same as snapshot
+ * @param[in]  username User name, must be same as snapshot
+ * @param[in]  wdef     With-defaults parameter, must be same as snapshot
+ * @param[out] psp      Snapshot, or NULL if not found, expired or not matching
+ * @param[out] pos      Position in snapshot
+ */
+static int
+pagination_snapshot_find(clicon_handle         h,
+                         char                 *cursor,
+                         char                 *db,
+                         char                 *xpath,
+                         char                 *username,
+                         withdefaults_type     wdef,
+                         pagination_snapshot **psp,
+                         size_t               *pos)
+{
+    pagination_snapshot *ps_list = NULL;
+    pagination_snapshot *ps;
+    uint32_t             id;
+    uint32_t             nonce;
+    int                  n = 0;
+
+    *psp = NULL;
+    if (sscanf(cursor, "%" SCNx32 ".%" SCNx32 ".%zu%n", &id, &nonce, pos, &n) != 3 ||
+        cursor[n] != '\0')
+        return 0;
+    clicon_ptr_get(h, "pagination-snapshots", (void**)&ps_list);
+    if ((ps = ps_list) != NULL)
+        do {
+            if (ps->ps_id == id){
+                if (ps->ps_nonce == nonce &&
+                    *pos <= ps->ps_len &&
+                    strcmp(ps->ps_db, db) == 0 &&
+                    strcmp(ps->ps_xpath, xpath) == 0 &&
+                    clicon_strcmp(ps->ps_username, username) == 0 &&
+                    ps->ps_wdef == wdef)
+                    *psp = ps;
+                break;
+            }
+            ps = NEXTQ(pagination_snapshot *, ps);
+        } while (ps && ps != ps_list);
+    return 0;
+}
+
+/*! Copy a list entry ancestor to a page without children except attributes and keys
+ *
+ * @param[in]  x0   Ancestor in snapshot
+ * @param[in]  xp1  Parent of copy
+ * @param[out] x1p  Copy
+ */
+static int
+pagination_ancestor_copy(cxobj  *x0,
+                         cxobj  *xp1,
+                         cxobj **x1p)
+{
+    int        retval = -1;
+    cxobj     *x1;
+    cxobj     *xc;
+    cxobj     *xc1;
+    yang_stmt *y;
+    int        ret;
+
+    if ((x1 = xml_new(xml_name(x0), xp1, CX_ELMNT)) == NULL)
+        goto done;
+    if (xml_copy_one(x0, x1) < 0)
+        goto done;
+    y = xml_spec(x0);
+    xc = NULL;
+    while ((xc = xml_child_each(x0, xc, -1)) != NULL){
+        if (xml_type(xc) == CX_BODY)
+            continue;
+        if (xml_type(xc) == CX_ELMNT){
+            if (y == NULL || yang_keyword_get(y) != Y_LIST)
+                continue;
+            if ((ret = yang_key_match(y, xml_name(xc), NULL)) < 0)
+                goto done;
+            if (ret == 0)
+                continue;
+        }
+        if ((xc1 = xml_new(xml_name(xc), x1, xml_type(xc))) == NULL)
+            goto done;
+        if (xml_copy(xc, xc1) < 0)
+            goto done;
+    }
+    *x1p = x1;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Copy a page of list entries from a snapshot with their ancestors
+ *
+ * @param[in]  ps     Snapshot
+ * @param[in]  pos    Position of first entry
+ * @param[in]  end    Position after last entry
+ * @param[out] xretp  Page with same top as datastore. Free with xml_free
+ */
+static int
+pagination_snapshot_page(pagination_snapshot *ps,
+                         size_t               pos,
+                         size_t               end,
+                         cxobj              **xretp)
+{
+    int     retval = -1;
+    cxobj  *xret = NULL;
+    cxobj **anc = NULL;  /* Ancestors of current entry in snapshot */
+    cxobj **src = NULL;  /* Ancestors of previous entry in snapshot */
+    cxobj **dst = NULL;  /* Copies of src in page */
+    int     depth = 0;
+    int     d;
+    int     d0;
+    size_t  i;
+    cxobj  *xp;
+    cxobj  *x1;
+
+    if ((xret = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (pos < end){
+        /* All entries of the list are on the same depth */
+        for (xp = xml_parent(ps->ps_vec[pos]); xp && xp != ps->ps_xt; xp = xml_parent(xp))
+            depth++;
+        if ((anc = calloc(depth+1, sizeof(cxobj *))) == NULL ||
+            (src = calloc(depth+1, sizeof(cxobj *))) == NULL ||
+            (dst = calloc(depth+1, sizeof(cxobj *))) == NULL){
+            clicon_err(OE_UNIX, errno, "calloc");
+            goto done;
+        }
+    }
+    for (i = pos; i < end; i++){
+        xp = xml_parent(ps->ps_vec[i]);
+        for (d = depth-1; d >= 0; d--){
+            anc[d] = xp;
+            xp = xml_parent(xp);
+        }
+        /* Reuse ancestors copied for previous entry */
+        for (d0 = 0; d0 < depth && anc[d0] == src[d0]; d0++);
+        for (d = d0; d < depth; d++){
+            if (pagination_ancestor_copy(anc[d], d?dst[d-1]:xret, &dst[d]) < 0)
+                goto done;
+            src[d] = anc[d];
+        }
+        if ((x1 = xml_new(xml_name(ps->ps_vec[i]), depth?dst[depth-1]:xret, CX_ELMNT)) == NULL)
+            goto done;
+        if (xml_copy(ps->ps_vec[i], x1) < 0)
+            goto done;
+    }
+    *xretp = xret;
+    xret = NULL;
+    retval = 0;
+ done:
+    if (anc)
+        free(anc);
+    if (src)
+        free(src);
+    if (dst)
+        free(dst);
+    if (xret)
+        xml_free(xret);
+    return retval;
+}
+
+/*! Get a page of a config list using a snapshot referenced by a cursor token
+ *
+ * An empty cursor creates a new snapshot of the list, otherwise the cursor references an
+ * existing snapshot and a position. Offset entries are skipped from the position.
+ * If there are more entries after the page, a cursor to the next page is returned, otherwise
+ * the snapshot is removed.
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Datastore
+ * @param[in]  xpath    Canonical xpath of list
+ * @param[in]  nsc      Namespace context of xpath
+ * @param[in]  username User name
+ * @param[in]  wdef     With-defaults parameter, see RFC 6243
+ * @param[in]  cursor   Cursor token, or "" for new snapshot
+ * @param[in]  offset   Number of entries to skip
+ * @param[in]  limit    Max number of entries, 0 means unbounded
+ * @param[out] xretp    Page, free with xml_free
+ * @param[out] cbnext   Next cursor token, empty if last page
+ * @param[out] cbret    Netconf error message if invalid
+ * @retval     1        OK
+ * @retval     0        Invalid cursor or failed to read datastore, netconf error in cbret
+ * @retval    -1        Error
+ */
+static int
+pagination_cursor_get(clicon_handle     h,
+                      char             *db,
+                      char             *xpath,
+                      cvec             *nsc,
+                      char             *username,
+                      withdefaults_type wdef,
+                      char             *cursor,
+                      uint32_t          offset,
+                      uint32_t          limit,
+                      cxobj           **xretp,
+                      cbuf             *cbnext,
+                      cbuf             *cbret)
+{
+    int                  retval = -1;
+    pagination_snapshot *ps = NULL;
+    size_t               pos = 0;
+    size_t               end;
+    struct timeval       now;
+    int                  ret;
+
+    if (clicon_option_int(h, "CLICON_BACKEND_PAGINATION_CURSORS") == 0){
+        if (netconf_invalid_value(cbret, "application", "Cursor-based list pagination is disabled") < 0)
+            goto done;
+        goto fail;
+    }
+    gettimeofday(&now, NULL);
+    if (strlen(cursor) == 0){
+        if ((ret = pagination_snapshot_new(h, db, xpath, nsc, username, wdef, &now, &ps, cbret)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+    }
+    else {
+        pagination_snapshots_purge(h, &now);
+        if (pagination_snapshot_find(h, cursor, db, xpath, username, wdef, &ps, &pos) < 0)
+            goto done;
+        if (ps == NULL){
+            if (netconf_invalid_value(cbret, "application", "List pagination cursor not found or expired") < 0)
+                goto done;
+            goto fail;
+        }
+        if (pagination_snapshot_touch(h, ps, &now, 0) < 0)
+            goto done;
+    }
+    pos = (offset < ps->ps_len - pos) ? pos + offset : ps->ps_len;
+    end = (limit && limit < ps->ps_len - pos) ? pos + limit : ps->ps_len;
+    if (pagination_snapshot_page(ps, pos, end, xretp) < 0)
+        goto done;
+    if (end < ps->ps_len)
+        cprintf(cbnext, "%" PRIx32 ".%" PRIx32 ".%zu", ps->ps_id, ps->ps_nonce, end);
+    else
+        pagination_snapshot_rm(h, ps);
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Free all list pagination snapshots
+ *
+ * @param[in]  h      Clixon handle
+ */
+int
+get_pagination_snapshots_free(clicon_handle h)
+{
+    pagination_snapshot *ps_list = NULL;
+    pagination_snapshot *ps;
+
+    clicon_ptr_get(h, "pagination-snapshots", (void**)&ps_list);
+    while ((ps = ps_list) != NULL){
+        DELQ(ps, ps_list, pagination_snapshot *);
+        pagination_snapshot_free(ps);
+    }
+    clicon_ptr_del(h, "pagination-snapshots");
+    return 0;
+}
+
 /*! Specialized get for list-pagination
  *
  * It is specialized enough to have its own function. Specifically, extra attributes as well
@@ -563,6 +1052,7 @@ list_pagination_hdr(clicon_handle h,
  * @param[in]  nsc     Namespace context of xpath
  * @param[in]  username
  * @param[in]  wdef   With-defaults parameter, see RFC 6243
+ * @param[in]  cursor Cursor token of config list snapshot, "" for new snapshot, or NULL
  * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error.. 
  * @retval     0       OK
  * @retval    -1       Error
@@ -582,6 +1072,7 @@ get_list_pagination(clicon_handle        h,
                     cvec                *nsc,
                     char                *username,
                     withdefaults_type    wdef,
+                    char                *cursor,
                     cbuf                *cbret
                     )
 {
@@ -601,6 +1092,8 @@ get_list_pagination(clicon_handle        h,
     cbuf           *cberr = NULL; 
     cxobj         **xvec = NULL;
     size_t          xlen;
+    state_cursor_stream *streams = NULL;
+    cbuf           *cbnext = NULL; /* Next cursor token */
 #ifdef NOTYET
     cxobj          *x;
     char           *direction = NULL;
@@ -646,6 +1139,13 @@ get_list_pagination(clicon_handle        h,
                 goto done;
             goto ok;
         }
+        /* A new snapshot is not created for state lists, and no next cursor is returned */
+        if (cursor != NULL && strlen(cursor)){
+            if (netconf_invalid_value(cbret, "application", "list-pagination cursor is only supported for config lists") < 0)
+                goto done;
+            goto ok;
+        }
+        cursor = NULL;
     }
     if ((ret = list_pagination_hdr(h, xe, &offset, &limit, cbret)) < 0)
         goto done;
@@ -676,6 +1176,19 @@ get_list_pagination(clicon_handle        h,
     switch (content){
     case CONTENT_CONFIG:    /* config data only */
     case CONTENT_ALL:       /* both config and state */
+        if (cursor != NULL){ /* Page of config list snapshot */
+            if ((cbnext = cbuf_new()) == NULL){
+                clicon_err(OE_UNIX, errno, "cbuf_new");
+                goto done;
+            }
+            if ((ret = pagination_cursor_get(h, db, xpath?xpath:"/", nsc, username, wdef,
+                                             cursor, offset, limit,
+                                             &xret, cbnext, cbret)) < 0)
+                goto done;
+            if (ret == 0)
+                goto ok;
+            break;
+        }
         /* Build a "predicate" cbuf 
          * This solution uses xpath predicates to translate "limit" and "offset" to
          * relational operators <>.
@@ -722,6 +1235,11 @@ get_list_pagination(clicon_handle        h,
         break;
     }/* switch content */
 
+    /* State list of cursor provider is streamed, skipping offset entries */
+    if (!list_config && ce != NULL &&
+        clicon_option_int(h, "CLICON_BACKEND_REPLY_CHUNK") > 0 &&
+        clixon_state_cursor_select(h, yspec, nsc, xpath, wdef, offset, limit, &streams) < 0)
+        goto done;
     if (list_config){
 #ifdef LIST_PAGINATION_REMAINING
         /* Get total/remaining
@@ -735,7 +1253,7 @@ get_list_pagination(clicon_handle        h,
         }
 #endif
     }
-    else {/* Check if running locked (by this session) */
+    else if (streams == NULL){ /* Check if running locked (by this session) */
         if ((iddb = xmldb_islocked(h, "running")) != 0 &&
             iddb == ce->ce_id)
             locked = 1;
@@ -799,7 +1317,8 @@ get_list_pagination(clicon_handle        h,
             cbuf_free(cba);
     }
 #endif /* LIST_PAGINATION_REMAINING */
-    if (get_nacm_and_reply(h, xret, xvec, xlen, xpath, nsc, username, depth, cbret) < 0)
+    if (get_nacm_and_reply(h, ce, &xret, xvec, xlen, xpath, nsc, username, depth, &streams,
+                           cbnext && cbuf_len(cbnext) ? cbuf_get(cbnext) : NULL, cbret) < 0)
         goto done;
  ok:
     retval = 0;
@@ -814,11 +1333,174 @@ get_list_pagination(clicon_handle        h,
         xml_free(xerr);
     if (cberr)
         cbuf_free(cberr);
+    if (cbnext)
+        cbuf_free(cbnext);
     if (xret)
         xml_free(xret);
+    if (streams)
+        clixon_state_cursor_streams_free(streams);
     return retval;
 }
 
+/*! Get generation of the config data of a get request
+ *
+ * The generation is the one of the top-level subtree selected by the xpath, or of the
+ * whole datastore if the xpath may select more than one top-level subtree.
+ * If NACM is enabled, a change of the NACM rules in the running datastore may change the
+ * result as well, therefore the most recent of the two generations is used.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Datastore
+ * @param[in]  xpath Canonical xpath, or NULL
+ * @param[in]  nsc   Namespace context of xpath
+ * @param[out] gen   Generation
+ * @param[out] tv    Time of last change
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xmldb_generation_get
+ */
+static int
+get_generation(clicon_handle   h,
+               char           *db,
+               char           *xpath,
+               cvec           *nsc,
+               uint64_t       *gen,
+               struct timeval *tv)
+{
+    int            retval = -1;
+    cbuf          *cb = NULL;
+    char          *step = NULL;
+    char          *name;
+    char          *prefix = NULL;
+    char          *ns;
+    size_t         len;
+    uint64_t       gen1;
+    struct timeval tv1;
+    char          *mode;
+
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    /* First step of a single location path, eg /ex:table/ex:parameter[ex:name='x'] */
+    if (xpath && xpath[0] == '/' && strchr(xpath, '|') == NULL){
+        len = strcspn(xpath+1, "/[");
+        if ((step = strndup(xpath+1, len)) == NULL){
+            clicon_err(OE_UNIX, errno, "strndup");
+            goto done;
+        }
+        if ((name = strchr(step, ':')) != NULL){
+            *name++ = '\0';
+            prefix = step;
+        }
+        else
+            name = step;
+        if (strlen(name) && strcmp(name, "*") != 0 &&
+            (ns = xml_nsctx_get(nsc, prefix)) != NULL)
+            cprintf(cb, "{%s}%s", ns, name);
+    }
+    if (xmldb_generation_get(h, db, cbuf_len(cb)?cbuf_get(cb):NULL, gen, tv) < 0)
+        goto done;
+    if ((mode = clicon_option_str(h, "CLICON_NACM_MODE")) != NULL &&
+        strcmp(mode, "disabled") != 0){
+        if (xmldb_generation_get(h, "running",
+                                 "{urn:ietf:params:xml:ns:yang:ietf-netconf-acm}nacm",
+                                 &gen1, &tv1) < 0)
+            goto done;
+        if (gen1 > *gen){
+            *gen = gen1;
+            *tv = tv1;
+        }
+    }
+    retval = 0;
+ done:
+    if (step)
+        free(step);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Conditional get of config data using datastore generations, clixon extension
+ *
+ * The request has the attribute if-generation with the generation of the data the client
+ * has, or if-modified-since with a timestamp. If the data is not modified the reply
+ * contains no data but the attribute not-modified.
+ * The generation and time of last change are always returned as attributes of data.
+ * @param[in]  h     Clicon handle
+ * @param[in]  xe    Request: <rpc><xn></rpc> 
+ * @param[in]  db    Datastore
+ * @param[in]  xpath Canonical xpath, or NULL
+ * @param[in]  nsc   Namespace context of xpath
+ * @param[out] gen   Generation
+ * @param[out] tv    Time of last change
+ * @param[out] cbret Return xml tree if not modified or error
+ * @retval     1     OK, data is modified
+ * @retval     0     Not modified or invalid attribute, reply in cbret
+ * @retval    -1     Error
+ */
+static int
+get_conditional(clicon_handle   h,
+                cxobj          *xe,
+                char           *db,
+                char           *xpath,
+                cvec           *nsc,
+                uint64_t       *gen,
+                struct timeval *tv,
+                cbuf           *cbret)
+{
+    int            retval = -1;
+    char          *attr;
+    uint64_t       ifgen = 0;
+    struct timeval ifsince = {0,};
+    char          *reason = NULL;
+    int            ret;
+    char           timestr[28];
+
+    if (get_generation(h, db, xpath, nsc, gen, tv) < 0)
+        goto done;
+    if ((attr = xml_find_value(xe, "if-generation")) != NULL){
+        if ((ret = parse_uint64(attr, &ifgen, &reason)) < 0){
+            clicon_err(OE_XML, errno, "parse_uint64");
+            goto done;
+        }
+        if (ret == 0){
+            if (netconf_bad_attribute(cbret, "application",
+                                      "if-generation", "Unrecognized value of if-generation attribute") < 0)
+                goto done;
+            goto fail;
+        }
+    }
+    else if ((attr = xml_find_value(xe, "if-modified-since")) != NULL &&
+             str2time(attr, &ifsince) < 0){
+        if (netconf_bad_attribute(cbret, "application",
+                                  "if-modified-since", "Unrecognized value of if-modified-since attribute") < 0)
+            goto done;
+        goto fail;
+    }
+    /* HTTP dates have a resolution of seconds */
+    if (ifgen ? ifgen == *gen : (ifsince.tv_sec != 0 && tv->tv_sec <= ifsince.tv_sec)){
+        if (time2str(*tv, timestr, sizeof(timestr)) < 0){
+            clicon_err(OE_UNIX, errno, "time2str");
+            goto done;
+        }
+        cprintf(cbret, "<rpc-reply xmlns=\"%s\"><%s %s:generation=\"%" PRIu64 "\" %s:last-modified=\"%s\" %s:not-modified=\"true\" xmlns:%s=\"%s\"/></rpc-reply>",
+                NETCONF_BASE_NAMESPACE, NETCONF_OUTPUT_DATA,
+                CLIXON_LIB_PREFIX, *gen,
+                CLIXON_LIB_PREFIX, timestr,
+                CLIXON_LIB_PREFIX,
+                CLIXON_LIB_PREFIX, CLIXON_LIB_NS);
+        goto fail;
+    }
+    retval = 1;
+ done:
+    if (reason)
+        free(reason);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Common get/get-config code for retrieving  configuration and state information.
  *
  * @param[in]  h       Clicon handle 
@@ -865,6 +1547,13 @@ get_common(clicon_handle        h,
     uint32_t        limit = 0;
     withdefaults_type wdef;
     char             *wdefstr;
+    state_cursor_stream *streams = NULL;
+    char             *cursor = NULL;
+    int               conditional = 0;
+    uint64_t          gen = 0;
+    struct timeval    tv = {0,};
+    char              timestr[28];
+    char              genstr[24];
 
 #ifdef NETCONF_DEFAULT_RETRIEVAL_REPORT_ALL
     /* Clixon 6.0 backward compatibly for NETCONF get/get-config behavior */
@@ -927,7 +1616,9 @@ get_common(clicon_handle        h,
             goto done;
         if (ret == 0)
             goto ok;
-        list_pagination = (offset != 0 || limit != 0);
+        /* Clixon extension: cursor token referencing a config list snapshot */
+        cursor = xml_find_value(xe, "cursor");
+        list_pagination = (offset != 0 || limit != 0 || cursor != NULL);
     }
     /* Sanity check for list pagination: path must be a list/leaf-list, if it is,
      * check config/state
@@ -937,10 +1628,20 @@ get_common(clicon_handle        h,
                                 xfind,
                                 content, db,
                                 depth, yspec, xpath, nsc, username, wdef,
-                                cbret) < 0)
+                                cursor, cbret) < 0)
             goto done;
         goto ok;
     }
+    /* Clixon extension: conditional get of config data, see get_conditional */
+    if (content == CONTENT_CONFIG &&
+        (xml_find_value(xe, "if-generation") != NULL ||
+         xml_find_value(xe, "if-modified-since") != NULL)){
+        if ((ret = get_conditional(h, xe, db, xpath, nsc, &gen, &tv, cbret)) < 0)
+            goto done;
+        if (ret == 0) /* Not modified */
+            goto ok;
+        conditional++;
+    }
     /* Read configuration */
     switch (content){
     case CONTENT_CONFIG:    /* config data only */
@@ -998,6 +1699,12 @@ get_common(clicon_handle        h,
         break;
     case CONTENT_ALL:       /* both config and state */
     case CONTENT_NONCONFIG: /* state data only */
+        /* Large state lists of cursor providers are streamed in a chunked reply */
+        if (ce != NULL &&
+            clicon_option_int(h, "CLICON_BACKEND_REPLY_CHUNK") > 0 &&
+            !clicon_option_bool(h, "CLICON_VALIDATE_STATE_XML") &&
+            clixon_state_cursor_select(h, yspec, nsc, xpath, wdef, 0, 0, &streams) < 0)
+            goto done;
         if ((ret = get_statedata(h, xpath?xpath:"/", nsc, wdef, &xret)) < 0)
             goto done;
         if (ret == 0){ /* Error from callback (error in xret) */
@@ -1045,7 +1752,19 @@ get_common(clicon_handle        h,
         goto done;
     if (filter_xpath_again(h, yspec, xret, xvec, xlen, xpath, nsc) < 0)
         goto done;
-    if (get_nacm_and_reply(h, xret, xvec, xlen, xpath, nsc, username, depth, cbret) < 0)
+    /* Generation and time of last change as attributes of data */
+    if (conditional && xret){
+        if (time2str(tv, timestr, sizeof(timestr)) < 0){
+            clicon_err(OE_UNIX, errno, "time2str");
+            goto done;
+        }
+        snprintf(genstr, sizeof(genstr), "%" PRIu64, gen);
+        if (xml_add_attr(xret, "generation", genstr, CLIXON_LIB_PREFIX, CLIXON_LIB_NS) < 0)
+            goto done;
+        if (xml_add_attr(xret, "last-modified", timestr, CLIXON_LIB_PREFIX, NULL) < 0)
+            goto done;
+    }
+    if (get_nacm_and_reply(h, ce, &xret, xvec, xlen, xpath, nsc, username, depth, &streams, NULL, cbret) < 0)
         goto done;
  ok:
     retval = 0;
@@ -1069,6 +1788,8 @@ get_common(clicon_handle        h,
         xml_free(xerr);
     if (xpath)
         free(xpath);
+    if (streams)
+        clixon_state_cursor_streams_free(streams);
     return retval;
 }
 
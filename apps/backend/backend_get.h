@@ -43,5 +43,6 @@
 int from_client_get_config(clicon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg);
 int from_client_get(clicon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg);
 int from_client_get_pageable_list(clicon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg); /* XXX */
+int get_pagination_snapshots_free(clicon_handle h);
 
 #endif  /* _BACKEND_GET_H_ */
@@ -75,6 +75,7 @@
 #include "clixon_backend_plugin.h"
 #include "clixon_backend_commit.h"
 #include "backend_handle.h"
+#include "backend_get.h"
 #include "backend_startup.h"
 #include "backend_plugin_restconf.h"
 
@@ -98,6 +99,7 @@ backend_terminate(clicon_handle h)
     struct stat st;
     int        ss;
     cvec      *nsctx;
+    struct client_entry *ce;
 
     clicon_debug(1, "%s", __FUNCTION__);
     if ((ss = clicon_socket_get(h)) != -1)
@@ -123,10 +125,17 @@ backend_terminate(clicon_handle h)
         cvec_free(nsctx);
     if ((x = clicon_nacm_ext(h)) != NULL)
         xml_free(x);
+    nacm_policy_free(h);
     if ((x = clicon_conf_xml(h)) != NULL)
         xml_free(x);
     confirmed_commit_free(h);
     stream_publish_exit();
+    /* Close state lists being streamed to clients while plugins are loaded */
+    for (ce = backend_client_list(h); ce; ce = ce->ce_next)
+        if (ce->ce_cursors){
+            clixon_state_cursor_streams_free(ce->ce_cursors);
+            ce->ce_cursors = NULL;
+        }
     /* Delete all plugins, RPC callbacks, and upgrade callbacks */
     clixon_plugin_module_exit(h);
     /* Delete all process-control entries */
@@ -134,6 +143,9 @@ backend_terminate(clicon_handle h)
 
     xpath_optimize_exit();
     clixon_pagination_free(h);
+    clixon_statedata_providers_free(h);
+    clixon_state_cursors_free(h);
+    get_pagination_snapshots_free(h);
     
     if (pidfile)
         unlink(pidfile);   
@@ -44,6 +44,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <inttypes.h>
 #include <dlfcn.h>
 #include <unistd.h>
 #include <errno.h>
@@ -51,6 +52,7 @@
 #include <syslog.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <sys/param.h>
 #include <netinet/in.h>
 
@@ -313,9 +315,739 @@ clixon_plugin_statedata_one(clixon_plugin_t *cp,
     goto done;
 }
 
+/* State data provider registered on a schema path
+ * @see clixon_statedata_cb_register
+ */
+struct statedata_provider{
+    qelem_t                sp_q;
+    char                  *sp_path;     /* Registered path, eg /module:container/list */
+    clixon_path           *sp_cplist;   /* Path resolved to YANG (on first use) */
+    int                    sp_resolved; /* 0: not yet, 1: resolved, -1: no such YANG */
+    clixon_statedata_cb_t *sp_fn;       /* Provider callback */
+    void                  *sp_arg;      /* Callback argument */
+    uint32_t               sp_ttl;      /* Cache time-to-live in ms, 0: no cache */
+    cxobj                 *sp_cache;    /* Cached YANG bound and sorted state, <config> */
+    struct timeval         sp_expire;   /* Time when cache expires */
+    uint64_t               sp_hits;     /* Requests served from cache */
+    uint64_t               sp_misses;   /* Requests calling provider with cache enabled */
+};
+typedef struct statedata_provider statedata_provider;
+
+/*! Skip single-child xpath-tree nodes until a node of a given type
+ *
+ * @param[in]  xs    XPath tree
+ * @param[in]  type  XPath tree node type
+ * @retval     xs    Node of type
+ * @retval     NULL  Not found, or a node with an operator or second child on the way
+ */
+static xpath_tree *
+statedata_xpath_unwrap(xpath_tree  *xs,
+                       enum xp_type type)
+{
+    while (xs && xs->xs_type != type){
+        switch (xs->xs_type){
+        case XP_EXP:
+        case XP_AND:
+        case XP_RELEX:
+        case XP_ADD:
+        case XP_UNION:
+        case XP_PATHEXPR:
+        case XP_LOCPATH:
+        case XP_FILTEREXPR:
+            if (xs->xs_c1 != NULL)
+                return NULL;
+            xs = xs->xs_c0;
+            break;
+        default:
+            return NULL;
+        }
+    }
+    return xs;
+}
+
+/*! Check that an xpath step is a child node test, with key predicates if keys is set
+ *
+ * A key predicate is [prefix:name='value']
+ * @param[in]  xs    XPath tree of type XP_STEP
+ * @param[in]  keys  Allow key predicates
+ * @retval     1     Simple step
+ * @retval     0     Not simple step
+ */
+static int
+statedata_xpath_step(xpath_tree *xs,
+                     int         keys)
+{
+    xpath_tree *xp;
+    xpath_tree *xe;
+    xpath_tree *xk;
+
+    if (xs == NULL || xs->xs_type != XP_STEP || xs->xs_int != A_CHILD)
+        return 0;
+    if ((xp = xs->xs_c0) == NULL || xp->xs_type != XP_NODE ||
+        xp->xs_s1 == NULL || strcmp(xp->xs_s1, "*") == 0)
+        return 0;
+    /* Predicates are a left-recursive list, c0 is previous, c1 is expression */
+    for (xp = xs->xs_c1; xp != NULL; xp = xp->xs_c0){
+        if (xp->xs_type != XP_PRED)
+            return 0;
+        if (xp->xs_c1 == NULL)
+            continue;
+        if (!keys)
+            return 0;
+        if ((xe = statedata_xpath_unwrap(xp->xs_c1, XP_RELEX)) == NULL ||
+            xe->xs_int != XO_EQ || xe->xs_c1 == NULL)
+            return 0;
+        if ((xk = statedata_xpath_unwrap(xe->xs_c0, XP_RELLOCPATH)) == NULL ||
+            xk->xs_c1 != NULL || !statedata_xpath_step(xk->xs_c0, 0))
+            return 0;
+        if (statedata_xpath_unwrap(xe->xs_c1, XP_PRIME_STR) == NULL)
+            return 0;
+    }
+    return 1;
+}
+
+/*! Parse and resolve a request xpath if it is a simple path with optional key predicates
+ *
+ * Accepts xpaths on the form /p:a/p:b[p:k='v']/p:c, which is what RESTCONF and most
+ * NETCONF requests for specific data use. The xpath is checked with the xpath parser and
+ * then parsed and resolved as an instance-identifier, with key values in cp_cvk.
+ * @param[in]  yspec   YANG spec
+ * @param[in]  xpath   Canonical xpath, ie prefixes are YANG module prefixes
+ * @param[out] cplistp Resolved path, free with clixon_path_free
+ * @retval     1       OK, cplistp set (NULL if path is /)
+ * @retval     0       Not a simple path or not resolvable
+ * @retval    -1       Error
+ * @see xpath2canonical
+ */
+static int
+statedata_path_parse(yang_stmt    *yspec,
+                     char         *xpath,
+                     clixon_path **cplistp)
+{
+    int          retval = -1;
+    xpath_tree  *xpt = NULL;
+    xpath_tree  *xs;
+    xpath_tree  *xr;
+    int          ret;
+
+    if (xpath_parse(xpath, &xpt) < 0)
+        goto done;
+    if ((xs = statedata_xpath_unwrap(xpt, XP_ABSPATH)) == NULL || xs->xs_int != A_ROOT)
+        goto fail;
+    if (xs->xs_c0 == NULL){ /* / */
+        *cplistp = NULL;
+        goto ok;
+    }
+    /* Relative location path is left-recursive, c0 is previous, c1 is last step */
+    for (xr = xs->xs_c0; xr->xs_c1 != NULL; xr = xr->xs_c0)
+        if (xr->xs_type != XP_RELLOCPATH || xr->xs_int != A_NAN ||
+            !statedata_xpath_step(xr->xs_c1, 1))
+            goto fail;
+    if (xr->xs_type != XP_RELLOCPATH || !statedata_xpath_step(xr->xs_c0, 1))
+        goto fail;
+    if ((ret = clixon_instance_id_parse(yspec, cplistp, NULL, "%s", xpath)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+ ok:
+    retval = 1;
+ done:
+    if (xpt)
+        xpath_tree_free(xpt);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Resolve a registered schema path with module names as prefixes
+ *
+ * The path is translated to an xpath with YANG prefixes as a RESTCONF api-path and then
+ * parsed and resolved as an instance-identifier.
+ * @param[in]  yspec   YANG spec
+ * @param[in]  path    Schema path, eg /ietf-interfaces:interfaces/interface
+ * @param[out] cplistp Resolved path, free with clixon_path_free
+ * @retval     1       OK, cplistp set (NULL if path is /)
+ * @retval     0       Not resolvable, eg module not loaded
+ * @retval    -1       Error
+ */
+static int
+statedata_path_resolve(yang_stmt    *yspec,
+                       char         *path,
+                       clixon_path **cplistp)
+{
+    int   retval = -1;
+    char *xpath = NULL;
+    int   ret;
+
+    if (strcmp(path, "/") == 0){
+        *cplistp = NULL;
+        goto ok;
+    }
+    if ((ret = api_path2xpath(path, yspec, &xpath, NULL, NULL)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+    if ((ret = clixon_instance_id_parse(yspec, cplistp, NULL, "%s", xpath)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+ ok:
+    retval = 1;
+ done:
+    if (xpath)
+        free(xpath);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Check if two resolved paths intersect, ie one is a prefix of the other
+ *
+ * Keys are not compared, a provider path has no keys
+ */
+static int
+statedata_path_intersect(clixon_path *cplist1,
+                         clixon_path *cplist2)
+{
+    clixon_path *cp1 = cplist1;
+    clixon_path *cp2 = cplist2;
+
+    while (cp1 && cp2){
+        if (cp1->cp_yang != cp2->cp_yang)
+            return 0;
+        cp1 = NEXTQ(clixon_path *, cp1);
+        cp2 = NEXTQ(clixon_path *, cp2);
+        if (cp1 == cplist1 || cp2 == cplist2)
+            break;
+    }
+    return 1;
+}
+
+/*! Bind and sort state data tree from one plugin or provider
+ *
+ * @param[in]     h       clicon handle
+ * @param[in]     yspec   Yang spec
+ * @param[in]     name    Name of plugin or provider for error messages
+ * @param[in]     x       State data tree, <config>...
+ * @param[in,out] xret    Replaced with netconf-error if invalid
+ * @retval       -1       Error
+ * @retval        0       Invalid state data (xret set with netconf-error)
+ * @retval        1       OK
+ */
+static int
+statedata_bind(clicon_handle h,
+               yang_stmt    *yspec,
+               char         *name,
+               cxobj        *x,
+               cxobj       **xret)
+{
+    int    retval = -1;
+    int    ret;
+    cxobj *xerr = NULL;
+
+    clicon_debug_xml(CLIXON_DBG_DETAIL, x, "%s %s STATE:", __FUNCTION__, name);
+    /* XXX: ret == 0 invalid yang binding should be handled as internal error */
+    if ((ret = xml_bind_yang(h, x, YB_MODULE, yspec, &xerr)) < 0)
+        goto done;
+    if (ret == 0){
+        if (clixon_netconf_internal_error(xerr,
+                                          ". Internal error, state callback returned invalid XML from plugin: ",
+                                          name) < 0)
+            goto done;
+        xml_free(*xret);
+        *xret = xerr;
+        xerr = NULL;
+        goto fail;
+    }
+    if (xml_sort_recurse(x) < 0)
+        goto done;
+    /* Remove global defaults and empty non-presence containers */
+    /* XXX: only for state data and according to with-defaults setting */
+    if (xml_defaults_nopresence(x, 2) < 0)
+        goto done;
+    retval = 1;
+ done:
+    if (xerr)
+        xml_free(xerr);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Bind, sort and merge state data tree from one plugin or provider into result
+ *
+ * @param[in]     h       clicon handle
+ * @param[in]     yspec   Yang spec
+ * @param[in]     name    Name of plugin or provider for error messages
+ * @param[in]     x       State data tree, <config>...
+ * @param[in,out] xret    State XML tree is merged with existing tree.
+ * @retval       -1       Error
+ * @retval        0       Invalid state data (xret set with netconf-error)
+ * @retval        1       OK
+ */
+static int
+statedata_merge(clicon_handle h,
+                yang_stmt    *yspec,
+                char         *name,
+                cxobj        *x,
+                cxobj       **xret)
+{
+    int    ret;
+
+    if (xml_child_nr(x) == 0)
+        return 1;
+    if ((ret = statedata_bind(h, yspec, name, x, xret)) < 1)
+        return ret;
+    return netconf_trymerge(x, yspec, xret);
+}
+
+/*! State callback failed, replace result with internal error
+ * @param[in]     name    Name of plugin or provider
+ * @param[in,out] xret    Replaced with netconf-error
+ */
+static int
+statedata_fail(char   *name,
+               cxobj **xret)
+{
+    int    retval = -1;
+    cbuf  *cberr = NULL; 
+    cxobj *xerr = NULL;
+
+    if ((cberr = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    /* error reason should be in clicon_err_reason */
+    cprintf(cberr, "Internal error, state callback in plugin %s returned invalid XML: %s",
+            name, clicon_err_reason);
+    if (netconf_operation_failed_xml(&xerr, "application", cbuf_get(cberr)) < 0)
+        goto done;
+    xml_free(*xret);
+    *xret = xerr;
+    retval = 0;
+ done:
+    if (cberr)
+        cbuf_free(cberr);
+    return retval;
+}
+
+/*! Get state of a provider with cache enabled, merge into result
+ *
+ * If the cache has expired, the provider is called for all its data (no filter), and the
+ * YANG bound and sorted result is kept. A copy of it is merged into the result.
+ * @param[in]     h       clicon handle
+ * @param[in]     yspec   Yang spec
+ * @param[in]     sp      State data provider
+ * @param[in]     nsc     Namespace context
+ * @param[in,out] xret    State XML tree is merged with existing tree.
+ * @retval       -1       Error
+ * @retval        0       Statedata callback failed (xret set with netconf-error)
+ * @retval        1       OK
+ */
+static int
+statedata_provider_cached(clicon_handle       h,
+                          yang_stmt          *yspec,
+                          statedata_provider *sp,
+                          cvec               *nsc,
+                          cxobj             **xret)
+{
+    int            retval = -1;
+    cxobj         *x = NULL;
+    struct timeval now;
+    struct timeval t;
+    int            ret;
+
+    gettimeofday(&now, NULL);
+    if (sp->sp_cache != NULL && timercmp(&now, &sp->sp_expire, <))
+        sp->sp_hits++;
+    else {
+        sp->sp_misses++;
+        if (sp->sp_cache){
+            xml_free(sp->sp_cache);
+            sp->sp_cache = NULL;
+        }
+        if ((x = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if (sp->sp_fn(h, NULL, nsc, NULL, x, sp->sp_arg) < 0){
+            if (clicon_errno < 0) 
+                clicon_log(LOG_WARNING, "%s: Internal error: State provider %s returned -1 but did not make a clicon_err call",
+                           __FUNCTION__, sp->sp_path);
+            if (statedata_fail(sp->sp_path, xret) < 0)
+                goto done;
+            goto fail;
+        }
+        if (xml_child_nr(x) && (ret = statedata_bind(h, yspec, sp->sp_path, x, xret)) < 1){
+            retval = ret;
+            goto done;
+        }
+        sp->sp_cache = x;
+        x = NULL;
+        t.tv_sec = sp->sp_ttl / 1000;
+        t.tv_usec = (sp->sp_ttl % 1000) * 1000;
+        timeradd(&now, &t, &sp->sp_expire);
+    }
+    if (xml_child_nr(sp->sp_cache) == 0)
+        goto ok;
+    /* Merge moves nodes, so merge a copy */
+    if ((x = xml_dup(sp->sp_cache)) == NULL)
+        goto done;
+    if ((ret = netconf_trymerge(x, yspec, xret)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+ ok:
+    retval = 1;
+ done:
+    if (x)
+        xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Call state data providers whose registered path intersects the request
+ *
+ * @param[in]     h       clicon handle
+ * @param[in]     yspec   Yang spec
+ * @param[in]     nsc     Namespace context
+ * @param[in]     xpath   String with XPATH syntax. or NULL for all
+ * @param[in,out] xret    State XML tree is merged with existing tree.
+ * @retval       -1       Error
+ * @retval        0       Statedata callback failed (xret set with netconf-error)
+ * @retval        1       OK
+ */
+static int
+clixon_statedata_providers_call(clicon_handle h,
+                                yang_stmt    *yspec,
+                                cvec         *nsc,
+                                char         *xpath,
+                                cxobj       **xret)
+{
+    int                 retval = -1;
+    statedata_provider *sp_list = NULL;
+    statedata_provider *sp;
+    clixon_path        *filter = NULL;
+    cxobj              *x = NULL;
+    int                 ret;
+    
+    if (clicon_ptr_get(h, "statedata-providers", (void**)&sp_list) < 0 || sp_list == NULL)
+        goto ok;
+    /* Request path with keys, or NULL if not a simple path: call all providers */
+    if (xpath && statedata_path_parse(yspec, xpath, &filter) < 0)
+        goto done;
+    sp = sp_list;
+    do {
+        if (sp->sp_resolved == 0){
+            if ((ret = statedata_path_resolve(yspec, sp->sp_path, &sp->sp_cplist)) < 0)
+                goto done;
+            sp->sp_resolved = ret?1:-1;
+            if (ret == 0) /* Eg module not loaded */
+                clicon_debug(CLIXON_DBG_DEFAULT, "%s: State data provider path %s does not match YANG, ignored",
+                             __FUNCTION__, sp->sp_path);
+        }
+        if (sp->sp_resolved < 0)
+            goto next;
+        if (filter && !statedata_path_intersect(filter, sp->sp_cplist))
+            goto next;
+        clicon_debug(CLIXON_DBG_DETAIL, "%s %s", __FUNCTION__, sp->sp_path);
+        if (sp->sp_ttl){
+            if ((ret = statedata_provider_cached(h, yspec, sp, nsc, xret)) < 0)
+                goto done;
+            if (ret == 0)
+                goto fail;
+            goto next;
+        }
+        if ((x = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if (sp->sp_fn(h, filter, nsc, xpath, x, sp->sp_arg) < 0){
+            if (clicon_errno < 0) 
+                clicon_log(LOG_WARNING, "%s: Internal error: State provider %s returned -1 but did not make a clicon_err call",
+                           __FUNCTION__, sp->sp_path);
+            if (statedata_fail(sp->sp_path, xret) < 0)
+                goto done;
+            goto fail;
+        }
+        if ((ret = statedata_merge(h, yspec, sp->sp_path, x, xret)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+        xml_free(x);
+        x = NULL;
+    next:
+        sp = NEXTQ(statedata_provider *, sp);
+    } while (sp && sp != sp_list);
+ ok:
+    retval = 1;
+ done:
+    if (filter)
+        clixon_path_free(filter);
+    if (x)
+        xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! State cursor provider, see clixon_state_cursor_register
+ */
+struct state_cursor{
+    qelem_t                   sc_q;
+    char                     *sc_path;     /* Registered path of list, eg /module:container/list */
+    clixon_path              *sc_cplist;   /* Path resolved to YANG (on first use) */
+    int                       sc_resolved; /* 0: not yet, 1: resolved, -1: not a state list */
+    clixon_state_cursor_cb_t *sc_fn;       /* Provider callback */
+    void                     *sc_arg;      /* Callback argument */
+    int                       sc_stream;   /* Streamed in reply of current request */
+};
+typedef struct state_cursor state_cursor;
+
+/*! Streaming of a state list from a cursor provider in a reply to a client
+ */
+struct state_cursor_stream{
+    qelem_t           cs_q;
+    clicon_handle     cs_h;
+    state_cursor     *cs_sc;       /* Cursor provider */
+    void             *cs_cursor;   /* Iterator of provider */
+    int               cs_started;  /* Provider has been called */
+    int               cs_done;     /* Provider is done or closed */
+    uint32_t          cs_offset;   /* Entries left to skip */
+    uint32_t          cs_limit;    /* Entries left to return, if cs_limited */
+    int               cs_limited;  /* Limit number of entries */
+    withdefaults_type cs_wdef;     /* With-defaults of request */
+    char             *cs_username; /* User of request, for NACM */
+    cxobj            *cs_xnacm;    /* Copy of NACM config at request, or NULL */
+    cxobj            *cs_xparent;  /* Parent of list entries in reply tree */
+    int               cs_nprev;    /* Nr of entries appended in previous batch */
+};
+
+/*! Resolve path of cursor provider to YANG on first use
+ *
+ * The path must be a state list whose ancestors are containers.
+ * @param[in]  sc     State cursor provider
+ * @param[in]  yspec  YANG spec
+ * @retval     0      OK, sc_resolved set
+ * @retval    -1      Error
+ */
+static int
+state_cursor_resolve(state_cursor *sc,
+                     yang_stmt    *yspec)
+{
+    int          ret;
+    clixon_path *cp;
+    yang_stmt   *y;
+
+    if (sc->sc_resolved != 0)
+        return 0;
+    if ((ret = statedata_path_resolve(yspec, sc->sc_path, &sc->sc_cplist)) < 0)
+        return -1;
+    sc->sc_resolved = -1;
+    if (ret == 1 && (cp = sc->sc_cplist) != NULL){
+        sc->sc_resolved = 1;
+        do {
+            y = cp->cp_yang;
+            if (cp->cp_cvk != NULL)
+                sc->sc_resolved = -1;
+            cp = NEXTQ(clixon_path *, cp);
+            if (cp == sc->sc_cplist){ /* The list */
+                if (yang_keyword_get(y) != Y_LIST || yang_config_ancestor(y) != 0)
+                    sc->sc_resolved = -1;
+            }
+            else if (yang_keyword_get(y) != Y_CONTAINER)
+                sc->sc_resolved = -1;
+        } while (cp != sc->sc_cplist);
+    }
+    if (sc->sc_resolved < 0)
+        clicon_debug(CLIXON_DBG_DEFAULT, "%s: State cursor path %s is not a state list in YANG, ignored",
+                     __FUNCTION__, sc->sc_path);
+    return 0;
+}
+
+/*! Find or create the ancestors of the list of a cursor provider
+ *
+ * @param[in]  xt       Top of tree, eg <config>
+ * @param[in]  cplist   Resolved path of list
+ * @param[in]  create   Create ancestors not found
+ * @param[out] xparentp Parent of list entries, NULL if not found and not created
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+state_cursor_parent(cxobj       *xt,
+                    clixon_path *cplist,
+                    int          create,
+                    cxobj      **xparentp)
+{
+    clixon_path *cp = cplist;
+    cxobj       *xp = xt;
+    cxobj       *x;
+    yang_stmt   *y;
+    yang_stmt   *yp;
+    char        *ns;
+
+    *xparentp = NULL;
+    while (NEXTQ(clixon_path *, cp) != cplist){ /* All but the list itself */
+        y = cp->cp_yang;
+        x = NULL;
+        while ((x = xml_child_each(xp, x, CX_ELMNT)) != NULL)
+            if (xml_spec(x) == y)
+                break;
+        if (x == NULL){
+            if (!create)
+                return 0;
+            if ((x = xml_new(yang_argument_get(y), xp, CX_ELMNT)) == NULL)
+                return -1;
+            xml_spec_set(x, y);
+            if ((ns = yang_find_mynamespace(y)) != NULL &&
+                ((yp = xml_spec(xp)) == NULL ||
+                 clicon_strcmp(yang_find_mynamespace(yp), ns) != 0))
+                if (xmlns_set(x, NULL, ns) < 0)
+                    return -1;
+        }
+        xp = x;
+        cp = NEXTQ(clixon_path *, cp);
+    }
+    *xparentp = xp;
+    return 0;
+}
+
+/*! Close an unfinished cursor of a provider
+ */
+static int
+state_cursor_close(state_cursor_stream *cs)
+{
+    state_cursor *sc = cs->cs_sc;
+
+    if (cs->cs_started && !cs->cs_done)
+        if (sc->sc_fn(cs->cs_h, &cs->cs_cursor, 0, NULL, sc->sc_arg) < 0)
+            clicon_log(LOG_WARNING, "%s: State cursor %s close failed", __FUNCTION__, sc->sc_path);
+    cs->cs_done = 1;
+    cs->cs_cursor = NULL;
+    return 0;
+}
+
+/*! Get all entries from a cursor provider and merge into state tree
+ *
+ * Used when the list is not streamed to the client, eg if the request selects specific
+ * list entries, which is then done on the resulting tree.
+ * @param[in]     h       clicon handle
+ * @param[in]     yspec   Yang spec
+ * @param[in]     sc      State cursor provider
+ * @param[in,out] xret    State XML tree is merged with existing tree.
+ * @retval       -1       Error
+ * @retval        0       Statedata callback failed (xret set with netconf-error)
+ * @retval        1       OK
+ */
+static int
+state_cursor_drain(clicon_handle h,
+                   yang_stmt    *yspec,
+                   state_cursor *sc,
+                   cxobj       **xret)
+{
+    int       retval = -1;
+    cxobj    *x = NULL;
+    cxobj    *xp;
+    void     *cursor = NULL;
+    uint32_t  batch;
+    int       ret;
+
+    if ((batch = clicon_option_int(h, "CLICON_BACKEND_STATE_BATCH")) == 0)
+        batch = 1;
+    if ((x = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (state_cursor_parent(x, sc->sc_cplist, 1, &xp) < 0)
+        goto done;
+    do {
+        if ((ret = sc->sc_fn(h, &cursor, batch, xp, sc->sc_arg)) < 0){
+            if (clicon_errno < 0) 
+                clicon_log(LOG_WARNING, "%s: Internal error: State cursor %s returned -1 but did not make a clicon_err call",
+                           __FUNCTION__, sc->sc_path);
+            if (statedata_fail(sc->sc_path, xret) < 0)
+                goto done;
+            goto fail;
+        }
+    } while (ret == 1);
+    if (xml_child_nr_type(xp, CX_ELMNT) == 0)
+        goto ok;
+    if ((ret = statedata_merge(h, yspec, sc->sc_path, x, xret)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+ ok:
+    retval = 1;
+ done:
+    if (x)
+        xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Get state from cursor providers not streamed to the client
+ *
+ * @param[in]     h       clicon handle
+ * @param[in]     yspec   Yang spec
+ * @param[in]     nsc     Namespace context
+ * @param[in]     xpath   String with XPATH syntax. or NULL for all
+ * @param[in,out] xret    State XML tree is merged with existing tree.
+ * @retval       -1       Error
+ * @retval        0       Statedata callback failed (xret set with netconf-error)
+ * @retval        1       OK
+ */
+static int
+state_cursors_call(clicon_handle h,
+                   yang_stmt    *yspec,
+                   cvec         *nsc,
+                   char         *xpath,
+                   cxobj       **xret)
+{
+    int           retval = -1;
+    state_cursor *sc_list = NULL;
+    state_cursor *sc;
+    clixon_path  *filter = NULL;
+    int           ret;
+
+    if (clicon_ptr_get(h, "state-cursors", (void**)&sc_list) < 0 || sc_list == NULL)
+        goto ok;
+    if (xpath && statedata_path_parse(yspec, xpath, &filter) < 0)
+        goto done;
+    sc = sc_list;
+    do {
+        if (state_cursor_resolve(sc, yspec) < 0)
+            goto done;
+        if (sc->sc_resolved < 0 || sc->sc_stream)
+            goto next;
+        if (filter && !statedata_path_intersect(filter, sc->sc_cplist))
+            goto next;
+        clicon_debug(CLIXON_DBG_DETAIL, "%s %s", __FUNCTION__, sc->sc_path);
+        if ((ret = state_cursor_drain(h, yspec, sc, xret)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+    next:
+        sc = NEXTQ(state_cursor *, sc);
+    } while (sc && sc != sc_list);
+ ok:
+    retval = 1;
+ done:
+    if (filter)
+        clixon_path_free(filter);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Go through all backend statedata callbacks and collect state data
  * This is internal system call, plugin is invoked (does not call) this function
- * Backend plugins can register 
+ * Backend plugins can register a ca_statedata callback which is called on every get, and
+ * state data providers on schema paths which are only called if their path intersects the
+ * request. State cursor providers not streamed to the client are called for all entries.
  * @param[in]     h       clicon handle
  * @param[in]     yspec   Yang spec
  * @param[in]     nsc     Namespace context
@@ -326,6 +1058,7 @@ clixon_plugin_statedata_one(clixon_plugin_t *cp,
  * @retval        0       Statedata callback failed (xret set with netconf-error)
  * @retval        1       OK
  * @note xret can be replaced in this function
+ * @see clixon_statedata_cb_register
  */
 int
 clixon_plugin_statedata_all(clicon_handle   h,
@@ -339,70 +1072,35 @@ clixon_plugin_statedata_all(clicon_handle   h,
     int              ret;
     cxobj           *x = NULL;
     clixon_plugin_t *cp = NULL;
-    cbuf            *cberr = NULL; 
-    cxobj           *xerr = NULL;
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     while ((cp = clixon_plugin_each(h, cp)) != NULL) {
         if ((ret = clixon_plugin_statedata_one(cp, h, nsc, xpath, &x)) < 0)
             goto done;
         if (ret == 0){
-            if ((cberr = cbuf_new()) == NULL){
-                clicon_err(OE_UNIX, errno, "cbuf_new");
-                goto done;
-            }
-            /* error reason should be in clicon_err_reason */
-            cprintf(cberr, "Internal error, state callback in plugin %s returned invalid XML: %s",
-                    clixon_plugin_name_get(cp), clicon_err_reason);
-            if (netconf_operation_failed_xml(&xerr, "application", cbuf_get(cberr)) < 0)
+            if (statedata_fail(clixon_plugin_name_get(cp), xret) < 0)
                 goto done;
-            xml_free(*xret);
-            *xret = xerr;
-            xerr = NULL;
             goto fail;
         }
         if (x == NULL)
             continue;
-        if (xml_child_nr(x) == 0){
-            xml_free(x);
-            x = NULL;
-            continue;
-        }
-        clicon_debug_xml(CLIXON_DBG_DETAIL, x, "%s %s STATE:", __FUNCTION__, clixon_plugin_name_get(cp));
-        /* XXX: ret == 0 invalid yang binding should be handled as internal error */
-        if ((ret = xml_bind_yang(h, x, YB_MODULE, yspec, &xerr)) < 0)
-            goto done;
-        if (ret == 0){
-            if (clixon_netconf_internal_error(xerr,
-                                              ". Internal error, state callback returned invalid XML from plugin: ",
-                                              clixon_plugin_name_get(cp)) < 0)
-                goto done;
-            xml_free(*xret);
-            *xret = xerr;
-            xerr = NULL;
-            goto fail;
-        }
-        if (xml_sort_recurse(x) < 0)
-            goto done;
-        /* Remove global defaults and empty non-presence containers */
-        /* XXX: only for state data and according to with-defaults setting */
-        if (xml_defaults_nopresence(x, 2) < 0)
-            goto done;
-        if ((ret = netconf_trymerge(x, yspec, xret)) < 0)
+        if ((ret = statedata_merge(h, yspec, clixon_plugin_name_get(cp), x, xret)) < 0)
             goto done;
         if (ret == 0)
             goto fail;
-        if (x){
-            xml_free(x);
-            x = NULL;
-        }
+        xml_free(x);
+        x = NULL;
     } /* while plugin */
+    if ((ret = clixon_statedata_providers_call(h, yspec, nsc, xpath, xret)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+    if ((ret = state_cursors_call(h, yspec, nsc, xpath, xret)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
     retval = 1;
  done:
-    if (xerr)
-        xml_free(xerr);
-    if (cberr)
-        cbuf_free(cberr);
     if (x)
         xml_free(x);
     return retval;
@@ -411,6 +1109,559 @@ clixon_plugin_statedata_all(clicon_handle   h,
     goto done;
 }
 
+/*! Register a state data provider on a schema path
+ *
+ * The provider is only called on get requests whose xpath intersects the path, ie the
+ * request is for data above, at or below the path. The request xpath is passed parsed and
+ * resolved to YANG with key predicates, if it is a simple path.
+ * @param[in]  h      Clixon handle
+ * @param[in]  fn     Provider callback
+ * @param[in]  path   Schema path with module names as prefixes, eg /ietf-interfaces:interfaces
+ * @param[in]  arg    Argument to callback
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @code
+ *   if (clixon_statedata_cb_register(h, my_state, "/ietf-interfaces:interfaces", NULL) < 0)
+ *      err;
+ * @endcode
+ * @see clixon_statedata_cb_t
+ */
+int
+clixon_statedata_cb_register(clicon_handle          h,
+                             clixon_statedata_cb_t *fn,
+                             char                  *path,
+                             void                  *arg)
+{
+    int                 retval = -1;
+    statedata_provider *sp_list = NULL;
+    statedata_provider *sp;
+
+    if ((sp = malloc(sizeof(*sp))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(sp, 0, sizeof(*sp));
+    if ((sp->sp_path = strdup(path)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        free(sp);
+        goto done;
+    }
+    sp->sp_fn = fn;
+    sp->sp_arg = arg;
+    clicon_ptr_get(h, "statedata-providers", (void**)&sp_list);
+    ADDQ(sp, sp_list);
+    if (clicon_ptr_set(h, "statedata-providers", sp_list) < 0)
+        goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Enable caching of state from a registered state data provider
+ *
+ * Requests within the time-to-live of the previous call are served from a cache of
+ * the YANG bound and sorted result. The provider is then called without filter so that
+ * the cached state is complete.
+ * @param[in]  h      Clixon handle
+ * @param[in]  path   Path as registered with clixon_statedata_cb_register
+ * @param[in]  ttl    Time-to-live in milliseconds, 0 disables the cache
+ * @retval     0      OK
+ * @retval    -1      Error, no provider registered on path
+ * @see clixon_statedata_cache_invalidate
+ */
+int
+clixon_statedata_cache_set(clicon_handle h,
+                           char         *path,
+                           uint32_t      ttl)
+{
+    statedata_provider *sp_list = NULL;
+    statedata_provider *sp;
+    int                 found = 0;
+
+    clicon_ptr_get(h, "statedata-providers", (void**)&sp_list);
+    if ((sp = sp_list) != NULL){
+        do {
+            if (strcmp(sp->sp_path, path) == 0){
+                sp->sp_ttl = ttl;
+                if (sp->sp_cache){
+                    xml_free(sp->sp_cache);
+                    sp->sp_cache = NULL;
+                }
+                found++;
+            }
+            sp = NEXTQ(statedata_provider *, sp);
+        } while (sp && sp != sp_list);
+    }
+    if (!found){
+        clicon_err(OE_PLUGIN, ENOENT, "No state data provider registered on %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+/*! Invalidate cached state of state data providers, eg when the state has changed
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  path   Path as registered with clixon_statedata_cb_register, or NULL for all
+ * @retval     0      OK
+ */
+int
+clixon_statedata_cache_invalidate(clicon_handle h,
+                                  char         *path)
+{
+    statedata_provider *sp_list = NULL;
+    statedata_provider *sp;
+
+    clicon_ptr_get(h, "statedata-providers", (void**)&sp_list);
+    if ((sp = sp_list) != NULL){
+        do {
+            if (sp->sp_cache &&
+                (path == NULL || strcmp(sp->sp_path, path) == 0)){
+                xml_free(sp->sp_cache);
+                sp->sp_cache = NULL;
+            }
+            sp = NEXTQ(statedata_provider *, sp);
+        } while (sp && sp != sp_list);
+    }
+    return 0;
+}
+
+/*! Get state cache statistics of state data providers with cache enabled
+ *
+ * @param[in]     h      Clixon handle
+ * @param[in,out] cb     Append stats on the form <state-cache>... of clixon-lib stats rpc
+ * @retval        0      OK
+ * @see from_client_stats
+ */
+int
+clixon_statedata_cache_stats(clicon_handle h,
+                             cbuf         *cb)
+{
+    statedata_provider *sp_list = NULL;
+    statedata_provider *sp;
+    uint64_t            nr;
+
+    clicon_ptr_get(h, "statedata-providers", (void**)&sp_list);
+    if ((sp = sp_list) != NULL){
+        do {
+            if (sp->sp_ttl){
+                cprintf(cb, "<state-cache xmlns=\"%s\">", CLIXON_LIB_NS);
+                cprintf(cb, "<path>");
+                xml_chardata_cbuf_append(cb, sp->sp_path);
+                cprintf(cb, "</path>");
+                cprintf(cb, "<ttl>%u</ttl>", sp->sp_ttl);
+                cprintf(cb, "<hits>%" PRIu64 "</hits>", sp->sp_hits);
+                cprintf(cb, "<misses>%" PRIu64 "</misses>", sp->sp_misses);
+                nr = 0;
+                if (sp->sp_cache)
+                    xml_stats(sp->sp_cache, &nr, NULL);
+                cprintf(cb, "<nr>%" PRIu64 "</nr>", nr);
+                cprintf(cb, "</state-cache>");
+            }
+            sp = NEXTQ(statedata_provider *, sp);
+        } while (sp && sp != sp_list);
+    }
+    return 0;
+}
+
+/*! Free state data providers
+ *
+ * @param[in]  h      Clixon handle
+ */
+int
+clixon_statedata_providers_free(clicon_handle h)
+{
+    statedata_provider *sp_list = NULL;
+    statedata_provider *sp;
+
+    clicon_ptr_get(h, "statedata-providers", (void**)&sp_list);
+    while ((sp = sp_list) != NULL){
+        DELQ(sp, sp_list, statedata_provider *);
+        if (sp->sp_path)
+            free(sp->sp_path);
+        if (sp->sp_cplist)
+            clixon_path_free(sp->sp_cplist);
+        if (sp->sp_cache)
+            xml_free(sp->sp_cache);
+        free(sp);
+    }
+    clicon_ptr_del(h, "statedata-providers");
+    return 0;
+}
+
+/*! Register a state cursor provider of a large state list
+ *
+ * Instead of building the whole list, the provider returns entries a batch at a time
+ * (CLICON_BACKEND_STATE_BATCH) from an iterator of its own. If the reply to a get request
+ * is written in chunks (CLICON_BACKEND_REPLY_CHUNK) and the request is for the whole list
+ * or above it, each batch is written to the client before the next is requested, so that
+ * the list is sent in constant memory. This also applies to list-pagination requests of the
+ * list, where offset entries are skipped.
+ * Otherwise, all entries are requested and merged into the state tree.
+ * Entries are sent in the order given by the provider, which should be the key order.
+ * @param[in]  h      Clixon handle
+ * @param[in]  fn     Provider callback
+ * @param[in]  path   Schema path of a state list whose ancestors are containers, with module
+ *                    names as prefixes, eg /example-rib:rib/routes/route
+ * @param[in]  arg    Argument to callback
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see clixon_state_cursor_cb_t
+ */
+int
+clixon_state_cursor_register(clicon_handle             h,
+                             clixon_state_cursor_cb_t *fn,
+                             char                     *path,
+                             void                     *arg)
+{
+    int           retval = -1;
+    state_cursor *sc_list = NULL;
+    state_cursor *sc;
+
+    if ((sc = malloc(sizeof(*sc))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(sc, 0, sizeof(*sc));
+    if ((sc->sc_path = strdup(path)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        free(sc);
+        goto done;
+    }
+    sc->sc_fn = fn;
+    sc->sc_arg = arg;
+    clicon_ptr_get(h, "state-cursors", (void**)&sc_list);
+    ADDQ(sc, sc_list);
+    if (clicon_ptr_set(h, "state-cursors", sc_list) < 0)
+        goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Select state cursor providers whose lists are streamed in the reply of a get request
+ *
+ * A list is streamed if the request is for all of the list or above it. Selected providers
+ * are not called when state data is collected. The streams are attached to the reply tree
+ * with clixon_state_cursor_attach(), or freed.
+ * @param[in]  h        Clixon handle
+ * @param[in]  yspec    Yang spec
+ * @param[in]  nsc      Namespace context of xpath
+ * @param[in]  xpath    Request xpath, or NULL for all
+ * @param[in]  wdef     With-defaults of request
+ * @param[in]  offset   Nr of entries to skip (list-pagination)
+ * @param[in]  limit    Max nr of entries, 0 is unbounded (list-pagination)
+ * @param[out] streamsp List of streams, NULL if none. Free with clixon_state_cursor_streams_free
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+int
+clixon_state_cursor_select(clicon_handle         h,
+                           yang_stmt            *yspec,
+                           cvec                 *nsc,
+                           char                 *xpath,
+                           withdefaults_type     wdef,
+                           uint32_t              offset,
+                           uint32_t              limit,
+                           state_cursor_stream **streamsp)
+{
+    int                  retval = -1;
+    state_cursor        *sc_list = NULL;
+    state_cursor        *sc;
+    state_cursor_stream *streams = NULL;
+    state_cursor_stream *cs;
+    clixon_path         *filter = NULL;
+    clixon_path         *cp1;
+    clixon_path         *cp2;
+    cxobj               *xnacm;
+    char                *username;
+    int                  ret;
+
+    if (clicon_ptr_get(h, "state-cursors", (void**)&sc_list) < 0 || sc_list == NULL)
+        goto ok;
+    /* Default tags are added to the whole tree */
+    if (wdef == WITHDEFAULTS_REPORT_ALL_TAGGED)
+        goto ok;
+    if (xpath && (ret = statedata_path_parse(yspec, xpath, &filter)) < 1){
+        if (ret < 0)
+            goto done;
+        goto ok; /* Not a simple path */
+    }
+    sc = sc_list;
+    do {
+        if (state_cursor_resolve(sc, yspec) < 0)
+            goto done;
+        if (sc->sc_resolved < 0)
+            goto next;
+        if (filter){
+            /* Filter must be at or above the list and without keys */
+            cp1 = filter;
+            cp2 = sc->sc_cplist;
+            do {
+                if (cp1->cp_yang != cp2->cp_yang || cp1->cp_cvk != NULL)
+                    goto next;
+                cp1 = NEXTQ(clixon_path *, cp1);
+                cp2 = NEXTQ(clixon_path *, cp2);
+                if (cp2 == sc->sc_cplist && cp1 != filter)
+                    goto next; /* Filter is below list */
+            } while (cp1 != filter);
+        }
+        if ((cs = malloc(sizeof(*cs))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        memset(cs, 0, sizeof(*cs));
+        ADDQ(cs, streams);
+        cs->cs_h = h;
+        cs->cs_sc = sc;
+        cs->cs_offset = offset;
+        cs->cs_limit = limit;
+        cs->cs_limited = (limit != 0);
+        cs->cs_wdef = wdef;
+        if ((username = clicon_username_get(h)) != NULL &&
+            (cs->cs_username = strdup(username)) == NULL){
+            clicon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+        /* NACM config of request, the NACM cache is only set while the request is handled */
+        if ((xnacm = clicon_nacm_cache(h)) != NULL &&
+            (cs->cs_xnacm = xml_dup(xnacm)) == NULL)
+            goto done;
+        sc->sc_stream = 1;
+    next:
+        sc = NEXTQ(state_cursor *, sc);
+    } while (sc && sc != sc_list);
+ ok:
+    *streamsp = streams;
+    streams = NULL;
+    retval = 0;
+ done:
+    if (streams)
+        clixon_state_cursor_streams_free(streams);
+    if (filter)
+        clixon_path_free(filter);
+    return retval;
+}
+
+/*! Attach streams of state lists to reply tree
+ *
+ * Create the ancestors of the lists in the reply tree, and mark the providers as
+ * no longer selected
+ * @param[in]  streams  List of streams
+ * @param[in]  xt       Reply tree, after NACM and filtering
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @see clixon_state_cursor_fill  to get entries while the reply is written
+ */
+int
+clixon_state_cursor_attach(state_cursor_stream *streams,
+                           cxobj               *xt)
+{
+    state_cursor_stream *cs;
+
+    if ((cs = streams) != NULL){
+        do {
+            cs->cs_sc->sc_stream = 0;
+            if (state_cursor_parent(xt, cs->cs_sc->sc_cplist, 1, &cs->cs_xparent) < 0)
+                return -1;
+            cs = NEXTQ(state_cursor_stream *, cs);
+        } while (cs && cs != streams);
+    }
+    return 0;
+}
+
+/*! Get parent of list entries of a stream in the reply tree
+ * @param[in]  cs   State cursor stream, attached
+ * @retval     xp   Parent of list entries
+ */
+cxobj *
+clixon_state_cursor_xparent(state_cursor_stream *cs)
+{
+    return cs->cs_xparent;
+}
+
+/*! Get next batch of list entries from a cursor provider into the reply tree
+ *
+ * Fill callback of the chunked serializer, called when the entries of the previous batch
+ * have been written. They are then removed. Entries are YANG bound, defaults are applied and
+ * NACM read access is checked as of the request.
+ * Provider errors end the list, since the reply has already been partly written.
+ * @param[in]  xparent  Parent of list entries in reply tree
+ * @param[in]  arg      State cursor stream
+ * @retval     n        Number of entries appended to xparent, 0 if no more
+ * @retval    -1        Error
+ * @see clixon_xml_chunk_fill
+ */
+int
+clixon_state_cursor_fill(cxobj *xparent,
+                         void  *arg)
+{
+    int                  retval = -1;
+    state_cursor_stream *cs = (state_cursor_stream *)arg;
+    state_cursor        *sc = cs->cs_sc;
+    clicon_handle        h = cs->cs_h;
+    yang_stmt           *yspec;
+    cxobj               *xt = NULL;
+    cxobj               *xp;
+    cxobj               *xc;
+    cxobj              **vec = NULL;
+    int                  vlen;
+    cxobj               *xerr = NULL;
+    uint32_t             batch;
+    int                  n = 0;
+    int                  ret;
+
+    /* Remove entries of previous batch, they have been written */
+    while (cs->cs_nprev > 0){
+        xc = xml_child_i(xparent, xml_child_nr(xparent) - 1);
+        if (xml_child_rm(xparent, xml_child_nr(xparent) - 1) < 0)
+            goto done;
+        xml_free(xc);
+        cs->cs_nprev--;
+    }
+    yspec = clicon_dbspec_yang(h);
+    if ((batch = clicon_option_int(h, "CLICON_BACKEND_STATE_BATCH")) == 0)
+        batch = 1;
+    /* Loop if all entries of a batch are skipped or denied */
+    while (n == 0 && !cs->cs_done){
+        if (cs->cs_limited && cs->cs_limit == 0){
+            state_cursor_close(cs);
+            break;
+        }
+        if ((xt = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if (state_cursor_parent(xt, sc->sc_cplist, 1, &xp) < 0)
+            goto done;
+        cs->cs_started = 1;
+        if ((ret = sc->sc_fn(h, &cs->cs_cursor, batch, xp, sc->sc_arg)) < 0){
+            clicon_log(LOG_WARNING, "%s: State cursor %s failed: %s", __FUNCTION__,
+                       sc->sc_path, clicon_err_reason);
+            cs->cs_done = 1;
+            break;
+        }
+        if (ret == 0)
+            cs->cs_done = 1;
+        if (xml_child_nr_type(xp, CX_ELMNT) == 0)
+            goto next;
+        if ((ret = statedata_bind(h, yspec, sc->sc_path, xt, &xerr)) < 0)
+            goto done;
+        if (ret == 0){
+            clicon_log(LOG_WARNING, "%s: State cursor %s returned invalid XML", __FUNCTION__,
+                       sc->sc_path);
+            state_cursor_close(cs);
+            break;
+        }
+        switch (cs->cs_wdef){
+        case WITHDEFAULTS_REPORT_ALL:
+        case WITHDEFAULTS_EXPLICIT:
+            if (xml_default_recurse(xp, 1) < 0)
+                goto done;
+            break;
+        case WITHDEFAULTS_TRIM:
+            if (xml_apply(xp, CX_ELMNT, (xml_applyfn_t*) xml_flag_state_default_value, (void*) XML_FLAG_MARK) < 0)
+                goto done;
+            if (xml_tree_prune_flags(xp, XML_FLAG_MARK, XML_FLAG_MARK) < 0)
+                goto done;
+            if (xml_defaults_nopresence(xp, 1) < 0)
+                goto done;
+            break;
+        default:
+            break;
+        }
+        if (cs->cs_xnacm){
+            vlen = 0;
+            xc = NULL;
+            while ((xc = xml_child_each(xp, xc, CX_ELMNT)) != NULL)
+                if (cxvec_append(xc, &vec, &vlen) < 0)
+                    goto done;
+            if (nacm_datanode_read(h, xt, vec, vlen, cs->cs_username, cs->cs_xnacm) < 0)
+                goto done;
+            free(vec);
+            vec = NULL;
+            /* Parent may be removed */
+            if (state_cursor_parent(xt, sc->sc_cplist, 0, &xp) < 0)
+                goto done;
+            if (xp == NULL)
+                goto next;
+        }
+        /* Move entries to reply tree, apply offset and limit */
+        while ((xc = xml_child_i_type(xp, 0, CX_ELMNT)) != NULL){
+            if (cs->cs_offset > 0){
+                cs->cs_offset--;
+                xml_purge(xc);
+                continue;
+            }
+            if (cs->cs_limited){
+                if (cs->cs_limit == 0)
+                    break;
+                cs->cs_limit--;
+            }
+            if (xml_addsub(xparent, xc) < 0)
+                goto done;
+            n++;
+        }
+    next:
+        xml_free(xt);
+        xt = NULL;
+    }
+    cs->cs_nprev = n;
+    retval = n;
+ done:
+    if (vec)
+        free(vec);
+    if (xt)
+        xml_free(xt);
+    if (xerr)
+        xml_free(xerr);
+    return retval;
+}
+
+/*! Free streams of state lists, close unfinished provider cursors
+ *
+ * @param[in]  streams  List of streams
+ */
+int
+clixon_state_cursor_streams_free(state_cursor_stream *streams)
+{
+    state_cursor_stream *cs;
+
+    while ((cs = streams) != NULL){
+        DELQ(cs, streams, state_cursor_stream *);
+        cs->cs_sc->sc_stream = 0;
+        state_cursor_close(cs);
+        if (cs->cs_username)
+            free(cs->cs_username);
+        if (cs->cs_xnacm)
+            xml_free(cs->cs_xnacm);
+        free(cs);
+    }
+    return 0;
+}
+
+/*! Free state cursor providers
+ *
+ * Streams must be freed before, see backend_client_rm
+ * @param[in]  h      Clixon handle
+ */
+int
+clixon_state_cursors_free(clicon_handle h)
+{
+    state_cursor *sc_list = NULL;
+    state_cursor *sc;
+
+    clicon_ptr_get(h, "state-cursors", (void**)&sc_list);
+    while ((sc = sc_list) != NULL){
+        DELQ(sc, sc_list, state_cursor *);
+        if (sc->sc_path)
+            free(sc->sc_path);
+        if (sc->sc_cplist)
+            clixon_path_free(sc->sc_cplist);
+        free(sc);
+    }
+    clicon_ptr_del(h, "state-cursors");
+    return 0;
+}
+
 /*! Lock database status has changed status
  * @param[in]  cp      Plugin handle
  * @param[in]  h    Clixon handle
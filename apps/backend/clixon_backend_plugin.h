@@ -89,6 +89,43 @@ typedef struct {
     cxobj            *pd_xstate;    /* Returned xml state tree */
 } pagination_data_t;
 
+/*! State data provider callback registered on a schema path
+ *
+ * Called on get requests whose xpath intersects the registered path.
+ * @param[in]  h       Clixon handle
+ * @param[in]  filter  Request xpath resolved to YANG with key values in cp_cvk, or NULL if the
+ *                     request is for all data or is not a simple path. Do not free
+ * @param[in]  nsc     Namespace context of xpath
+ * @param[in]  xpath   Request xpath, or NULL for all
+ * @param[out] xstate  XML tree, <config/> on entry. Add state data here
+ * @param[in]  arg     Argument given at registration
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see clixon_statedata_cb_register
+ */
+typedef int (clixon_statedata_cb_t)(clicon_handle h, clixon_path *filter, cvec *nsc, char *xpath,
+                                    cxobj *xstate, void *arg);
+
+/*! State cursor provider callback, returns entries of a state list a batch at a time
+ *
+ * The provider keeps its own iterator in *cursor, which is NULL on the first call.
+ * Several cursors of the same provider may be open at the same time.
+ * @param[in]     h       Clixon handle
+ * @param[in,out] cursor  Iterator of provider, NULL on first call. 
+ * @param[in]     batch   Max nr of entries to add. 0 means close: free the iterator
+ * @param[in]     xparent Parent of the list, add entries as children. NULL on close
+ * @param[in]     arg     Argument given at registration
+ * @retval        1       OK, more entries may follow
+ * @retval        0       OK, no more entries, the iterator is freed
+ * @retval       -1       Error, the iterator is freed
+ * @see clixon_state_cursor_register
+ */
+typedef int (clixon_state_cursor_cb_t)(clicon_handle h, void **cursor, uint32_t batch,
+                                       cxobj *xparent, void *arg);
+
+/* Streaming of a state list from a cursor provider in a reply to a client */
+typedef struct state_cursor_stream state_cursor_stream;
+
 /*
  * Prototypes
  */
@@ -102,6 +139,22 @@ int clixon_plugin_statedata_all(clicon_handle h, yang_stmt *yspec, cvec *nsc, ch
                                 withdefaults_type wdef, cxobj **xtop);
 int clixon_plugin_lockdb_all(clicon_handle h, char *db, int lock, int id);
 
+int clixon_statedata_cb_register(clicon_handle h, clixon_statedata_cb_t *fn, char *path, void *arg);
+int clixon_statedata_cache_set(clicon_handle h, char *path, uint32_t ttl);
+int clixon_statedata_cache_invalidate(clicon_handle h, char *path);
+int clixon_statedata_cache_stats(clicon_handle h, cbuf *cb);
+int clixon_statedata_providers_free(clicon_handle h);
+
+int clixon_state_cursor_register(clicon_handle h, clixon_state_cursor_cb_t *fn, char *path, void *arg);
+int clixon_state_cursor_select(clicon_handle h, yang_stmt *yspec, cvec *nsc, char *xpath,
+                               withdefaults_type wdef, uint32_t offset, uint32_t limit,
+                               state_cursor_stream **streamsp);
+int clixon_state_cursor_attach(state_cursor_stream *streams, cxobj *xt);
+cxobj *clixon_state_cursor_xparent(state_cursor_stream *cs);
+int clixon_state_cursor_fill(cxobj *xparent, void *arg);
+int clixon_state_cursor_streams_free(state_cursor_stream *streams);
+int clixon_state_cursors_free(clicon_handle h);
+
 int clixon_pagination_cb_register(clicon_handle h, handler_function fn, char *path, void *arg);
 int clixon_pagination_cb_call(clicon_handle h, char *xpath, int locked,
                               uint32_t offset, uint32_t limit, 
@@ -1144,6 +1144,8 @@ cli_pagination(clicon_handle h,
     cxobj          **xvec = NULL;
     size_t           xlen;
     int              locked = 0;
+    char            *cursor = NULL;
+    char            *next = NULL;
     
     if (cvec_len(argv) != 5){
         clicon_err(OE_PLUGIN, 0, "Expected usage: <xpath> <prefix> <namespace> <format> <limit>");
@@ -1177,13 +1179,17 @@ cli_pagination(clicon_handle h,
         goto done;
     locked++;
     for (i = 0;; i++){
+        /* Config lists are read from a backend snapshot using the returned cursor,
+         * state lists do not return a cursor and are read using offset */
         if (clicon_rpc_get_pageable_list(h, "running", xpath, nsc,
                                          CONTENT_ALL,
                                          -1,       /* depth */
                                          NULL,     /* with-default */
-                                         limit*i,  /* offset */
+                                         cursor?0:limit*i,  /* offset */
                                          limit,    /* limit */
                                          NULL, NULL, NULL, /* nyi */
+                                         cursor?cursor:"",
+                                         &next,
                                          &xret) < 0){
             goto done;
         }
@@ -1223,6 +1229,12 @@ cli_pagination(clicon_handle h,
             break;
         if (xlen != limit) /* Break if fewer elements than requested */
             break;
+        if (cursor != NULL && next == NULL) /* Last page of snapshot */
+            break;
+        if (cursor)
+            free(cursor);
+        cursor = next;
+        next = NULL;
         if (xret){
             xml_free(xret);
             xret = NULL;
@@ -1236,6 +1248,10 @@ cli_pagination(clicon_handle h,
  done:
     if (locked)
         clicon_rpc_unlock(h, "running");
+    if (cursor)
+        free(cursor);
+    if (next)
+        free(next);
     if (xvec)
         free(xvec);
     if (xret)
@@ -81,6 +81,8 @@
 #define NETCONF_HASH_BUF "netconf_input_cbuf"
 #define NETCONF_FRAME_STATE "netconf_input_frame_state"
 #define NETCONF_FRAME_SIZE "netconf_input_frame_size"
+/* clixon-data value to save incremental parser between invocations with chunked framing */
+#define NETCONF_HASH_PUSH "netconf_input_push"
 
 /*! Ignore errors on packet errors: continue */
 static int ignore_packet_errors = 1;
@@ -370,10 +372,12 @@ netconf_input_packet(clicon_handle h,
     return retval;
 }
 
-/*! Process incoming frame, ie a char message framed by ]]>]]>
- * Parse string to xml, check only one netconf message within a frame
+/*! Process parsed incoming frame, check only one netconf message within a frame
+ *
  * @param[in]   h    Clixon handle
- * @param[in]   cb   Packet buffer
+ * @param[in]   xtop Parsed XML, NULL if empty message
+ * @param[in]   xret Error XML if ret is 0
+ * @param[in]   ret  Return value from XML parsing, -1 parse error, 0 yang bind fail, 1 OK
  * @param[out]  eof  Set to 1 if pending close socket
  * @retval      0    OK
  * @retval     -1    Fatal error
@@ -390,30 +394,22 @@ netconf_input_packet(clicon_handle h,
  * - RPC messages: send rpc-error
  */
 static int
-netconf_input_frame(clicon_handle h, 
-                    cbuf         *cb,
-                    int          *eof)
+netconf_input_frame_xml(clicon_handle h, 
+                        cxobj        *xtop,
+                        cxobj        *xret,
+                        int           ret,
+                        int          *eof)
 {
     int        retval = -1;
-    char      *str = NULL;
-    cxobj     *xtop = NULL; /* Request (in) */
     cxobj     *xreq = NULL;
-    cxobj     *xret = NULL; /* Return (out) */
     cbuf      *cbret = NULL;
     yang_stmt *yspec;
-    int        ret;
     netconf_framing_type framing;
     
-    clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
-    clicon_debug(CLIXON_DBG_MSG, "Recv ext: %s", cbuf_get(cb));
     framing = clicon_option_int(h, "netconf-framing");
     yspec = clicon_dbspec_yang(h);
-    if ((str = strdup(cbuf_get(cb))) == NULL){
-        clicon_err(OE_UNIX, errno, "strdup");
-        goto done;
-    }
-    /* Special case:  */
-    if (strlen(str) == 0){
+    /* Special case: empty XML */
+    if (xtop == NULL && ret == 1){
         if ((cbret = cbuf_new()) == NULL){ 
             clicon_err(OE_UNIX, errno, "cbuf_new");
             goto done;
@@ -426,8 +422,8 @@ netconf_input_frame(clicon_handle h,
             goto done;
         goto ok;
     }
-    /* Parse incoming XML message */
-    if ((ret = clixon_xml_parse_string(str, YB_RPC, yspec, &xtop, &xret)) < 0){ 
+    /* Parse error of incoming XML message */
+    if (ret < 0){ 
         if ((cbret = cbuf_new()) == NULL){ 
             clicon_err(OE_UNIX, errno, "cbuf_new");
             goto done;
@@ -493,6 +489,47 @@ netconf_input_frame(clicon_handle h,
         goto done;
  ok:
     retval = 0;
+ done:
+    if (cbret)
+        cbuf_free(cbret);
+    return retval;
+}
+
+/*! Process incoming frame, ie a char message framed by ]]>]]>
+ *
+ * Parse string to xml, check only one netconf message within a frame
+ * @param[in]   h    Clixon handle
+ * @param[in]   cb   Packet buffer
+ * @param[out]  eof  Set if eof encountered
+ * @retval      0    OK
+ * @retval     -1    Fatal error
+ * @see netconf_input_frame_xml
+ */
+static int
+netconf_input_frame(clicon_handle h, 
+                    cbuf         *cb,
+                    int          *eof)
+{
+    int        retval = -1;
+    char      *str = NULL;
+    cxobj     *xtop = NULL; /* Request (in) */
+    cxobj     *xret = NULL; /* Return (out) */
+    yang_stmt *yspec;
+    int        ret = 1;
+    
+    clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
+    clicon_debug(CLIXON_DBG_MSG, "Recv ext: %s", cbuf_get(cb));
+    yspec = clicon_dbspec_yang(h);
+    if ((str = strdup(cbuf_get(cb))) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    /* Parse incoming XML message, unless empty */
+    if (strlen(str) != 0)
+        ret = clixon_xml_parse_string(str, YB_RPC, yspec, &xtop, &xret);
+    if (netconf_input_frame_xml(h, xtop, xret, ret, eof) < 0)
+        goto done;
+    retval = 0;
  done:
     if (str)
         free(str);
@@ -500,11 +537,102 @@ netconf_input_frame(clicon_handle h,
         xml_free(xtop);
     if (xret)
         xml_free(xret);
-    if (cbret)
-        cbuf_free(cbret);
     return retval;
 }
 
+/*! Process incoming chunked frame that has been incrementally parsed
+ *
+ * The chunk data has been fed to the push parser as it arrived, see netconf_input_cb
+ * @param[in]   h    Clixon handle
+ * @param[in]   xp   Push parser handle
+ * @param[out]  eof  Set if eof encountered
+ * @retval      0    OK
+ * @retval     -1    Fatal error
+ * @see netconf_input_frame_xml
+ */
+static int
+netconf_input_frame_push(clicon_handle    h, 
+                         clixon_xml_push *xp,
+                         int             *eof)
+{
+    int        retval = -1;
+    cxobj     *xtop;
+    cxobj     *xret = NULL; /* Return (out) */
+    int        ret = 1;
+    
+    clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
+    xtop = clixon_xml_push_top(xp);
+    if (clixon_xml_push_len(xp) == 0)
+        xtop = NULL;
+    else if ((ret = clixon_xml_push_done(xp, &xret)) > 0)
+        clicon_debug_xml(CLIXON_DBG_MSG, xtop, "Recv ext:");
+    if (netconf_input_frame_xml(h, xtop, xret, ret, eof) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xret)
+        xml_free(xret);
+    return retval;
+}
+
+/*! Get push parser for chunked framing saved between calls, or create a new
+ * @param[in]   h    Clixon handle
+ * @retval      xp   Push parser handle
+ * @retval      NULL Error
+ */
+static clixon_xml_push *
+netconf_input_push_get(clicon_handle h)
+{
+    clixon_xml_push *xp = NULL;
+    clicon_hash_t   *cdat = clicon_data(h);
+    cxobj           *xt = NULL;
+    void            *ptr;
+    size_t           cdatlen = 0;
+    
+    if ((ptr = clicon_hash_value(cdat, NETCONF_HASH_PUSH, &cdatlen)) != NULL){
+        if (cdatlen != sizeof(xp)){
+            clicon_err(OE_XML, EINVAL, "size mismatch %lu %lu",
+                       (unsigned long)cdatlen, (unsigned long)sizeof(xp));
+            goto done;
+        }
+        xp = *(clixon_xml_push**)ptr;
+        goto done;
+    }
+    if ((xt = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if ((xp = clixon_xml_push_new(YB_RPC, clicon_dbspec_yang(h), xt)) == NULL){
+        xml_free(xt);
+        goto done;
+    }
+    if (clicon_hash_add(cdat, NETCONF_HASH_PUSH, &xp, sizeof(xp)) == NULL){
+        clixon_xml_push_free(xp);
+        xml_free(xt);
+        xp = NULL;
+        goto done;
+    }
+ done:
+    return xp;
+}
+
+/*! Free push parser for chunked framing and its parse-tree, and remove it from handle
+ * @param[in]   h    Clixon handle
+ */
+static int
+netconf_input_push_free(clicon_handle h)
+{
+    clixon_xml_push *xp;
+    clicon_hash_t   *cdat = clicon_data(h);
+    void            *ptr;
+
+    if ((ptr = clicon_hash_value(cdat, NETCONF_HASH_PUSH, NULL)) != NULL){
+        xp = *(clixon_xml_push**)ptr;
+        xml_free(clixon_xml_push_top(xp));
+        clixon_xml_push_free(xp);
+        clicon_hash_del(cdat, NETCONF_HASH_PUSH);
+    }
+    return 0;
+}
+
 /*! Get netconf message: detect end-of-msg 
  * @param[in]   s    Socket where input arrived. read from this.
  * @param[in]   arg  Clixon handle.
@@ -515,6 +643,8 @@ netconf_input_frame(clicon_handle h,
  * is not completely present on the s, ie if eg:
  *   <a>foo ..pause.. </a>]]>]]>
  * then only "</a>" would be delivered to netconf_input_frame().
+ * @note With chunked framing, chunk-data is not buffered but fed to an incremental parser saved
+ * in clicon-handle at NETCONF_HASH_PUSH, see clixon_xml_push_feed
  */
 static int
 netconf_input_cb(int   s, 
@@ -534,6 +664,9 @@ netconf_input_cb(int   s,
     size_t         frame_size;
     int            ret;
     int            eof = 0;  /* Set to 1 if pending close socket */
+    clixon_xml_push *xp = NULL; /* Incremental parser if chunked framing */
+    size_t         n;
+    unsigned char *p;
 
     if (clicon_option_exists(h, NETCONF_FRAME_STATE) == 0)
         frame_state = 0;
@@ -574,6 +707,7 @@ netconf_input_cb(int   s,
         } /* read */
         if (len == 0){  /* EOF */
             clicon_debug(1, "%s len==0, closing", __FUNCTION__);
+            netconf_input_push_free(h);
             clixon_event_unreg_fd(s, netconf_input_cb);
             close(s);
             clixon_exit_set(1);     
@@ -583,23 +717,39 @@ netconf_input_cb(int   s,
             if (buf[i] == 0)
                 continue; /* Skip NULL chars (eg from terminals) */
             if (clicon_option_int(h, "netconf-framing") == NETCONF_SSH_CHUNKED){
+                if (xp == NULL && (xp = netconf_input_push_get(h)) == NULL)
+                    goto done;
+                /* Feed contiguous chunk-data directly to incremental parser
+                 * Parse errors are kept in the parser and reported at end-of-data */
+                if (frame_state == 4 && frame_size > 0){
+                    n = len - i;
+                    if (n > frame_size)
+                        n = frame_size;
+                    if ((p = memchr(&buf[i], 0, n)) != NULL)
+                        n = p - &buf[i];
+                    clixon_xml_push_feed(xp, (char*)&buf[i], n);
+                    frame_size -= n;
+                    i += n - 1;
+                    continue;
+                }
                 /* Track chunked framing defined in RFC6242 */
                 if ((ret = netconf_input_chunked_framing(buf[i], &frame_state, &frame_size)) < 0)
                     goto done;
                 switch (ret){
                 case 1: /* chunk-data */
-                    cprintf(cb, "%c", buf[i]);
+                    clixon_xml_push_feed(xp, (char*)&buf[i], 1);
                     break;
                 case 2: /* end-of-data */
                     /* Somewhat complex error-handling:
                      * Ignore packet errors, UNLESS an explicit termination request (eof)
                      */
-                    if (netconf_input_frame(h, cb, &eof) < 0 &&
-                        !ignore_packet_errors) 
+                    ret = netconf_input_frame_push(h, xp, &eof);
+                    netconf_input_push_free(h);
+                    xp = NULL;
+                    if (ret < 0 && !ignore_packet_errors) 
                         goto done; 
                     if (eof)
                         goto done;
-                    cbuf_reset(cb);
                     break;
                 default:
                     break;
@@ -639,6 +789,8 @@ netconf_input_cb(int   s,
     clicon_option_int_set(h, NETCONF_FRAME_SIZE, frame_size);
     retval = 0;
  done:
+    if (retval < 0)
+        netconf_input_push_free(h);
     if (cb)
         cbuf_free(cb);
     return retval;
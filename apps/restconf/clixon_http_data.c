@@ -53,6 +53,7 @@
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <libgen.h>
+#include <stdint.h>
 #include <sys/stat.h> /* chmod */
 
 /* cligen */
@@ -84,6 +85,58 @@ static const map_str2str mime_map[] = {
     { NULL,    NULL} /* if not found: application/octet-stream */
 };
 
+/* Modification time of file with sub-second resolution */
+#ifdef __APPLE__
+#define HTTP_DATA_MTIME(st) ((st)->st_mtimespec)
+#else
+#define HTTP_DATA_MTIME(st) ((st)->st_mtim)
+#endif
+#define HTTP_DATA_MTIME_EQ(ts, st) ((ts).tv_sec == HTTP_DATA_MTIME(st).tv_sec && \
+                                    (ts).tv_nsec == HTTP_DATA_MTIME(st).tv_nsec)
+#define HTTP_DATA_MTIME_NS(st) ((uintmax_t)HTTP_DATA_MTIME(st).tv_sec*1000000000 + \
+                                HTTP_DATA_MTIME(st).tv_nsec)
+
+/* Cached static file, see HTTP_DATA_CACHE_FILE_MAX
+ * Kept in a list in the clixon handle with most recently used first
+ * Replies are written directly from hf_data, an entry removed from the cache while
+ * replies are being written is freed when the last of them is written
+ */
+typedef struct {
+    qelem_t         hf_qelem;    /* List header */
+    char           *hf_filename; /* File name including CLICON_HTTP_DATA_ROOT */
+    ino_t           hf_ino;      /* Inode of file when read */
+    off_t           hf_size;     /* Size of file when read */
+    struct timespec hf_mtime;    /* Modification time of file when read */
+    char           *hf_data;     /* File contents, hf_size bytes */
+    int             hf_refs;     /* Replies being written from hf_data */
+    int             hf_removed;  /* Removed from cache, free when hf_refs is 0 */
+} http_data_file;
+
+/*! Free http data file cache entry
+ */
+static int
+http_data_file_free(http_data_file *hf)
+{
+    if (hf->hf_filename)
+        free(hf->hf_filename);
+    if (hf->hf_data)
+        free(hf->hf_data);
+    free(hf);
+    return 0;
+}
+
+/*! Remove entry from http data file cache, free it if no reply is written from it
+ */
+static int
+http_data_file_remove(http_data_file *hf)
+{
+    if (hf->hf_refs)
+        hf->hf_removed = 1;
+    else
+        http_data_file_free(hf);
+    return 0;
+}
+
 /*! Check if uri path denotes a data path
  *
  * @param[in]  h      Clixon handle
@@ -164,29 +217,26 @@ api_http_data_err(clicon_handle  h,
  * @param[in]      req     Generic Www handle (can be part of clixon handle)
  * @param[in]      prefix  Prefix of path0, where to start file check
  * @param[in,out]  cbpath  Filepath as cbuf, internal redirection may change it
- * @param[out]     fp      Open file, if retval = 1
- * @param[out]     fsz     Size of file, if retval = 1
+ * @param[out]     st      File status, if retval = 1
  * @retval        -1       Error
  * @retval         0       Invalid
- * @retval         1       OK, fp,fsz set
+ * @retval         1       OK, st set
  */
 static int
 http_data_check_file_path(clicon_handle h,
                           void         *req,
                           char         *prefix,
                           cbuf         *cbpath,
-                          FILE        **fp,
-                          off_t        *fsz)
+                          struct stat  *st)
 {
     int         retval = -1;
     struct stat fstat;
     char       *p;
     int         i;
     int         code = 0;
-    FILE       *f;
 
-    if (prefix == NULL || cbpath == NULL || fp == NULL){
-        clicon_err(OE_UNIX, EINVAL, "prefix, cbpath0 or fp is NULL");
+    if (prefix == NULL || cbpath == NULL || st == NULL){
+        clicon_err(OE_UNIX, EINVAL, "prefix, cbpath0 or st is NULL");
         goto done;
     }
     p = cbuf_get(cbpath);
@@ -246,13 +296,7 @@ http_data_check_file_path(clicon_handle h,
         code = 403;
         goto invalid;
     }
-    *fsz = fstat.st_size;
-    if ((f = fopen(p, "rb")) == NULL){
-        clicon_debug(1, "%s Error fopen(%s) %s", __FUNCTION__, p, strerror(errno));
-        code = 403;
-        goto invalid;
-    }
-    *fp = f;
+    *st = fstat;
     retval = 1; /* OK */
  done:
     return retval;
@@ -263,13 +307,167 @@ http_data_check_file_path(clicon_handle h,
     goto done;
 }
                    
+#if HTTP_DATA_CACHE_FILE_MAX > 0
+/*! Release reference to cache entry when reply written from it is done
+ *
+ * @param[in]  arg   Cache entry
+ * @see restconf_reply_send_buf
+ */
+static void
+http_data_file_release(void *arg)
+{
+    http_data_file *hf = (http_data_file *)arg;
+
+    if (--hf->hf_refs == 0 && hf->hf_removed)
+        http_data_file_free(hf);
+}
+
+/*! Find file in http data file cache, and check it is still valid
+ *
+ * A hit is moved first in the cache list, so that the last entry is least recently used
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  File name
+ * @param[in]  st        Current file status
+ * @retval     hf        Valid cache entry
+ * @retval     NULL      Not found or stale (stale entry is removed)
+ */
+static http_data_file *
+http_data_cache_get(clicon_handle h,
+                    char         *filename,
+                    struct stat  *st)
+{
+    http_data_file *hf_list = NULL;
+    http_data_file *hf;
+
+    if (clicon_ptr_get(h, "http-data-cache", (void**)&hf_list) < 0 || hf_list == NULL)
+        return NULL;
+    hf = hf_list;
+    do {
+        if (strcmp(hf->hf_filename, filename) == 0){
+            DELQ(hf, hf_list, http_data_file *);
+            if (hf->hf_ino != st->st_ino ||
+                hf->hf_size != st->st_size ||
+                !HTTP_DATA_MTIME_EQ(hf->hf_mtime, st)){
+                clicon_debug(1, "%s %s stale", __FUNCTION__, filename);
+                http_data_file_remove(hf);
+                hf = NULL;
+            }
+            else
+                INSQ(hf, hf_list);
+            clicon_ptr_set(h, "http-data-cache", hf_list);
+            return hf;
+        }
+        hf = NEXTQ(http_data_file *, hf);
+    } while (hf && hf != hf_list);
+    return NULL;
+}
+
+/*! Read file into a new http data file cache entry
+ *
+ * The file is read directly into the buffer of the cache entry.
+ * Least recently used entries are removed to keep the cache within HTTP_DATA_CACHE_MAX
+ * @param[in]  h         Clicon handle
+ * @param[in]  filename  File name
+ * @param[in]  st        File status used to validate cache entry
+ * @param[in]  fd        Open file positioned at start
+ * @param[out] hfp       New cache entry, or NULL if file could not be read completely
+ * @retval     0         OK
+ * @retval    -1         Error
+ */
+static int
+http_data_cache_add(clicon_handle    h,
+                    char            *filename,
+                    struct stat     *st,
+                    int              fd,
+                    http_data_file **hfp)
+{
+    int             retval = -1;
+    http_data_file *hf_list = NULL;
+    http_data_file *hf = NULL;
+    http_data_file *hf1;
+    size_t          sz = 0;
+    ssize_t         n;
+
+    if ((hf = malloc(sizeof(*hf))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(hf, 0, sizeof(*hf));
+    if ((hf->hf_filename = strdup(filename)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    if ((hf->hf_data = malloc(st->st_size)) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    if ((n = read(fd, hf->hf_data, st->st_size)) < 0){
+        clicon_err(OE_UNIX, errno, "read");
+        goto done;
+    }
+    if (n != st->st_size){
+        clicon_debug(1, "%s Error read(%s) sz:%zd", __FUNCTION__, filename, n);
+        *hfp = NULL;
+        goto ok;
+    }
+    hf->hf_ino = st->st_ino;
+    hf->hf_size = st->st_size;
+    hf->hf_mtime = HTTP_DATA_MTIME(st);
+    clicon_ptr_get(h, "http-data-cache", (void**)&hf_list);
+    if ((hf1 = hf_list) != NULL)
+        do {
+            sz += hf1->hf_size;
+            hf1 = NEXTQ(http_data_file *, hf1);
+        } while (hf1 && hf1 != hf_list);
+    while (hf_list && sz + hf->hf_size > HTTP_DATA_CACHE_MAX){
+        hf1 = PREVQ(http_data_file *, hf_list); /* Least recently used */
+        sz -= hf1->hf_size;
+        DELQ(hf1, hf_list, http_data_file *);
+        http_data_file_remove(hf1);
+    }
+    INSQ(hf, hf_list);
+    clicon_ptr_set(h, "http-data-cache", hf_list);
+    *hfp = hf;
+    hf = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (hf)
+        http_data_file_free(hf);
+    return retval;
+}
+#endif /* HTTP_DATA_CACHE_FILE_MAX */
+
+/*! Free all entries in the http data file cache
+ * @param[in]  h         Clicon handle
+ */
+int
+api_http_data_cache_free(clicon_handle h)
+{
+    http_data_file *hf_list = NULL;
+    http_data_file *hf;
+
+    if (clicon_ptr_get(h, "http-data-cache", (void**)&hf_list) < 0)
+        return 0;
+    while ((hf = hf_list) != NULL){
+        DELQ(hf, hf_list, http_data_file *);
+        http_data_file_remove(hf);
+    }
+    clicon_ptr_del(h, "http-data-cache");
+    return 0;
+}
+
 /*! Read file data request
+ *
+ * A strong entity-tag is made from inode, size and modification time of the file, and a
+ * matching If-None-Match returns 304 Not Modified.
+ * Small files are kept in an in-memory cache validated with the same file attributes,
+ * see HTTP_DATA_CACHE_FILE_MAX, and replies are written directly from the cache entry.
+ * Larger files are not read here, the open file is given to restconf_reply_send_file.
  * @param[in]  h         Clicon handle
  * @param[in]  req       Generic Www handle (can be part of clixon handle)
  * @param[in]  pathname  With stripped prefix (eg /data), ultimately a filename
  * @param[in]  head      HEAD not GET
- * @note: primitive file handling, just check if file exists and read it all
- * XXX 1: Buffer copying once too many, see #if 0 below
  */
 static int
 api_http_data_file(clicon_handle h,
@@ -277,19 +475,21 @@ api_http_data_file(clicon_handle h,
                    char         *pathname,
                    int           head)
 {
-    int         retval = -1;
-    cbuf       *cbfile = NULL;
-    char       *filename = NULL;
-    cbuf       *cbdata = NULL;
-    FILE       *f = NULL;
-    off_t       fsz = 0;
-    long        fsize;
-    char       *www_data_root = NULL;
-    char       *suffix;
-    char       *media;
-    int         ret;
-    char       *buf = NULL;
-    size_t      sz;
+    int             retval = -1;
+    cbuf           *cbfile = NULL;
+    char           *filename = NULL;
+    struct stat     st;
+    struct stat     fst;
+    int             fd = -1;
+    char           *www_data_root = NULL;
+    char           *suffix;
+    char           *media;
+    char           *inm;
+    char            etag[64];
+    int             ret;
+#if HTTP_DATA_CACHE_FILE_MAX > 0
+    http_data_file *hf;
+#endif
 
     clicon_debug(1, "%s", __FUNCTION__);    
     if ((cbfile = cbuf_new()) == NULL){
@@ -312,7 +512,7 @@ api_http_data_file(clicon_handle h,
         }
         cprintf(cbfile, "%s", pathname); /* Assume pathname starts with '/' */
     }
-    if ((ret = http_data_check_file_path(h, req, www_data_root, cbfile, &f, &fsz)) < 0)
+    if ((ret = http_data_check_file_path(h, req, www_data_root, cbfile, &st)) < 0)
         goto done;
     if (ret == 0) /* Invalid, return code set */
         goto ok;
@@ -326,63 +526,81 @@ api_http_data_file(clicon_handle h,
         if ((media = clicon_str2str(mime_map, suffix)) == NULL)
             media = "application/octet-stream";
     }
-    /* Size could have been taken from stat() but this reduces the race condition interval 
-     * There is still one without flock
-     */
-    fseek(f, 0, SEEK_END);
-    fsize = ftell(f);
-    /* Extra sanity check, had some problems with wrong file types */
-    if (fsz != fsize){
-        clicon_debug(1, "%s Error file %s size mismatch sz:%zu vs %li",
-                     __FUNCTION__, filename, (size_t)fsz, fsize);
-        if (api_http_data_err(h, req, 500) < 0) /* Internal error? */
+    snprintf(etag, sizeof(etag), "\"%jx-%jx-%jx\"",
+             (uintmax_t)st.st_ino, (uintmax_t)st.st_size, (uintmax_t)HTTP_DATA_MTIME_NS(&st));
+    if (restconf_reply_header(req, "ETag", "%s", etag) < 0)
+        goto done;
+    if ((inm = restconf_param_get(h, "HTTP_IF_NONE_MATCH")) != NULL &&
+        restconf_etag_match(inm, etag)){
+        clicon_debug(1, "%s %s not modified", __FUNCTION__, filename);
+        if (restconf_reply_send(req, 304, NULL, 0) < 0)
             goto done;
         goto ok;
     }
-    fseek(f, 0, SEEK_SET);  /* same as rewind(f); */
-    if ((cbdata = cbuf_new_alloc(fsize+1)) == NULL){
-        clicon_err(OE_UNIX, errno, "cbuf_new_alloc");
-        goto done;
+#if HTTP_DATA_CACHE_FILE_MAX > 0
+    if ((hf = http_data_cache_get(h, filename, &st)) != NULL){
+        clicon_debug(1, "%s %s cache hit", __FUNCTION__, filename);
+        if (restconf_reply_header(req, "Content-Type", "%s", media) < 0)
+            goto done;
+        hf->hf_refs++;
+        if (restconf_reply_send_buf(req, 200, hf->hf_data, hf->hf_size, head,
+                                    http_data_file_release, hf) < 0)
+            goto done;
+        goto ok;
     }
-    /* Unoptimized, no direct read but requires an extra copy,
-     * the cligen buf API should have some mechanism for this case without the extra copy.
-     */
-    if ((buf = malloc(fsize)) == NULL){
-        clicon_err(OE_UNIX, errno, "malloc");
-        goto done;
+#endif
+    if ((fd = open(filename, O_RDONLY)) < 0){
+        clicon_debug(1, "%s Error open(%s) %s", __FUNCTION__, filename, strerror(errno));
+        if (api_http_data_err(h, req, 403) < 0)
+            goto done;
+        goto ok;
     }
-    if ((ret = fread(buf, fsize, 1, f)) < 0){
-        clicon_err(OE_UNIX, errno, "fread");
+    /* Extra sanity check that the file opened is the file checked, reduces race condition
+     * interval. There is still one without flock
+     */
+    if (fstat(fd, &fst) < 0){
+        clicon_err(OE_UNIX, errno, "fstat");
         goto done;
     }
-    sz = (size_t)ret;
-    if (sz != 1){
-        clicon_debug(1, "%s Error fread(%s) sz:%zu", __FUNCTION__, filename, sz);
+    if (fst.st_ino != st.st_ino || fst.st_size != st.st_size){
+        clicon_debug(1, "%s Error file %s changed sz:%zu vs %zu",
+                     __FUNCTION__, filename, (size_t)st.st_size, (size_t)fst.st_size);
         if (api_http_data_err(h, req, 500) < 0) /* Internal error? */
             goto done;
         goto ok;
     }
-    if (cbuf_append_buf(cbdata, buf, fsize) < 0){
-        clicon_err(OE_UNIX, errno, "cbuf_append_str");
-        goto done;
-    }
     if (restconf_reply_header(req, "Content-Type", "%s", media) < 0)
         goto done;
-    if (restconf_reply_send(req, 200, cbdata, head) < 0)
+#if HTTP_DATA_CACHE_FILE_MAX > 0
+    if (st.st_size > 0 && st.st_size <= HTTP_DATA_CACHE_FILE_MAX){
+        /* Read small file into a cache entry and reply from it */
+        if (http_data_cache_add(h, filename, &st, fd, &hf) < 0)
+            goto done;
+        if (hf == NULL){
+            if (api_http_data_err(h, req, 500) < 0) /* Internal error? */
+                goto done;
+            goto ok;
+        }
+        hf->hf_refs++;
+        if (restconf_reply_send_buf(req, 200, hf->hf_data, hf->hf_size, head,
+                                    http_data_file_release, hf) < 0)
+            goto done;
+        goto ok;
+    }
+#endif
+    if (restconf_reply_send_file(req, 200, fd, st.st_size, head) < 0){
+        fd = -1;
         goto done;
-    cbdata = NULL; /* consumed by reply-send */
+    }
+    fd = -1; /* consumed by reply-send */
     clicon_debug(1, "%s Read %s OK", __FUNCTION__, filename);
  ok:
     retval = 0;
  done:
-    if (buf)
-        free(buf);
-    if (f)
-        fclose(f);
+    if (fd != -1)
+        close(fd);
     if (cbfile)
         cbuf_free(cbfile);
-    if (cbdata)
-        cbuf_free(cbdata);
  return retval;
 }
 
@@ -38,6 +38,12 @@
 #ifndef _RESTCONF_API_H_
 #define _RESTCONF_API_H_
 
+/*
+ * Types
+ */
+/* Release of borrowed reply body, see restconf_reply_send_buf */
+typedef void (restconf_release_fn)(void *arg);
+
 /*
  * Prototypes
  */
@@ -46,6 +52,13 @@ int restconf_reply_header(void *req, const char *name, const char *vfmt, ...)  _
 /* note cb is consumed dont free */
 int restconf_reply_send(void *req, int code, cbuf *cb, int head);
 
+/* note fd is consumed dont close */
+int restconf_reply_send_file(void *req, int code, int fd, size_t len, int head);
+
+/* note buf is borrowed until fn is called */
+int restconf_reply_send_buf(void *req, int code, char *buf, size_t len, int head,
+                            restconf_release_fn *fn, void *arg);
+
 cbuf *restconf_get_indata(void *req);
 
 #endif /* _RESTCONF_API_H_ */
@@ -221,6 +221,92 @@ restconf_reply_send(void  *req0,
     return retval;
 }
 
+/*! Send HTTP reply with message body read from a file
+ * @param[in]     req   Fastcgi request handle
+ * @param[in]     code  Status code
+ * @param[in]     fd    Open file positioned at start of body. Note is consumed
+ * @param[in]     len   Length of body
+ * @param[in]     head  Only send headers, dont send body. 
+ * @see restconf_reply_send
+ */
+int
+restconf_reply_send_file(void  *req0,
+                         int    code,
+                         int    fd,
+                         size_t len,
+                         int    head)
+{
+    FCGX_Request *req = (FCGX_Request *)req0;
+    int           retval = -1;
+    const char   *reason_phrase;
+    char          buf[BUFSIZ];
+    ssize_t       n;
+
+    FCGX_SetExitStatus(code, req->out);
+    if ((reason_phrase = restconf_code2reason(code)) == NULL)
+        reason_phrase="";
+    if (restconf_reply_header(req, "Status", "%d %s", code, reason_phrase) < 0)
+        goto done;
+    if (restconf_reply_header(req, "Content-Length", "%zu", len) < 0)
+        goto done;
+    FCGX_FPrintF(req->out, "\r\n");
+    while (!head && len > 0){
+        if ((n = read(fd, buf, len<sizeof(buf)?len:sizeof(buf))) < 0){
+            clicon_err(OE_UNIX, errno, "read");
+            goto done;
+        }
+        if (n == 0)
+            break;
+        FCGX_PutStr(buf, n, req->out);
+        len -= n;
+    }
+    FCGX_FFlush(req->out);
+    retval = 0;
+ done:
+    close(fd);
+    return retval;
+}
+
+/*! Send HTTP reply with a message body that is borrowed, not copied
+ * @param[in]     req   Fastcgi request handle
+ * @param[in]     code  Status code
+ * @param[in]     buf   Body
+ * @param[in]     len   Length of body
+ * @param[in]     head  Only send headers, dont send body. 
+ * @param[in]     fn    Called with arg when buf is not used anymore
+ * @param[in]     arg   Argument to fn
+ * @see restconf_reply_send
+ */
+int
+restconf_reply_send_buf(void                *req0,
+                        int                  code,
+                        char                *buf,
+                        size_t               len,
+                        int                  head,
+                        restconf_release_fn *fn,
+                        void                *arg)
+{
+    FCGX_Request *req = (FCGX_Request *)req0;
+    int           retval = -1;
+    const char   *reason_phrase;
+
+    FCGX_SetExitStatus(code, req->out);
+    if ((reason_phrase = restconf_code2reason(code)) == NULL)
+        reason_phrase="";
+    if (restconf_reply_header(req, "Status", "%d %s", code, reason_phrase) < 0)
+        goto done;
+    if (restconf_reply_header(req, "Content-Length", "%zu", len) < 0)
+        goto done;
+    FCGX_FPrintF(req->out, "\r\n");
+    if (!head && len)
+        FCGX_PutStr(buf, len, req->out);
+    FCGX_FFlush(req->out);
+    retval = 0;
+ done:
+    fn(arg);
+    return retval;
+}
+
 /*! Get input data from http request, eg such as curl -X PUT http://... <indata>
  * @param[in]  req        Fastcgi request handle
  * @retval     indata     
@@ -49,6 +49,9 @@
 #include <arpa/inet.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 #ifdef HAVE_LIBNGHTTP2
 #include <nghttp2/nghttp2.h>
@@ -61,9 +64,15 @@
 #include <clixon/clixon.h>
 
 #include "restconf_lib.h"
+#include "restconf_handle.h"
 #include "restconf_api.h"  /* Virtual api */
 #include "restconf_native.h"
 
+#ifdef HAVE_LIBZ
+/* Size of output chunks of reply compression */
+#define NATIVE_COMPRESS_CHUNK 16384
+#endif
+
 /*! Add HTTP header field name and value to reply
  * @param[in]  req   request handle
  * @param[in]  name  HTTP header field name
@@ -120,6 +129,147 @@ restconf_reply_header(void       *req0,
     return retval;
 }
 
+#ifdef HAVE_LIBZ
+/*! Select content coding of reply from Accept-Encoding request header
+ *
+ * gzip is preferred over deflate. Codings with q=0 are not acceptable, other q-values are
+ * not compared.
+ * @param[in]  accept  Value of Accept-Encoding header, eg "gzip, deflate, br;q=0.5"
+ * @retval     coding  "gzip" or "deflate"
+ * @retval     NULL    No supported coding acceptable, do not compress
+ * @see RFC 9110 Sec 12.5.3
+ */
+static const char *
+native_accept_encoding(const char *accept)
+{
+    const char *s = accept;
+    const char *p;
+    size_t      len;
+    size_t      toklen;
+    int         gzip = 0;
+    int         deflate = 0;
+    int         star = 0;
+    int         ok;
+
+    while (*s){
+        s += strspn(s, " \t,");
+        if ((len = strcspn(s, ",")) == 0)
+            break;
+        toklen = strcspn(s, " \t;,");
+        /* Coding with weight q=0 is not acceptable */
+        ok = 1;
+        if ((p = memchr(s, ';', len)) != NULL){
+            p += strspn(p+1, " \t") + 1;
+            if (strncasecmp(p, "q=", 2) == 0 && atof(p+2) == 0.0)
+                ok = -1;
+        }
+        if ((toklen == 4 && strncasecmp(s, "gzip", 4) == 0) ||
+            (toklen == 6 && strncasecmp(s, "x-gzip", 6) == 0))
+            gzip = ok;
+        else if (toklen == 7 && strncasecmp(s, "deflate", 7) == 0)
+            deflate = ok;
+        else if (toklen == 1 && *s == '*')
+            star = ok;
+        s += len;
+    }
+    if (gzip > 0 || (gzip == 0 && star > 0))
+        return "gzip";
+    if (deflate > 0 || (deflate == 0 && star > 0))
+        return "deflate";
+    return NULL;
+}
+
+/*! Compress reply body if client accepts it and body is large enough
+ *
+ * The body is deflated in fixed size output chunks into a new buffer which replaces the
+ * original body. A Content-Encoding header is added. The body is kept as is if it is
+ * not made smaller.
+ * Note the whole body is compressed before the reply is sent since HTTP/1 replies carry
+ * a Content-Length, see restconf_http1_reply()
+ * @param[in]     h     Clixon handle
+ * @param[in]     sd    Http stream
+ * @param[in]     buf   Reply body
+ * @param[in]     len   Length of reply body
+ * @param[out]    cbzp  Compressed body if compressed, otherwise NULL. Free with cbuf_free
+ * @retval        0     OK
+ * @retval       -1     Error
+ * @see compression-min-size and compression-level in clixon-restconf.yang
+ */
+static int
+native_reply_compress(clicon_handle         h,
+                      restconf_stream_data *sd,
+                      char                 *buf,
+                      size_t                len,
+                      cbuf                **cbzp)
+{
+    int                     retval = -1;
+    restconf_native_handle *rn;
+    cbuf                   *cbz = NULL;
+    const char             *coding;
+    char                   *accept;
+    z_stream                zs = {0,};
+    int                     zinit = 0;
+    unsigned char           out[NATIVE_COMPRESS_CHUNK];
+    int                     ret;
+
+    if ((rn = restconf_native_handle_get(h)) == NULL ||
+        rn->rn_compress_min == 0 ||
+        len < rn->rn_compress_min)
+        goto ok;
+    if (sd->sd_code < 200 || sd->sd_code == 204 || sd->sd_code == 304)
+        goto ok;
+    if (cvec_find(sd->sd_outp_hdrs, "Content-Encoding") != NULL)
+        goto ok;
+    /* Reply depends on Accept-Encoding, also if not compressed */
+    if (restconf_reply_header(sd, "Vary", "Accept-Encoding") < 0)
+        goto done;
+    if ((accept = restconf_param_get(h, "HTTP_ACCEPT_ENCODING")) == NULL ||
+        (coding = native_accept_encoding(accept)) == NULL)
+        goto ok;
+    if ((cbz = cbuf_new_alloc(len/4 + NATIVE_COMPRESS_CHUNK)) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new_alloc");
+        goto done;
+    }
+    /* windowBits 15 + 16 makes a gzip header and trailer, otherwise zlib (deflate) */
+    if (deflateInit2(&zs, rn->rn_compress_level, Z_DEFLATED,
+                     strcmp(coding, "gzip")==0 ? 15+16 : 15,
+                     8, Z_DEFAULT_STRATEGY) != Z_OK){
+        clicon_err(OE_RESTCONF, 0, "deflateInit2: %s", zs.msg?zs.msg:"error");
+        goto done;
+    }
+    zinit++;
+    zs.next_in = (unsigned char*)buf;
+    zs.avail_in = len;
+    do {
+        zs.next_out = out;
+        zs.avail_out = sizeof(out);
+        if ((ret = deflate(&zs, Z_FINISH)) == Z_STREAM_ERROR){
+            clicon_err(OE_RESTCONF, 0, "deflate: %s", zs.msg?zs.msg:"error");
+            goto done;
+        }
+        if (cbuf_append_buf(cbz, out, sizeof(out) - zs.avail_out) < 0){
+            clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+            goto done;
+        }
+        if (cbuf_len(cbz) >= len) /* Not smaller */
+            goto ok;
+    } while (ret != Z_STREAM_END);
+    if (restconf_reply_header(sd, "Content-Encoding", "%s", coding) < 0)
+        goto done;
+    clicon_debug(1, "%s %s %zu -> %zu", __FUNCTION__, coding, len, cbuf_len(cbz));
+    *cbzp = cbz;
+    cbz = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (zinit)
+        deflateEnd(&zs);
+    if (cbz)
+        cbuf_free(cbz);
+    return retval;
+}
+#endif /* HAVE_LIBZ */
+
 /*! Send HTTP reply with potential message body
  * @param[in]     req   http request handle
  * @param[in]     code  Status code
@@ -127,6 +277,7 @@ restconf_reply_header(void       *req0,
  * @param[in]     head  Only send headers, dont send body. 
  * 
  * Prerequisites: status code set, headers given, body if wanted set
+ * The body may be compressed here, see native_reply_compress
  */
 int
 restconf_reply_send(void  *req0,
@@ -145,6 +296,20 @@ restconf_reply_send(void  *req0,
     sd->sd_code = code;
     if (cb != NULL){
         if (cbuf_len(cb)){
+#ifdef HAVE_LIBZ
+            cbuf *cbz = NULL;
+
+            if (sd->sd_conn &&
+                native_reply_compress(sd->sd_conn->rc_h, sd,
+                                      cbuf_get(cb), cbuf_len(cb), &cbz) < 0){
+                cbuf_free(cb);
+                goto done;
+            }
+            if (cbz){
+                cbuf_free(cb);
+                cb = cbz;
+            }
+#endif
             sd->sd_body_len = cbuf_len(cb); 
             if (head){
                 cbuf_free(cb);
@@ -166,6 +331,120 @@ restconf_reply_send(void  *req0,
     return retval;
 }
 
+/*! Send HTTP reply with message body read from a file
+ *
+ * The body is not read here, the file is sent when the reply is written, with
+ * sendfile(2) for HTTP/1 if possible, see native_buf_sendfile
+ * @param[in]  req   http request handle
+ * @param[in]  code  Status code
+ * @param[in]  fd    Open file positioned at start of body. Note is consumed
+ * @param[in]  len   Length of body
+ * @param[in]  head  Only send headers, dont send body. 
+ * @see restconf_reply_send
+ */
+int
+restconf_reply_send_file(void  *req0,
+                         int    code,
+                         int    fd,
+                         size_t len,
+                         int    head)
+{
+    int                   retval = -1;
+    restconf_stream_data *sd = (restconf_stream_data *)req0;
+
+    clicon_debug(1, "%s code:%d len:%zu", __FUNCTION__, code, len);
+    if (sd == NULL){
+        clicon_err(OE_CFG, EINVAL, "sd is NULL");
+        close(fd);
+        goto done;
+    }
+    sd->sd_code = code;
+    sd->sd_body_len = len;
+    if (head || len == 0)
+        close(fd);
+    else {
+        if (sd->sd_fd != -1)
+            close(sd->sd_fd);
+        sd->sd_fd = fd;
+        sd->sd_body_offset = 0;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Send HTTP reply with a message body that is borrowed, not copied
+ *
+ * The body is written directly from buf when the reply is written. The caller keeps
+ * buf valid until fn is called, which is when the reply is written, or directly if
+ * the body is not sent, eg HEAD or compressed.
+ * @param[in]  req   http request handle
+ * @param[in]  code  Status code
+ * @param[in]  buf   Body
+ * @param[in]  len   Length of body
+ * @param[in]  head  Only send headers, dont send body. 
+ * @param[in]  fn    Called with arg when buf is not used anymore
+ * @param[in]  arg   Argument to fn
+ * @see restconf_reply_send
+ */
+int
+restconf_reply_send_buf(void                *req0,
+                        int                  code,
+                        char                *buf,
+                        size_t               len,
+                        int                  head,
+                        restconf_release_fn *fn,
+                        void                *arg)
+{
+    int                   retval = -1;
+    restconf_stream_data *sd = (restconf_stream_data *)req0;
+#ifdef HAVE_LIBZ
+    cbuf                 *cbz = NULL;
+#endif
+
+    clicon_debug(1, "%s code:%d len:%zu", __FUNCTION__, code, len);
+    if (sd == NULL){
+        clicon_err(OE_CFG, EINVAL, "sd is NULL");
+        fn(arg);
+        goto done;
+    }
+    sd->sd_code = code;
+    sd->sd_body_len = len;
+#ifdef HAVE_LIBZ
+    if (len && sd->sd_conn &&
+        native_reply_compress(sd->sd_conn->rc_h, sd, buf, len, &cbz) < 0){
+        fn(arg);
+        goto done;
+    }
+    if (cbz){
+        fn(arg);
+        sd->sd_body_len = cbuf_len(cbz);
+        if (head)
+            cbuf_free(cbz);
+        else{
+            sd->sd_body = cbz;
+            sd->sd_body_offset = 0;
+        }
+        goto ok;
+    }
+#endif
+    if (head || len == 0)
+        fn(arg);
+    else {
+        restconf_stream_body_release(sd);
+        sd->sd_body_ref = buf;
+        sd->sd_body_release = fn;
+        sd->sd_body_arg = arg;
+        sd->sd_body_offset = 0;
+    }
+#ifdef HAVE_LIBZ
+ ok:
+#endif
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Get input data from http request, eg such as curl -X PUT http://... <indata>
  * @param[in]  req        Request handle
  * @note: reuses cbuf from stream-data
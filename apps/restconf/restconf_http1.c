@@ -40,8 +40,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <strings.h>
+#include <ctype.h>
 #include <inttypes.h>
 #include <syslog.h>
 #include <errno.h>
@@ -66,6 +69,7 @@
 #include "restconf_err.h"
 #include "clixon_http1_parse.h"
 #include "restconf_http1.h"
+#include "restconf_stream.h"
 #include "clixon_http_data.h"
 
 /* Size of xml read buffer */
@@ -237,6 +241,287 @@ clixon_http1_parse_buf(clicon_handle  h,
     return ret;
 }
 
+/*! Check if character is a token character
+ * tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." /
+ *         "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+ */
+static int
+http1_tchar(char c)
+{
+    return isalnum(c & 0xff) || (c != '\0' && strchr("!#$%&'*+-.^_`|~", c) != NULL);
+}
+
+/*! Check if characters at p is a path or query character
+ * pchar = unreserved / pct-encoded / sub-delims / ":" / "@"
+ * @param[in]  p      Characters
+ * @param[in]  end    End of characters
+ * @param[in]  extra  Extra allowed characters, eg "/" for path and "/?" for query
+ * @retval     n      Number of characters (3 if pct-encoded)
+ * @retval     0      Not a pchar
+ */
+static int
+http1_pchar(char       *p,
+            char       *end,
+            const char *extra)
+{
+    if (p >= end || *p == '\0')
+        return 0;
+    if (isalnum(*p & 0xff) || strchr("-._~!$&'()*+,;=:@", *p) != NULL || strchr(extra, *p) != NULL)
+        return 1;
+    if (*p == '%' && end - p >= 3 && isxdigit(p[1] & 0xff) && isxdigit(p[2] & 0xff))
+        return 3;
+    return 0;
+}
+
+/*! Check if a comma-separated header field value contains a token, case-insensitive
+ * @param[in]  val    Header field value
+ * @param[in]  token  Token, eg "close"
+ */
+static int
+http1_value_has_token(http1_span *val,
+                      const char *token)
+{
+    char  *p = val->hs_str;
+    char  *end = val->hs_str + val->hs_len;
+    char  *q;
+    size_t len = strlen(token);
+
+    while (p < end){
+        while (p < end && (*p == ',' || *p == ' ' || *p == '\t'))
+            p++;
+        q = p;
+        while (q < end && *q != ',' && *q != ' ' && *q != '\t')
+            q++;
+        if (q - p == len && strncasecmp(p, token, len) == 0)
+            return 1;
+        p = q;
+    }
+    return 0;
+}
+
+/*! Parse HTTP/1 request line and header fields
+ *
+ * Incremental and non-allocating: the result is spans into buf, and the search for the end of the
+ * header starts where the previous call for the same request ended.
+ * Content-Length, Connection and Expect header fields are also interpreted.
+ * @param[in]     buf    Input buffer, starting with a request line
+ * @param[in]     len    Length of input buffer
+ * @param[in,out] scan   Bytes of buf already searched for end of header, set to 0 for new request
+ * @param[out]    hr     Request, valid if retval is 1
+ * @retval        1      OK, complete request header of length hr_len, body may follow
+ * @retval        0      Incomplete, read more data
+ * @retval       -1      Malformed request, clicon_err called
+ * @see RFC 7230 Sec 3
+ */
+int
+http1_request_parse(char          *buf,
+                    size_t         len,
+                    size_t        *scan,
+                    http1_request *hr)
+{
+    char       *p;
+    char       *q;
+    char       *end;
+    char       *eol;
+    size_t      i;
+    size_t      hdrlen = 0;
+    int         n;
+    int         keepalive = 0;
+    int         conn_close = 0;
+    uint64_t    clen;
+    http1_span *name;
+    http1_span *val;
+
+    /* Find end of header (empty line), continue where last search ended */
+    for (i = *scan>2?*scan-2:0; i+1 < len; i++){
+        if (buf[i] != '\n')
+            continue;
+        if (buf[i+1] == '\n'){
+            hdrlen = i + 2;
+            break;
+        }
+        if (buf[i+1] == '\r' && i+2 < len && buf[i+2] == '\n'){
+            hdrlen = i + 3;
+            break;
+        }
+    }
+    if (i+1 >= len || (buf[i+1] == '\r' && i+2 >= len)){
+        *scan = len;
+        if (len > HTTP1_HEADER_LEN_MAX){
+            clicon_err(OE_RESTCONF, E2BIG, "Request header too long");
+            return -1;
+        }
+        return 0;
+    }
+    memset(hr, 0, offsetof(http1_request, hr_names));
+    hr->hr_len = hdrlen;
+    end = buf + i + 1; /* Empty line */
+    /* request-line = method SP request-target SP HTTP-version CRLF */
+    p = q = buf;
+    while (q < end && http1_tchar(*q))
+        q++;
+    if (q == p || *q != ' ')
+        goto malformed;
+    hr->hr_method.hs_str = p;
+    hr->hr_method.hs_len = q - p;
+    /* origin-form = absolute-path [ "?" query ] */
+    p = ++q;
+    if (*p != '/')
+        goto malformed;
+    while ((n = http1_pchar(q, end, "/")) > 0)
+        q += n;
+    hr->hr_path.hs_str = p;
+    hr->hr_path.hs_len = q - p;
+    if (*q == '?'){
+        p = ++q;
+        while ((n = http1_pchar(q, end, "/?")) > 0)
+            q += n;
+        hr->hr_query.hs_str = p;
+        hr->hr_query.hs_len = q - p;
+    }
+    if (*q++ != ' ')
+        goto malformed;
+    /* HTTP-version = "HTTP/" DIGIT "." DIGIT */
+    if (end - q < 9 || strncmp(q, "HTTP/", 5) != 0 ||
+        !isdigit(q[5] & 0xff) || q[6] != '.' || !isdigit(q[7] & 0xff))
+        goto malformed;
+    hr->hr_d1 = q[5] - '0';
+    hr->hr_d2 = q[7] - '0';
+    q += 8;
+    /* header-field = field-name ":" OWS field-value OWS CRLF
+     * Lines may also end with LF only, RFC 7230 Sec 3.5 */
+    for (; q < end; q++){
+        if (*q == '\r' && q[1] == '\n')
+            q++;
+        if (*q != '\n')
+            goto malformed;
+        p = q + 1;
+        if (p == end)
+            break;
+        if (hr->hr_nhdrs == HTTP1_HEADERS_MAX){
+            clicon_err(OE_RESTCONF, E2BIG, "Too many header fields");
+            return -1;
+        }
+        q = p;
+        while (q < end && http1_tchar(*q))
+            q++;
+        if (q == p || *q != ':')
+            goto malformed;
+        name = &hr->hr_names[hr->hr_nhdrs];
+        name->hs_str = p;
+        name->hs_len = q - p;
+        q++;
+        while (*q == ' ' || *q == '\t')
+            q++;
+        p = q;
+        /* No control characters in field value, there is always a LF before end */
+        while (*q != '\r' && *q != '\n'){
+            if (((*q & 0xff) < 0x20 && *q != '\t') || *q == 0x7f)
+                goto malformed;
+            q++;
+        }
+        for (eol = q; eol > p && (eol[-1] == ' ' || eol[-1] == '\t'); eol--);
+        val = &hr->hr_values[hr->hr_nhdrs++];
+        val->hs_str = p;
+        val->hs_len = eol - p;
+        if (name->hs_len == strlen("Content-Length") &&
+            strncasecmp(name->hs_str, "Content-Length", name->hs_len) == 0){
+            if (val->hs_len == 0 || val->hs_len > 15)
+                goto malformed;
+            for (clen = 0, i = 0; i < val->hs_len; i++){
+                if (!isdigit(val->hs_str[i] & 0xff))
+                    goto malformed;
+                clen = clen*10 + val->hs_str[i] - '0';
+            }
+            /* Several differing Content-Length is an error, RFC 7230 Sec 3.3.2 */
+            if (hr->hr_clen_set && hr->hr_clen != clen)
+                goto malformed;
+            hr->hr_clen = clen;
+            hr->hr_clen_set = 1;
+        }
+        else if (name->hs_len == strlen("Transfer-Encoding") &&
+                 strncasecmp(name->hs_str, "Transfer-Encoding", name->hs_len) == 0){
+            clicon_err(OE_RESTCONF, EINVAL, "Transfer-Encoding not supported");
+            return -1;
+        }
+        else if (name->hs_len == strlen("Connection") &&
+                 strncasecmp(name->hs_str, "Connection", name->hs_len) == 0){
+            conn_close |= http1_value_has_token(val, "close");
+            keepalive |= http1_value_has_token(val, "keep-alive");
+        }
+        else if (name->hs_len == strlen("Expect") &&
+                 strncasecmp(name->hs_str, "Expect", name->hs_len) == 0){
+            hr->hr_expect = (val->hs_len == strlen("100-continue") &&
+                             strncasecmp(val->hs_str, "100-continue", val->hs_len) == 0);
+        }
+    }
+    /* HTTP/1.1 is persistent by default, HTTP/1.0 only with keep-alive, RFC 7230 Sec 6.3 */
+    if (conn_close || (hr->hr_d1 == 1 && hr->hr_d2 == 0 && !keepalive))
+        hr->hr_close = 1;
+    return 1;
+ malformed:
+    clicon_err(OE_RESTCONF, EINVAL, "Malformed HTTP/1 request at offset %zu", (size_t)(q - buf));
+    return -1;
+}
+
+/*! Set restconf request parameters from parsed HTTP/1 request header
+ *
+ * The spans of the request are null-terminated in place, ie buf given to http1_request_parse
+ * is modified and should not be parsed again.
+ * @param[in]  h    Clixon handle
+ * @param[in]  rc   Restconf connection
+ * @param[in]  sd   Restconf stream data (for http1 only stream 0)
+ * @param[in]  hr   Parsed request, see http1_request_parse
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+int
+http1_request_set(clicon_handle         h,
+                  restconf_conn        *rc,
+                  restconf_stream_data *sd,
+                  http1_request        *hr)
+{
+    int         retval = -1;
+    http1_span *path;
+    size_t      len;
+    int         i;
+
+#ifdef RESTCONF_HTTP1_YACC
+    if (clixon_http1_parse_buf(h, rc, hr->hr_method.hs_str, hr->hr_len) < 0)
+        goto done;
+#else
+    hr->hr_method.hs_str[hr->hr_method.hs_len] = '\0';
+    if (restconf_param_set(h, "REQUEST_METHOD", hr->hr_method.hs_str) < 0)
+        goto done;
+    /* Not according to standards: trailing / is removed */
+    path = &hr->hr_path;
+    len = path->hs_len;
+    if (len > 1 && path->hs_str[len-1] == '/')
+        len--;
+    path->hs_str[len] = '\0';
+    if (restconf_param_set(h, "REQUEST_URI", path->hs_str) < 0)
+        goto done;
+    if (hr->hr_query.hs_str != NULL){
+        hr->hr_query.hs_str[hr->hr_query.hs_len] = '\0';
+        if (uri_str2cvec(hr->hr_query.hs_str, '&', '=', 1, &sd->sd_qvec) < 0)
+            goto done;
+    }
+    rc->rc_proto_d1 = hr->hr_d1;
+    rc->rc_proto_d2 = hr->hr_d2;
+    for (i=0; i<hr->hr_nhdrs; i++){
+        if (hr->hr_values[i].hs_len == 0)
+            continue;
+        hr->hr_names[i].hs_str[hr->hr_names[i].hs_len] = '\0';
+        hr->hr_values[i].hs_str[hr->hr_values[i].hs_len] = '\0';
+        if (restconf_convert_hdr(h, hr->hr_names[i].hs_str, hr->hr_values[i].hs_str) < 0)
+            goto done;
+    }
+#endif
+    retval = 0;
+ done:
+    return retval;
+}
+
 #ifdef HAVE_LIBNGHTTP2
 /*! Check http/1 UPGRADE to http/2
  * If upgrade headers are encountered AND http/2 is configured, then 
@@ -292,7 +577,8 @@ http1_upgrade_http2(clicon_handle         h,
 }
 #endif /* HAVE_LIBNGHTTP2 */
 
-/*! Construct an HTTP/1 reply (dont actually send it)
+/*! Construct HTTP/1 reply status line and headers (dont actually send it)
+ * The body is sent separately, see restconf_http1_process
  */
 static int
 restconf_http1_reply(restconf_conn        *rc,
@@ -309,7 +595,8 @@ restconf_http1_reply(restconf_conn        *rc,
      * (Successful) response to a CONNECT request (Section 4.3.6 of
      * [RFC7231]).
      */
-    if (sd->sd_code != 204 && sd->sd_code > 199)
+    /* Event stream body is written as events arrive and ends when connection is closed */
+    if (sd->sd_code != 204 && sd->sd_code != 304 && sd->sd_code > 199 && !sd->sd_sse)
         if (restconf_reply_header(sd, "Content-Length", "%zu", sd->sd_body_len) < 0)
             goto done;  
     /* Create reply and write headers */
@@ -328,15 +615,7 @@ restconf_http1_reply(restconf_conn        *rc,
     while ((cv = cvec_each(sd->sd_outp_hdrs, cv)) != NULL)
         cprintf(sd->sd_outp_buf, "%s: %s\r\n", cv_name_get(cv), cv_string_get(cv));
     cprintf(sd->sd_outp_buf, "\r\n");
-    /* Write a body */
-    if (sd->sd_body){
-        if (cbuf_append_buf(sd->sd_outp_buf, cbuf_get(sd->sd_body), cbuf_len(sd->sd_body)) < 0){
-            clicon_err(OE_RESTCONF, errno, "cbuf_append_buf");
-            goto done;
-        }
-        cbuf_free(sd->sd_body);
-        sd->sd_body = NULL;
-    }
+    /* Body is not copied here, it is written separately from sd_body, sd_body_ref or sd_fd */
     retval = 0;
  done:
     return retval;
@@ -430,8 +709,9 @@ restconf_http1_path_root(clicon_handle  h,
     /* Matching algorithm:
      * 1. try well-known
      * 2. try /restconf
-     * 3. try /data
-     * 4. call restconf anyway (because it handles errors a la restconf)
+     * 3. try /streams
+     * 4. try /data
+     * 5. call restconf anyway (because it handles errors a la restconf)
      * This is for the situation where data is / and /restconf is more specific
      */
     if (strcmp(sd->sd_path, RESTCONF_WELL_KNOWN) == 0){
@@ -442,6 +722,10 @@ restconf_http1_path_root(clicon_handle  h,
         if (api_root_restconf(h, sd, sd->sd_qvec) < 0)
             goto done;
     }
+    else if (api_path_is_stream(h)){
+        if (api_stream(h, sd, sd->sd_qvec, NULL) < 0)
+            goto done;
+    }
     else if (api_path_is_data(h)){
         if (api_http_data(h, sd, sd->sd_qvec) < 0)
             goto done;
@@ -469,68 +753,18 @@ restconf_http1_path_root(clicon_handle  h,
     return retval;
 }
 
-/*! Check expect header, if found generate a Continue reply
+/*! Generate a Continue reply to an Expect: 100-continue request
  *
- * @param[in] h   Clixon handle
  * @param[in] rc  Restconf connection
  * @param[in] sd  Restconf stream data (for http1 only stream 0)
- * @retval    1   OK, Send continue 
- * @retval    0   OK, Dont send continue
+ * @retval    0   OK, send continue by flushing stream buffer after the call
  * @retval   -1   Error
  * @see rfc7231 Sec 5.1.1
  */
 int
-http1_check_expect(clicon_handle         h,
-                   restconf_conn        *rc,
-                   restconf_stream_data *sd)
-{
-    int    retval = -1;
-    char  *val;
-    
-    if ((val = restconf_param_get(h, "HTTP_EXPECT")) != NULL &&
-        strcmp(val, "100-continue") == 0){ /* just drop if not well-formed */
-        sd->sd_code = 100;
-        if (restconf_http1_reply(rc, sd) < 0)
-            goto done;
-        retval = 1; /* send continue by flushing stream buffer after the call */
-    }
-    else
-        retval = 0;
- done:
-    return retval;
-}
-
-/*! Is there more data to be read?
- *
- * Use Content-Length header as an indicator on the status of reading an input message:
- * 0: No Content-Length or 0
- *    Either message header not fully read OR header does not contain Content-Length
- * 1: Content-Length found but body has fewer bytes, ie remaining bytes to read
- * 2: Content-Length found and matches body length. No more bytes to read
- * @param[in]  h       Clixon handle
- * @param[in]  sd      Restconf stream data (for http1 only stream 0)
- * @param[out] status  0-2, see description above
- * @retval     0       OK, see status param
- * @retval    -1       Error
- */
-int
-http1_check_content_length(clicon_handle         h,
-                           restconf_stream_data *sd,
-                           int                  *status)
+http1_send_continue(restconf_conn        *rc,
+                    restconf_stream_data *sd)
 {
-    int   retval = -1;
-    char *val;
-    int   len;
-    
-    if ((val = restconf_param_get(h, "HTTP_CONTENT_LENGTH")) == NULL ||
-        (len = atoi(val)) == 0)
-        *status = 0;
-    else{
-        if (cbuf_len(sd->sd_indata) < len)
-            *status = 1;
-        else
-            *status = 2;
-    }
-    retval = 0;
-    return retval;
+    sd->sd_code = 100;
+    return restconf_http1_reply(rc, sd);
 }
@@ -36,14 +36,52 @@
 #ifndef _RESTCONF_HTTP1_H_
 #define _RESTCONF_HTTP1_H_
 
+/*
+ * Constants
+ */
+/* Max number of header fields in a request */
+#define HTTP1_HEADERS_MAX 64
+
+/* Max length of request line and header fields */
+#define HTTP1_HEADER_LEN_MAX 65536
+
+/*
+ * Types
+ */
+/* Span of characters in the input buffer, not null-terminated */
+typedef struct {
+    char   *hs_str;
+    size_t  hs_len;
+} http1_span;
+
+/* HTTP/1 request line and header fields as spans into the input buffer
+ * @see http1_request_parse
+ */
+typedef struct {
+    size_t     hr_len;       /* Length of request line and headers including empty line */
+    size_t     hr_clen;      /* Content-Length, 0 if none */
+    int        hr_clen_set;  /* Content-Length header field seen */
+    int        hr_expect;    /* Expect: 100-continue */
+    int        hr_close;     /* Close connection after reply */
+    http1_span hr_method;
+    http1_span hr_path;      /* Request target without query */
+    http1_span hr_query;     /* Query without '?', hs_str is NULL if no query */
+    int        hr_d1;        /* HTTP version digit 1 */
+    int        hr_d2;        /* HTTP version digit 2 */
+    int        hr_nhdrs;     /* Number of header fields */
+    http1_span hr_names[HTTP1_HEADERS_MAX];
+    http1_span hr_values[HTTP1_HEADERS_MAX]; /* Without leading and trailing whitespace */
+} http1_request;
+
 /*
  * Prototypes
  */
 int clixon_http1_parse_file(clicon_handle h, restconf_conn *rc, FILE *f, const char *filename);
 int clixon_http1_parse_string(clicon_handle h, restconf_conn *rc, char *str);
 int clixon_http1_parse_buf(clicon_handle h, restconf_conn *rc, char *buf, size_t n);
+int http1_request_parse(char *buf, size_t len, size_t *scan, http1_request *hr);
+int http1_request_set(clicon_handle h, restconf_conn *rc, restconf_stream_data *sd, http1_request *hr);
 int restconf_http1_path_root(clicon_handle h, restconf_conn *rc);
-int http1_check_expect(clicon_handle h, restconf_conn *rc, restconf_stream_data *sd);
-int http1_check_content_length(clicon_handle h, restconf_stream_data *sd, int *status);
+int http1_send_continue(restconf_conn *rc, restconf_stream_data *sd);
 
 #endif  /* _RESTCONF_HTTP1_H_ */
@@ -818,6 +818,7 @@ restconf_config_init(clicon_handle h,
  * @param[in]  port      TCP port
  * @param[in]  backlog  Listen backlog, queie of pending connections
  * @param[in]  flags    Socket flags OR:ed in with the socket(2) type parameter
+ * @param[in]  reuseport If set, several processes may bind the same address, see CLICON_RESTCONF_WORKERS
  * @param[out] ss        Server socket (bound for accept)
  */
 int
@@ -827,6 +828,7 @@ restconf_socket_init(const char   *netns0,
                      uint16_t      port,
                      int           backlog,
                      int           flags,
+                     int           reuseport,
                      int          *ss)
 {
     int                 retval = -1;
@@ -843,7 +845,7 @@ restconf_socket_init(const char   *netns0,
         netns = netns0;
     if (clixon_inet2sin(addrtype, addrstr, port, sa, &sa_len) < 0)
         goto done;
-    if (clixon_netns_socket(netns, sa, sa_len, backlog, flags, addrstr, ss) < 0)
+    if (clixon_netns_socket(netns, sa, sa_len, backlog, flags, reuseport, addrstr, ss) < 0)
         goto done;
     clicon_debug(1, "%s ss=%d", __FUNCTION__, *ss);
     retval = 0;
@@ -852,3 +854,33 @@ restconf_socket_init(const char   *netns0,
     return retval;
 }
 
+/*! Check if If-None-Match request header matches an entity-tag
+ * @param[in]  inm   If-None-Match header value, a list of entity-tags or "*"
+ * @param[in]  etag  Entity tag, eg "1234"
+ * @retval     1     Match
+ * @retval     0     No match
+ * Weak comparison is used, ie a W/ prefix is ignored
+ * @see RFC 7232 Sec 3.2
+ */
+int
+restconf_etag_match(char *inm,
+                    char *etag)
+{
+    char  *p = inm;
+    size_t len = strlen(etag);
+
+    while (*p){
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        if (*p == '*')
+            return 1;
+        if (strncmp(p, "W/", 2) == 0) /* Weak comparison */
+            p += 2;
+        if (strncmp(p, etag, len) == 0 &&
+            (p[len] == '\0' || p[len] == ',' || p[len] == ' ' || p[len] == '\t'))
+            return 1;
+        while (*p && *p != ',')
+            p++;
+    }
+    return 0;
+}
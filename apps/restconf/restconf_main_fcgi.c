@@ -86,6 +86,7 @@
 #include "restconf_methods_get.h"
 #include "restconf_methods_post.h"
 #include "restconf_stream.h"
+#include "clixon_http_data.h"
 
 /* Command line options to be passed to getopt(3) */
 #define RESTCONF_OPTS "hD:f:E:l:p:d:y:a:u:rW:R:o:"
@@ -667,6 +668,7 @@ main(int    argc,
     retval = 0;
  done:
     stream_child_freeall(h);
+    api_http_data_cache_free(h);
     restconf_terminate(h);
     return retval;
 }
@@ -120,12 +120,16 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <inttypes.h>
+#include <time.h>
 #include <syslog.h>
 #include <pwd.h>
 #include <ctype.h>
 #include <assert.h>
 #include <signal.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <sys/resource.h>
@@ -134,6 +138,12 @@
 #include <openssl/rand.h>
 #include <openssl/err.h>
 #include <openssl/x509v3.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
 
 #ifdef HAVE_LIBNGHTTP2
 #include <nghttp2/nghttp2.h>
@@ -152,6 +162,8 @@
 #include "restconf_err.h"
 #include "restconf_root.h"
 #include "restconf_native.h"   /* Restconf-openssl mode specific headers*/
+#include "restconf_stream.h"
+#include "clixon_http_data.h"
 #ifdef HAVE_LIBNGHTTP2
 #include "restconf_nghttp2.h"  /* http/2 */
 #endif
@@ -177,6 +189,22 @@
 /* Cert verify depth: dont know what to set here? */
 #define VERIFY_DEPTH 5
 
+/* A worker that fails within this many seconds from start is not restarted,
+ * see restconf_workers_run */
+#define RESTCONF_WORKER_RESTART_MIN 2
+
+/* Defaults of TLS session options if not in config, see clixon-restconf.yang */
+#define RESTCONF_TLS_SESSION_CACHE_SIZE  20480
+#define RESTCONF_TLS_SESSION_TIMEOUT     300
+#define RESTCONF_TLS_TICKET_KEY_ROTATION 3600
+
+/* Defaults of reply compression options if not in config, see clixon-restconf.yang */
+#define RESTCONF_COMPRESSION_MIN_SIZE 1024
+#define RESTCONF_COMPRESSION_LEVEL    6
+
+/* Length of key name of TLS session ticket, see SSL_CTX_set_tlsext_ticket_key_cb(3) */
+#define RESTCONF_TICKET_KEYNAME_LEN 16
+
 static int             session_id_context = 1;
 
 /*! Set restconf native handle
@@ -391,7 +419,8 @@ restconf_ssl_context_create(clicon_handle h)
     SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_1);
 
     SSL_CTX_set_options(ctx, SSL_MODE_RELEASE_BUFFERS | SSL_OP_NO_COMPRESSION);
-    //    SSL_CTX_set_timeout(ctx, cfg->ssl_ctx_timeout); /* default 300s */
+    /* Sockets are non-blocking: a write that would block is retried from another buffer */
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
     /* Application Layer Protocol Negotiation (alpn) callback */
     SSL_CTX_set_alpn_select_cb(ctx, alpn_select_proto_cb, h);
  done:
@@ -437,7 +466,6 @@ restconf_ssl_context_configure(clixon_handle h,
 
     SSL_CTX_set_session_id_context(ctx, (void *)&session_id_context, sizeof(session_id_context));
     SSL_CTX_set_app_data(ctx, h);
-    SSL_CTX_set_session_cache_mode(ctx, 0);
 
     /* Set the key and cert */
     if (SSL_CTX_use_certificate_chain_file(ctx, server_cert_path) != 1) {
@@ -457,6 +485,228 @@ restconf_ssl_context_configure(clixon_handle h,
     return retval;
 }
 
+/*! Derive TLS session ticket keys of a key rotation period
+ *
+ * The keys are derived from a secret made before worker processes are forked, so that
+ * all workers use the same keys, and a client may resume its session in any worker.
+ * @param[in]  rn      Restconf native handle
+ * @param[in]  period  Key rotation period number
+ * @param[out] name    Key name, RESTCONF_TICKET_KEYNAME_LEN bytes
+ * @param[out] aeskey  Ticket encryption key, 32 bytes
+ * @param[out] hmackey Ticket HMAC key, 32 bytes
+ */
+static void
+restconf_ticket_keys(restconf_native_handle *rn,
+                     uint64_t                period,
+                     unsigned char          *name,
+                     unsigned char          *aeskey,
+                     unsigned char          *hmackey)
+{
+    unsigned char data[9];
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int  mdlen;
+    int           i;
+
+    for (i=0; i<8; i++)
+        data[i+1] = (period >> (56-8*i)) & 0xff;
+    data[0] = 'n';
+    HMAC(EVP_sha256(), rn->rn_ticket_secret, sizeof(rn->rn_ticket_secret),
+         data, sizeof(data), md, &mdlen);
+    memcpy(name, md, RESTCONF_TICKET_KEYNAME_LEN);
+    data[0] = 'a';
+    HMAC(EVP_sha256(), rn->rn_ticket_secret, sizeof(rn->rn_ticket_secret),
+         data, sizeof(data), aeskey, &mdlen);
+    data[0] = 'h';
+    HMAC(EVP_sha256(), rn->rn_ticket_secret, sizeof(rn->rn_ticket_secret),
+         data, sizeof(data), hmackey, &mdlen);
+    OPENSSL_cleanse(md, sizeof(md));
+}
+
+/*! TLS session ticket key callback, encrypt a new ticket or decrypt a ticket from a client
+ *
+ * A new ticket is encrypted with the key of the current rotation period. A ticket encrypted
+ * with the key of the previous period is accepted and renewed, older tickets are ignored
+ * and a full handshake is made.
+ * @param[in]  ssl   SSL connection
+ * @param[in]  name  Key name, set if enc, otherwise name in ticket
+ * @param[in]  iv    Initialization vector, set if enc
+ * @param[in]  cctx  Cipher context to initialize
+ * @param[in]  hctx  HMAC context to initialize
+ * @param[in]  enc   1: encrypt new ticket, 0: decrypt ticket
+ * @retval     2     Ticket decrypted, but renew ticket
+ * @retval     1     OK
+ * @retval     0     Key not found, make full handshake
+ * @retval    -1     Error
+ * @see tls-ticket-key-rotation in clixon-restconf.yang
+ */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int
+restconf_ticket_key_cb(SSL            *ssl,
+                       unsigned char  *name,
+                       unsigned char  *iv,
+                       EVP_CIPHER_CTX *cctx,
+                       EVP_MAC_CTX    *hctx,
+                       int             enc)
+#else
+static int
+restconf_ticket_key_cb(SSL            *ssl,
+                       unsigned char  *name,
+                       unsigned char  *iv,
+                       EVP_CIPHER_CTX *cctx,
+                       HMAC_CTX       *hctx,
+                       int             enc)
+#endif
+{
+    int                     retval = -1;
+    clicon_handle           h;
+    restconf_native_handle *rn;
+    unsigned char           keyname[RESTCONF_TICKET_KEYNAME_LEN];
+    unsigned char           aeskey[32];
+    unsigned char           hmackey[32];
+    uint64_t                period = 0;
+    int                     ret = 1;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM              params[3];
+#endif
+
+    h = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+    if ((rn = restconf_native_handle_get(h)) == NULL)
+        goto done;
+    if (rn->rn_ticket_rotation)
+        period = time(NULL) / rn->rn_ticket_rotation;
+    restconf_ticket_keys(rn, period, keyname, aeskey, hmackey);
+    if (enc){
+        memcpy(name, keyname, RESTCONF_TICKET_KEYNAME_LEN);
+        if (RAND_bytes(iv, EVP_MAX_IV_LENGTH) != 1)
+            goto done;
+        if (EVP_EncryptInit_ex(cctx, EVP_aes_256_cbc(), NULL, aeskey, iv) != 1)
+            goto done;
+    }
+    else {
+        if (memcmp(name, keyname, RESTCONF_TICKET_KEYNAME_LEN) != 0){
+            if (period == 0)
+                goto notfound;
+            restconf_ticket_keys(rn, period-1, keyname, aeskey, hmackey);
+            if (memcmp(name, keyname, RESTCONF_TICKET_KEYNAME_LEN) != 0)
+                goto notfound;
+            ret = 2; /* Previous key: renew ticket */
+        }
+        if (EVP_DecryptInit_ex(cctx, EVP_aes_256_cbc(), NULL, aeskey, iv) != 1)
+            goto done;
+    }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, hmackey, sizeof(hmackey));
+    params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "sha256", 0);
+    params[2] = OSSL_PARAM_construct_end();
+    if (EVP_MAC_CTX_set_params(hctx, params) != 1)
+        goto done;
+#else
+    if (HMAC_Init_ex(hctx, hmackey, sizeof(hmackey), EVP_sha256(), NULL) != 1)
+        goto done;
+#endif
+    retval = ret;
+ done:
+    OPENSSL_cleanse(aeskey, sizeof(aeskey));
+    OPENSSL_cleanse(hmackey, sizeof(hmackey));
+    return retval;
+ notfound:
+    retval = 0;
+    goto done;
+}
+
+/*! Get uint32 option from restconf config
+ * @param[in]  xrestconf  XML restconf config
+ * @param[in]  name       Name of option
+ * @param[out] val        Value, not changed if option is not set
+ * @retval     0          OK
+ * @retval    -1          Error
+ */
+static int
+restconf_config_uint32(cxobj      *xrestconf,
+                       const char *name,
+                       uint32_t   *val)
+{
+    int   retval = -1;
+    char *str;
+    char *reason = NULL;
+    int   ret;
+
+    if ((str = xml_find_body(xrestconf, (char*)name)) != NULL){
+        if ((ret = parse_uint32(str, val, &reason)) < 0){
+            clicon_err(OE_XML, errno, "parse_uint32");
+            goto done;
+        }
+        if (ret == 0){
+            clicon_err(OE_XML, EINVAL, "Unrecognized value of %s: %s", name, str);
+            goto done;
+        }
+    }
+    retval = 0;
+ done:
+    if (reason)
+        free(reason);
+    return retval;
+}
+
+/*! Configure TLS session resumption with session cache and session tickets
+ *
+ * @param[in]  h          Clixon handle
+ * @param[in]  ctx        SSL context
+ * @param[in]  xrestconf  XML restconf config
+ * @retval     0          OK
+ * @retval    -1          Error
+ * @see restconf_ticket_key_cb
+ */
+static int
+restconf_ssl_session_configure(clicon_handle h,
+                               SSL_CTX      *ctx,
+                               cxobj        *xrestconf)
+{
+    int                     retval = -1;
+    restconf_native_handle *rn;
+    uint32_t                cachesize = RESTCONF_TLS_SESSION_CACHE_SIZE;
+    uint32_t                timeout = RESTCONF_TLS_SESSION_TIMEOUT;
+    uint32_t                rotation = RESTCONF_TLS_TICKET_KEY_ROTATION;
+    char                   *str;
+
+    if ((rn = restconf_native_handle_get(h)) == NULL){
+        clicon_err(OE_RESTCONF, EINVAL, "No restconf native handle");
+        goto done;
+    }
+    if (restconf_config_uint32(xrestconf, "tls-session-cache-size", &cachesize) < 0)
+        goto done;
+    if (restconf_config_uint32(xrestconf, "tls-session-timeout", &timeout) < 0)
+        goto done;
+    if (restconf_config_uint32(xrestconf, "tls-ticket-key-rotation", &rotation) < 0)
+        goto done;
+    if (cachesize){
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx, cachesize);
+    }
+    else
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_timeout(ctx, timeout);
+    if ((str = xml_find_body(xrestconf, "tls-session-tickets")) != NULL &&
+        strcmp(str, "false") == 0){
+        /* Note in TLS 1.3, tickets are still sent but refer to the session cache */
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+    else{
+        rn->rn_ticket_rotation = rotation;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, restconf_ticket_key_cb);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(ctx, restconf_ticket_key_cb);
+#endif
+    }
+    clicon_debug(1, "%s cache:%u timeout:%u tickets:%s rotation:%u", __FUNCTION__,
+                 cachesize, timeout, (SSL_CTX_get_options(ctx) & SSL_OP_NO_TICKET)?"false":"true",
+                 rotation);
+    retval = 0;
+ done:
+    return retval;
+}
+
 #if 0 /* debug */
 /*! Debug print all loaded certs
  */
@@ -626,8 +876,14 @@ restconf_native_terminate(clicon_handle h)
                 free(rsock->rs_from_addr);
             free(rsock);
         }
+        stream_sub_freeall(h);
+        restconf_backend_pool_free(h);
         if (rn->rn_ctx)
             SSL_CTX_free(rn->rn_ctx);
+        if (rn->rn_tls_full || rn->rn_tls_resumed)
+            clicon_log(LOG_INFO, "%s TLS handshakes full:%" PRIu64 " resumed:%" PRIu64,
+                       __PROGRAM__, rn->rn_tls_full, rn->rn_tls_resumed);
+        OPENSSL_cleanse(rn->rn_ticket_secret, sizeof(rn->rn_ticket_secret));
         free(rn);
     }
     EVP_cleanup();
@@ -742,11 +998,22 @@ openssl_init_socket(clicon_handle h,
     /* Extract socket parameters from single socket config: ns, addr, port, ssl */
     if (restconf_socket_extract(h, xs, nsc, rsock, &netns, &address, &addrtype, &port) < 0)
         goto done;
+    if ((rn = restconf_native_handle_get(h)) == NULL){
+        clicon_err(OE_XML, EFAULT, "No openssl handle");
+        goto done;
+    }
     if (rsock->rs_callhome){
         if (!rsock->rs_ssl){
             clicon_err(OE_SSL, EINVAL, "Restconf callhome requires SSL");
             goto done;
         }
+        /* Only one worker calls home, otherwise there would be one connection per worker */
+        if (rn->rn_worker != 0){
+            if (rsock->rs_description)
+                free(rsock->rs_description);
+            free(rsock);
+            goto ok;
+        }
     }
     else { /* listen/accept */
         /* Open restconf socket and bind for later accept */
@@ -757,14 +1024,11 @@ openssl_init_socket(clicon_handle h,
 #else /* blocking */
                                  0,
 #endif
+                                 rn->rn_workers > 1, /* Each worker binds its own socket */
                                  &ss
                                  ) < 0)
             goto done;
     }
-    if ((rn = restconf_native_handle_get(h)) == NULL){
-        clicon_err(OE_XML, EFAULT, "No openssl handle");
-        goto done;
-    }
     if ((rsock->rs_addrstr = strdup(address)) == NULL){
         clicon_err(OE_UNIX, errno, "strdup");
         goto done;
@@ -788,6 +1052,7 @@ openssl_init_socket(clicon_handle h,
         if (clixon_event_reg_fd(rsock->rs_ss, restconf_accept_client, rsock, "restconf socket") < 0) 
             goto done;
     }
+ ok:
     retval = 0;
  done:
     return retval;
@@ -870,9 +1135,19 @@ restconf_openssl_init(clicon_handle h,
                 goto done;
         if (restconf_ssl_context_configure(h, ctx, server_cert_path, server_key_path, server_ca_cert_path) < 0)
             goto done;
+        if (restconf_ssl_session_configure(h, ctx, xrestconf) < 0)
+            goto done;
     }
     rn = restconf_native_handle_get(h);
     rn->rn_ctx = ctx;
+    if (restconf_backend_pool_init(h) < 0)
+        goto done;
+    rn->rn_compress_min = RESTCONF_COMPRESSION_MIN_SIZE;
+    rn->rn_compress_level = RESTCONF_COMPRESSION_LEVEL;
+    if (restconf_config_uint32(xrestconf, "compression-min-size", &rn->rn_compress_min) < 0)
+        goto done;
+    if (restconf_config_uint32(xrestconf, "compression-level", &rn->rn_compress_level) < 0)
+        goto done;
     /* get the list of socket config-data */
     if (xpath_vec(xrestconf, nsc, "socket", &vec, &veclen) < 0)
         goto done;
@@ -1087,6 +1362,234 @@ restconf_sig_term(int arg)
     clixon_exit_set(1); 
 }
 
+/*! Supervisor got SIGTERM or SIGINT: terminate workers and exit
+ */
+static void
+restconf_workers_sig_term(int arg)
+{
+    clixon_exit_set(1); 
+}
+
+/* Supervisor got SIGHUP: replace all workers */
+static int _restconf_workers_reload = 0;
+
+/*! Supervisor got SIGHUP: replace all workers
+ */
+static void
+restconf_workers_sig_hup(int arg)
+{
+    _restconf_workers_reload++;
+}
+
+/*! Supervisor got SIGCHLD: a worker exited
+ * Nothing to do here, it is needed to wake up sigsuspend, workers are reaped in 
+ * restconf_workers_run
+ */
+static void
+restconf_workers_sig_child(int arg)
+{
+}
+
+/*! Fork a restconf worker process
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  i       Worker index
+ * @param[in]  sigset  Signal mask of worker
+ * @param[out] pid     Process id of worker (parent only)
+ * @retval     1       Parent, worker started
+ * @retval     0       Worker, continue with socket init and event loop
+ * @retval    -1       Error
+ */
+static int
+restconf_worker_fork(clicon_handle h,
+                     int           i,
+                     sigset_t     *sigset,
+                     pid_t        *pid)
+{
+    int                     retval = -1;
+    pid_t                   child;
+    restconf_native_handle *rn;
+
+    if ((child = fork()) < 0){
+        clicon_err(OE_UNIX, errno, "fork");
+        goto done;
+    }
+    if (child == 0){ /* Worker */
+        if ((rn = restconf_native_handle_get(h)) == NULL){
+            clicon_err(OE_XML, EFAULT, "No openssl handle");
+            goto done;
+        }
+        rn->rn_worker = i;
+        if (set_signal(SIGTERM, restconf_sig_term, NULL) < 0)
+            goto done;
+        if (set_signal(SIGINT, restconf_sig_term, NULL) < 0)
+            goto done;
+        if (set_signal(SIGHUP, SIG_DFL, NULL) < 0)
+            goto done;
+        if (set_signal(SIGCHLD, SIG_DFL, NULL) < 0)
+            goto done;
+        if (sigprocmask(SIG_SETMASK, sigset, NULL) < 0){
+            clicon_err(OE_UNIX, errno, "sigprocmask");
+            goto done;
+        }
+        clicon_log(LOG_NOTICE, "%s native %u worker %d Started", __PROGRAM__, getpid(), i);
+        retval = 0;
+        goto done;
+    }
+    *pid = child;
+    retval = 1;
+ done:
+    return retval;
+}
+
+/*! Start and supervise restconf worker processes
+ *
+ * Each worker opens its own listening sockets with SO_REUSEPORT and runs its own event
+ * loop, and the kernel distributes incoming connections between them. Workers share the
+ * restconf config read by the supervisor, and each has its own backend session.
+ * The supervisor:
+ * - restarts a worker that exits, unless it failed directly after start
+ * - replaces all workers on SIGHUP, eg to read renewed certificates. A new worker is
+ *   started before the old is terminated, so the sockets keep accepting
+ * - terminates the workers on SIGTERM and SIGINT, and returns when they have exited
+ * @param[in]  h       Clixon handle
+ * @param[in]  workers Number of worker processes
+ * @retval     1       Worker, continue with socket init and event loop
+ * @retval     0       Supervisor, all workers terminated
+ * @retval    -1       Error
+ * @see CLICON_RESTCONF_WORKERS
+ */
+static int
+restconf_workers_run(clicon_handle h,
+                     int           workers)
+{
+    int            retval = -1;
+    pid_t         *pids = NULL;   /* Current workers, 0 if not running */
+    time_t        *starts = NULL; /* Start time of current workers */
+    sigset_t       blockset;
+    sigset_t       sigset;        /* Original signal mask, also of workers */
+    struct timeval now;
+    pid_t          pid;
+    pid_t          old;
+    int            status;
+    int            failed = 0;
+    int            alive;
+    int            terminating = 0;
+    int            s;
+    int            i;
+    int            ret;
+
+    clicon_debug(1, "%s %d", __FUNCTION__, workers);
+    if ((pids = calloc(workers, sizeof(*pids))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    if ((starts = calloc(workers, sizeof(*starts))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    /* Do not share the backend socket, workers open their own sessions */
+    if ((s = clicon_client_socket_get(h)) != -1){
+        close(s);
+        clicon_client_socket_set(h, -1);
+    }
+    clicon_session_id_del(h);
+    if (set_signal(SIGTERM, restconf_workers_sig_term, NULL) < 0)
+        goto done;
+    if (set_signal(SIGINT, restconf_workers_sig_term, NULL) < 0)
+        goto done;
+    if (set_signal(SIGHUP, restconf_workers_sig_hup, NULL) < 0)
+        goto done;
+    if (set_signal(SIGCHLD, restconf_workers_sig_child, NULL) < 0)
+        goto done;
+    /* Signals are only delivered in sigsuspend below */
+    sigemptyset(&blockset);
+    sigaddset(&blockset, SIGTERM);
+    sigaddset(&blockset, SIGINT);
+    sigaddset(&blockset, SIGHUP);
+    sigaddset(&blockset, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &blockset, &sigset) < 0){
+        clicon_err(OE_UNIX, errno, "sigprocmask");
+        goto done;
+    }
+    gettimeofday(&now, NULL);
+    for (i=0; i<workers; i++){
+        if ((ret = restconf_worker_fork(h, i, &sigset, &pids[i])) < 0)
+            goto done;
+        if (ret == 0)
+            goto worker;
+        starts[i] = now.tv_sec;
+    }
+    while (1){
+        gettimeofday(&now, NULL);
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0){
+            for (i=0; i<workers; i++)
+                if (pids[i] == pid)
+                    break;
+            if (i == workers) /* Replaced worker */
+                continue;
+            pids[i] = 0;
+            if (clixon_exit_get())
+                continue;
+            if ((!WIFEXITED(status) || WEXITSTATUS(status) != 0) &&
+                now.tv_sec - starts[i] < RESTCONF_WORKER_RESTART_MIN){
+                clicon_log(LOG_ERR, "%s: worker %d pid %u failed at start", __PROGRAM__, i, pid);
+                failed++;
+                clixon_exit_set(1);
+                continue;
+            }
+            clicon_log(LOG_WARNING, "%s: worker %d pid %u exited, restarting", __PROGRAM__, i, pid);
+            if ((ret = restconf_worker_fork(h, i, &sigset, &pids[i])) < 0)
+                goto done;
+            if (ret == 0)
+                goto worker;
+            starts[i] = now.tv_sec;
+        }
+        if (clixon_exit_get()){
+            alive = 0;
+            for (i=0; i<workers; i++)
+                if (pids[i] != 0){
+                    if (!terminating)
+                        kill(pids[i], SIGTERM);
+                    alive++;
+                }
+            terminating++;
+            if (alive == 0)
+                break;
+        }
+        else if (_restconf_workers_reload){
+            _restconf_workers_reload = 0;
+            clicon_log(LOG_NOTICE, "%s: replacing %d workers", __PROGRAM__, workers);
+            for (i=0; i<workers; i++){
+                old = pids[i];
+                if ((ret = restconf_worker_fork(h, i, &sigset, &pids[i])) < 0)
+                    goto done;
+                if (ret == 0)
+                    goto worker;
+                starts[i] = now.tv_sec;
+                if (old != 0)
+                    kill(old, SIGTERM);
+            }
+        }
+        sigsuspend(&sigset);
+    }
+    if (failed){
+        clicon_err(OE_DAEMON, 0, "Restconf worker failed at start");
+        goto done;
+    }
+    retval = 0;
+ done:
+    clicon_debug(1, "%s %d", __FUNCTION__, retval);
+    if (pids)
+        free(pids);
+    if (starts)
+        free(starts);
+    return retval;
+ worker:
+    retval = 1;
+    goto done;
+}
+
 /*! Usage help routine
  * @param[in]  argv0  command line
  * @param[in]  h      Clicon handle
@@ -1295,6 +1798,20 @@ main(int    argc,
     memset(rn, 0, sizeof *rn);
     if (restconf_native_handle_set(h, rn) < 0)
         goto done;
+    /* Made before workers are forked, so that TLS session tickets are valid in all workers */
+    if (RAND_bytes(rn->rn_ticket_secret, sizeof(rn->rn_ticket_secret)) != 1){
+        clicon_err(OE_SSL, 0, "RAND_bytes");
+        goto done;
+    }
+    /* Fork worker processes that each opens sockets and runs an event loop */
+    if ((rn->rn_workers = clicon_option_int(h, "CLICON_RESTCONF_WORKERS")) > 1){
+        if ((ret = restconf_workers_run(h, rn->rn_workers)) < 0)
+            goto done;
+        if (ret == 0){ /* Supervisor, all workers terminated */
+            retval = 0;
+            goto done;
+        }
+    }
     /* Openssl inits */ 
     if (restconf_openssl_init(h, dbg, xrestconf) < 0)
         goto done;
@@ -1318,6 +1835,7 @@ main(int    argc,
     if (xrestconf)
         xml_free(xrestconf);
     restconf_native_terminate(h);
+    api_http_data_cache_free(h);
     restconf_terminate(h);
     return retval;
 }
@@ -41,6 +41,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <inttypes.h>
+#include <ctype.h>
 #include <errno.h>
 #include <signal.h>
 #include <syslog.h>
@@ -66,6 +68,141 @@
 /* Forward */
 static int api_data_pagination(clicon_handle h, void *req, char *api_path, int pi, cvec *qvec, int pretty, restconf_media media_out);
 
+/*! Check if a yang data node has config data only, ie neither it nor descendants are config false
+ * @param[in]  y   Yang node
+ * @retval     1   Config data only
+ * @retval     0   Has state data
+ */
+static int
+api_data_config_only(yang_stmt *y)
+{
+    yang_stmt *yc = NULL;
+
+    if (yang_config(y) == 0)
+        return 0;
+    while ((yc = yn_each(y, yc)) != NULL) {
+        if (!yang_datanode(yc) &&
+            yang_keyword_get(yc) != Y_CHOICE &&
+            yang_keyword_get(yc) != Y_CASE)
+            continue;
+        if (api_data_config_only(yc) == 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*! Media part of entity-tag of config data
+ *
+ * The same data has different entity-tags in XML and JSON
+ * @param[in]  media  Media of reply
+ */
+static char *
+api_data_etag_media(restconf_media media)
+{
+    switch (media){
+    case YANG_DATA_JSON:
+    case YANG_PATCH_JSON:
+        return "json";
+    default:
+        return "xml";
+    }
+}
+
+/*! Get generation of first entity-tag of the reply media in If-None-Match header
+ * @param[in]  inm   If-None-Match header value, eg W/"1234-json", "5678-xml"
+ * @param[in]  media Media of reply
+ * @retval     gen   Generation, or 0 if none
+ * @see restconf_etag_match
+ */
+static uint64_t
+api_data_etag_gen(char          *inm,
+                  restconf_media media)
+{
+    char    *p = inm;
+    char    *ep;
+    char    *m;
+    uint64_t gen;
+
+    m = api_data_etag_media(media);
+
+    while (*p){
+        while (*p == ' ' || *p == '\t' || *p == ',')
+            p++;
+        if (strncmp(p, "W/", 2) == 0)
+            p += 2;
+        if (*p == '"' && isdigit(*(p+1))){
+            gen = strtoull(p+1, &ep, 10);
+            if (*ep == '-' && strncmp(ep+1, m, strlen(m)) == 0 && ep[1+strlen(m)] == '"')
+                return gen;
+        }
+        while (*p && *p != ',')
+            p++;
+    }
+    return 0;
+}
+
+/*! Translate between time and HTTP-date on the IMF-fixdate form
+ * @param[in]  str  HTTP-date, eg "Sun, 06 Nov 1994 08:49:37 GMT"
+ * @param[out] t    Time
+ * @retval     0    OK
+ * @retval    -1    Not an IMF-fixdate, obsolete HTTP-date forms are not accepted
+ * @see RFC 7231 Sec 7.1.1.1
+ */
+static int
+api_http_date2time(char   *str,
+                   time_t *t)
+{
+    const char *months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    struct tm   tm = {0,};
+    char        mon[4];
+    char       *p;
+
+    if (sscanf(str, "%*3s, %2d %3s %4d %2d:%2d:%2d GMT",
+               &tm.tm_mday, mon, &tm.tm_year, &tm.tm_hour, &tm.tm_min, &tm.tm_sec) != 6)
+        return -1;
+    if (strlen(mon) != 3 || (p = strstr(months, mon)) == NULL || (p-months)%3 != 0)
+        return -1;
+    tm.tm_mon = (p-months)/3;
+    tm.tm_year -= 1900;
+    if ((*t = timegm(&tm)) == (time_t)-1)
+        return -1;
+    return 0;
+}
+
+/*! Add ETag and Last-Modified reply headers of config data
+ * @param[in]  req     Generic Www handle
+ * @param[in]  gen     Generation of data, see xmldb_generation_get
+ * @param[in]  media   Media of reply, part of ETag
+ * @param[in]  lastmod Time of last change of data
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @note Weak ETag since the same data is encoded with different content-encoding
+ */
+static int
+api_data_validators(void           *req,
+                    uint64_t        gen,
+                    restconf_media  media,
+                    struct timeval *lastmod)
+{
+    int       retval = -1;
+    struct tm tm;
+    char      datestr[64];
+
+    if (restconf_reply_header(req, "ETag", "W/\"%" PRIu64 "-%s\"",
+                              gen, api_data_etag_media(media)) < 0)
+        goto done;
+    /* Reply depends on Accept */
+    if (restconf_reply_header(req, "Vary", "Accept") < 0)
+        goto done;
+    if (gmtime_r(&lastmod->tv_sec, &tm) != NULL &&
+        strftime(datestr, sizeof(datestr), "%a, %d %b %Y %H:%M:%S GMT", &tm) > 0 &&
+        restconf_reply_header(req, "Last-Modified", "%s", datestr) < 0)
+        goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Generic GET (both HEAD and GET)
  * According to restconf 
  * @param[in]  h        Clixon handle
@@ -93,6 +230,9 @@ static int api_data_pagination(clicon_handle h, void *req, char *api_path, int p
  * "400 Bad Request" status-line MUST be returned by the server.
  * Netconf: <get-config>, <get>                        
  * @note there is an ad-hoc method to determine json pagination request instead of regular GET
+ * Config data, ie content=config or a resource without state data, is read with a conditional
+ * get: the generation of the data is returned as ETag and Last-Modified, and
+ * If-None-Match and If-Modified-Since gets 304 Not Modified if the data is not modified.
  */
 static int
 api_data_get2(clicon_handle  h,
@@ -125,6 +265,16 @@ api_data_get2(clicon_handle  h,
     yang_stmt *y = NULL;
     char      *defaults = NULL;
     cvec      *nscd = NULL;
+    int        conditional = 0;
+    char      *inm = NULL;
+    char      *ims;
+    uint64_t   ifgen = 0;
+    struct timeval  ifsince = {0,};
+    struct timeval *ifsincep = NULL;
+    uint64_t   gen = 0;
+    struct timeval  lastmod = {0,};
+    int        notmodified = 0;
+    char       etag[32];
     
     clicon_debug(1, "%s", __FUNCTION__);
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
@@ -158,7 +308,8 @@ api_data_get2(clicon_handle  h,
             (yang_keyword_get(y) == Y_LIST || yang_keyword_get(y) == Y_LEAF_LIST) &&
             (cvec_find(qvec, "where")     || cvec_find(qvec, "sort-by") ||
              cvec_find(qvec, "direction") || cvec_find(qvec, "offset") ||
-             cvec_find(qvec, "limit")     || cvec_find(qvec, "sublist-limit"))){
+             cvec_find(qvec, "limit")     || cvec_find(qvec, "sublist-limit") ||
+             cvec_find(qvec, "cursor"))){
             if (api_data_pagination(h, req, api_path, 0, qvec, pretty, media_out) < 0)
                 goto done;
             goto ok;
@@ -200,8 +351,40 @@ api_data_get2(clicon_handle  h,
         defaults = attr;
     }
 
+    /* Config data only: conditional get with ETag and Last-Modified, RFC 8040 Sec 3.4.1 */
+    if (content == CONTENT_CONFIG ||
+        (content == CONTENT_ALL && y != NULL &&
+         yang_config_ancestor(y) && api_data_config_only(y)))
+        conditional++;
     clicon_debug(1, "%s path:%s", __FUNCTION__, xpath);
-    ret = clicon_rpc_get(h, xpath, nsc, content, depth, defaults, &xret);
+    if (conditional){
+        /* If-Modified-Since is ignored if If-None-Match is present, RFC 7232 Sec 3.3 */
+        if ((inm = restconf_param_get(h, "HTTP_IF_NONE_MATCH")) != NULL)
+            ifgen = api_data_etag_gen(inm, media_out);
+        else if ((ims = restconf_param_get(h, "HTTP_IF_MODIFIED_SINCE")) != NULL &&
+                 api_http_date2time(ims, &ifsince.tv_sec) == 0)
+            ifsincep = &ifsince;
+        ret = clicon_rpc_get_cond(h, xpath, nsc, depth, defaults,
+                                  ifgen, ifsincep, &gen, &lastmod, &xret);
+        if (ret == 0){
+            clicon_debug(1, "%s not modified", __FUNCTION__);
+            if (api_data_validators(req, gen, media_out, &lastmod) < 0)
+                goto done;
+            if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0)
+                goto done;
+            if (restconf_reply_send(req, 304, NULL, 0) < 0)
+                goto done;
+            goto ok;
+        }
+        /* Other entity-tags than the first, or "*" */
+        if (ret > 0 && inm != NULL && gen != 0){
+            snprintf(etag, sizeof(etag), "\"%" PRIu64 "-%s\"",
+                     gen, api_data_etag_media(media_out));
+            notmodified = restconf_etag_match(inm, etag);
+        }
+    }
+    else
+        ret = clicon_rpc_get(h, xpath, nsc, content, depth, defaults, &xret);
 
     if (ret < 0){
         if (netconf_operation_failed_xml(&xerr, "protocol", clicon_err_reason) < 0)
@@ -228,21 +411,7 @@ api_data_get2(clicon_handle  h,
         clicon_err(OE_UNIX, errno, "cbuf_new");
         goto done;
     }
-    if (xpath==NULL || strcmp(xpath,"/")==0){ /* Special case: data root */
-        switch (media_out){
-        case YANG_DATA_XML:
-            if (clixon_xml2cbuf(cbx, xret, 0, pretty, -1, 0) < 0) /* Dont print top object?  */
-                goto done;
-            break;
-        case YANG_DATA_JSON:
-            if (clixon_json2cbuf(cbx, xret, pretty, 0, 0) < 0)
-                goto done;
-            break;
-        default:
-            break;
-        }
-    }
-    else{
+    if (xpath != NULL && strcmp(xpath,"/") != 0){
         if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath) < 0){
             if (netconf_operation_failed_xml(&xerr, "application", clicon_err_reason) < 0)
                 goto done;
@@ -263,6 +432,32 @@ api_data_get2(clicon_handle  h,
                 goto done;
             goto ok;
         }
+    }
+    if (gen != 0 &&
+        api_data_validators(req, gen, media_out, &lastmod) < 0)
+        goto done;
+    if (notmodified){
+        if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0)
+            goto done;
+        if (restconf_reply_send(req, 304, NULL, 0) < 0)
+            goto done;
+        goto ok;
+    }
+    if (xpath==NULL || strcmp(xpath,"/")==0){ /* Special case: data root */
+        switch (media_out){
+        case YANG_DATA_XML:
+            if (clixon_xml2cbuf(cbx, xret, 0, pretty, -1, 0) < 0) /* Dont print top object?  */
+                goto done;
+            break;
+        case YANG_DATA_JSON:
+            if (clixon_json2cbuf(cbx, xret, pretty, 0, 0) < 0)
+                goto done;
+            break;
+        default:
+            break;
+        }
+    }
+    else{
         switch (media_out){
         case YANG_DATA_XML:
             for (i=0; i<xlen; i++){
@@ -375,6 +570,9 @@ api_data_pagination(clicon_handle  h,
     char      *sort;
     char      *where;
     char      *ns;
+    cg_var    *cv;
+    char      *cursor = NULL;
+    char      *next = NULL;
     
     clicon_debug(1, "%s", __FUNCTION__);
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
@@ -485,9 +683,19 @@ api_data_pagination(clicon_handle  h,
     direction = cvec_find_str(qvec, "direction");
     sort = cvec_find_str(qvec, "sort-by");
     where = cvec_find_str(qvec, "where");
+    /* Clixon extension: cursor token of config list snapshot, empty for first page */
+    if ((cv = cvec_find(qvec, "cursor")) != NULL)
+        cursor = cv_type_get(cv) == CGV_STRING ? cv_string_get(cv) : "";
+    if (cursor && strspn(cursor, CLIXON_CURSOR_CHARS) != strlen(cursor)){
+        if (netconf_invalid_value_xml(&xerr, "application", "Invalid list pagination cursor") < 0)
+            goto done;
+        if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+            goto done;
+        goto ok;
+    }
     if (clicon_rpc_get_pageable_list(h, "running", xpath, nsc, content,
                                      depth, NULL, offset, limit, direction, sort, where, 
-                                     &xret) < 0){
+                                     cursor, &next, &xret) < 0){
         if (netconf_operation_failed_xml(&xerr, "protocol", clicon_err_reason) < 0)
             goto done;
         if ((xe = xpath_first(xerr, NULL, "rpc-error")) == NULL){
@@ -556,6 +764,15 @@ api_data_pagination(clicon_handle  h,
         goto done;
     if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0)
         goto done;
+    /* Relative link to next page of snapshot, RFC 8288 */
+    if (next != NULL){
+        if (limit){
+            if (restconf_reply_header(req, "Link", "<?cursor=%s&limit=%u>; rel=\"next\"", next, limit) < 0)
+                goto done;
+        }
+        else if (restconf_reply_header(req, "Link", "<?cursor=%s>; rel=\"next\"", next) < 0)
+            goto done;
+    }
     if (restconf_reply_send(req, 200, cbx, 0 /* XXX head */) < 0)
         goto done;
     cbx = NULL; /* is consumed by above */
@@ -563,6 +780,8 @@ api_data_pagination(clicon_handle  h,
     retval = 0;
  done:
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (next)
+        free(next);
     if (cbrpc)
         cbuf_free(cbrpc);
     if (xpath)
@@ -41,12 +41,19 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <inttypes.h>
 #include <syslog.h>
 #include <pwd.h>
 #include <ctype.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 #include <arpa/inet.h>
 #include <sys/resource.h>
 
@@ -67,8 +74,10 @@
 /* restconf */
 #include "restconf_lib.h"       /* generic shared with plugins */
 #include "restconf_handle.h"
+#include "restconf_api.h"       /* Virtual api */
 #include "restconf_err.h"
 #include "restconf_native.h"    /* Restconf-openssl mode specific headers*/
+#include "restconf_stream.h"
 #ifdef HAVE_LIBNGHTTP2
 #include <nghttp2/nghttp2.h>
 #include "restconf_nghttp2.h"  /* http/2 */
@@ -77,8 +86,19 @@
 #include "restconf_http1.h"
 #endif
 
+/* Max time in ms to wait for socket to be writable when writing pending output at close */
+#define NATIVE_FLUSH_TIMEOUT 1000
+
+/* Max size of reply headers and body coalesced into one write on TLS connections,
+ * same as max TLS record payload */
+#define NATIVE_COALESCE_MAX 16384
+
+/* Size of chunks read from file when it cannot be sent directly, see native_buf_sendfile */
+#define NATIVE_FILE_CHUNK 16384
+
 /* Forward */
 static int restconf_idle_cb(int fd, void *arg);
+static int restconf_ssl_handshake_cb(int s, void *arg);
 
 /*!
  * @param[in]  rc       Restconf connection handle 
@@ -143,6 +163,8 @@ restconf_stream_find(restconf_conn *rc,
 int
 restconf_stream_free(restconf_stream_data *sd)
 {
+    if (sd->sd_sub)
+        stream_sub_leave(sd);
     if (sd->sd_fd != -1) {
         close(sd->sd_fd);
     }
@@ -156,16 +178,286 @@ restconf_stream_free(restconf_stream_data *sd)
         cbuf_free(sd->sd_outp_buf);
     if (sd->sd_body)
         cbuf_free(sd->sd_body);
+    restconf_stream_body_release(sd);
     if (sd->sd_path)
         free(sd->sd_path);
     if (sd->sd_settings2)
         free(sd->sd_settings2);
     if (sd->sd_qvec)
         cvec_free(sd->sd_qvec);
+    if (sd->sd_inp_hdrs)
+        cvec_free(sd->sd_inp_hdrs);
     free(sd);
     return 0;
 }
 
+/*! Release borrowed output body of stream, if any
+ *
+ * @param[in]  sd       Restconf data stream
+ * @see restconf_reply_send_buf
+ */
+int
+restconf_stream_body_release(restconf_stream_data *sd)
+{
+    if (sd->sd_body_ref){
+        sd->sd_body_ref = NULL;
+        sd->sd_body_release(sd->sd_body_arg);
+        sd->sd_body_release = NULL;
+        sd->sd_body_arg = NULL;
+    }
+    return 0;
+}
+
+/*---------------------------- Backend sessions ---------------------------*/
+
+/*! Set backend socket and session-id of handle from backend session
+ *
+ * clicon_rpc_* functions use the socket and session-id of the handle
+ * @param[in]  h   Clixon handle
+ * @param[in]  bs  Backend session
+ */
+static void
+backend_session_load(clicon_handle             h,
+                     restconf_backend_session *bs)
+{
+    clicon_client_socket_set(h, bs->bs_s);
+    if (bs->bs_id)
+        clicon_session_id_set(h, bs->bs_id);
+    else
+        clicon_session_id_del(h);
+}
+
+/*! Save backend socket and session-id of handle in backend session
+ *
+ * They may have been changed by a request, eg connected or reconnected to the backend
+ * @param[in]  h   Clixon handle
+ * @param[in]  bs  Backend session
+ */
+static void
+backend_session_save(clicon_handle             h,
+                     restconf_backend_session *bs)
+{
+    uint32_t id;
+
+    bs->bs_s = clicon_client_socket_get(h);
+    if (clicon_session_id_get(h, &id) < 0)
+        id = 0;
+    bs->bs_id = id;
+}
+
+/*! Log backend session pool statistics
+ *
+ * @param[in]  rn      Restconf native handle
+ * @param[in]  onexit  If set, log as info on exit, otherwise as debug
+ */
+static void
+backend_pool_log(restconf_native_handle *rn,
+                 int                     onexit)
+{
+    uint64_t requests = 0;
+    int      i;
+
+    for (i=0; i<rn->rn_nbsessions; i++)
+        requests += rn->rn_bsessions[i].bs_requests;
+    if (onexit)
+        clicon_log(LOG_INFO, "Restconf backend sessions:%d max used:%d requests:%" PRIu64
+                   " connections:%" PRIu64 " shared:%" PRIu64 " closed:%" PRIu64,
+                   rn->rn_nbsessions, rn->rn_bs_maxused, requests,
+                   rn->rn_bs_binds, rn->rn_bs_shared, rn->rn_bs_closed);
+    else
+        clicon_debug(1, "Restconf backend sessions:%d max used:%d requests:%" PRIu64
+                     " connections:%" PRIu64 " shared:%" PRIu64 " closed:%" PRIu64,
+                     rn->rn_nbsessions, rn->rn_bs_maxused, requests,
+                     rn->rn_bs_binds, rn->rn_bs_shared, rn->rn_bs_closed);
+}
+
+/*! Create pool of backend sessions with size CLICON_RESTCONF_BACKEND_SESSIONS
+ *
+ * The first session takes over the backend session of the handle, if any.
+ * Other sessions are connected when first used.
+ * @param[in]  h   Clixon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see restconf_backend_pool_free
+ */
+int
+restconf_backend_pool_init(clicon_handle h)
+{
+    int                     retval = -1;
+    restconf_native_handle *rn;
+    int                     n;
+    int                     i;
+
+    if ((rn = restconf_native_handle_get(h)) == NULL){
+        clicon_err(OE_RESTCONF, EINVAL, "No restconf native handle");
+        goto done;
+    }
+    if (rn->rn_bsessions == NULL){
+        if ((n = clicon_option_int(h, "CLICON_RESTCONF_BACKEND_SESSIONS")) < 1)
+            n = 1;
+        if ((rn->rn_bsessions = calloc(n, sizeof(restconf_backend_session))) == NULL){
+            clicon_err(OE_UNIX, errno, "calloc");
+            goto done;
+        }
+        rn->rn_nbsessions = n;
+        for (i=0; i<n; i++)
+            rn->rn_bsessions[i].bs_s = -1;
+        backend_session_save(h, &rn->rn_bsessions[0]);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Free pool of backend sessions and log pool statistics
+ *
+ * The statistics are also logged with debug when a connection is closed
+ * The backend session of the handle is not closed here, it is closed by restconf_terminate
+ * @param[in]  h   Clixon handle
+ * @retval     0   OK
+ * @see restconf_backend_pool_init
+ */
+int
+restconf_backend_pool_free(clicon_handle h)
+{
+    restconf_native_handle   *rn;
+    restconf_backend_session *bs;
+    int                       s;
+    int                       i;
+
+    if ((rn = restconf_native_handle_get(h)) == NULL ||
+        rn->rn_bsessions == NULL)
+        return 0;
+    s = clicon_client_socket_get(h);
+    for (i=0; i<rn->rn_nbsessions; i++){
+        bs = &rn->rn_bsessions[i];
+        clicon_debug(1, "%s session:%d id:%u requests:%" PRIu64, __FUNCTION__,
+                     i, bs->bs_id, bs->bs_requests);
+        if (bs->bs_s != -1 && bs->bs_s != s)
+            close(bs->bs_s);
+    }
+    backend_pool_log(rn, 1);
+    free(rn->rn_bsessions);
+    rn->rn_bsessions = NULL;
+    rn->rn_nbsessions = 0;
+    return 0;
+}
+
+/*! Enter backend session of connection before executing a request
+ *
+ * A connection is bound to a backend session on its first request, and keeps it until
+ * closed. An unused session is preferred, if all are in use the session with fewest
+ * connections is shared.
+ * @param[in]  rc  Restconf connection
+ * @retval     0   OK
+ * @see restconf_backend_session_leave  Call after request
+ */
+int
+restconf_backend_session_enter(restconf_conn *rc)
+{
+    clicon_handle             h = rc->rc_h;
+    restconf_native_handle   *rn;
+    restconf_backend_session *bs;
+    restconf_backend_session *bs1;
+    int                       used = 0;
+    int                       i;
+
+    if ((rn = restconf_native_handle_get(h)) == NULL ||
+        rn->rn_bsessions == NULL)
+        return 0; /* Use session of handle */
+    if ((bs = rc->rc_bs) == NULL){
+        for (i=0; i<rn->rn_nbsessions; i++){
+            bs1 = &rn->rn_bsessions[i];
+            if (bs1->bs_conns)
+                used++;
+            /* Fewest connections, then prefer already connected */
+            if (bs == NULL ||
+                bs1->bs_conns < bs->bs_conns ||
+                (bs1->bs_conns == bs->bs_conns && bs->bs_s == -1 && bs1->bs_s != -1))
+                bs = bs1;
+        }
+        if (bs->bs_conns)
+            rn->rn_bs_shared++;
+        else if (++used > rn->rn_bs_maxused)
+            rn->rn_bs_maxused = used;
+        bs->bs_conns++;
+        rn->rn_bs_binds++;
+        rc->rc_bs = bs;
+        clicon_debug(1, "%s session:%d conns:%d", __FUNCTION__,
+                     (int)(bs - rn->rn_bsessions), bs->bs_conns);
+    }
+    backend_session_load(h, bs);
+    return 0;
+}
+
+/*! Leave backend session of connection after executing a request
+ *
+ * @param[in]  rc  Restconf connection
+ * @param[in]  sd  Http stream of request
+ * @retval     0   OK
+ * @see restconf_backend_session_enter
+ */
+int
+restconf_backend_session_leave(restconf_conn        *rc,
+                               restconf_stream_data *sd)
+{
+    restconf_backend_session *bs;
+    char                     *root;
+    size_t                    len;
+
+    if ((bs = rc->rc_bs) == NULL)
+        return 0;
+    backend_session_save(rc->rc_h, bs);
+    bs->bs_requests++;
+    /* An RPC, eg lock, may leave state in the backend session */
+    if (sd->sd_path &&
+        (root = clicon_option_str(rc->rc_h, "CLICON_RESTCONF_API_ROOT")) != NULL &&
+        strncmp(sd->sd_path, root, (len = strlen(root))) == 0 &&
+        strncmp(sd->sd_path + len, "/operations/", strlen("/operations/")) == 0)
+        bs->bs_dirty = 1;
+    return 0;
+}
+
+/*! Unbind connection from its backend session when connection is closed
+ *
+ * If the connection made an RPC, eg lock, and no other connection uses the session, the
+ * session is closed, so that the backend releases locks of the session.
+ * Not if there is only one backend session, which is then shared by all connections.
+ * @param[in]  rc  Restconf connection
+ * @retval     0   OK
+ */
+static int
+restconf_backend_session_unbind(restconf_conn *rc)
+{
+    clicon_handle             h = rc->rc_h;
+    restconf_native_handle   *rn;
+    restconf_backend_session *bs;
+
+    if ((bs = rc->rc_bs) == NULL)
+        return 0;
+    rc->rc_bs = NULL;
+    if ((rn = restconf_native_handle_get(h)) == NULL)
+        return 0;
+    if (clicon_debug_get())
+        backend_pool_log(rn, 0);
+    if (--bs->bs_conns > 0 || bs->bs_dirty == 0)
+        return 0;
+    bs->bs_dirty = 0;
+    if (rn->rn_nbsessions < 2)
+        return 0;
+    if (bs->bs_s != -1){
+        if (clicon_client_socket_get(h) == bs->bs_s){
+            clicon_client_socket_set(h, -1);
+            clicon_session_id_del(h);
+        }
+        close(bs->bs_s);
+        bs->bs_s = -1;
+        rn->rn_bs_closed++;
+    }
+    bs->bs_id = 0;
+    return 0;
+}
+
 /*! Create restconf connection struct, per connect, ie transient
  *
  * @param[in] h     Clixon handle
@@ -221,6 +513,9 @@ restconf_conn_free(restconf_conn *rc)
         if (sd)
             restconf_stream_free(sd);
     }
+    if (rc->rc_outp)
+        cbuf_free(rc->rc_outp);
+    restconf_backend_session_unbind(rc);
     /* Free connect from server sock */
     if ((rsock = rc->rc_socket) != NULL &&
         (rc1 = rsock->rs_conns) != NULL){
@@ -363,66 +658,48 @@ restconf_connection_sanity(clicon_handle         h,
     return retval;
 }
 
-/* Write buf to socket
- * see also this function in restcont_api_openssl.c
- * @param[in]  h        Clixon handle
+/*! Write as much as possible of a buffer to a non-blocking connection socket
+ *
+ * @param[in]  rc       Connection struct
  * @param[in]  buf      Buffer to write
  * @param[in]  buflen   Length of buffer
- * @param[in]  rc       Connection struct
- * @param[in]  callfn   For debug
+ * @param[out] np       Bytes written, less than buflen if socket write would block
  * @retval  1  OK
  * @retval  0  OK, but socket write returned error, caller should close rc
  * @retval -1  Error
  */
 static int
-native_buf_write(clicon_handle    h,
-                 char            *buf,
-                 size_t           buflen,
-                 restconf_conn   *rc,
-                 const char      *callfn)                
+native_write1(restconf_conn *rc,
+              char          *buf,
+              size_t         buflen,
+              size_t        *np)
 {
     int     retval = -1;
     ssize_t len;
-    ssize_t totlen = 0;
+    size_t  totlen = 0;
     int     er;
     SSL    *ssl;
 
-    if (rc == NULL){
-        clicon_err(OE_RESTCONF, EINVAL, "rc is NULL");
-        goto done;
-    }
     ssl = rc->rc_ssl;
-    /* Two problems with debugging buffers that this fixes:
-     * 1. they are not "strings" in the sense they are not NULL-terminated
-     * 2. they are often very long
-     */
-    if (clicon_debug_get()) { 
-        char *dbgstr = NULL;
-        size_t sz;
-        sz = buflen>256?256:buflen; /* Truncate to 256 */
-        if ((dbgstr = malloc(sz+1)) == NULL){
-            clicon_err(OE_UNIX, errno, "malloc");
-            goto done;
-        }
-        memcpy(dbgstr, buf, sz);
-        dbgstr[sz] = '\0';
-        clicon_debug(1, "%s %s buflen:%zu buf:\n%s", __FUNCTION__, callfn, buflen, dbgstr);
-        free(dbgstr);
-    }
     while (totlen < buflen){
         if (ssl){
             if ((len = SSL_write(ssl, buf+totlen, buflen-totlen)) <= 0){
                 er = errno;
                 switch (SSL_get_error(ssl, len)){
+                case SSL_ERROR_WANT_READ:            /* 2 */
+                case SSL_ERROR_WANT_WRITE:           /* 3 */
+                    clicon_debug(1, "%s write SSL_ERROR_WANT_WRITE", __FUNCTION__);
+                    goto ok;
+                    break;
                 case SSL_ERROR_SYSCALL:              /* 5 */
                     if (er == ECONNRESET || /* Connection reset by peer */
                         er == EPIPE) {      /* Reading end of socket is closed */
                         goto closed; /* Close socket and ssl */
                     }
                     else if (er == EAGAIN){
+                        /* Same as want_write on some platforms */
                         clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-                        usleep(10000);
-                        continue;
+                        goto ok;
                     }
                     else{
                         clicon_err(OE_RESTCONF, er, "SSL_write %d", er);
@@ -442,8 +719,7 @@ native_buf_write(clicon_handle    h,
                 switch (errno){
                 case EAGAIN:     /* Operation would block */
                     clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-                    usleep(10000);
-                    continue;
+                    goto ok;
                     break;
                     //          case EBADF: // XXX if this happens there is some larger error
                 case ECONNRESET: /* Connection reset by peer */
@@ -459,6 +735,171 @@ native_buf_write(clicon_handle    h,
         }
         totlen += len;
     } /* while */
+ ok:
+    *np = totlen;
+    retval = 1;
+ done:
+    return retval;
+ closed:
+    retval = 0;
+    goto done;
+}
+
+/*! Write pending output when connection socket is writable
+ *
+ * Registered by native_buf_write when a socket write would block, and unregistered
+ * when all pending output is written.
+ * @param[in]  s    Connection socket
+ * @param[in]  arg  Restconf connection
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+restconf_connection_output(int   s,
+                           void *arg)
+{
+    int            retval = -1;
+    restconf_conn *rc = (restconf_conn *)arg;
+    size_t         n = 0;
+    int            ret;
+
+    clicon_debug(1, "%s %d", __FUNCTION__, s);
+    if ((ret = native_write1(rc, cbuf_get(rc->rc_outp) + rc->rc_outp_off,
+                             cbuf_len(rc->rc_outp) - rc->rc_outp_off, &n)) < 0)
+        goto done;
+    if (ret == 0){
+        if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
+            goto done;
+        goto ok;
+    }
+    gettimeofday(&rc->rc_t, NULL); /* activity timer */
+    rc->rc_outp_off += n;
+    if (rc->rc_outp_off == cbuf_len(rc->rc_outp)){
+        cbuf_reset(rc->rc_outp);
+        rc->rc_outp_off = 0;
+        clixon_event_unreg_fd(s, restconf_connection_output);
+#ifdef HAVE_LIBNGHTTP2
+        /* Send http/2 frames held back while output was pending */
+        if (rc->rc_proto == HTTP_2 && rc->rc_ngsession &&
+            nghttp2_session_want_write(rc->rc_ngsession)){
+            clicon_err_reset();
+            if (nghttp2_session_send(rc->rc_ngsession) != 0){
+                if (clicon_errno)
+                    goto done;
+                if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
+                    goto done;
+            }
+        }
+#endif
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Write all pending output before connection is closed
+ *
+ * Wait for the socket to be writable, but not longer than NATIVE_FLUSH_TIMEOUT
+ * @param[in]  rc   Restconf connection
+ * @retval     0    OK, or output could not be written
+ * @retval    -1    Error
+ */
+static int
+native_buf_flush(restconf_conn *rc)
+{
+    int           retval = -1;
+    struct pollfd pfd = {0,};
+    size_t        n;
+    int           ret;
+
+    while (rc->rc_outp != NULL && rc->rc_outp_off < cbuf_len(rc->rc_outp)){
+        n = 0;
+        if ((ret = native_write1(rc, cbuf_get(rc->rc_outp) + rc->rc_outp_off,
+                                 cbuf_len(rc->rc_outp) - rc->rc_outp_off, &n)) < 0)
+            goto done;
+        if (ret == 0)
+            break;
+        rc->rc_outp_off += n;
+        if (rc->rc_outp_off < cbuf_len(rc->rc_outp)){
+            pfd.fd = rc->rc_s;
+            pfd.events = POLLOUT;
+            if (poll(&pfd, 1, NATIVE_FLUSH_TIMEOUT) <= 0)
+                break;
+        }
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Write buf to connection socket
+ *
+ * The socket is non-blocking. If a write would block, the rest of buf is kept in the
+ * connection and is written when the socket is writable, see restconf_connection_output.
+ * Any later write is appended after pending output to keep order.
+ * @param[in]  h        Clixon handle
+ * @param[in]  buf      Buffer to write
+ * @param[in]  buflen   Length of buffer
+ * @param[in]  rc       Connection struct
+ * @param[in]  callfn   For debug
+ * @retval  1  OK
+ * @retval  0  OK, but socket write returned error, caller should close rc
+ * @retval -1  Error
+ */
+int
+native_buf_write(clicon_handle    h,
+                 char            *buf,
+                 size_t           buflen,
+                 restconf_conn   *rc,
+                 const char      *callfn)                
+{
+    int     retval = -1;
+    size_t  n = 0;
+    int     ret;
+
+    if (rc == NULL){
+        clicon_err(OE_RESTCONF, EINVAL, "rc is NULL");
+        goto done;
+    }
+    /* Two problems with debugging buffers that this fixes:
+     * 1. they are not "strings" in the sense they are not NULL-terminated
+     * 2. they are often very long
+     */
+    if (clicon_debug_get()) { 
+        char *dbgstr = NULL;
+        size_t sz;
+        sz = buflen>256?256:buflen; /* Truncate to 256 */
+        if ((dbgstr = malloc(sz+1)) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        memcpy(dbgstr, buf, sz);
+        dbgstr[sz] = '\0';
+        clicon_debug(1, "%s %s buflen:%zu buf:\n%s", __FUNCTION__, callfn, buflen, dbgstr);
+        free(dbgstr);
+    }
+    /* If output is pending, append after it */
+    if (rc->rc_outp == NULL || rc->rc_outp_off == cbuf_len(rc->rc_outp)){
+        if ((ret = native_write1(rc, buf, buflen, &n)) < 0)
+            goto done;
+        if (ret == 0)
+            goto closed;
+    }
+    if (n < buflen){
+        if (rc->rc_outp == NULL &&
+            (rc->rc_outp = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if (cbuf_len(rc->rc_outp) == 0 &&
+            clixon_event_reg_fd_write(rc->rc_s, restconf_connection_output, rc, "restconf client output") < 0)
+            goto done;
+        if (cbuf_append_buf(rc->rc_outp, buf+n, buflen-n) < 0){
+            clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+            goto done;
+        }
+    }
     retval = 1;
  done:
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
@@ -510,30 +951,207 @@ native_send_badrequest(clicon_handle    h,
 }
 
 #ifdef HAVE_HTTP1
-/*! Clear all input stream data if input is interrupted for some reason
+/*! Write several buffers to connection socket
  *
- * Only used by HTTP/1.
- * @param[in]  h    Clixon handle
- * @param[in]  sd   Http stream
- * @retval     0    OK
- * @retval    -1    Error
+ * On plain sockets the buffers are written with one writev(2). On TLS connections small
+ * buffers are coalesced into one SSL_write, ie one TLS record, larger buffers are
+ * written one by one. If output is pending, the buffers are appended after it.
+ * @param[in]  h        Clixon handle
+ * @param[in]  iov      Vector of buffers
+ * @param[in]  iovcnt   Number of buffers in iov
+ * @param[in]  rc       Connection struct
+ * @param[in]  callfn   For debug
+ * @retval  1  OK
+ * @retval  0  OK, but socket write returned error, caller should close rc
+ * @retval -1  Error
+ * @see native_buf_write
  */
 static int
-http1_native_clear_input(clicon_handle         h,
-                         restconf_stream_data *sd)
+native_buf_writev(clicon_handle    h,
+                  struct iovec    *iov,
+                  int              iovcnt,
+                  restconf_conn   *rc,
+                  const char      *callfn)
 {
-    int retval = -1;
-
-    cbuf_reset(sd->sd_indata);
-    if (sd->sd_qvec){
-        cvec_free(sd->sd_qvec);
-        sd->sd_qvec = NULL;
+    int     retval = -1;
+    cbuf   *cb = NULL;
+    size_t  totlen = 0;
+    ssize_t len;
+    int     i;
+
+    for (i=0; i<iovcnt; i++)
+        totlen += iov[i].iov_len;
+    if (iovcnt == 1 ||
+        (rc->rc_outp != NULL && rc->rc_outp_off < cbuf_len(rc->rc_outp)) ||
+        (rc->rc_ssl && totlen > NATIVE_COALESCE_MAX)){
+        for (i=0; i<iovcnt; i++)
+            if ((retval = native_buf_write(h, iov[i].iov_base, iov[i].iov_len, rc, callfn)) != 1)
+                goto done;
+        goto ok;
     }
-    if (restconf_param_del_all(h) < 0)
+    if (rc->rc_ssl){
+        if ((cb = cbuf_new_alloc(totlen+1)) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new_alloc");
+            goto done;
+        }
+        for (i=0; i<iovcnt; i++)
+            if (cbuf_append_buf(cb, iov[i].iov_base, iov[i].iov_len) < 0){
+                clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+                goto done;
+            }
+        retval = native_buf_write(h, cbuf_get(cb), cbuf_len(cb), rc, callfn);
         goto done;
+    }
+    clicon_debug(1, "%s %s totlen:%zu", __FUNCTION__, callfn, totlen);
+    if ((len = writev(rc->rc_s, iov, iovcnt)) < 0){
+        switch (errno){
+        case EAGAIN:     /* Operation would block */
+        case EINTR:
+            len = 0;
+            break;
+        case ECONNRESET: /* Connection reset by peer */
+        case EPIPE:      /* Broken pipe */
+            goto closed;
+            break;
+        default:
+            clicon_err(OE_UNIX, errno, "writev");
+            goto done;
+            break;
+        }
+    }
+    /* Keep what was not written as pending output */
+    for (i=0; i<iovcnt; i++){
+        if ((size_t)len >= iov[i].iov_len){
+            len -= iov[i].iov_len;
+            continue;
+        }
+        if ((retval = native_buf_write(h, (char*)iov[i].iov_base + len, iov[i].iov_len - len,
+                                       rc, callfn)) != 1)
+            goto done;
+        len = 0;
+    }
+ ok:
+    retval = 1;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+ closed:
     retval = 0;
+    goto done;
+}
+
+/*! Write contents of a file to connection socket
+ *
+ * On plain sockets sendfile(2) is used, and on TLS connections SSL_sendfile() if kernel
+ * TLS is active, so that file data is not copied to user space.
+ * Otherwise, and for the rest of the file if the socket would block, the file is read in
+ * chunks and written with native_buf_write.
+ * @param[in]  h        Clixon handle
+ * @param[in]  fd       Open file, written from offset 0
+ * @param[in]  len      Number of bytes to write
+ * @param[in]  rc       Connection struct
+ * @param[in]  callfn   For debug
+ * @retval  1  OK
+ * @retval  0  OK, but socket write returned error or file is truncated, caller should close rc
+ * @retval -1  Error
+ */
+static int
+native_buf_sendfile(clicon_handle    h,
+                    int              fd,
+                    size_t           len,
+                    restconf_conn   *rc,
+                    const char      *callfn)
+{
+    int     retval = -1;
+    off_t   off = 0;
+    ssize_t n;
+    char    buf[NATIVE_FILE_CHUNK];
+
+    clicon_debug(1, "%s %s len:%zu", __FUNCTION__, callfn, len);
+    /* Only if no output is pending */
+    if (rc->rc_outp == NULL || rc->rc_outp_off == cbuf_len(rc->rc_outp)){
+        if (rc->rc_ssl == NULL){
+#ifdef __linux__
+            while (off < len){
+                if ((n = sendfile(rc->rc_s, fd, &off, len - off)) < 0){
+                    if (errno == EAGAIN || errno == EINTR)
+                        break;
+                    if (errno == ECONNRESET || errno == EPIPE)
+                        goto closed;
+                    clicon_err(OE_UNIX, errno, "sendfile");
+                    goto done;
+                }
+                if (n == 0)
+                    break;
+            }
+#endif
+        }
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+        else if (BIO_get_ktls_send(SSL_get_wbio(rc->rc_ssl))){
+            while (off < len){
+                if ((n = SSL_sendfile(rc->rc_ssl, fd, off, len - off, 0)) <= 0)
+                    break;
+                off += n;
+            }
+        }
+#endif
+    }
+    while (off < len){
+        if ((n = pread(fd, buf, len-off<sizeof(buf)?len-off:sizeof(buf), off)) < 0){
+            clicon_err(OE_UNIX, errno, "pread");
+            goto done;
+        }
+        if (n == 0){ /* File truncated, Content-Length can not be fulfilled */
+            clicon_debug(1, "%s file truncated at %zu", __FUNCTION__, (size_t)off);
+            goto closed;
+        }
+        if ((retval = native_buf_write(h, buf, n, rc, callfn)) != 1)
+            goto done;
+        off += n;
+    }
+    retval = 1;
  done:
     return retval;
+ closed:
+    retval = 0;
+    goto done;
+}
+
+/*! Write HTTP/1 reply: status line and headers, body from buffer or from file
+ *
+ * Headers and body buffer are written together without copying them into one buffer
+ * @param[in]  h    Clixon handle
+ * @param[in]  rc   Restconf connection
+ * @param[in]  sd   Http stream
+ * @retval  1  OK
+ * @retval  0  OK, but socket write returned error, caller should close rc
+ * @retval -1  Error
+ */
+static int
+native_http1_send_reply(clicon_handle         h,
+                        restconf_conn        *rc,
+                        restconf_stream_data *sd)
+{
+    struct iovec iov[2];
+    int          iovcnt = 0;
+    int          ret;
+
+    iov[iovcnt].iov_base = cbuf_get(sd->sd_outp_buf);
+    iov[iovcnt++].iov_len = cbuf_len(sd->sd_outp_buf);
+    if (sd->sd_body && cbuf_len(sd->sd_body)){
+        iov[iovcnt].iov_base = cbuf_get(sd->sd_body);
+        iov[iovcnt++].iov_len = cbuf_len(sd->sd_body);
+    }
+    else if (sd->sd_body_ref){
+        iov[iovcnt].iov_base = sd->sd_body_ref;
+        iov[iovcnt++].iov_len = sd->sd_body_len;
+    }
+    if ((ret = native_buf_writev(h, iov, iovcnt, rc, __FUNCTION__)) != 1)
+        return ret;
+    if (sd->sd_fd != -1)
+        ret = native_buf_sendfile(h, sd->sd_fd, sd->sd_body_len, rc, __FUNCTION__);
+    return ret;
 }
 #endif
 
@@ -543,7 +1161,7 @@ http1_native_clear_input(clicon_handle         h,
  * @param[in]  buf   Input buffer
  * @param[in]  sz    Size of input buffer
  * @param[out] np    Bytes read
- * @param[out] again    If set, read data again, do not continue processing
+ * @param[out] again If set, no data available, return to event loop and resume when readable
  * @retval     -1    Error
  * @retval     0     OK
  */
@@ -562,13 +1180,11 @@ read_ssl(restconf_conn *rc,
         clicon_debug(1, "%s SSL_read() n:%zd errno:%d sslerr:%d", __FUNCTION__, *np, errno, sslerr);
         switch (sslerr){
         case SSL_ERROR_WANT_READ:            /* 2 */
+        case SSL_ERROR_WANT_WRITE:           /* 3 */
             /* SSL_ERROR_WANT_READ is returned when the last operation was a read operation 
-             * from a nonblocking BIO. 
-             * That is, it can happen if restconf_socket_init() below is called 
-             * with SOCK_NONBLOCK
+             * from a nonblocking BIO, ie no complete TLS record is available yet.
              */
             clicon_debug(1, "%s SSL_read SSL_ERROR_WANT_READ", __FUNCTION__);
-            usleep(1000);
             *again = 1;
             break;
         case SSL_ERROR_ZERO_RETURN:
@@ -592,7 +1208,7 @@ read_ssl(restconf_conn *rc,
  * @param[in]  buf      Input buffer
  * @param[in]  sz       Size of input buffer
  * @param[out] np       Bytes read
- * @param[out] again    If set, read data again, do not continue processing
+ * @param[out] again    If set, no data available, return to event loop and resume when readable
  * @retval     -1       Error
  * @retval     0        Socket closed, quit
  * @retval     1        OK
@@ -620,7 +1236,6 @@ read_regular(restconf_conn *rc,
             break;
         case EAGAIN:
             clicon_debug(1, "%s read EAGAIN", __FUNCTION__);
-            usleep(1000);
             *again = 1;
             break;
         default:;
@@ -638,6 +1253,11 @@ read_regular(restconf_conn *rc,
 
 /*! Restconf HTTP/1 processing after chunk of bytes read
  *
+ * Input is appended to the connection input buffer, and all complete requests in the buffer
+ * are processed in order (pipelining) before returning. The reply of each request is written,
+ * or queued as pending output, before the next request is processed.
+ * A request is complete when its header and Content-Length bytes of body are read. Restconf
+ * parameters are not set until then since they are shared by all connections.
  * @param[in]  rc           Restconf connection handle 
  * @param[in]  buf          Input buffer
  * @param[in]  n            Length of data in input buffer
@@ -655,8 +1275,11 @@ restconf_http1_process(restconf_conn *rc,
     int                   retval = -1;
     restconf_stream_data *sd;
     clicon_handle         h;
+    http1_request         hr;
+    char                 *p;
+    size_t                len;
+    size_t                off = 0;
     int                   ret;
-    int                   status;
     cbuf                 *cberr = NULL;
     
     h = rc->rc_h;
@@ -664,125 +1287,137 @@ restconf_http1_process(restconf_conn *rc,
         clicon_err(OE_RESTCONF, EINVAL, "restconf stream not found");
         goto done;
     }
-    /* Two states for reading:
-     * 1) Initial reading of headers, parse from start
-     * 2) Headers are read / body started, dont parse, just append body
-     */
-    /* Check whole message is read. 
-     * Only way this could happen is that body is read
-     * 0: No Content-Length or 0
-     *    header does not contain Content-Length or is 0
-     *    (OR: message header not fully read SHOULDNT HAPPEN IF BODY READ)
-     * 1: Content-Length found but body has fewer bytes, ie remaining bytes to read
-     * 2: Content-Length found and matches body length. No more bytes to read
-     */
-    if ((ret = http1_check_content_length(h, sd, &status)) < 0)
+    /* Event stream: the connection is used for events until closed, input is ignored */
+    if (sd->sd_sse){
+        (*readmore)++;
+        retval = 1;
         goto done;
-    if (status == 1){   /* Next read: keep header state and only append inbody */
-        if (cbuf_append_buf(sd->sd_indata, buf, n) < 0){
-            clicon_err(OE_UNIX, errno, "cbuf_append");
-            goto done;
-        }
     }
-    else {
-        /* multi-buffer for multiple reads 
-         * This is different from sd_indata that it is before and includes headers
-         */
-        if (cbuf_append_buf(sd->sd_inbuf, buf, n) < 0){
-            clicon_err(OE_UNIX, errno, "cbuf_append");
-            goto done;
+    if (cbuf_append_buf(sd->sd_inbuf, buf, n) < 0){
+        clicon_err(OE_UNIX, errno, "cbuf_append");
+        goto done;
+    }
+    while (off < cbuf_len(sd->sd_inbuf)){
+        p = cbuf_get(sd->sd_inbuf) + off;
+        len = cbuf_len(sd->sd_inbuf) - off;
+        /* Ignore empty lines before request-line, RFC 7230 Sec 3.5 */
+        if (sd->sd_reqlen == 0 && sd->sd_hdrscan == 0 && (p[0] == '\r' || p[0] == '\n')){
+            off++;
+            continue;
         }
-        if (clixon_http1_parse_string(h, rc, cbuf_get(sd->sd_inbuf)) < 0){
-            /* XXX This does not work for SSL */
-            if (rc->rc_ssl){
-                ret = SSL_pending(rc->rc_ssl);
-            }
-            else if ((ret = clixon_event_poll(rc->rc_s)) < 0)
-                goto done;
-            if (ret > 0){
-                if (http1_native_clear_input(h, sd) < 0)
-                    goto done;
-                (*readmore)++;
-                goto ok;
-            }
-            /* Return error. Honestly, the sender could just e slow, it should really be a 
-             * timeout here.
-             */
+        /* Request length is not known until header is read, then check whole body is read */
+        if (sd->sd_reqlen != 0 && len < sd->sd_reqlen)
+            break;
+        if ((ret = http1_request_parse(p, len, &sd->sd_hdrscan, &hr)) < 0){
+            /* Malformed header: return error and drop input, request boundaries are lost */
             if ((cberr = cbuf_new()) == NULL){
                 clicon_err(OE_UNIX, errno, "cbuf_new");
                 goto done;
             }
             cprintf(cberr, "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>%s</error-message></error></errors>", clicon_err_reason);
-            if ((ret = native_send_badrequest(h, "application/yang-data+xml", cbuf_get(cberr), rc)) < 0)
+            clicon_err_reset();
+            off = cbuf_len(sd->sd_inbuf);
+            sd->sd_hdrscan = 0;
+            sd->sd_reqlen = 0;
+            if (native_send_badrequest(h, "application/yang-data+xml", cbuf_get(cberr), rc) < 0)
                 goto done;
-            goto ok;
+            /* Connection: close was sent, close when the reply is flushed */
+            goto closed;
+        }
+        if (ret == 0) /* Header not complete: wait for more data */
+            break;
+        if (sd->sd_reqlen == 0){
+            sd->sd_reqlen = hr.hr_len + hr.hr_clen;
+            if (len < sd->sd_reqlen){
+                /* Check for Continue and if so reply with 100 Continue */
+                if (hr.hr_expect){
+                    if (http1_send_continue(rc, sd) < 0)
+                        goto done;
+                    if ((ret = native_buf_write(h, cbuf_get(sd->sd_outp_buf), cbuf_len(sd->sd_outp_buf),
+                                                rc, __FUNCTION__)) < 0)
+                        goto done;
+                    cvec_reset(sd->sd_outp_hdrs);
+                    cbuf_reset(sd->sd_outp_buf);
+                    if (ret == 0)
+                        goto closed;
+                }
+                break;
+            }
         }
-        /* Check for Continue and if so reply with 100 Continue 
-         * ret == 1: send reply
-         */
-        if ((ret = http1_check_expect(h, rc, sd)) < 0)
+        /* Complete request */
+        if (cbuf_append_buf(sd->sd_indata, p + hr.hr_len, hr.hr_clen) < 0){
+            clicon_err(OE_UNIX, errno, "cbuf_append");
             goto done;
-        if (ret == 1){
-            if ((ret = native_buf_write(h, cbuf_get(sd->sd_outp_buf), cbuf_len(sd->sd_outp_buf),
-                                        rc, __FUNCTION__)) < 0)
-                goto done;
-            cvec_reset(sd->sd_outp_hdrs);
-            cbuf_reset(sd->sd_outp_buf);
-            if (ret == 0){
-                if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
-                    goto done;
-                rc = NULL;
-                retval = 0;
+        }
+        off += sd->sd_reqlen;
+        sd->sd_reqlen = 0;
+        sd->sd_hdrscan = 0;
+        if (http1_request_set(h, rc, sd, &hr) < 0)
+            goto done;
+        /* nginx compatible, set HTTPS parameter if SSL */
+        if (rc->rc_ssl)
+            if (restconf_param_set(h, "HTTPS", "https") < 0)
                 goto done;
-            }
+        if (hr.hr_close &&
+            restconf_reply_header(sd, "Connection", "close") < 0)
+            goto done;
+        /* main restconf processing */
+        if (restconf_backend_session_enter(rc) < 0)
+            goto done;
+        if (restconf_http1_path_root(h, rc) < 0)
+            goto done;
+        if (restconf_backend_session_leave(rc, sd) < 0)
+            goto done;
+        if (hr.hr_close && !sd->sd_sse)
+            rc->rc_exit = 1;
+        if ((ret = native_http1_send_reply(h, rc, sd)) < 0)
+            goto done;
+        cvec_reset(sd->sd_outp_hdrs); /* Can be done in native_send_reply */
+        cbuf_reset(sd->sd_outp_buf);
+        cbuf_reset(sd->sd_indata);
+        if (sd->sd_body){
+            cbuf_free(sd->sd_body);
+            sd->sd_body = NULL;
         }
-    }
-    /* Check whole message is read. 
-     * Only way this could happen is that body is read
-     * 0: No Content-Length or 0
-     *    header does not contain Content-Length or is 0
-     *    (OR: message header not fully read SHOULDNT HAPPEN IF BODY READ OK in parse above)
-     * 1: Content-Length found but body has fewer bytes, ie remaining bytes to read
-     * 2: Content-Length found and matches body length. No more bytes to read
-     */
-    if ((ret = http1_check_content_length(h, sd, &status)) < 0)
-        goto done;
-    if (status == 1){
-        (*readmore)++;
-        goto ok;
-    }
-    /* nginx compatible, set HTTPS parameter if SSL */
-    if (rc->rc_ssl)
-        if (restconf_param_set(h, "HTTPS", "https") < 0)
+        restconf_stream_body_release(sd);
+        if (sd->sd_fd != -1){
+            close(sd->sd_fd);
+            sd->sd_fd = -1;
+        }
+        if (sd->sd_qvec){
+            cvec_free(sd->sd_qvec);
+            sd->sd_qvec = NULL;
+        }
+        if (ret == 0 || rc->rc_exit)  /* Client or server-initiated exit */
+            goto closed;
+        if (sd->sd_upgrade2) /* Rest of input is http/2, params are used by upgraded stream */
+            break;
+        if (restconf_param_del_all(h) < 0)
             goto done;
-    /* main restconf processing */
-    if (restconf_http1_path_root(h, rc) < 0)
-        goto done;
-    if ((ret = native_buf_write(h, cbuf_get(sd->sd_outp_buf), cbuf_len(sd->sd_outp_buf),
-                                rc, __FUNCTION__)) < 0)
-        goto done;
-    cvec_reset(sd->sd_outp_hdrs); /* Can be done in native_send_reply */
-    cbuf_reset(sd->sd_outp_buf);
-    cbuf_reset(sd->sd_inbuf);
-    cbuf_reset(sd->sd_indata);
-    if (sd->sd_body)
-        cbuf_reset(sd->sd_body);
-    if (sd->sd_qvec){
-        cvec_free(sd->sd_qvec);
-        sd->sd_qvec = NULL;
+        if (sd->sd_sse){     /* Event stream, following requests are not processed */
+            off = cbuf_len(sd->sd_inbuf);
+            break;
+        }
     }
-    if (ret == 0 || rc->rc_exit){  /* Server-initiated exit */
-        if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
-            goto done;
-        retval = 0;
-        goto done;
+    /* Remove processed requests from input buffer */
+    if (off > 0){
+        len = cbuf_len(sd->sd_inbuf) - off;
+        memmove(cbuf_get(sd->sd_inbuf), cbuf_get(sd->sd_inbuf) + off, len);
+        cbuf_trunc(sd->sd_inbuf, len);
     }
- ok:
+    /* Read until socket would block, TLS may have buffered more input than poll shows */
+    if (!sd->sd_upgrade2)
+        (*readmore)++;
     retval = 1;
  done:
     if (cberr)
         cbuf_free(cberr);
     return retval;
+ closed:
+    if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
+        goto done;
+    retval = 0;
+    goto done;
 }
 #endif
 
@@ -884,14 +1519,8 @@ restconf_http2_process(restconf_conn *rc,
             retval = 0;
             goto done;
         }
-        /* Check if read more data frames */
-        ret = 0;
-        if (rc->rc_ssl)
-            ret = SSL_pending(rc->rc_ssl);
-        else if ((ret = clixon_event_poll(rc->rc_s)) < 0)
-            goto done;
-        if (ret > 0)
-            (*readmore)++;
+        /* Read until socket would block, then execute requests, see http2_exec_ready */
+        (*readmore)++;
     }
     retval = 1;
  done:
@@ -940,6 +1569,7 @@ restconf_connection(int   s,
     ssize_t        n;
     char           buf[1024]; /* Alter BUFSIZ (8K) from stdio.h 8K. 256 fails some tests */
     int            readmore = 1;
+    int            again;
     int            ret;
 
     clicon_debug(1, "%s %d", __FUNCTION__, s);
@@ -955,20 +1585,37 @@ restconf_connection(int   s,
     while (readmore) {
         clicon_debug(1, "%s readmore", __FUNCTION__);
         readmore = 0;
+        again = 0;
         /* Example: curl -Ssik -u wilma:bar -X GET https://localhost/restconf/data/example:x */
         if (rc->rc_ssl){
-            if (read_ssl(rc, buf, sizeof(buf), &n, &readmore) < 0)
+            if (read_ssl(rc, buf, sizeof(buf), &n, &again) < 0)
                 goto done;
         }
         else{ /* Not SSL */
-            if ((ret = read_regular(rc, buf, sizeof(buf), &n, &readmore)) < 0)
+            if ((ret = read_regular(rc, buf, sizeof(buf), &n, &again)) < 0)
                 goto done;
             if (ret == 0)
                 goto ok; /* abort here */
         }
         clicon_debug(1, "%s read:%zd", __FUNCTION__, n);
-        if (readmore)
-            continue;
+        /* No more data now: return to event loop, input state is kept in rc until readable */
+        if (again){
+#ifdef HAVE_LIBNGHTTP2
+            /* Execute next http/2 request, then read again to handle frames received meanwhile */
+            if (rc->rc_proto == HTTP_2 && rc->rc_nready > 0){
+                if ((ret = http2_exec_ready(rc)) < 0)
+                    goto done;
+                if (ret == 0){
+                    if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
+                        goto done;
+                    goto ok;
+                }
+                readmore = 1;
+                continue;
+            }
+#endif
+            goto ok;
+        }
         if (n == 0){
             clicon_debug(1, "%s n=0 closing socket", __FUNCTION__);
             if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
@@ -1036,6 +1683,8 @@ restconf_connection_close1(restconf_conn *rc)
         goto done;
     }
     clixon_event_unreg_fd(rc->rc_s, restconf_connection);
+    clixon_event_unreg_fd(rc->rc_s, restconf_connection_output);
+    clixon_event_unreg_fd(rc->rc_s, restconf_ssl_handshake_cb);
     /* re-set timer */
     if (rc->rc_callhome){
         if (rsock->rs_periodic)
@@ -1067,6 +1716,9 @@ restconf_close_ssl_socket(restconf_conn *rc,
     int er;
 
     clicon_debug(1, "%s %s", __FUNCTION__, callfn);
+    if (!dontshutdown &&
+        native_buf_flush(rc) < 0)
+        goto done;
     if (rc->rc_ssl != NULL){
         if (!dontshutdown &&
             (ret = SSL_shutdown(rc->rc_ssl)) < 0){
@@ -1164,12 +1816,251 @@ ssl_alpn_check(clicon_handle        h,
     return retval;
 } /* ssl_alpn_check */
 
+/*! Connection is up: create protocol state and register for input
+ * @param[in]  rc     Restconf connection
+ * @param[in]  proto  HTTP protocol, negotiated by ALPN if SSL
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+restconf_conn_start(restconf_conn      *rc,
+                    restconf_http_proto proto)
+{
+    int retval = -1;
+
+    rc->rc_proto = proto;
+    switch (rc->rc_proto){
+#ifdef HAVE_HTTP1
+    case HTTP_10:
+    case HTTP_11:
+        /* Create a default stream for http/1 */
+        if (restconf_stream_data_new(rc, 0) == NULL)
+            goto done;
+        break;
+#endif /* HAVE_HTTP1 */
+#ifdef HAVE_LIBNGHTTP2
+    case HTTP_2:{
+        if (http2_session_init(rc) < 0){
+            restconf_close_ssl_socket(rc, __FUNCTION__, 0);
+            goto done;
+        }
+        if (http2_send_server_connection(rc) < 0){
+            restconf_close_ssl_socket(rc, __FUNCTION__, 0);
+            goto done;
+        }
+        break;
+    }
+#endif /* HAVE_LIBNGHTTP2 */
+    default:
+        break;
+    } /* switch proto */
+    gettimeofday(&rc->rc_t, NULL); /* activity timer */
+    if (clixon_event_reg_fd(rc->rc_s, restconf_connection, (void*)rc, "restconf client socket") < 0)
+        goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Make one step of the TLS handshake of a new connection
+ *
+ * The socket is non-blocking. If the handshake needs more data from the client, or
+ * cannot write, return to the event loop and continue when the socket is ready, see
+ * restconf_ssl_handshake_cb. When the handshake is done, the connection is started.
+ * @param[in]  rc    Restconf connection
+ * @retval     1     OK, connection is up or handshake is in progress
+ * @retval     0     OK, but connection closed
+ * @retval    -1     Error
+ */
+static int
+restconf_ssl_handshake(restconf_conn *rc)
+{
+    int                  retval = -1;
+    clicon_handle        h;
+    int                  ret;
+    int                  e;
+    int                  er;
+    const unsigned char *alpn = NULL;
+    unsigned int         alpnlen = 0;
+    restconf_http_proto  proto = HTTP_11;
+    restconf_native_handle *rn;
+
+    clicon_debug(1, "%s", __FUNCTION__);
+#ifdef HAVE_LIBNGHTTP2
+#ifndef HAVE_HTTP1
+    proto = HTTP_2;     /* If nghttp2 only let default be 2.0  */
+#endif
+#endif
+    h = rc->rc_h;
+    /* 1: OK, -1 fatal, 0: TLS/SSL handshake was not successful
+     * Both error cases: Call SSL_get_error() with the return value ret 
+     */
+    if ((ret = SSL_accept(rc->rc_ssl)) != 1) {
+        clicon_debug(1, "%s SSL_accept() ret:%d errno:%d", __FUNCTION__, ret, er=errno);
+        e = SSL_get_error(rc->rc_ssl, ret);
+        switch (e){
+        case SSL_ERROR_SSL:                  /* 1 */
+            clicon_debug(1, "%s SSL_ERROR_SSL (non-ssl message on ssl socket)", __FUNCTION__);
+#ifdef HTTP_ON_HTTPS_REPLY
+            SSL_free(rc->rc_ssl);
+            rc->rc_ssl = NULL;
+            if (native_send_badrequest(h, "application/yang-data+xml",
+                                       "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>The plain HTTP request was sent to HTTPS port</error-message></error></errors>", rc) < 0)
+                goto done;
+#endif
+            if (restconf_close_ssl_socket(rc, __FUNCTION__, 1) < 0)
+                goto done;
+            goto closed;
+            break;
+        case SSL_ERROR_SYSCALL:              /* 5 */
+            /* Some non-recoverable, fatal I/O error occurred. The OpenSSL error queue 
+               may contain more information on the error. For socket I/O on Unix systems, 
+               consult errno for details. If this error occurs then no further I/O
+               operations should be performed on the connection and SSL_shutdown() must 
+               not be called.*/
+            clicon_debug(1, "%s SSL_accept() SSL_ERROR_SYSCALL %d", __FUNCTION__, er);
+            if (restconf_close_ssl_socket(rc, __FUNCTION__, 1) < 0)
+                goto done;
+            goto closed;
+            break;
+        case SSL_ERROR_WANT_READ:            /* 2 */
+            /* Wait for more handshake data from client */
+            clicon_debug(1, "%s SSL_accept() SSL_ERROR_WANT_READ", __FUNCTION__);
+            if (clixon_event_reg_fd(rc->rc_s, restconf_ssl_handshake_cb, (void*)rc, "restconf tls handshake") < 0)
+                goto done;
+            goto ok;
+            break;
+        case SSL_ERROR_WANT_WRITE:           /* 3 */
+            clicon_debug(1, "%s SSL_accept() SSL_ERROR_WANT_WRITE", __FUNCTION__);
+            if (clixon_event_reg_fd_write(rc->rc_s, restconf_ssl_handshake_cb, (void*)rc, "restconf tls handshake") < 0)
+                goto done;
+            goto ok;
+            break;
+        case SSL_ERROR_NONE:                 /* 0 */
+        case SSL_ERROR_ZERO_RETURN:          /* 6 */
+        case SSL_ERROR_WANT_CONNECT:         /* 7 */
+        case SSL_ERROR_WANT_ACCEPT:          /* 8 */
+        case SSL_ERROR_WANT_X509_LOOKUP:     /* 4 */
+        case SSL_ERROR_WANT_ASYNC:           /* 8 */
+        case SSL_ERROR_WANT_ASYNC_JOB:       /* 10 */
+#ifdef SSL_ERROR_WANT_CLIENT_HELLO_CB
+        case SSL_ERROR_WANT_CLIENT_HELLO_CB: /* 11 */
+#endif
+        default:
+            clicon_err(OE_SSL, 0, "SSL_accept:%d", e);
+            goto done;
+            break;
+        }
+    } /* SSL_accept */
+    if ((rn = restconf_native_handle_get(h)) != NULL){
+        if (SSL_session_reused(rc->rc_ssl))
+            rn->rn_tls_resumed++;
+        else
+            rn->rn_tls_full++;
+        clicon_debug(1, "%s TLS handshakes full:%" PRIu64 " resumed:%" PRIu64,
+                     __FUNCTION__, rn->rn_tls_full, rn->rn_tls_resumed);
+    }
+    /* Sets data and len to point to the client's requested protocol for this connection. */
+#ifndef OPENSSL_NO_NEXTPROTONEG
+    SSL_get0_next_proto_negotiated(rc->rc_ssl, &alpn, &alpnlen);
+#endif /* !OPENSSL_NO_NEXTPROTONEG */
+    if (alpn == NULL) {
+        /* Returns a pointer to the selected protocol in data with length len. */
+        SSL_get0_alpn_selected(rc->rc_ssl, &alpn, &alpnlen);
+    }
+    if ((ret = ssl_alpn_check(h, alpn, alpnlen, rc, &proto)) < 0)
+        goto done;
+    if (ret == 0)
+        goto closed;
+    clicon_debug(1, "%s proto:%s", __FUNCTION__, restconf_proto2str(proto));
+
+#if 0 /* Seems too early to fail here, instead let authentication callback deal with this */
+    /* For client-cert authentication, check if any certs are present,
+    * if not, send bad request
+    * Alt: set SSL_CTX_set_verify(ctx, SSL_VERIFY_FAIL_IF_NO_PEER_CERT)
+    * but then SSL_accept fails.
+    */
+    if (restconf_auth_type_get(h) == CLIXON_AUTH_CLIENT_CERTIFICATE){
+        X509 *peercert;
+
+        if ((peercert = SSL_get_peer_certificate(rc->rc_ssl)) != NULL){
+            X509_free(peercert);
+        }
+        else { /* Get certificates (if available) */
+            if (proto != HTTP_2 &&
+                native_send_badrequest(h, rc->rc_s, rc->rc_ssl, "application/yang-data+xml",
+                                              "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>Peer certificate required</error-message></error></errors>", rc->rc_socket, rc) < 0)
+                goto done;
+            if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
+                goto done;
+            goto closed;
+        }
+    }
+#endif
+    /* Get the actual peer, XXX this maybe could be done in ca-auth client-cert code ? 
+     * Note this _only_ works if SSL_set1_host() was set previously,...
+     */
+    if ((ret = SSL_get_verify_result(rc->rc_ssl)) == X509_V_OK) { /* for peer cert */
+        const char *peername = SSL_get0_peername(rc->rc_ssl);
+        if (peername != NULL) {
+            /* Name checks were in scope and matched the peername */
+            clicon_debug(1, "%s peername:%s", __FUNCTION__, peername);
+        }
+    }
+#if 0
+    else{
+        clicon_log(LOG_NOTICE, "Cert error: %s", X509_verify_cert_error_string(ret));
+        /* Maybe should return already  here, but to get proper return message need to
+         * continue to http/1 or http/2 handling
+         * @see restconf_connection_sanity
+         */
+
+    }
+#endif
+#if 0 /* debug */
+    if (clicon_debug_get())
+        restconf_listcerts(rc->rc_ssl);
+#endif
+    if (restconf_conn_start(rc, proto) < 0)
+        goto done;
+ ok:
+    retval = 1;
+ done:
+    clicon_debug(1, "%s retval %d", __FUNCTION__, retval);
+    return retval;
+ closed:
+    retval = 0; /* OK, closed */
+    goto done;
+}
+
+/*! Continue TLS handshake when connection socket is ready
+ * @param[in]  s    Connection socket
+ * @param[in]  arg  Restconf connection
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see restconf_ssl_handshake where this callback is registered
+ */
+static int
+restconf_ssl_handshake_cb(int   s,
+                          void *arg)
+{
+    restconf_conn *rc = (restconf_conn *)arg;
+
+    clixon_event_unreg_fd(s, restconf_ssl_handshake_cb);
+    if (restconf_ssl_handshake(rc) < 0)
+        return -1;
+    return 0;
+}
+
 /*! Accept new socket client. Note SSL not ip, this applies also to callhome
+ *
+ * The socket is set non-blocking. For SSL, the TLS handshake is started, and if it
+ * cannot complete directly, it continues from the event loop.
  * @param[in]  h     Clixon handle
  * @param[in]  s     Socket (unix or ip)
  * @param[in]  rsock Socket struct
  * @param[out] rcp   Restconf connection, if present and retval=1
- * @retval     1     OK, connection is up, rcp set
+ * @retval     1     OK, connection is up or TLS handshake in progress, rcp set
  * @retval     0     OK, but connection closed
  * @retval    -1     Error
  * @see openssl_init_socket where this callback is registered
@@ -1183,13 +2074,8 @@ restconf_ssl_accept_client(clicon_handle    h,
     int                     retval = -1;
     restconf_native_handle *rn = NULL;
     restconf_conn          *rc = NULL;
-    char                   *name = NULL;
     int                     ret;
-    int                     e;
-    int                     er;
-    int                     readmore;
-    const unsigned char    *alpn = NULL;
-    unsigned int            alpnlen = 0;
+    int                     flags;
     restconf_http_proto     proto = HTTP_11;  /* Non-SSL negotiation NYI */
 
     clicon_debug(1, "%s", __FUNCTION__);
@@ -1202,6 +2088,12 @@ restconf_ssl_accept_client(clicon_handle    h,
         clicon_err(OE_XML, EFAULT, "No openssl handle");
         goto done;
     }
+    /* Accepted sockets do not inherit non-blocking from listen socket on all platforms */
+    if ((flags = fcntl(s, F_GETFL, 0)) < 0 ||
+        fcntl(s, F_SETFL, flags | O_NONBLOCK) < 0){
+        clicon_err(OE_UNIX, errno, "fcntl");
+        goto done;
+    }
     /*
      * Register callbacks for actual data socket 
      */
@@ -1243,167 +2135,18 @@ restconf_ssl_accept_client(clicon_handle    h,
             clicon_err(OE_SSL, 0, "SSL_set_fd");
             goto done;
         }
-        readmore = 1;
-        while (readmore){
-            readmore = 0;
-            /* 1: OK, -1 fatal, 0: TLS/SSL handshake was not successful
-             * Both error cases: Call SSL_get_error() with the return value ret 
-             */
-            if ((ret = SSL_accept(rc->rc_ssl)) != 1) {
-                clicon_debug(1, "%s SSL_accept() ret:%d errno:%d", __FUNCTION__, ret, er=errno);
-                e = SSL_get_error(rc->rc_ssl, ret);
-                switch (e){
-                case SSL_ERROR_SSL:                  /* 1 */
-                    clicon_debug(1, "%s SSL_ERROR_SSL (non-ssl message on ssl socket)", __FUNCTION__);
-#ifdef HTTP_ON_HTTPS_REPLY
-                    SSL_free(rc->rc_ssl);
-                    rc->rc_ssl = NULL;
-                    if (native_send_badrequest(h, "application/yang-data+xml",
-                                               "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>The plain HTTP request was sent to HTTPS port</error-message></error></errors>", rc) < 0)
-                        goto done;
-#endif
-                    if (restconf_close_ssl_socket(rc, __FUNCTION__, 1) < 0)
-                        goto done;
-                    goto closed;
-                    break;
-                case SSL_ERROR_SYSCALL:              /* 5 */
-                    /* Some non-recoverable, fatal I/O error occurred. The OpenSSL error queue 
-                       may contain more information on the error. For socket I/O on Unix systems, 
-                       consult errno for details. If this error occurs then no further I/O
-                       operations should be performed on the connection and SSL_shutdown() must 
-                       not be called.*/
-                    clicon_debug(1, "%s SSL_accept() SSL_ERROR_SYSCALL %d", __FUNCTION__, er);
-                    if (restconf_close_ssl_socket(rc, __FUNCTION__, 1) < 0)
-                        goto done;
-                    rc = NULL;
-                    goto closed;
-                    break;
-                case SSL_ERROR_WANT_READ:            /* 2 */
-                case SSL_ERROR_WANT_WRITE:           /* 3 */
-                    /* SSL_ERROR_WANT_READ is returned when the last operation was a read operation 
-                     * from a nonblocking BIO. 
-                     * That is, it can happen if restconf_socket_init() below is called 
-                     * with SOCK_NONBLOCK
-                     */
-                    clicon_debug(1, "%s write SSL_ERROR_WANT_READ", __FUNCTION__);
-                    usleep(10000);
-                    readmore = 1;
-                    break;
-                case SSL_ERROR_NONE:                 /* 0 */
-                case SSL_ERROR_ZERO_RETURN:          /* 6 */
-                case SSL_ERROR_WANT_CONNECT:         /* 7 */
-                case SSL_ERROR_WANT_ACCEPT:          /* 8 */
-                case SSL_ERROR_WANT_X509_LOOKUP:     /* 4 */
-                case SSL_ERROR_WANT_ASYNC:           /* 8 */
-                case SSL_ERROR_WANT_ASYNC_JOB:       /* 10 */
-#ifdef SSL_ERROR_WANT_CLIENT_HELLO_CB
-                case SSL_ERROR_WANT_CLIENT_HELLO_CB: /* 11 */
-#endif
-                default:
-                    clicon_err(OE_SSL, 0, "SSL_accept:%d", e);
-                    goto done;
-                    break;
-                }
-            } /* SSL_accept */
-        } /* while(readmore) */
-        /* Sets data and len to point to the client's requested protocol for this connection. */
-#ifndef OPENSSL_NO_NEXTPROTONEG
-        SSL_get0_next_proto_negotiated(rc->rc_ssl, &alpn, &alpnlen);
-#endif /* !OPENSSL_NO_NEXTPROTONEG */
-        if (alpn == NULL) {
-            /* Returns a pointer to the selected protocol in data with length len. */
-            SSL_get0_alpn_selected(rc->rc_ssl, &alpn, &alpnlen);
-        }
-        if ((ret = ssl_alpn_check(h, alpn, alpnlen, rc, &proto)) < 0)
+        if ((ret = restconf_ssl_handshake(rc)) < 0)
             goto done;
         if (ret == 0)
             goto closed;
-        clicon_debug(1, "%s proto:%s", __FUNCTION__, restconf_proto2str(proto));
-
-#if 0 /* Seems too early to fail here, instead let authentication callback deal with this */
-        /* For client-cert authentication, check if any certs are present,
-        * if not, send bad request
-        * Alt: set SSL_CTX_set_verify(ctx, SSL_VERIFY_FAIL_IF_NO_PEER_CERT)
-        * but then SSL_accept fails.
-        */
-        if (restconf_auth_type_get(h) == CLIXON_AUTH_CLIENT_CERTIFICATE){
-            X509 *peercert;
-
-            if ((peercert = SSL_get_peer_certificate(rc->rc_ssl)) != NULL){
-                X509_free(peercert);
-            }
-            else { /* Get certificates (if available) */
-                if (proto != HTTP_2 &&
-                    native_send_badrequest(h, rc->rc_s, rc->rc_ssl, "application/yang-data+xml",
-                                                  "<errors xmlns=\"urn:ietf:params:xml:ns:yang:ietf-restconf\"><error><error-type>protocol</error-type><error-tag>malformed-message</error-tag><error-message>Peer certificate required</error-message></error></errors>", rc->rc_socket, rc) < 0)
-                    goto done;
-                if (restconf_close_ssl_socket(rc, __FUNCTION__, 0) < 0)
-                    goto done;
-                goto closed;
-            }
-        }
-#endif
-        /* Get the actual peer, XXX this maybe could be done in ca-auth client-cert code ? 
-         * Note this _only_ works if SSL_set1_host() was set previously,...
-         */
-        if ((ret = SSL_get_verify_result(rc->rc_ssl)) == X509_V_OK) { /* for peer cert */
-            const char *peername = SSL_get0_peername(rc->rc_ssl);
-            if (peername != NULL) {
-                /* Name checks were in scope and matched the peername */
-                clicon_debug(1, "%s peername:%s", __FUNCTION__, peername);
-            }
-        }
-#if 0
-        else{
-            clicon_log(LOG_NOTICE, "Cert error: %s", X509_verify_cert_error_string(ret));
-            /* Maybe should return already  here, but to get proper return message need to
-             * continue to http/1 or http/2 handling
-             * @see restconf_connection_sanity
-             */
-
-        }
-#endif
-#if 0 /* debug */
-        if (clicon_debug_get())
-            restconf_listcerts(rc->rc_ssl);
-#endif
-    } /* if ssl */
-    rc->rc_proto = proto;
-    switch (rc->rc_proto){
-#ifdef HAVE_HTTP1
-    case HTTP_10:
-    case HTTP_11:
-        /* Create a default stream for http/1 */
-        if (restconf_stream_data_new(rc, 0) == NULL)
-            goto done;
-        break;
-#endif /* HAVE_HTTP1 */
-#ifdef HAVE_LIBNGHTTP2
-    case HTTP_2:{
-        if (http2_session_init(rc) < 0){
-            restconf_close_ssl_socket(rc, __FUNCTION__, 0);
-            goto done;
-        }
-        if (http2_send_server_connection(rc) < 0){
-            restconf_close_ssl_socket(rc, __FUNCTION__, 0);
-            goto done;
-        }
-        break;
     }
-#endif /* HAVE_LIBNGHTTP2 */
-    default:
-        break;
-    } /* switch proto */
-    gettimeofday(&rc->rc_t, NULL); /* activity timer */
-    if (clixon_event_reg_fd(rc->rc_s, restconf_connection, (void*)rc, "restconf client socket") < 0)
+    else if (restconf_conn_start(rc, proto) < 0)
         goto done;
     if (rcp)
         *rcp = rc;
     retval = 1; /* OK, up */
  done:
     clicon_debug(1, "%s retval %d", __FUNCTION__, retval);
-    if (name)
-        free(name);
     return retval;
  closed:
     retval = 0; /* OK, closed */
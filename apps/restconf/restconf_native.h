@@ -76,14 +76,19 @@ struct restconf_conn;
 typedef struct  {
     qelem_t               sd_qelem;     /* List header */
     int32_t               sd_stream_id;
-    int                   sd_fd;        /* XXX Is this used? */
+    int                   sd_fd;        /* Output body file, or -1, see restconf_reply_send_file */
     cvec                 *sd_outp_hdrs; /* List of output headers */
     cbuf                 *sd_outp_buf;  /* Output buffer */
     cbuf                 *sd_body;      /* http output body as cbuf terminated with \r\n */
     size_t                sd_body_len;  /* Content-Length, note for HEAD body body can be NULL and this non-zero */
     size_t                sd_body_offset; /* Offset into body */
+    char                 *sd_body_ref;  /* Borrowed output body, see restconf_reply_send_buf */
+    void                (*sd_body_release)(void *); /* Called when borrowed body is not used */
+    void                 *sd_body_arg;  /* Argument to sd_body_release */
     cbuf                 *sd_inbuf;     /* Receive/input buf (whole message) */
     cbuf                 *sd_indata;    /* Receive/input data body */
+    size_t                sd_hdrscan;   /* HTTP/1: bytes of sd_inbuf searched for end of header */
+    size_t                sd_reqlen;    /* HTTP/1: length of header and body, 0 if header not read */
     char                 *sd_path;      /* Uri path, uri-encoded, without args (eg ?) */
     uint16_t              sd_code;      /* If != 0 send a reply XXX: need reply flag? */
     struct restconf_conn *sd_conn;      /* Backpointer to connection this stream is part of */
@@ -92,9 +97,24 @@ typedef struct  {
     void                 *sd_req;       /* Lib-specific request */
     int                   sd_upgrade2;  /* Upgrade to http/2 */
     uint8_t              *sd_settings2; /* Settings for upgrade to http/2 request */
+    cvec                 *sd_inp_hdrs;  /* HTTP/2: request headers, set as params when executed */
+    int                   sd_ready;     /* HTTP/2: request received, waiting to be executed */
+    int                   sd_sse;       /* Event stream, body is written as notifications arrive */
+    void                 *sd_sub;       /* Event stream subscription, see restconf_stream_native.c */
 } restconf_stream_data;
 
 typedef struct restconf_socket restconf_socket;
+
+/* Backend session of restconf process, a pool of these is shared by restconf connections
+ * @see CLICON_RESTCONF_BACKEND_SESSIONS
+ */
+typedef struct {
+    int                   bs_s;         /* Backend socket, -1 if not connected */
+    uint32_t              bs_id;        /* Backend session-id, 0 if not assigned */
+    int                   bs_conns;     /* Number of restconf connections bound to session */
+    int                   bs_dirty;     /* RPC called that may lock, close when unbound */
+    uint64_t              bs_requests;  /* Number of requests made in session */
+} restconf_backend_session;
     
 /* Restconf connection handle 
  * Per connection request
@@ -117,10 +137,14 @@ typedef struct restconf_conn {
      * drawback is specific includes need to go everywhere */
 #ifdef HAVE_LIBNGHTTP2
     nghttp2_session      *rc_ngsession; /* XXX Not sure it is needed */
+    int                   rc_nready;    /* Number of streams with sd_ready set */
 #endif
     restconf_socket      *rc_socket;    /* Backpointer to restconf_socket needed for callhome */
+    restconf_backend_session *rc_bs;    /* Backend session bound to this connection */
     struct timeval        rc_t;         /* Timestamp of last read/write activity, used by callhome
                                            idle-timeout algorithm */
+    cbuf                 *rc_outp;      /* Output not yet written since socket write would block */
+    size_t                rc_outp_off;  /* Offset of first unwritten byte in rc_outp */
 } restconf_conn;
 
 /* Restconf per socket handle
@@ -166,6 +190,20 @@ typedef struct {
     SSL_CTX         *rn_ctx;       /* SSL context */
     restconf_socket *rn_sockets;   /* List of restconf server (ready for accept) sockets */
     void            *rn_arg;       /* Packet specific handle */
+    int              rn_workers;   /* Number of worker processes, see CLICON_RESTCONF_WORKERS */
+    int              rn_worker;    /* Index of this worker process (0 if single process) */
+    unsigned char    rn_ticket_secret[32]; /* TLS ticket keys are derived from this, shared by workers */
+    uint32_t         rn_ticket_rotation;   /* Ticket key rotation interval in seconds, 0: never */
+    uint64_t         rn_tls_full;  /* Number of full TLS handshakes */
+    uint64_t         rn_tls_resumed; /* Number of resumed TLS handshakes */
+    uint32_t         rn_compress_min; /* Min reply body size to compress, 0: never compress */
+    uint32_t         rn_compress_level; /* zlib compression level of replies, 1-9 */
+    restconf_backend_session *rn_bsessions; /* Pool of backend sessions */
+    int              rn_nbsessions; /* Number of backend sessions in pool */
+    uint64_t         rn_bs_binds;  /* Number of connections bound to a backend session */
+    uint64_t         rn_bs_shared; /* Binds to a session already used by another connection */
+    uint64_t         rn_bs_closed; /* Sessions closed since a connection made an RPC */
+    int              rn_bs_maxused; /* Max number of sessions bound at the same time */
 } restconf_native_handle;
 
 /*
@@ -174,12 +212,18 @@ typedef struct {
 restconf_stream_data *restconf_stream_data_new(restconf_conn *rc, int32_t stream_id);
 restconf_stream_data *restconf_stream_find(restconf_conn *rc, int32_t id);
 int               restconf_stream_free(restconf_stream_data *sd);
+int               restconf_stream_body_release(restconf_stream_data *sd);
 restconf_conn    *restconf_conn_new(clicon_handle h, int s, restconf_socket *socket);
 int               ssl_x509_name_oneline(SSL *ssl, char **oneline);
 
+int               native_buf_write(clicon_handle h, char *buf, size_t buflen, restconf_conn *rc, const char *callfn);
 int               restconf_close_ssl_socket(restconf_conn *rc, const char *callfn, int sslerr0);
 int               restconf_connection_sanity(clicon_handle h, restconf_conn *rc, restconf_stream_data *sd);
 restconf_native_handle *restconf_native_handle_get(clicon_handle h);
+int               restconf_backend_pool_init(clicon_handle h);
+int               restconf_backend_pool_free(clicon_handle h);
+int               restconf_backend_session_enter(restconf_conn *rc);
+int               restconf_backend_session_leave(restconf_conn *rc, restconf_stream_data *sd);
 int               restconf_connection(int s, void *arg);
 int               restconf_ssl_accept_client(clicon_handle h, int s, restconf_socket *rsock, restconf_conn  **rcp);
 int               restconf_idle_timer_unreg(restconf_conn *rc);
@@ -87,6 +87,7 @@
 #include "restconf_native.h"    /* Restconf-openssl mode specific headers*/
 #ifdef HAVE_LIBNGHTTP2          /* Ends at end-of-file */
 #include "restconf_nghttp2.h"   /* Restconf-openssl mode specific headers*/
+#include "restconf_stream.h"
 #include "clixon_http_data.h"
 
 #define ARRLEN(x) (sizeof(x) / sizeof(x[0]))
@@ -165,90 +166,23 @@ session_send_callback(nghttp2_session *session,
                       int              flags,
                       void            *user_data)
 {
-    int            retval = NGHTTP2_ERR_CALLBACK_FAILURE;
     restconf_conn *rc = (restconf_conn *)user_data;
-    int            er;
-    ssize_t        len;
-    ssize_t        totlen = 0;
-    int            s;
-    int            sslerr;
+    int            ret;
     
     clicon_debug(1, "%s buflen:%zu", __FUNCTION__, buflen);
-    s = rc->rc_s;
-    while (totlen < buflen){
-        if (rc->rc_ssl){
-            if ((len = SSL_write(rc->rc_ssl, buf+totlen, buflen-totlen)) <= 0){
-                er = errno;
-                sslerr = SSL_get_error(rc->rc_ssl, len);
-                clicon_debug(1, "%s errno:%d sslerr:%d", __FUNCTION__, er, sslerr);
-                switch (sslerr){
-                case SSL_ERROR_WANT_WRITE:           /* 3 */
-                    clicon_debug(1, "%s write SSL_ERROR_WANT_WRITE", __FUNCTION__);
-                    usleep(1000);
-                    continue;
-                    break;
-                case SSL_ERROR_SYSCALL:              /* 5 */
-                    if (er == ECONNRESET || /* Connection reset by peer */
-                        er == EPIPE) {      /* Reading end of socket is closed */
-                        goto done; /* Cleanup in http2_recv() */
-                    }
-                    else if (er == EAGAIN){
-                        /* same as want_write above, but different behaviour on different 
-                         * platforms, linux here, freebsd want_write, or possibly differnt
-                         * ssl lib versions?
-                         */
-                        clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-                        usleep(1000);
-                        continue;
-                    }
-                    else{
-                        clicon_err(OE_RESTCONF, er, "SSL_write %d", sslerr);
-                        goto done;
-                    }
-                    break;
-                default:
-                    clicon_err(OE_SSL, 0, "SSL_write");
-                    goto done;
-                    break;
-                }
-                goto done;
-            }
-        }
-        else{
-            if ((len = write(s, buf+totlen, buflen-totlen)) < 0){
-                if (errno == EAGAIN){
-                    clicon_debug(1, "%s write EAGAIN", __FUNCTION__);
-                    usleep(10000);
-                    continue;
-                }
-#if 1
-                else if (errno == ECONNRESET) {/* Connection reset by peer */
-                    close(s);
-                    // XXXUnclear why this is commented, maybe should call
-                    // restconf_connection_close?
-                    //  clixon_event_unreg_fd(s, restconf_connection);
-
-                    goto ok; /* Close socket and ssl */
-                }
-#endif
-                else{
-                    clicon_err(OE_UNIX, errno, "write");
-                    goto done;
-                }
-            }
-            assert(len != 0);
-        }
-        totlen += len;
-    } /* while */
- ok:
-    retval = 0;
- done:
-    if (retval < 0){
-        clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
-        return retval;
-    }
-    clicon_debug(1, "%s retval:%zd", __FUNCTION__, totlen);
-    return retval == 0 ? totlen : retval;
+    /* Hold back frames while earlier output is pending. nghttp2 keeps them and reads
+     * more DATA with restconf_sd_read only when the socket is writable again,
+     * see restconf_connection_output */
+    if (rc->rc_outp != NULL && rc->rc_outp_off < cbuf_len(rc->rc_outp))
+        return NGHTTP2_ERR_WOULDBLOCK;
+    /* Output that would block is kept in rc and written when socket is writable,
+     * so all bytes are accepted here */
+    if ((ret = native_buf_write(rc->rc_h, (char*)buf, buflen, rc, __FUNCTION__)) < 0)
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+    if (ret == 0) /* Closed by peer, cleanup in http2_recv() */
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+    clicon_debug(1, "%s retval:%zu", __FUNCTION__, buflen);
+    return buflen;
 }
 
 /*! Invoked when |session| wants to receive data from the remote peer.  
@@ -314,8 +248,9 @@ restconf_nghttp2_path(restconf_stream_data *sd)
         /* Matching algorithm:
          * 1. try well-known
          * 2. try /restconf
-         * 3. try /data
-         * 4. call restconf anyway (because it handles errors)
+         * 3. try /streams
+         * 4. try /data
+         * 5. call restconf anyway (because it handles errors)
          * This is for the situation where data is / and /restconf is more specific
          */
         if (strcmp(sd->sd_path, RESTCONF_WELL_KNOWN) == 0){
@@ -326,6 +261,10 @@ restconf_nghttp2_path(restconf_stream_data *sd)
             if (api_root_restconf(h, sd, sd->sd_qvec) < 0)
                 goto done;          
         }
+        else if (api_path_is_stream(h)){
+            if (api_stream(h, sd, sd->sd_qvec, NULL) < 0)
+                goto done;
+        }
         else if (api_path_is_data(h)){
             if (api_http_data(h, sd, sd->sd_qvec) < 0)
                 goto done;
@@ -346,8 +285,12 @@ restconf_nghttp2_path(restconf_stream_data *sd)
     return retval; /* void */
 }
 
-/*! data callback, just pass pointer to cbuf
- * XXX handle several chunks with cbuf 
+/*! Data callback, read next chunk of response body
+ *
+ * Called by nghttp2 when the stream and connection flow-control windows allow more
+ * DATA, length is bounded by the windows and the frame size. A large body is therefore
+ * sent chunk by chunk as the client opens the windows, a body from file is read a chunk
+ * at a time.
  */
 static ssize_t
 restconf_sd_read(nghttp2_session     *session,
@@ -362,7 +305,50 @@ restconf_sd_read(nghttp2_session     *session,
     cbuf                 *cb;
     size_t                len = 0;
     size_t                remain;
-
+    ssize_t               n;
+
+    if (sd->sd_fd != -1){ /* Body from file, see restconf_reply_send_file */
+        remain = sd->sd_body_len - sd->sd_body_offset;
+        len = remain <= length ? remain : length;
+        if ((n = pread(sd->sd_fd, buf, len, sd->sd_body_offset)) <= 0){
+            clicon_debug(1, "%s pread: %s", __FUNCTION__, n<0?strerror(errno):"file truncated");
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        }
+        sd->sd_body_offset += n;
+        if (sd->sd_body_offset == sd->sd_body_len)
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        clicon_debug(1, "%s retval:%zd", __FUNCTION__, n);
+        return n;
+    }
+    if (sd->sd_body_ref){ /* Borrowed body, see restconf_reply_send_buf */
+        remain = sd->sd_body_len - sd->sd_body_offset;
+        len = remain <= length ? remain : length;
+        memcpy(buf, sd->sd_body_ref + sd->sd_body_offset, len);
+        sd->sd_body_offset += len;
+        if (sd->sd_body_offset == sd->sd_body_len)
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        clicon_debug(1, "%s retval:%zu", __FUNCTION__, len);
+        return len;
+    }
+    if (sd->sd_sse){ /* Event stream, events are queued in body, see http2_stream_event */
+        cb = sd->sd_body;
+        remain = cb ? cbuf_len(cb) - sd->sd_body_offset : 0;
+        if (remain == 0){
+            if (sd->sd_sub == NULL){ /* Subscription ended */
+                *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+                return 0;
+            }
+            return NGHTTP2_ERR_DEFERRED; /* Resumed when next event is queued */
+        }
+        len = remain <= length ? remain : length;
+        memcpy(buf, cbuf_get(cb) + sd->sd_body_offset, len);
+        sd->sd_body_offset += len;
+        if (sd->sd_body_offset == cbuf_len(cb)){
+            cbuf_reset(cb);
+            sd->sd_body_offset = 0;
+        }
+        return len;
+    }
     if ((cb = sd->sd_body) == NULL){ /* shouldnt happen */
         *data_flags |= NGHTTP2_DATA_FLAG_EOF;
         return 0;
@@ -476,9 +462,14 @@ http2_exec(restconf_conn        *rc,
     sd->sd_proto = HTTP_2; /* XXX is this necessary? */
     if (strcmp(sd->sd_path, RESTCONF_WELL_KNOWN) == 0
         || api_path_is_restconf(rc->rc_h)
+        || api_path_is_stream(rc->rc_h)
         || api_path_is_data(rc->rc_h)){
+        if (restconf_backend_session_enter(rc) < 0)
+            goto done;
         if (restconf_nghttp2_path(sd) < 0)
             goto done;
+        if (restconf_backend_session_leave(rc, sd) < 0)
+            goto done;
     }
     else{
         sd->sd_code = 404;    /* not found */
@@ -519,7 +510,6 @@ on_frame_recv_callback(nghttp2_session     *session,
     int                   retval = -1;
     restconf_conn        *rc = (restconf_conn *)user_data;
     restconf_stream_data *sd = NULL;
-    char                 *query;
     
     clicon_debug(1, "%s %s %d", __FUNCTION__, 
                  clicon_int2str(nghttp2_frame_type_map, frame->hd.type),
@@ -534,23 +524,18 @@ on_frame_recv_callback(nghttp2_session     *session,
              */
             if ((sd = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id)) == NULL)
                 return 0;
-            /* Query vector, ie the ?a=x&b=y stuff */
-            query = restconf_param_get(rc->rc_h, "REQUEST_URI");
-            if ((query = index(query, '?')) != NULL){
-                query++;
-                if (strlen(query) &&
-                    uri_str2cvec(query, '&', '=', 1, &sd->sd_qvec) < 0)
-                    goto done;
+            /* Executed later, see http2_exec_ready */
+            if (!sd->sd_ready){
+                sd->sd_ready = 1;
+                rc->rc_nready++;
             }
-            if (http2_exec(rc, sd, session, frame->hd.stream_id) < 0)
-                goto done;
         }
         break;
     default:
         break;
     }
     retval = 0;
- done:
+    // done:
     return retval;
 }
 
@@ -637,7 +622,8 @@ on_stream_close_callback(nghttp2_session   *session,
                          nghttp2_error_code error_code,
                          void              *user_data)
 {
-    //    restconf_conn *rc = (restconf_conn *)user_data;
+    restconf_conn        *rc = (restconf_conn *)user_data;
+    restconf_stream_data *sd;
 
     clicon_debug(1, "%s %d %s", __FUNCTION__, error_code, nghttp2_strerror(error_code));
 #if 0 // NOTNEEDED /* XXX think this is not necessary? */
@@ -646,6 +632,13 @@ on_stream_close_callback(nghttp2_session   *session,
             return -1;
     }
 #endif
+    /* Response is sent or stream is reset by peer: free stream, also if not yet executed */
+    if ((sd = restconf_stream_find(rc, stream_id)) != NULL){
+        if (sd->sd_ready)
+            rc->rc_nready--;
+        DELQ(sd, rc->rc_streams, restconf_stream_data *);
+        restconf_stream_free(sd);
+    }
     return 0;
 }
 
@@ -720,14 +713,24 @@ on_header_callback(nghttp2_session     *session,
                    void               *user_data)
 {
     int                   retval = -1;
-    restconf_conn      *rc = (restconf_conn *)user_data;
+    restconf_stream_data *sd;
 
     switch (frame->hd.type){
     case NGHTTP2_HEADERS:
         assert (frame->headers.cat == NGHTTP2_HCAT_REQUEST);
         clicon_debug(1, "%s HEADERS %s %s", __FUNCTION__, name, value);
-        if (nghttp2_hdr2clixon(rc->rc_h, (char*)name, (char*)value) < 0)
+        /* Kept in stream and set as params when executed, see http2_exec_ready */
+        if ((sd = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id)) == NULL)
+            break;
+        if (sd->sd_inp_hdrs == NULL &&
+            (sd->sd_inp_hdrs = cvec_new(0)) == NULL){
+            clicon_err(OE_UNIX, errno, "cvec_new");
+            goto done;
+        }
+        if (cvec_add_string(sd->sd_inp_hdrs, (char*)name, (char*)value) == NULL){
+            clicon_err(OE_UNIX, errno, "cvec_add_string");
             goto done;
+        }
         break;
     default:
         clicon_debug(1, "%s %s %s", __FUNCTION__, clicon_int2str(nghttp2_frame_type_map, frame->hd.type), name);
@@ -874,6 +877,126 @@ error_callback2(nghttp2_session *session,
 }
 #endif
 
+/*! Queue an event on a http/2 event stream and send it
+ *
+ * The event is queued in the stream body and sent as DATA when flow-control windows allow,
+ * see restconf_sd_read
+ * @param[in] sd   Http/2 stream of event stream
+ * @param[in] buf  Encoded event
+ * @param[in] len  Length of buf
+ * @retval    1    OK
+ * @retval    0    Socket closed, caller should close connection
+ * @retval   -1    Fatal error
+ * @see api_stream
+ */
+int
+http2_stream_event(restconf_stream_data *sd,
+                   char                 *buf,
+                   size_t                len)
+{
+    int            retval = -1;
+    restconf_conn *rc = sd->sd_conn;
+    nghttp2_error  ngerr;
+
+    clicon_debug(1, "%s %d len:%zu", __FUNCTION__, sd->sd_stream_id, len);
+    if (sd->sd_body == NULL &&
+        (sd->sd_body = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (cbuf_append_buf(sd->sd_body, buf, len) < 0){
+        clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+        goto done;
+    }
+    nghttp2_session_resume_data(rc->rc_ngsession, sd->sd_stream_id);
+    clicon_err_reset();
+    if ((ngerr = nghttp2_session_send(rc->rc_ngsession)) != 0){
+        if (clicon_errno)
+            goto done;
+        else
+            goto fail; /* Not fatal error */
+    }
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Execute the oldest request received on a http/2 stream of a connection
+ *
+ * Requests are not executed in the nghttp2 frame callbacks, instead the streams are marked
+ * ready and are executed one at a time when no more input is available on the connection.
+ * In between, input frames of other streams, eg WINDOW_UPDATE or RST_STREAM, are processed,
+ * and the response of each stream is sent before the next stream is executed.
+ * Request headers are kept in the stream until it is executed, since restconf parameters
+ * are per handle.
+ * @param[in] rc   Restconf connection
+ * @retval    1    OK
+ * @retval    0    Socket closed, caller should close rc
+ * @retval   -1    Fatal error
+ * @see restconf_connection
+ */
+int
+http2_exec_ready(restconf_conn *rc)
+{
+    int                   retval = -1;
+    restconf_stream_data *sd;
+    restconf_stream_data *sd1 = NULL;
+    cg_var               *cv;
+    char                 *query;
+    nghttp2_error         ngerr;
+
+    clicon_debug(1, "%s", __FUNCTION__);
+    /* Client stream ids are increasing, the oldest request has the lowest id */
+    if ((sd = rc->rc_streams) != NULL){
+        do {
+            if (sd->sd_ready && (sd1 == NULL || sd->sd_stream_id < sd1->sd_stream_id))
+                sd1 = sd;
+            sd = NEXTQ(restconf_stream_data *, sd);
+        } while (sd && sd != rc->rc_streams);
+    }
+    if ((sd = sd1) == NULL){
+        rc->rc_nready = 0;
+        goto ok;
+    }
+    sd->sd_ready = 0;
+    rc->rc_nready--;
+    if (restconf_param_del_all(rc->rc_h) < 0)
+        goto done;
+    cv = NULL;
+    while ((cv = cvec_each(sd->sd_inp_hdrs, cv)) != NULL)
+        if (nghttp2_hdr2clixon(rc->rc_h, cv_name_get(cv), cv_string_get(cv)) < 0)
+            goto done;
+    /* Query vector, ie the ?a=x&b=y stuff */
+    if ((query = restconf_param_get(rc->rc_h, "REQUEST_URI")) != NULL &&
+        (query = index(query, '?')) != NULL){
+        query++;
+        if (strlen(query) &&
+            uri_str2cvec(query, '&', '=', 1, &sd->sd_qvec) < 0)
+            goto done;
+    }
+    if (http2_exec(rc, sd, rc->rc_ngsession, sd->sd_stream_id) < 0)
+        goto done;
+    /* Note sd may be freed here if the stream is closed */
+    clicon_err_reset();
+    if ((ngerr = nghttp2_session_send(rc->rc_ngsession)) != 0){
+        if (clicon_errno)
+            goto done;
+        else
+            goto fail; /* Not fatal error */
+    }
+ ok:
+    retval = 1;
+ done:
+    clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Process an HTTP/2 request received in buffer, process request and send reply
  *
  * @param[in] rc   Restconf connection
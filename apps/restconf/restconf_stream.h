@@ -41,8 +41,12 @@
  * Prototypes
  */
 int api_path_is_stream(clicon_handle h);
+int api_stream(clicon_handle h, void *req, cvec *qvec, int *finish);
+/* fcgi */
 int stream_child_free(clicon_handle h, int pid);
 int stream_child_freeall(clicon_handle h);
-int api_stream(clicon_handle h, void *req, cvec *qvec, int *finish);
+/* native */
+int stream_sub_leave(void *req);
+int stream_sub_freeall(clicon_handle h);
 
 #endif /* _RESTCONF_STREAM_H_ */
@@ -0,0 +1,803 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2019 Olof Hagsand
+  Copyright (C) 2020-2022 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+  Restconf event stream implementation for native http/1 and http/2
+  See RFC 8040  RESTCONF Protocol Sections 3.8, 6, 9.3
+  See restconf_stream_fcgi.c for the fcgi variant
+
+  An event stream is a long-lived http reply with Content-Type text/event-stream, ie
+  server-sent events (SSE), where each notification is sent as an event:
+      data: <notification ...>...</notification>
+      <empty line>
+
+  Clients of the same stream and filter, with the same user, share one backend
+  subscription. Each notification from the backend is encoded once and is written to all
+  clients of the subscription. Output to a client that cannot be written at once is queued
+  per client: in the connection for http/1 (see native_buf_write) and in the http/2 stream
+  (see http2_stream_event). A client with more than STREAM_CLIENT_QUEUE_MAX queued bytes is
+  considered stuck and is disconnected, so that a slow client does not hold memory or
+  delay others.
+  A subscription with start-time or stop-time (replay) is not shared.
+
+  The backend subscription is closed when its last client leaves, and all clients are
+  ended when the backend closes the subscription or at stop-time.
+  A http/1 reply has no Content-Length, the connection is closed at the end of the stream,
+  and no further requests are read from it. A http/2 stream ends with an empty DATA frame
+  with END_STREAM.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <syslog.h>
+#include <sys/time.h>
+
+#include <openssl/ssl.h>
+
+#ifdef HAVE_LIBNGHTTP2
+#include <nghttp2/nghttp2.h>
+#endif
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+/* restconf */
+#include "restconf_lib.h"
+#include "restconf_handle.h"
+#include "restconf_api.h"
+#include "restconf_err.h"
+#include "restconf_native.h"
+#include "restconf_stream.h"
+#ifdef HAVE_LIBNGHTTP2
+#include "restconf_nghttp2.h"
+#endif
+
+/*
+ * Constants
+ */
+/* Max bytes queued to a client, if more the client is disconnected */
+#define STREAM_CLIENT_QUEUE_MAX (1024*1024)
+
+/* Shared backend subscription of a notification stream, fanned out to its clients
+ */
+typedef struct {
+    qelem_t                ss_qelem;    /* List header */
+    char                  *ss_key;      /* User, stream and filter, NULL if not shared */
+    int                    ss_s;        /* Backend notification socket */
+    struct timeval         ss_stop;     /* End subscription at this time if set */
+    restconf_stream_data **ss_clients;  /* Vector of http streams receiving events */
+    int                    ss_nclients; /* Length of ss_clients */
+    int                    ss_maxclients; /* Allocated length of ss_clients */
+} stream_sub;
+
+/* List of backend subscriptions
+ * @note could hang STREAM_SUB list on clicon handle instead, as STREAM_CHILD in fcgi
+ */
+static stream_sub *STREAM_SUB = NULL;
+
+/* Statistics, logged at exit */
+static uint64_t STREAM_NSUBS = 0;    /* Backend subscriptions made */
+static uint64_t STREAM_NCLIENTS = 0; /* Clients subscribed */
+static uint64_t STREAM_NEVENTS = 0;  /* Events received from backend */
+static uint64_t STREAM_NWRITES = 0;  /* Events written to clients */
+static uint64_t STREAM_NDROPPED = 0; /* Clients disconnected since output could not be written */
+
+/* Forward */
+static int stream_sub_notify(int s, void *arg);
+static int stream_sub_stop(int fd, void *arg);
+
+/*! Check if uri path denotes a stream/notification path
+ *
+ * @retval     0    No, not a stream path
+ * @retval     1    Yes, a stream path
+ */
+int
+api_path_is_stream(clicon_handle h)
+{
+    int    retval = 0;
+    char  *path = NULL;
+    char  *stream_path;
+
+    if ((path = restconf_uripath(h)) == NULL)
+        goto done;
+    if ((stream_path = clicon_option_str(h, "CLICON_STREAM_PATH")) == NULL)
+        goto done;
+    if (strlen(path) < 1 + strlen(stream_path)) /* "/" + stream */
+        goto done;
+    if (path[0] != '/')
+        goto done;
+    if (strncmp(path+1, stream_path, strlen(stream_path)) != 0)
+        goto done;
+    retval = 1;
+ done:
+    if (path)
+        free(path);
+    return retval;
+}
+
+/*! Add client to subscription
+ */
+static int
+stream_sub_client_add(stream_sub           *ss,
+                      restconf_stream_data *sd)
+{
+    restconf_stream_data **vec;
+    int                    n;
+
+    if (ss->ss_nclients == ss->ss_maxclients){
+        n = ss->ss_maxclients ? 2*ss->ss_maxclients : 4;
+        if ((vec = realloc(ss->ss_clients, n*sizeof(*vec))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+        ss->ss_clients = vec;
+        ss->ss_maxclients = n;
+    }
+    ss->ss_clients[ss->ss_nclients++] = sd;
+    sd->sd_sub = ss;
+    STREAM_NCLIENTS++;
+    return 0;
+}
+
+/*! Remove client with index i from subscription, client keeps its http stream
+ */
+static void
+stream_sub_client_detach(stream_sub *ss,
+                         int         i)
+{
+    ss->ss_clients[i]->sd_sub = NULL;
+    ss->ss_nclients--;
+    memmove(&ss->ss_clients[i], &ss->ss_clients[i+1],
+            (ss->ss_nclients - i)*sizeof(*ss->ss_clients));
+}
+
+/*! Bytes queued to a client, not yet written to its socket
+ */
+static size_t
+stream_client_queued(restconf_stream_data *sd)
+{
+    restconf_conn *rc = sd->sd_conn;
+    size_t         len = 0;
+
+    if (rc->rc_outp)
+        len += cbuf_len(rc->rc_outp) - rc->rc_outp_off;
+    if (sd->sd_body)
+        len += cbuf_len(sd->sd_body) - sd->sd_body_offset;
+    return len;
+}
+
+/*! Write an event to a client
+ *
+ * @param[in]  sd   Http stream of client
+ * @param[in]  cb   Encoded event
+ * @retval     1    OK
+ * @retval     0    Client could not be written to, or is too slow
+ * @retval    -1    Error
+ */
+static int
+stream_client_write(restconf_stream_data *sd,
+                    cbuf                 *cb)
+{
+    restconf_conn *rc = sd->sd_conn;
+
+    if (stream_client_queued(sd) + cbuf_len(cb) > STREAM_CLIENT_QUEUE_MAX){
+        clicon_debug(1, "%s client queue full", __FUNCTION__);
+        return 0;
+    }
+#ifdef HAVE_LIBNGHTTP2
+    if (rc->rc_proto == HTTP_2)
+        return http2_stream_event(sd, cbuf_get(cb), cbuf_len(cb));
+#endif
+    return native_buf_write(rc->rc_h, cbuf_get(cb), cbuf_len(cb), rc, __FUNCTION__);
+}
+
+/*! End detached clients of a subscription
+ *
+ * A http/2 stream is ended after queued events are sent, or is reset if dropped.
+ * A http/1 connection is closed, after queued events are written unless dropped.
+ * @param[in]  vec   Vector of http streams, detached from subscription
+ * @param[in]  n     Length of vec
+ * @param[in]  drop  Client could not be written to: do not wait for queued output
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+stream_clients_end(restconf_stream_data **vec,
+                   int                    n,
+                   int                    drop)
+{
+    int             retval = -1;
+    restconf_conn **rcs = NULL;
+    restconf_conn  *rc;
+    int             nrc = 0;
+    int             i;
+#ifdef HAVE_LIBNGHTTP2
+    restconf_conn **rcs2 = NULL;
+    int             nrc2 = 0;
+    int             j;
+#endif
+
+    if (n == 0)
+        goto ok;
+    /* Connections to close, and http/2 connections to send to, each only once */
+    if ((rcs = calloc(n, sizeof(*rcs))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+#ifdef HAVE_LIBNGHTTP2
+    if ((rcs2 = calloc(n, sizeof(*rcs2))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+#endif
+    for (i=0; i<n; i++){
+        rc = vec[i]->sd_conn;
+#ifdef HAVE_LIBNGHTTP2
+        if (rc->rc_proto == HTTP_2){
+            if (drop)
+                nghttp2_submit_rst_stream(rc->rc_ngsession, NGHTTP2_FLAG_NONE,
+                                          vec[i]->sd_stream_id, NGHTTP2_CANCEL);
+            else
+                nghttp2_session_resume_data(rc->rc_ngsession, vec[i]->sd_stream_id);
+            for (j=0; j<nrc2; j++)
+                if (rcs2[j] == rc)
+                    break;
+            if (j == nrc2)
+                rcs2[nrc2++] = rc;
+            continue;
+        }
+#endif
+        rcs[nrc++] = rc;
+    }
+#ifdef HAVE_LIBNGHTTP2
+    /* Note streams in vec may be freed here when closed */
+    for (i=0; i<nrc2; i++){
+        clicon_err_reset();
+        if (nghttp2_session_send(rcs2[i]->rc_ngsession) != 0){
+            if (clicon_errno)
+                goto done;
+            rcs[nrc++] = rcs2[i];
+        }
+    }
+#endif
+    for (i=0; i<nrc; i++)
+        if (restconf_close_ssl_socket(rcs[i], __FUNCTION__, drop) < 0)
+            goto done;
+ ok:
+    retval = 0;
+ done:
+    if (rcs)
+        free(rcs);
+#ifdef HAVE_LIBNGHTTP2
+    if (rcs2)
+        free(rcs2);
+#endif
+    return retval;
+}
+
+/*! Close backend subscription and end all its clients
+ *
+ * @param[in]  ss   Subscription, is freed
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+stream_sub_free(stream_sub *ss)
+{
+    int                    retval = -1;
+    restconf_stream_data **vec;
+    int                    n;
+
+    clicon_debug(1, "%s %s clients:%d", __FUNCTION__, ss->ss_key?ss->ss_key:"", ss->ss_nclients);
+    DELQ(ss, STREAM_SUB, stream_sub *);
+    if (ss->ss_s != -1){
+        clixon_event_unreg_fd(ss->ss_s, stream_sub_notify);
+        close(ss->ss_s);
+    }
+    if (timerisset(&ss->ss_stop))
+        clixon_event_unreg_timeout(stream_sub_stop, ss);
+    /* Detach all clients before they are ended, since ending may free them */
+    vec = ss->ss_clients;
+    n = ss->ss_nclients;
+    while (ss->ss_nclients)
+        stream_sub_client_detach(ss, ss->ss_nclients-1);
+    if (ss->ss_key)
+        free(ss->ss_key);
+    free(ss);
+    retval = stream_clients_end(vec, n, 0);
+    if (vec)
+        free(vec);
+    return retval;
+}
+
+/*! Subscription stop-time has passed, end subscription
+ */
+static int
+stream_sub_stop(int   fd,
+                void *arg)
+{
+    stream_sub *ss = (stream_sub *)arg;
+
+    clicon_debug(1, "%s", __FUNCTION__);
+    timerclear(&ss->ss_stop);
+    return stream_sub_free(ss);
+}
+
+/*! Encode notification as event, once for all clients
+ *
+ * Each line of the notification is a data field
+ * @param[in]  xn   Notification XML
+ * @param[out] cb   Encoded event
+ */
+static int
+stream_event_encode(cxobj *xn,
+                    cbuf  *cb)
+{
+    int   retval = -1;
+    cbuf *cbx = NULL;
+    char *p;
+    char *nl;
+
+    if ((cbx = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (clixon_xml2cbuf(cbx, xn, 0, 0, -1, 0) < 0)
+        goto done;
+    p = cbuf_get(cbx);
+    do {
+        if ((nl = strchr(p, '\n')) != NULL)
+            *nl = '\0';
+        cprintf(cb, "data: %s\r\n", p);
+        p = nl + 1;
+    } while (nl != NULL);
+    cprintf(cb, "\r\n");
+    retval = 0;
+ done:
+    if (cbx)
+        cbuf_free(cbx);
+    return retval;
+}
+
+/*! Callback when stream notifications arrive from backend, write to all clients
+ *
+ * @param[in]  s    Backend notification socket
+ * @param[in]  arg  Subscription
+ * @see restconf_stream_cb in restconf_stream_fcgi.c
+ */
+static int
+stream_sub_notify(int   s,
+                  void *arg)
+{
+    int                    retval = -1;
+    stream_sub            *ss = (stream_sub *)arg;
+    int                    eof;
+    struct clicon_msg     *reply = NULL;
+    cxobj                 *xtop = NULL;
+    cxobj                 *xn;
+    cbuf                  *cb = NULL;
+    restconf_stream_data **drop = NULL;
+    int                    ndrop = 0;
+    int                    i;
+    int                    ret;
+
+    clicon_debug(1, "%s", __FUNCTION__);
+    if (clicon_msg_rcv(s, &reply, &eof) < 0)
+        goto done;
+    if (eof){ /* Backend closed subscription */
+        clicon_debug(1, "%s eof", __FUNCTION__);
+        if (stream_sub_free(ss) < 0)
+            goto done;
+        goto ok;
+    }
+    if ((ret = clicon_msg_decode(reply, NULL, NULL, &xtop, NULL)) < 0)
+        goto done;
+    if (ret == 0){ /* Invalid notification, close subscription as on eof */
+        clicon_log(LOG_WARNING, "%s: Invalid notification, closing subscription", __FUNCTION__);
+        if (stream_sub_free(ss) < 0)
+            goto done;
+        goto ok;
+    }
+    if ((xn = xpath_first(xtop, NULL, "notification")) == NULL)
+        goto ok;
+    STREAM_NEVENTS++;
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (stream_event_encode(xn, cb) < 0)
+        goto done;
+    if ((drop = calloc(ss->ss_nclients, sizeof(*drop))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    i = 0;
+    while (i < ss->ss_nclients){
+        if ((ret = stream_client_write(ss->ss_clients[i], cb)) < 0)
+            goto done;
+        if (ret == 0){
+            drop[ndrop++] = ss->ss_clients[i];
+            stream_sub_client_detach(ss, i);
+            continue;
+        }
+        STREAM_NWRITES++;
+        i++;
+    }
+    if (ndrop){
+        STREAM_NDROPPED += ndrop;
+        if (ss->ss_nclients == 0 && stream_sub_free(ss) < 0)
+            goto done;
+        /* Note ss may be freed here when clients are closed */
+        if (stream_clients_end(drop, ndrop, 1) < 0)
+            goto done;
+    }
+ ok:
+    retval = 0;
+ done:
+    clicon_debug(1, "%s retval: %d", __FUNCTION__, retval);
+    if (drop)
+        free(drop);
+    if (xtop != NULL)
+        xml_free(xtop);
+    if (reply)
+        free(reply);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Append string to cbuf as XML attribute value in double quotes
+ */
+static void
+stream_attr_append(cbuf *cb,
+                   char *str)
+{
+    for (; *str; str++)
+        switch (*str){
+        case '&':
+            cprintf(cb, "&amp;");
+            break;
+        case '<':
+            cprintf(cb, "&lt;");
+            break;
+        case '"':
+            cprintf(cb, "&quot;");
+            break;
+        default:
+            cprintf(cb, "%c", *str);
+            break;
+        }
+}
+
+/*! Make backend subscription on a new backend session
+ *
+ * The backend session of the handle is kept, since notifications are sent on the socket
+ * of the subscription.
+ * @param[in]  h      Clixon handle
+ * @param[in]  req    Generic Www handle
+ * @param[in]  name   Stream name
+ * @param[in]  filter XPath filter or NULL
+ * @param[in]  start  Start-time or NULL
+ * @param[in]  stop   Stop-time or NULL
+ * @param[in]  pretty Pretty-print error reply
+ * @param[in]  media_out Restconf output media of error reply
+ * @param[out] sp     Notification socket, -1 if error reply was sent
+ * @retval     0      OK, see sp
+ * @retval    -1      Error
+ */
+static int
+stream_backend_subscribe(clicon_handle  h,
+                         void          *req,
+                         char          *name,
+                         char          *filter,
+                         char          *start,
+                         char          *stop,
+                         int            pretty,
+                         restconf_media media_out,
+                         int           *sp)
+{
+    int       retval = -1;
+    cbuf     *cb = NULL;
+    cxobj    *xret = NULL;
+    cxobj    *xe;
+    char     *username;
+    int       s0;
+    uint32_t  id0 = 0;
+    int       s = -1;
+    int       ret;
+
+    *sp = -1;
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "<rpc xmlns=\"%s\"", NETCONF_BASE_NAMESPACE);
+    if ((username = clicon_username_get(h)) != NULL){
+        cprintf(cb, " %s:username=\"", NETCONF_BASE_PREFIX);
+        stream_attr_append(cb, username);
+        cprintf(cb, "\" xmlns:%s=\"%s\"", NETCONF_BASE_PREFIX, NETCONF_BASE_NAMESPACE);
+    }
+    cprintf(cb, " %s>", NETCONF_MESSAGE_ID_ATTR);
+    cprintf(cb, "<create-subscription xmlns=\"%s\"><stream>", EVENT_RFC5277_NAMESPACE);
+    xml_chardata_cbuf_append(cb, name);
+    cprintf(cb, "</stream>");
+    if (filter){
+        cprintf(cb, "<filter type=\"xpath\" select=\"");
+        stream_attr_append(cb, filter);
+        cprintf(cb, "\"/>");
+    }
+    if (start){
+        cprintf(cb, "<startTime>");
+        xml_chardata_cbuf_append(cb, start);
+        cprintf(cb, "</startTime>");
+    }
+    if (stop){
+        cprintf(cb, "<stopTime>");
+        xml_chardata_cbuf_append(cb, stop);
+        cprintf(cb, "</stopTime>");
+    }
+    cprintf(cb, "</create-subscription></rpc>");
+    /* Use a new backend session for the subscription */
+    s0 = clicon_client_socket_get(h);
+    if (clicon_session_id_get(h, &id0) < 0)
+        id0 = 0;
+    clicon_client_socket_set(h, -1);
+    clicon_session_id_del(h);
+    if ((ret = clicon_rpc_netconf(h, cbuf_get(cb), &xret, &s)) < 0)
+        s = clicon_client_socket_get(h); /* May be connected, closed below */
+    clicon_client_socket_set(h, s0);
+    if (id0)
+        clicon_session_id_set(h, id0);
+    else
+        clicon_session_id_del(h);
+    if (ret < 0)
+        goto done;
+    if ((xe = xpath_first(xret, NULL, "rpc-reply/rpc-error")) != NULL){
+        if (api_return_err(h, req, xe, pretty, media_out, 0) < 0)
+            goto done;
+        goto ok;
+    }
+    *sp = s;
+    s = -1;
+ ok:
+    retval = 0;
+ done:
+    if (s != -1)
+        close(s);
+    if (xret)
+        xml_free(xret);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Process a stream request: subscribe and start event stream
+ *
+ * Query parameters start-time, stop-time and filter, see RFC 8040 Sec 4.8
+ * @param[in]  h          Clicon handle
+ * @param[in]  req        Generic Www handle (can be part of clixon handle)
+ * @param[in]  qvec       Query parameters, ie the ?<id>=<val>&<id>=<val> stuff
+ * @param[out] finish     Not used in native
+ */
+int
+api_stream(clicon_handle h,
+           void         *req,
+           cvec         *qvec,
+           int          *finish)
+{
+    int                   retval = -1;
+    restconf_stream_data *sd = (restconf_stream_data *)req;
+    char                 *path = NULL;
+    char                **pvec = NULL;
+    int                   pn;
+    int                   pretty;
+    restconf_media        media_out = YANG_DATA_XML;
+    cxobj                *xerr = NULL;
+    char                 *method;
+    char                 *filter;
+    char                 *start;
+    char                 *stop;
+    char                 *username;
+    cbuf                 *cbkey = NULL;
+    stream_sub           *ss = NULL;
+    stream_sub           *ss1;
+    struct timeval        tv;
+    struct timeval        now;
+    int                   s;
+    int                   ret;
+
+    clicon_debug(1, "%s", __FUNCTION__);
+    pretty = restconf_pretty_get(h);
+    if ((path = restconf_uripath(h)) == NULL)
+        goto done;
+    if ((pvec = clicon_strsep(path, "/", &pn)) == NULL)
+        goto done;
+    /* Sanity check of path. Should be /stream/<name> */
+    if (pn != 3 || strlen(pvec[0]) != 0 ||
+        strcmp(pvec[1], clicon_option_str(h, "CLICON_STREAM_PATH")) != 0 ||
+        strlen(pvec[2]) == 0){
+        if (netconf_invalid_value_xml(&xerr, "protocol", "Invalid path, /stream/<name> expected") < 0)
+            goto done;
+        if (api_return_err0(h, req, xerr, pretty, media_out, 0) < 0)
+            goto done;
+        goto ok;
+    }
+    if ((method = restconf_param_get(h, "REQUEST_METHOD")) == NULL ||
+        strcmp(method, "GET") != 0){
+        if (restconf_method_notallowed(h, req, "GET", pretty, media_out) < 0)
+            goto done;
+        goto ok;
+    }
+    /* If present, check credentials. See "plugin_credentials" in plugin
+     * See RFC 8040 section 2.5
+     */
+    if ((ret = restconf_authentication_cb(h, req, pretty, media_out)) < 0)
+        goto done;
+    if (ret == 0)
+        goto ok;
+    filter = cvec_find_str(qvec, "filter");
+    start = cvec_find_str(qvec, "start-time");
+    stop = cvec_find_str(qvec, "stop-time");
+    clicon_debug(1, "%s stream:%s filter:%s", __FUNCTION__, pvec[2], filter?filter:"");
+    /* Share subscription of same user, stream and filter, not if replay */
+    if (start == NULL && stop == NULL){
+        if ((cbkey = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        username = clicon_username_get(h);
+        cprintf(cbkey, "%s\n%s\n%s", username?username:"", pvec[2], filter?filter:"");
+        if ((ss1 = STREAM_SUB) != NULL){
+            do {
+                if (ss1->ss_key && strcmp(ss1->ss_key, cbuf_get(cbkey)) == 0){
+                    ss = ss1;
+                    break;
+                }
+                ss1 = NEXTQ(stream_sub *, ss1);
+            } while (ss1 && ss1 != STREAM_SUB);
+        }
+    }
+    if (ss == NULL){
+        if (stream_backend_subscribe(h, req, pvec[2], filter, start, stop,
+                                     pretty, media_out, &s) < 0)
+            goto done;
+        if (s == -1) /* Error reply */
+            goto ok;
+        if ((ss = malloc(sizeof(*ss))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            close(s);
+            goto done;
+        }
+        memset(ss, 0, sizeof(*ss));
+        ss->ss_s = s;
+        ADDQ(ss, STREAM_SUB);
+        STREAM_NSUBS++;
+        if (cbkey && (ss->ss_key = strdup(cbuf_get(cbkey))) == NULL){
+            clicon_err(OE_UNIX, errno, "strdup");
+            stream_sub_free(ss);
+            goto done;
+        }
+        if (clixon_event_reg_fd(s, stream_sub_notify, ss, "restconf stream subscription") < 0){
+            stream_sub_free(ss);
+            goto done;
+        }
+        /* End subscription after stop-time, events up to stop-time are sent by backend */
+        if (stop && str2time(stop, &tv) == 0){
+            gettimeofday(&now, NULL);
+            if (timercmp(&tv, &now, <))
+                tv = now;
+            tv.tv_sec++;
+            ss->ss_stop = tv;
+            if (clixon_event_reg_timeout(tv, stream_sub_stop, ss, "restconf stream stop-time") < 0){
+                stream_sub_free(ss);
+                goto done;
+            }
+        }
+    }
+    if (stream_sub_client_add(ss, sd) < 0)
+        goto done;
+    sd->sd_sse = 1;
+    clicon_debug(1, "%s clients:%d", __FUNCTION__, ss->ss_nclients);
+    /* Setting up stream */
+    if (restconf_reply_header(req, "Content-Type", "text/event-stream") < 0)
+        goto done;
+    if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0)
+        goto done;
+    if (restconf_reply_send(req, 200, NULL, 0) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (cbkey)
+        cbuf_free(cbkey);
+    if (xerr)
+        xml_free(xerr);
+    if (pvec)
+        free(pvec);
+    if (path)
+        free(path);
+    return retval;
+}
+
+/*! Http stream of client is freed, leave its subscription
+ *
+ * The backend subscription is closed when its last client leaves
+ * @param[in]  req   Http stream
+ * @see restconf_stream_free
+ */
+int
+stream_sub_leave(void *req)
+{
+    restconf_stream_data *sd = (restconf_stream_data *)req;
+    stream_sub           *ss;
+    int                   i;
+
+    if ((ss = sd->sd_sub) == NULL)
+        return 0;
+    for (i=0; i<ss->ss_nclients; i++)
+        if (ss->ss_clients[i] == sd){
+            stream_sub_client_detach(ss, i);
+            break;
+        }
+    clicon_debug(1, "%s clients:%d", __FUNCTION__, ss->ss_nclients);
+    if (ss->ss_nclients == 0)
+        return stream_sub_free(ss);
+    return 0;
+}
+
+/*! Free all subscriptions and log statistics
+ * Typically called on restconf exit
+ */
+int
+stream_sub_freeall(clicon_handle h)
+{
+    while (STREAM_SUB != NULL)
+        stream_sub_free(STREAM_SUB);
+    if (STREAM_NSUBS)
+        clicon_log(LOG_INFO, "Restconf stream subscriptions:%" PRIu64 " clients:%" PRIu64
+                   " events:%" PRIu64 " writes:%" PRIu64 " dropped:%" PRIu64,
+                   STREAM_NSUBS, STREAM_NCLIENTS, STREAM_NEVENTS, STREAM_NWRITES, STREAM_NDROPPED);
+    return 0;
+}
@@ -37,13 +37,14 @@
   * argc/argv after -- in clixon_backend:
   *  -a <..> Register callback for this yang action
   *  -n  Notification streams example
+  *  -N  Notification streams example without periodic notifications
   *  -r  enable the reset function 
   *  -s  enable the state function
   *  -S <file>  read state data from file, otherwise construct it programmatically (requires -s)
   *  -i  read state file on init not by request for optimization (requires -sS <file>)
   *  -u  enable upgrade function - auto-upgrade testing
   *  -U  general-purpose upgrade
-  *  -t  enable transaction logging (call syslog for every transaction)
+  *  -t  enable transaction logging (call syslog for every transaction and events state call)
   *  -V <xpath> Failing validate and commit if <xpath> is present (synthetic error)
  */
 #include <stdio.h>
@@ -68,7 +69,7 @@
 #include <clixon/clixon_backend.h> 
 
 /* Command line options to be passed to getopt(3) */
-#define BACKEND_EXAMPLE_OPTS "a:nrsS:x:iuUtV:"
+#define BACKEND_EXAMPLE_OPTS "a:nNrsS:x:ic:R:uUtV:"
 
 /*! Yang action
  * Start backend with -- -a <instance-id>
@@ -80,6 +81,7 @@ static char *_action_instanceid = NULL;
 /*! Notification stream
  * Enable notification streams for netconf/restconf 
  * Start backend with -- -n
+ * or with -- -N for a stream without periodic notifications, eg to only send bursts
  */
 static int _notification_stream = 0;
 
@@ -109,6 +111,16 @@ static char *_state_file = NULL;
  */
 static char *_state_xpath = NULL;
 
+/*! Cache time-to-live in ms of events state data provider, if _state is true
+ * Start backend with -- -s -c <ms>
+ */
+static uint32_t _state_cache_ttl = 0;
+
+/*! Number of routes returned by state cursor provider of example-rib
+ * Start backend with -- -R <nr>
+ */
+static int _state_routes = 0;
+
 /*! Read state file init on startup instead of on request
  * Primarily for testing: -i
  * Start backend with -- -siS <file>
@@ -300,6 +312,84 @@ example_stream_timer_setup(clicon_handle h)
     return clixon_event_reg_timeout(t, example_stream_timer, h, "example stream timer");
 }
 
+/*! Send a burst of notifications on the example stream in one batch
+ *
+ * Input is the number of events, default 1. The events are numbered in the card leaf,
+ * starting from 1, so that the order they are delivered in can be checked.
+ * Yang:
+ *   rpc notify-burst { input { leaf count { type uint32; } } }
+ */
+static int 
+example_notify_burst(clicon_handle h,            /* Clicon handle */
+                     cxobj        *xe,           /* Request: <rpc><xn></rpc> */
+                     cbuf         *cbret,        /* Reply eg <rpc-reply>... */
+                     void         *arg,          /* client_entry */
+                     void         *regarg)       /* Argument given at register */
+{
+    int      retval = -1;
+    cxobj  **vec = NULL;
+    cxobj   *xt = NULL;
+    cxobj   *xc;
+    char    *str;
+    char    *reason = NULL;
+    uint32_t count = 1;
+    uint32_t i;
+    int      ret;
+
+    if ((str = xml_find_body(xe, "count")) != NULL){
+        if ((ret = parse_uint32(str, &count, &reason)) < 0){
+            clicon_err(OE_XML, errno, "parse_uint32");
+            goto done;
+        }
+        if (ret == 0){
+            if (netconf_invalid_value(cbret, "application", reason) < 0)
+                goto done;
+            goto ok;
+        }
+    }
+    if (count && (vec = calloc(count, sizeof(cxobj *))) == NULL){
+        clicon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (i = 0; i < count; i++){
+        if (clixon_xml_parse_va(YB_NONE, NULL, &xt, NULL,
+                                "<event xmlns=\"urn:example:clixon\"><event-class>burst</event-class>"
+                                "<reportingEntity><card>%u</card></reportingEntity>"
+                                "<severity>minor</severity></event>", i+1) < 0)
+            goto done;
+        if ((xc = xml_child_i_type(xt, 0, CX_ELMNT)) == NULL){
+            clicon_err(OE_XML, EINVAL, "No event");
+            goto done;
+        }
+        if (xml_rm(xc) < 0)
+            goto done;
+        vec[i] = xc;
+        xml_free(xt);
+        xt = NULL;
+    }
+    /* The events are taken over by stream_notify_vec, also on error */
+    ret = stream_notify_vec(h, "EXAMPLE", vec, NULL, count);
+    free(vec);
+    vec = NULL;
+    if (ret < 0)
+        goto done;
+    cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+ ok:
+    retval = 0;
+ done:
+    if (vec){
+        for (i = 0; i < count; i++)
+            if (vec[i])
+                xml_free(vec[i]);
+        free(vec);
+    }
+    if (xt)
+        xml_free(xt);
+    if (reason)
+        free(reason);
+    return retval;
+}
+
 /*! Smallest possible RPC declaration for test 
  * Yang/XML:
  * If the RPC operation invocation succeeded and no output parameters
@@ -475,19 +565,6 @@ example_statedata(clicon_handle   h,
                                     NULL, &xstate, NULL) < 0)
             goto done; /* For the case when urn:example:clixon is not loaded */
     }
-    /* Event state from RFC8040 Appendix B.3.1 
-     * Note: (1) order is by-system so is different, 
-     *       (2) event-count is XOR on name, so is not 42 and 4
-     */
-    if (yang_find_module_by_namespace(yspec, "urn:example:events") != NULL){
-        cbuf_reset(cb);
-        cprintf(cb, "<events xmlns=\"urn:example:events\">");
-        cprintf(cb, "<event><name>interface-down</name><event-count>90</event-count></event>");
-        cprintf(cb, "<event><name>interface-up</name><event-count>77</event-count></event>");
-        cprintf(cb, "</events>");
-        if (clixon_xml_parse_string(cbuf_get(cb), YB_NONE, NULL, &xstate, NULL) < 0)
-            goto done;
-    }
  ok:
     retval = 0;
  done:
@@ -502,6 +579,115 @@ example_statedata(clicon_handle   h,
     return retval;
 }
 
+/*! State data provider of events, registered on path /example-events:events
+ *
+ * Event state from RFC8040 Appendix B.3.1 
+ * Note: (1) order is by-system so is different, 
+ *       (2) event-count is XOR on name, so is not 42 and 4
+ * Only called if the request intersects the path, and if the module is loaded.
+ * With -t, each call is logged with its filter.
+ * @param[in]    h        Clicon handle
+ * @param[in]    filter   Request path with keys, or NULL
+ * @param[in]    nsc      External XML namespace context, or NULL
+ * @param[in]    xpath    String with XPATH syntax. or NULL for all
+ * @param[out]   xstate   XML tree, <config/> on entry. 
+ * @param[in]    arg      Registered argument
+ * @retval       0        OK
+ * @retval      -1        Error
+ * @see clixon_statedata_cb_register
+ */
+static int 
+example_statedata_events(clicon_handle h, 
+                         clixon_path  *filter,
+                         cvec         *nsc,
+                         char         *xpath,
+                         cxobj        *xstate,
+                         void         *arg)
+{
+    int          retval = -1;
+    cbuf        *cb = NULL;
+    clixon_path *cp;
+    cg_var      *cv;
+
+    if (_transaction_log){
+        /* Log call and filter, so that tests can check when and how the provider is called */
+        if ((cb = cbuf_new()) == NULL){
+            clicon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if ((cp = filter) != NULL)
+            do {
+                cprintf(cb, "/%s:%s", yang_argument_get(ys_module(cp->cp_yang)), cp->cp_id);
+                cv = NULL;
+                while (cp->cp_cvk && (cv = cvec_each(cp->cp_cvk, cv)) != NULL)
+                    cprintf(cb, "[%s='%s']", cv_name_get(cv), cv_string_get(cv));
+                cp = NEXTQ(clixon_path *, cp);
+            } while (cp && cp != filter);
+        else
+            cprintf(cb, "none");
+        clicon_log(LOG_NOTICE, "%s filter:%s", __FUNCTION__, cbuf_get(cb));
+    }
+    if (clixon_xml_parse_string("<events xmlns=\"urn:example:events\">"
+                                "<event><name>interface-down</name><event-count>90</event-count></event>"
+                                "<event><name>interface-up</name><event-count>77</event-count></event>"
+                                "</events>",
+                                YB_NONE, NULL, &xstate, NULL) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! State cursor provider of a large state list: /example-rib:rib/route
+ *
+ * Generated routes are returned a batch at a time, the iterator is the index of the next route
+ * @param[in]     h       Clixon handle
+ * @param[in,out] cursor  Iterator, NULL on first call
+ * @param[in]     batch   Max nr of entries to add, 0 means close
+ * @param[in]     xparent Parent of the list, add entries as children
+ * @param[in]     arg     Registered argument
+ * @retval        1       OK, more entries may follow
+ * @retval        0       OK, no more entries
+ * @retval       -1       Error
+ * @see clixon_state_cursor_register
+ */
+static int
+example_state_routes(clicon_handle h,
+                     void        **cursor,
+                     uint32_t      batch,
+                     cxobj        *xparent,
+                     void         *arg)
+{
+    int     *ip = (int *)*cursor;
+    uint32_t n;
+
+    if (ip == NULL){
+        if (batch == 0)
+            return 0;
+        if ((ip = malloc(sizeof(*ip))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            return -1;
+        }
+        *ip = 0;
+        *cursor = ip;
+    }
+    for (n = 0; n < batch && *ip < _state_routes; n++, (*ip)++)
+        if (clixon_xml_parse_va(YB_NONE, NULL, &xparent, NULL,
+                                "<route><prefix>r%06d</prefix><next-hop>10.0.%d.%d</next-hop></route>",
+                                *ip, (*ip >> 8) & 0xff, *ip & 0xff) < 0){
+            free(ip);
+            *cursor = NULL;
+            return -1;
+        }
+    if (batch && *ip < _state_routes)
+        return 1;
+    free(ip);
+    *cursor = NULL;
+    return 0;
+}
+
 /*! Called to get state data from plugin by reading a file, also pagination
  *
  * The example shows how to read and parse a state XML file, (which is cached in the -i case).
@@ -1385,6 +1571,9 @@ clixon_plugin_init(clicon_handle h)
         case 'n':
             _notification_stream = 1;
             break;
+        case 'N':
+            _notification_stream = 2;
+            break;
         case 'r':
             _reset = 1;
             break;
@@ -1400,6 +1589,12 @@ clixon_plugin_init(clicon_handle h)
         case 'i': /* read state file on init not by request (requires -sS <file> */
             _state_file_cached = 1;
             break;
+        case 'c': /* events state cache time-to-live in ms (requires -s) */
+            _state_cache_ttl = atoi(optarg);
+            break;
+        case 'R': /* routes of state cursor provider */
+            _state_routes = atoi(optarg);
+            break;
        case 'u': /* module-specific upgrade */
            _module_upgrade = 1;
            break;
@@ -1414,6 +1609,25 @@ clixon_plugin_init(clicon_handle h)
             break;
         }
 
+    if (_state && !_state_file){
+        /* State data provider, only called if request intersects path */
+        if (clixon_statedata_cb_register(h,
+                                         example_statedata_events,
+                                         "/example-events:events",
+                                         NULL) < 0)
+            goto done;
+        if (_state_cache_ttl &&
+            clixon_statedata_cache_set(h, "/example-events:events", _state_cache_ttl) < 0)
+            goto done;
+    }
+    if (_state_routes){
+        /* State cursor provider of large list, entries are requested a batch at a time */
+        if (clixon_state_cursor_register(h,
+                                         example_state_routes,
+                                         "/example-rib:rib/route",
+                                         NULL) < 0)
+            goto done;
+    }
     if (_state_file){
         api.ca_statedata = example_statefile; /* Switch state data callback */
         if (_state_xpath){
@@ -1442,7 +1656,15 @@ clixon_plugin_init(clicon_handle h)
         if (clicon_option_exists(h, "CLICON_STREAM_PUB") &&
             stream_publish(h, "EXAMPLE") < 0)
             goto done;
-        if (example_stream_timer_setup(h) < 0)
+        if (_notification_stream == 1 &&
+            example_stream_timer_setup(h) < 0)
+            goto done;
+        /* Send a burst of notifications on request */
+        if (rpc_callback_register(h, example_notify_burst,
+                                  NULL,
+                                  "urn:example:clixon",
+                                  "notify-burst"
+                                  ) < 0)
             goto done;
     }
     /* Register callback for routing rpc calls 
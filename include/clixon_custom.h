@@ -107,6 +107,26 @@
  */
 #define HTTP_DATA_INTERNAL_REDIRECT "index.html"
 
+/*! Max size of a static http data file kept in the in-memory file cache
+ * Larger files are sent directly from the file, eg with sendfile(2) in native restconf.
+ * Cache entries are validated with inode, size and modification time of the file.
+ * Set to 0 to disable the cache
+ */
+#define HTTP_DATA_CACHE_FILE_MAX 65536
+
+/*! Max total size of all files in the http data file cache
+ * Least recently used files are removed when this is reached
+ */
+#define HTTP_DATA_CACHE_MAX (4*1024*1024)
+
+/*! Use the flex/bison HTTP/1 parser for native restconf request headers
+ * The default is a hand-written incremental parser that does not allocate or copy the
+ * request, see http1_request_parse(). Set this to compare with the older parser.
+ * Request framing, ie end of header and Content-Length, is always made by the hand-written
+ * parser.
+ */
+#undef RESTCONF_HTTP1_YACC
+
 /*! Set a temporary parent for use in special case "when" xpath calls
  * Problem is when changing an existing (candidate) in-memory datastore that yang "when" conditionals
  * should be changed in clixon_datastore_write.c:text_modify().
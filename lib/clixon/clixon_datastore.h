@@ -78,5 +78,8 @@ int xmldb_empty_get(clicon_handle h, const char *db);
 int xmldb_dump(clicon_handle h, FILE *f, cxobj *xt);
 int xmldb_print(clicon_handle h, FILE *f);
 int xmldb_rename(clicon_handle h, const char *db, const char *newdb, const char *suffix);
+int xmldb_generation_get(clicon_handle h, const char *db, const char *subtree, uint64_t *gen, struct timeval *tv);
+int xmldb_generation_bump(clicon_handle h, const char *db, cxobj *xt);
+int xmldb_generation_copy(clicon_handle h, const char *from, const char *to);
 
 #endif /* _CLIXON_DATASTORE_H */
@@ -62,6 +62,8 @@ int nacm_datanode_read(clicon_handle h, cxobj *xt, cxobj **xvec, size_t xlen, ch
 int nacm_datanode_write(clicon_handle h, cxobj *xr, cxobj *xt,
                         enum nacm_access access,
                         char *username, cxobj *xnacm, cbuf *cbret);
+int nacm_policy_update(clicon_handle h, cxobj *xnacm);
+int nacm_policy_free(clicon_handle h);
 int nacm_access_pre(clicon_handle h, char *peername, char *username, cxobj **xnacmp);
 int verify_nacm_user(clicon_handle h, enum nacm_credentials_t cred, char *peername, char *nacmname, cbuf *cbret);
 
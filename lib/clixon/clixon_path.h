@@ -85,6 +85,7 @@ int api_path2xml(char *api_path, yang_stmt *yspec, cxobj *xtop,
                  yang_class nodeclass, int strict,
                  cxobj **xpathp, yang_stmt **ypathp, cxobj **xerr);
 int xml2api_path_1(cxobj *x, cbuf *cb);
+int clixon_path_search(cxobj *xt, yang_stmt *yt, clixon_path *cplist, struct clixon_xml_vec **xvec);
 int clixon_xml_find_api_path(cxobj *xt, yang_stmt *yt, cxobj ***xvec, int *xlen, const char *format,
                      ...) __attribute__ ((format (printf, 5, 6)));;
 int clixon_xml_find_instance_id(cxobj *xt, yang_stmt *yt, cxobj ***xvec, int *xlen, const char *format,
@@ -51,9 +51,17 @@ enum format_enum{
     FORMAT_NETCONF
 };
 
+/* Flag in op_len of a message chunk: more chunks of the same message follow.
+ * A chunked message is a sequence of chunks each with its own header, where all but the
+ * last have this flag set. Only the last chunk body is NULL-terminated.
+ * @see clicon_msg_rcv which assembles chunks into one message
+ */
+#define CLICON_MSG_MORE 0x80000000
+
 /* Protocol message header */
 struct clicon_msg {
-    uint32_t    op_len;     /* length of whole message: body+header, network byte order. */
+    uint32_t    op_len;     /* length of whole message: body+header, network byte order. 
+                             * Possibly with CLICON_MSG_MORE flag */
     uint32_t    op_id;      /* session-id. network byte order. 1..max(u32), can be zero in client hello */
     char        op_body[0]; /* rest of message, actual data */
 };
@@ -95,6 +103,10 @@ int send_msg_notify_xml(clicon_handle h, int s, cxobj *xev);
 
 int send_msg_reply(int s, char *data, uint32_t datalen);
 
+int clicon_msg_chunk_begin(cbuf *cb);
+
+int clicon_msg_chunk_end(cbuf *cb, int more);
+
 int detect_endtag(char *tag, char  ch, int  *state);
 
 int clixon_inet2sin(const char *addrtype, const char *addrstr, uint16_t port, struct sockaddr *sa, size_t *sa_len);
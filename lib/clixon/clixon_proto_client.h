@@ -42,6 +42,12 @@
 #ifndef _CLIXON_PROTO_CLIENT_H_
 #define _CLIXON_PROTO_CLIENT_H_
 
+/*
+ * Constants
+ */
+/* Characters of list pagination cursor tokens made by the backend: <id>.<nonce>.<position> */
+#define CLIXON_CURSOR_CHARS "0123456789abcdefABCDEF."
+
 int clicon_rpc_connect(clicon_handle h, int *sock0);
 int clicon_rpc_msg(clicon_handle h, struct clicon_msg *msg, cxobj **xret0);
 int clicon_rpc_msg_persistent(clicon_handle h, struct clicon_msg *msg, cxobj **xret0, int *sock0);
@@ -55,10 +61,14 @@ int clicon_rpc_delete_config(clicon_handle h, char *db);
 int clicon_rpc_lock(clicon_handle h, char *db);
 int clicon_rpc_unlock(clicon_handle h, char *db);
 int clicon_rpc_get(clicon_handle h, char *xpath, cvec *nsc, netconf_content content, int32_t depth, char *defaults, cxobj **xret);
+int clicon_rpc_get_cond(clicon_handle h, char *xpath, cvec *nsc, int32_t depth, char *defaults,
+                        uint64_t ifgen, struct timeval *ifsince, uint64_t *gen, struct timeval *lastmod,
+                        cxobj **xt);
 int clicon_rpc_get_pageable_list(clicon_handle h, char *datastore, char *xpath, 
                                  cvec *nsc, netconf_content content, int32_t depth, char *defaults,
                                  uint32_t offset, uint32_t limit,
                                  char *direction, char *sort, char *where,
+                                 char *cursor, char **next,
                                  cxobj **xt);
 int clicon_rpc_close_session(clicon_handle h);
 int clicon_rpc_kill_session(clicon_handle h, uint32_t session_id);
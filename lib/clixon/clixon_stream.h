@@ -41,34 +41,60 @@
 /*
  * Constants
  */
+/* Number of events in a replay buffer segment */
+#define STREAM_REPLAY_SEGMENT 256
 
 /*
  * Types
  */
+struct clicon_msg; /* see clixon_proto.h */
+
 /* Subscription callback 
  * @param[in]  h     Clicon handle
- * @param[in]  op    Operation: 0 OK, 1 Close
+ * @param[in]  op    Operation: 0 OK, 1 Close, 2 Flush: events of a dispatch are delivered
+ *                   and may be written, event is NULL
  * @param[in]  event Event as XML
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @see stream_ss_add
  */
 typedef int (*stream_fn_t)(clicon_handle h, int op, cxobj *event, void *arg);
 
+/* Compiled subscription filter, shared by all subscriptions of a stream with the same
+ * filter selector. A filter whose first location step selects a named child of the
+ * notification is indexed on that name in the stream, other filters are evaluated
+ * for every event.
+ * @see stream_ss_add
+ */
+struct stream_filter{
+    struct stream_filter        *sf_next;   /* Next filter with same index key */
+    char                        *sf_xpath;  /* Filter selector as xpath, or NULL */
+    struct xpath_tree           *sf_xptree; /* Parsed xpath, NULL if no filter */
+    char                        *sf_key;    /* Required notification child, or NULL */
+    struct stream_subscription **sf_vec;    /* Subscriptions using this filter */
+    int                          sf_len;    /* Length of sf_vec */
+};
+
 struct stream_subscription{
     qelem_t                     ss_q;   /* queue header */
     char                       *ss_stream; /* Name of associated stream */
     char                       *ss_xpath;  /* Filter selector as xpath */
+    struct stream_filter       *ss_filter; /* Compiled filter shared between subscriptions */
     struct timeval              ss_starttime; /* Replay starttime */
     struct timeval              ss_stoptime; /* Replay stoptime */
     stream_fn_t                 ss_fn;     /* Callback when event occurs */
     void                       *ss_arg;    /* Callback argument */
+    int                         ss_pending; /* Marks during dispatch of events */
 };
 
-/* Replay time-series */
+/* Replay time-series segment. A replay buffer is a vector of fixed-size segments with
+ * events in time order. Events are dropped from the first segment and added to the last.
+ * @see stream_replay_add
+ */
 struct stream_replay{
-    qelem_t        r_q;   /* queue header */
-    struct timeval r_tv;  /* time index */
-    cxobj         *r_xml; /* event in xml form */
+    struct timeval r_tv[STREAM_REPLAY_SEGMENT];  /* time index */
+    char          *r_str[STREAM_REPLAY_SEGMENT]; /* event serialized as XML */
+    int            r_first; /* First event, events before have been dropped */
+    int            r_len;   /* Number of events added to segment */
 };
 
 /* See RFC8040 9.3, stream list, no replay support for now
@@ -80,8 +106,14 @@ struct event_stream{
     struct stream_subscription *es_subscription;
     int                  es_replay_enabled; /* set if replay is enables */
     struct timeval       es_retention; /* replay retention - how much to save */
-    struct stream_replay *es_replay;
-
+    struct stream_replay **es_replay; /* Replay buffer segments in time order */
+    int                  es_replay_nr;    /* Number of replay buffer segments */
+    size_t               es_replay_len;   /* Number of events in replay buffer */
+    size_t               es_replay_bytes; /* Size of events in replay buffer */
+    size_t               es_replay_max;   /* Max number of events, 0 means no limit */
+    size_t               es_replay_maxbytes; /* Max size of events, 0 means no limit */
+    clicon_hash_t       *es_index;    /* Filters indexed on notification child name */
+    struct stream_filter *es_wildcard; /* Filters that may match any notification */
 };
 typedef struct event_stream event_stream_t;
 
@@ -104,10 +136,13 @@ int stream_ss_delete_all(clicon_handle h, stream_fn_t fn, void *arg);
 int stream_ss_delete(clicon_handle h, char *name, stream_fn_t fn, void *arg);
 
 int stream_notify_xml(clicon_handle h, char *stream, cxobj *xml);
+int stream_notify_vec(clicon_handle h, char *stream, cxobj **events, struct timeval *tvs, size_t len);
 int stream_notify(clicon_handle h, char *stream, const char *event, ...)  __attribute__ ((format (printf, 3, 4)));
+int stream_event_cache(clicon_handle h, cxobj *xevent, cbuf **cbp, struct clicon_msg **msgp);
+int stream_event_cache_clear(clicon_handle h);
 
 /* Replay */
-int stream_replay_add(event_stream_t *es, struct timeval *tv, cxobj *xv);
+int stream_replay_add(clicon_handle h, event_stream_t *es, struct timeval *tv, cxobj *xv);
 int stream_replay_trigger(clicon_handle h, char *stream, stream_fn_t fn, void *arg);
 
 /* Experimental publish streams using SSE. CLIXON_PUBLISH_STREAMS should be set */
@@ -40,6 +40,23 @@
 #ifndef _CLIXON_XML_IO_H_
 #define _CLIXON_XML_IO_H_
 
+/*
+ * Types
+ */
+/* Incremental (push) XML parser handle, see clixon_xml_push.c */
+typedef struct clixon_xml_push clixon_xml_push;
+
+/* Chunked XML serializer handle, see clixon_xml_chunk_new() */
+typedef struct clixon_xml_chunk clixon_xml_chunk;
+
+/*! Fill callback of chunked XML serializer, see clixon_xml_chunk_fill()
+ * @param[in]  x    XML element whose children have all been serialized
+ * @param[in]  arg  Argument given at registration
+ * @retval     n    Number of children appended to x, 0 if no more
+ * @retval    -1    Error
+ */
+typedef int (clixon_xml_chunk_fill_t)(cxobj *x, void *arg);
+
 /*
  * Prototypes
  */
@@ -47,11 +64,21 @@ int   clixon_xml2file(FILE *f, cxobj *xn, int level, int pretty, clicon_output_c
 int   xml_print(FILE *f, cxobj *xn);
 int   xml_dump(FILE  *f, cxobj *x);
 int   clixon_xml2cbuf(cbuf *cb, cxobj *x, int level, int prettyprint, int32_t depth, int skiptop);
+clixon_xml_chunk *clixon_xml_chunk_new(cxobj *x, int32_t depth, int skiptop);
+int   clixon_xml_chunk_free(clixon_xml_chunk *xc);
+int   clixon_xml_chunk_next(clixon_xml_chunk *xc, cbuf *cb, size_t max);
+int   clixon_xml_chunk_fill(clixon_xml_chunk *xc, cxobj *x, clixon_xml_chunk_fill_t *fn, void *arg);
 int   xmltree2cbuf(cbuf *cb, cxobj *x, int level);
 int   clixon_xml_parse_file(FILE *f, yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
 int   clixon_xml_parse_string(const char *str, yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
 int   clixon_xml_parse_va(yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr, 
                         const char *format, ...)  __attribute__ ((format (printf, 5, 6)));
 int   clixon_xml_attr_copy(cxobj *xin, cxobj *xout, char *name);
+clixon_xml_push *clixon_xml_push_new(yang_bind yb, yang_stmt *yspec, cxobj *xt);
+int   clixon_xml_push_free(clixon_xml_push *xp);
+int   clixon_xml_push_feed(clixon_xml_push *xp, const char *buf, size_t len);
+int   clixon_xml_push_done(clixon_xml_push *xp, cxobj **xerr);
+cxobj *clixon_xml_push_top(clixon_xml_push *xp);
+size_t clixon_xml_push_len(clixon_xml_push *xp);
 
 #endif  /* _CLIXON_XML_IO_H_ */
@@ -134,6 +134,7 @@ xpath_tree *xpath_tree_traverse(xpath_tree *xt, ...);
 int   xpath_tree_free(xpath_tree *xs);
 int   xpath_parse(const char *xpath, xpath_tree **xptree);
 int   xpath_vec_ctx(cxobj *xcur, cvec *nsc, const char *xpath, int localonly, xp_ctx  **xrp);
+int   xpath_tree_vec_ctx(cxobj *xcur, cvec *nsc, xpath_tree *xptree, int localonly, xp_ctx  **xrp);
 
 int    xpath_vec_bool(cxobj *xcur, cvec *nsc, const char *xpformat, ...) __attribute__ ((format (printf, 3, 4)));
 int    xpath_vec_flag(cxobj *xcur, cvec *nsc, const char *xpformat, uint16_t flags, 
@@ -145,6 +146,7 @@ int    xpath_vec_flag(cxobj *xcur, cvec *nsc, const char *xpformat, uint16_t fla
  * If you do not know what a namespace context is, see README.md#xml-and-xpath
  */
 cxobj *xpath_first(cxobj *xcur, cvec *nsc, const char *xpformat,  ...) __attribute__ ((format (printf, 3, 4)));
+cxobj *xpath_first_tree(cxobj *xcur, cvec *nsc, xpath_tree *xptree);
 cxobj *xpath_first_localonly(cxobj *xcur, const char *xpformat,  ...) __attribute__ ((format (printf, 2, 3)));
 int    xpath_vec(cxobj *xcur, cvec *nsc, const char *xpformat, cxobj ***vec, size_t *veclen, ...) __attribute__ ((format (printf, 3, 6)));
 
@@ -76,6 +76,7 @@
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_data.h"
+#include "clixon_nacm.h"
 
 /*! Get generic clixon data on the form <name>=<val> where <val> is string
  * @param[in]  h    Clicon handle
@@ -412,15 +413,21 @@ clicon_nacm_cache(clicon_handle h)
 }
 
 /*! Set NACM (rfc 8341) external XML parse tree cache
+ *
+ * Also check the compiled NACM policy against the new tree, and invalidate it if the
+ * NACM config has changed
  * @param[in]  h   Clicon handle
  * @param[in]  xn  XML Nacm tree direct pointer, no copying
  * @note  Use with caution, only valid on a stack, direct pointer freed on function return
  * @see from_client_msg
+ * @see nacm_policy_update
  */
 int
 clicon_nacm_cache_set(clicon_handle h,
                       cxobj        *xn)
 {
+    if (nacm_policy_update(h, xn) < 0)
+        return -1;
     return clicon_ptr_set(h, "nacm_cache", xn);
 }
 
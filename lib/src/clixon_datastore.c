@@ -71,6 +71,7 @@
 #include "clixon_file.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
+#include "clixon_xml_nsctx.h"
 #include "clixon_yang_module.h"
 #include "clixon_plugin.h"
 #include "clixon_options.h"
@@ -80,6 +81,9 @@
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
 
+/* Forward */
+static int xmldb_generations_free(clicon_handle h);
+
 
 /*! Translate from symbolic database name to actual filename in file-system
  * @param[in]   th       text handle handle
@@ -172,6 +176,7 @@ xmldb_disconnect(clicon_handle h)
                 de->de_xml = NULL;
             }
         }
+    xmldb_generations_free(h);
     retval = 0;
  done:
     if (keys)
@@ -247,6 +252,8 @@ xmldb_copy(clicon_handle h,
         goto done;
     if (clicon_file_copy(fromfile, tofile) < 0)
         goto done;
+    if (xmldb_generation_copy(h, from, to) < 0)
+        goto done;
     retval = 0;
  done:
     if (fromfile)
@@ -455,6 +462,8 @@ xmldb_delete(clicon_handle h,
             clicon_err(OE_DB, errno, "truncate %s", filename);
             goto done;
         }
+    if (xmldb_generation_bump(h, db, NULL) < 0)
+        goto done;
     retval = 0;
  done:
     if (filename)
@@ -491,6 +500,8 @@ xmldb_create(clicon_handle h,
         clicon_err(OE_UNIX, errno, "open(%s)", filename);
         goto done;
     }
+    if (xmldb_generation_bump(h, db, NULL) < 0)
+        goto done;
    retval = 0;
  done:
     if (filename)
@@ -665,6 +676,8 @@ xmldb_rename(clicon_handle h,
         clicon_err(OE_UNIX, errno, "rename: %s", strerror(errno));
         goto done;
     };
+    if (xmldb_generation_bump(h, db, NULL) < 0)
+        goto done;
     retval = 0;
  done:
     if (cb)
@@ -673,3 +686,340 @@ xmldb_rename(clicon_handle h,
         free(old);
     return retval;
 }
+
+/*
+ * Datastore generations
+ * A generation is a number that is changed every time a datastore is modified, a client
+ * may use it to check if data has changed since it was last read, eg restconf ETag.
+ * All datastores share one counter so that a generation identifies one content: a copy
+ * also copies the generations of the source.
+ * Generations are also kept per top-level subtree, with key {namespace}name, so that a
+ * change in one top-level subtree does not change the generation of the others.
+ * Subtrees without a generation of their own have the base generation of the datastore.
+ * The counter is started from the time in microseconds so that generations are not
+ * re-used after a restart.
+ */
+
+/* Generation of datastore or subtree in hash */
+struct xmldb_gen {
+    uint64_t       xg_generation; /* Generation */
+    struct timeval xg_tv;         /* Time of last change */
+};
+
+/* Generation state of all datastores, see clicon_ptr "xmldb-generations" */
+typedef struct {
+    uint64_t       xs_counter;    /* Last generation given out, shared by all datastores */
+    clicon_hash_t *xs_hash;       /* Keys: <db>, <db>/ (base) and <db>/{ns}name (subtree) */
+} xmldb_generations;
+
+/*! Get generation state, create it if not exists
+ * @param[in]  h   Clicon handle
+ * @retval     xs  Generation state
+ * @retval     NULL Error
+ */
+static xmldb_generations *
+xmldb_generations_get(clicon_handle h)
+{
+    xmldb_generations *xs = NULL;
+    struct timeval     tv;
+
+    if (clicon_ptr_get(h, "xmldb-generations", (void**)&xs) == 0 && xs != NULL)
+        return xs;
+    if ((xs = malloc(sizeof(*xs))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(xs, 0, sizeof(*xs));
+    if ((xs->xs_hash = clicon_hash_init()) == NULL){
+        free(xs);
+        return NULL;
+    }
+    gettimeofday(&tv, NULL);
+    xs->xs_counter = (uint64_t)tv.tv_sec*1000000 + tv.tv_usec;
+    if (clicon_ptr_set(h, "xmldb-generations", xs) < 0){
+        clicon_hash_free(xs->xs_hash);
+        free(xs);
+        return NULL;
+    }
+    return xs;
+}
+
+/*! Set generation of datastore, base or subtree to a new value
+ * @param[in]  xs   Generation state
+ * @param[in]  key  Hash key: <db>, <db>/ or <db>/{ns}name
+ * @param[in]  xg   Generation and timestamp
+ */
+static int
+xmldb_generation_set(xmldb_generations *xs,
+                     const char        *key,
+                     struct xmldb_gen  *xg)
+{
+    if (clicon_hash_add(xs->xs_hash, key, xg, sizeof(*xg)) == NULL)
+        return -1;
+    return 0;
+}
+
+/*! Remove all generations of a datastore including subtrees
+ * @param[in]  xs   Generation state
+ * @param[in]  db   Database name
+ */
+static int
+xmldb_generation_clear(xmldb_generations *xs,
+                       const char        *db)
+{
+    int     retval = -1;
+    char  **keys = NULL;
+    size_t  klen;
+    size_t  len;
+    int     i;
+
+    len = strlen(db);
+    if (clicon_hash_keys(xs->xs_hash, &keys, &klen) < 0)
+        goto done;
+    for (i = 0; i < klen; i++)
+        if (strncmp(keys[i], db, len) == 0 &&
+            (keys[i][len] == '\0' || keys[i][len] == '/'))
+            clicon_hash_del(xs->xs_hash, keys[i]);
+    retval = 0;
+ done:
+    if (keys)
+        free(keys);
+    return retval;
+}
+
+/*! Get generation and time of last change of a datastore or one of its top-level subtrees
+ *
+ * @param[in]  h       Clicon handle
+ * @param[in]  db      Database name
+ * @param[in]  subtree Top-level subtree on the form {namespace}name, or NULL for datastore
+ * @param[out] gen     Generation
+ * @param[out] tv      Time of last change (if not NULL)
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @code
+ *   uint64_t gen;
+ *   if (xmldb_generation_get(h, "running", "{urn:example:clixon}table", &gen, NULL) < 0)
+ *      err;
+ * @endcode
+ */
+int
+xmldb_generation_get(clicon_handle   h,
+                     const char     *db,
+                     const char     *subtree,
+                     uint64_t       *gen,
+                     struct timeval *tv)
+{
+    int                retval = -1;
+    xmldb_generations *xs;
+    struct xmldb_gen  *xg;
+    struct xmldb_gen   xg0 = {0,};
+    cbuf              *cb = NULL;
+
+    if ((xs = xmldb_generations_get(h)) == NULL)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_XML, errno, "cbuf_new");
+        goto done;
+    }
+    if (subtree){
+        cprintf(cb, "%s/%s", db, subtree);
+        xg = clicon_hash_value(xs->xs_hash, cbuf_get(cb), NULL);
+        cbuf_reset(cb);
+        cprintf(cb, "%s/", db); /* base */
+    }
+    else{
+        cprintf(cb, "%s", db);
+        xg = NULL;
+    }
+    if (xg == NULL &&
+        (xg = clicon_hash_value(xs->xs_hash, cbuf_get(cb), NULL)) == NULL){
+        /* First access: new datastore and base generation */
+        xg0.xg_generation = ++xs->xs_counter;
+        gettimeofday(&xg0.xg_tv, NULL);
+        if (xmldb_generation_set(xs, db, &xg0) < 0)
+            goto done;
+        cbuf_reset(cb);
+        cprintf(cb, "%s/", db);
+        if (xmldb_generation_set(xs, cbuf_get(cb), &xg0) < 0)
+            goto done;
+        xg = &xg0;
+    }
+    *gen = xg->xg_generation;
+    if (tv)
+        *tv = xg->xg_tv;
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Datastore is modified, give it and its modified subtrees a new generation
+ *
+ * @param[in]  h   Clicon handle
+ * @param[in]  db  Database name
+ * @param[in]  xt  Modification tree, its top-level children are the modified subtrees.
+ *                 If NULL, the whole datastore is modified
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see xmldb_generation_get
+ */
+int
+xmldb_generation_bump(clicon_handle h,
+                      const char   *db,
+                      cxobj        *xt)
+{
+    int                retval = -1;
+    xmldb_generations *xs;
+    struct xmldb_gen   xg = {0,};
+    cbuf              *cb = NULL;
+    cxobj             *x;
+    char              *ns;
+
+    if ((xs = xmldb_generations_get(h)) == NULL)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_XML, errno, "cbuf_new");
+        goto done;
+    }
+    if (xt != NULL){ /* Ensure base generation of unmodified subtrees exists */
+        if (xmldb_generation_get(h, db, NULL, &xg.xg_generation, NULL) < 0)
+            goto done;
+    }
+    xg.xg_generation = ++xs->xs_counter;
+    gettimeofday(&xg.xg_tv, NULL);
+    if (xt == NULL){ /* All subtrees get the new base generation */
+        if (xmldb_generation_clear(xs, db) < 0)
+            goto done;
+        cprintf(cb, "%s/", db);
+        if (xmldb_generation_set(xs, cbuf_get(cb), &xg) < 0)
+            goto done;
+    }
+    else{
+        x = NULL;
+        while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+            ns = NULL;
+            if (xml2ns(x, xml_prefix(x), &ns) < 0)
+                goto done;
+            cbuf_reset(cb);
+            cprintf(cb, "%s/{%s}%s", db, ns?ns:"", xml_name(x));
+            if (xmldb_generation_set(xs, cbuf_get(cb), &xg) < 0)
+                goto done;
+        }
+    }
+    if (xmldb_generation_set(xs, db, &xg) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Datastore is copied, copy generations of source datastore and its subtrees
+ *
+ * The content of the destination is the same as the source, and so are the generations.
+ * Timestamps of unchanged generations of the destination are kept.
+ * @param[in]  h     Clicon handle
+ * @param[in]  from  Source database
+ * @param[in]  to    Destination database
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see xmldb_copy
+ */
+int
+xmldb_generation_copy(clicon_handle h,
+                      const char   *from,
+                      const char   *to)
+{
+    int                retval = -1;
+    xmldb_generations *xs;
+    uint64_t           gen;
+    char             **keys = NULL;
+    size_t             klen;
+    size_t             len;
+    int                i;
+    clicon_hash_t     *hto = NULL;
+    struct xmldb_gen  *xg;
+    struct xmldb_gen   xg0;
+    struct xmldb_gen  *xgto;
+    cbuf              *cb = NULL;
+    struct timeval     now;
+
+    if (strcmp(from, to) == 0)
+        goto ok;
+    /* Ensure source has generations */
+    if (xmldb_generation_get(h, from, NULL, &gen, NULL) < 0)
+        goto done;
+    if ((xs = xmldb_generations_get(h)) == NULL)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_XML, errno, "cbuf_new");
+        goto done;
+    }
+    /* Save old generations of destination for timestamps */
+    if ((hto = clicon_hash_init()) == NULL)
+        goto done;
+    len = strlen(to);
+    if (clicon_hash_keys(xs->xs_hash, &keys, &klen) < 0)
+        goto done;
+    for (i = 0; i < klen; i++)
+        if (strncmp(keys[i], to, len) == 0 &&
+            (keys[i][len] == '\0' || keys[i][len] == '/') &&
+            (xg = clicon_hash_value(xs->xs_hash, keys[i], NULL)) != NULL &&
+            clicon_hash_add(hto, keys[i]+len, xg, sizeof(*xg)) == NULL)
+            goto done;
+    free(keys);
+    keys = NULL;
+    if (xmldb_generation_clear(xs, to) < 0)
+        goto done;
+    gettimeofday(&now, NULL);
+    len = strlen(from);
+    if (clicon_hash_keys(xs->xs_hash, &keys, &klen) < 0)
+        goto done;
+    for (i = 0; i < klen; i++){
+        if (strncmp(keys[i], from, len) != 0 ||
+            (keys[i][len] != '\0' && keys[i][len] != '/'))
+            continue;
+        if ((xg = clicon_hash_value(xs->xs_hash, keys[i], NULL)) == NULL)
+            continue;
+        xg0 = *xg;
+        if ((xgto = clicon_hash_value(hto, keys[i]+len, NULL)) == NULL ||
+            xgto->xg_generation != xg0.xg_generation)
+            xg0.xg_tv = now;
+        else
+            xg0.xg_tv = xgto->xg_tv;
+        cbuf_reset(cb);
+        cprintf(cb, "%s%s", to, keys[i]+len);
+        if (xmldb_generation_set(xs, cbuf_get(cb), &xg0) < 0)
+            goto done;
+    }
+ ok:
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    if (hto)
+        clicon_hash_free(hto);
+    if (keys)
+        free(keys);
+    return retval;
+}
+
+/*! Free generation state
+ * @param[in]  h   Clicon handle
+ * @see xmldb_disconnect
+ */
+static int
+xmldb_generations_free(clicon_handle h)
+{
+    xmldb_generations *xs = NULL;
+
+    if (clicon_ptr_get(h, "xmldb-generations", (void**)&xs) == 0 && xs != NULL){
+        if (xs->xs_hash)
+            clicon_hash_free(xs->xs_hash);
+        free(xs);
+        clicon_ptr_del(h, "xmldb-generations");
+    }
+    return 0;
+}
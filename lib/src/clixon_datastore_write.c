@@ -66,6 +66,7 @@
 #include "clixon_yang.h"
 #include "clixon_xml.h"
 #include "clixon_xml_sort.h"
+#include "clixon_xml_vec.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_xpath_ctx.h"
@@ -440,11 +441,14 @@ choice_delete_other(cxobj     *x0,
  * @param[in]  username User name of requestor for nacm
  * @param[in]  xnacm    NACM XML tree (only if !permit)
  * @param[in]  permit   If set, no NACM tests using xnacm required
+ * @param[in]  xvnew    If set, append new ordered-by system x0 to this vector instead of inserting
  * @param[out] cbret    Initialized cligen buffer. Contains return XML if retval is 0.
  * @retval    -1        Error
  * @retval     0        Failed (cbret set)
  * @retval     1        OK
  * Assume x0 and x1 are same on entry and that y is the spec
+ * If xvnew is set, the caller is responsible for inserting the new nodes into x0p, 
+ * see xml_insert_vec
  * @see text_modify_top
  * RFC 7950 Sec 7.7.9(leaf-list), 7.8.6(lists)
  * In an "ordered-by user" list, the attributes "insert" and "key" in
@@ -463,6 +467,7 @@ text_modify(clicon_handle       h,
             char               *username,
             cxobj              *xnacm,
             int                 permit,
+            clixon_xvec        *xvnew,
             cbuf               *cbret)
 {
     int        retval = -1;
@@ -487,6 +492,9 @@ text_modify(clicon_handle       h,
     char      *createstr = NULL;        
     yang_stmt *yrestype = NULL;
     char      *restype;
+    int        x1nr;
+    int        bulk;
+    clixon_xvec *xvbulk = NULL; /* new children of x0 to be merged in one pass */
 #ifdef CLIXON_YANG_SCHEMA_MOUNT
     int        ismount = 0;
     yang_stmt *mount_yspec = NULL;
@@ -689,7 +697,13 @@ text_modify(clicon_handle       h,
                 }
             } /* x1bstr */
             if (changed){ 
-                if (xml_insert(x0p, x0, insert, valstr, NULL) < 0) 
+                if (xvnew && insert == INS_LAST &&
+                    yang_find(y0, Y_ORDERED_BY, "user") == NULL){
+                    if (clixon_xvec_append(xvnew, x0) < 0)
+                        goto done;
+                    x0 = NULL; /* inserted by caller */
+                }
+                else if (xml_insert(x0p, x0, insert, valstr, NULL) < 0) 
                     goto done;
             }
             break;
@@ -850,7 +864,8 @@ text_modify(clicon_handle       h,
             /* First pass: Loop through children of the x1 modification tree 
              * collect matching nodes from x0 in x0vec (no changes to x0 children)
              */
-            if ((x0vec = calloc(xml_child_nr_type(x1, CX_ELMNT), sizeof(x1))) == NULL){
+            x1nr = xml_child_nr_type(x1, CX_ELMNT);
+            if ((x0vec = calloc(x1nr, sizeof(x1))) == NULL){
                 clicon_err(OE_UNIX, errno, "calloc");
                 goto done;
             }
@@ -901,7 +916,14 @@ text_modify(clicon_handle       h,
             /* Second pass: Loop through children of the x1 modification tree again
              * Now potentially modify x0:s children 
              * Here x0vec contains one-to-one matching nodes of x1:s children.
+             * For large modifications, new children are collected and merged into x0 in
+             * one pass after the loop, instead of one sorted insert per child.
              */
+            bulk = clicon_option_int(h, "CLICON_XMLDB_BULK_THRESHOLD");
+            if (bulk > 0 && x1nr >= bulk){
+                if ((xvbulk = clixon_xvec_new()) == NULL)
+                    goto done;
+            }
             x1c = NULL;
             i = 0;
             while ((x1c = xml_child_each(x1, x1c, CX_ELMNT)) != NULL) {
@@ -923,17 +945,25 @@ text_modify(clicon_handle       h,
 #endif
                 if ((ret = text_modify(h, x0c, x0, x0t, x1c, x1t,
                                        yc, op,
-                                       username, xnacm, permit, cbret)) < 0)
+                                       username, xnacm, permit, xvbulk, cbret)) < 0)
                     goto done;
                 /* If xml return - ie netconf error xml tree, then stop and return OK */
                 if (ret == 0)
                     goto fail;
             }
+            if (xvbulk && xml_insert_vec(x0, xvbulk) < 0)
+                goto done;
             if (changed){
 #ifdef XML_PARENT_CANDIDATE
                 xml_parent_candidate_set(x0, NULL);
 #endif
-                if (xml_insert(x0p, x0, insert, keystr, nscx1) < 0)
+                if (xvnew && insert == INS_LAST &&
+                    yang_find(y0, Y_ORDERED_BY, "user") == NULL){
+                    if (clixon_xvec_append(xvnew, x0) < 0)
+                        goto done;
+                    x0 = NULL; /* inserted by caller */
+                }
+                else if (xml_insert(x0p, x0, insert, keystr, nscx1) < 0)
                     goto done;
             }
             break;
@@ -978,6 +1008,13 @@ text_modify(clicon_handle       h,
         xml_purge(x0);
     if (x0vec)
         free(x0vec);
+    if (xvbulk){
+        /* Remove dangling added children if not merged, eg on error */
+        for (i=0; i<clixon_xvec_len(xvbulk); i++)
+            if (xml_parent(clixon_xvec_i(xvbulk, i)) == NULL)
+                xml_purge(clixon_xvec_i(xvbulk, i));
+        clixon_xvec_free(xvbulk);
+    }
     return retval;
  fail: /* cbret set */
     retval = 0;
@@ -1130,7 +1167,7 @@ text_modify_top(clicon_handle       h,
         }
         if ((ret = text_modify(h, x0c, x0t, x0t, x1c, x1t,
                                yc, op,
-                               username, xnacm, permit, cbret)) < 0)
+                               username, xnacm, permit, NULL, cbret)) < 0)
             goto done;
         /* If xml return - ie netconf error xml tree, then stop and return OK */
         if (ret == 0)
@@ -1317,6 +1354,9 @@ xmldb_put(clicon_handle       h,
      */
     if (xmodst && xml_purge(xmodst) < 0)
         goto done;
+    /* Replace of top-level may remove any subtree, otherwise only those modified */
+    if (x1 && xmldb_generation_bump(h, db, op==OP_REPLACE?NULL:x1) < 0)
+        goto done;
     retval = 1;
  done:
     if (f != NULL)
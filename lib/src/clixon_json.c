@@ -75,7 +75,7 @@
 #include "clixon_xml_nsctx.h" /* namespace context */
 #include "clixon_netconf_lib.h"
 #include "clixon_json.h"
-#include "clixon_json_parse.h"
+#include "clixon_json_read.h"
 
 /* Let xml2json_cbuf_vec() return json array: [a,b].
    ALternative is to create a pseudo-object and return that: {top:{a,b}}
@@ -108,15 +108,16 @@ enum childtype{
 
 /*! x is element and has exactly one child which in turn has none 
  * remove attributes from x
+ * @param[in]  x     XML node
+ * @param[in]  clen  Number of non-attribute children of x
  * @see tleaf in clixon_xml_map.c
  */
 static enum childtype
-child_type(cxobj *x)
+child_type(cxobj *x,
+           int    clen)
 {
     cxobj *xc;   /* the only child of x */
-    int    clen; /* nr of children */
 
-    clen = xml_child_nr_notype(x, CX_ATTR);
     if (xml_type(x) != CX_ELMNT)
         return -1; /* n/a */
     if (clen == 0)
@@ -130,7 +131,7 @@ child_type(cxobj *x)
             break;
     if (xc == NULL)
         return -2; /* n/a */
-    if (xml_child_nr_notype(xc, CX_ATTR) == 0 && xml_type(xc)==CX_BODY)
+    if (xml_type(xc)==CX_BODY && xml_child_nr_notype(xc, CX_ATTR) == 0)
         return BODY_CHILD;
     else
         return ANY_CHILD;
@@ -179,55 +180,85 @@ arraytype2str(enum array_element_type lt)
     return "";
 }
 
+/*! Get default namespace attribute of an XML element, used when comparing siblings in arrays
+ * @param[in]  x    XML node or NULL
+ * @retval     ns   Value of xmlns attribute, or NULL if none or x is not an element
+ */
+static char *
+array_ns(cxobj *x)
+{
+    if (x == NULL || xml_type(x) != CX_ELMNT)
+        return NULL;
+    return xml_find_type_value(x, NULL, "xmlns", CX_ATTR);
+}
+
+/*! Find the span of an array in the child vector of a node
+ *
+ * Children are sorted so that list and leaf-list entries are adjacent. The span is the
+ * run of elements starting at i with the same name and namespace.
+ * Each element is compared once, when the span it is part of is computed.
+ * @param[in]  x     Parent XML node
+ * @param[in]  i     Index of first element of span, must be an element
+ * @param[in]  nr    Number of children of x
+ * @retval     j     Index of last element of span, i if single
+ */
+static int
+array_span(cxobj *x,
+           int    i,
+           int    nr)
+{
+    cxobj *xc;
+    char  *name;
+    char  *ns;
+    char  *nsj;
+    int    j;
+
+    xc = xml_child_i(x, i);
+    name = xml_name(xc);
+    ns = array_ns(xc);
+    for (j=i+1; j<nr; j++){
+        xc = xml_child_i(x, j);
+        if (xml_type(xc) != CX_ELMNT || strcmp(name, xml_name(xc)) != 0)
+            break;
+        nsj = array_ns(xc);
+        if (!((!ns && !nsj) || (ns && nsj && strcmp(ns, nsj)==0)))
+            break;
+    }
+    return j-1;
+}
+
 /*! Check typeof x in array
  * 
  * Check if element is in an array, and if so, if it is in the start "[x,", in the middle: "[..,x,..]"
  * in the end: ",x]", or a single element: "[x]"
- * Some complexity when x is in different namespaces
- * @param[in]  xprev     The previous element (if any)
+ * The array is given by the span of x in the child vector, see array_span()
  * @param[in]  x         The element itself
- * @param[in]  xnext     The next element (if any)
+ * @param[in]  i         Index of x in child vector
+ * @param[in]  first     Index of first element in span of x
+ * @param[in]  last      Index of last element in span of x
  * @retval     arraytype Type of array 
  */
 static enum array_element_type
-array_eval(cxobj *xprev, 
-           cxobj *x, 
-           cxobj *xnext)
+array_eval(cxobj *x, 
+           int    i,
+           int    first,
+           int    last)
 {
     enum array_element_type arraytype = NO_ARRAY;
-    int                     eqprev=0;
-    int                     eqnext=0;
     yang_stmt              *ys;
-    char                   *nsx; /* namespace of x */
-    char                   *ns2;
 
-    nsx = xml_find_type_value(x, NULL, "xmlns", CX_ATTR);
     if (xml_type(x) != CX_ELMNT){
         arraytype = BODY_ARRAY;
         goto done;
     }
-    if (xnext && 
-        xml_type(xnext)==CX_ELMNT &&
-        strcmp(xml_name(x), xml_name(xnext))==0){
-        ns2 = xml_find_type_value(xnext, NULL, "xmlns", CX_ATTR);
-        if ((!nsx && !ns2)
-            || (nsx && ns2 && strcmp(nsx,ns2)==0))
-            eqnext++;
-    }
-    if (xprev &&
-        xml_type(xprev)==CX_ELMNT &&
-        strcmp(xml_name(x),xml_name(xprev))==0){
-        ns2 = xml_find_type_value(xprev, NULL, "xmlns", CX_ATTR);
-        if ((!nsx && !ns2)
-            || (nsx && ns2 && strcmp(nsx,ns2)==0))
-            eqprev++;
+    if (first < last){
+        if (i == first)
+            arraytype = FIRST_ARRAY;
+        else if (i == last)
+            arraytype = LAST_ARRAY;
+        else
+            arraytype = MIDDLE_ARRAY;
     }
-    if (eqprev && eqnext)
-        arraytype = MIDDLE_ARRAY;
-    else if (eqprev)
-        arraytype = LAST_ARRAY;
-    else if (eqnext)
-        arraytype = FIRST_ARRAY;
     else if ((ys = xml_spec(x)) != NULL) {
         if (yang_keyword_get(ys) == Y_LIST || yang_keyword_get(ys) == Y_LEAF_LIST)
             arraytype = SINGLE_ARRAY;
@@ -249,25 +280,26 @@ json_str_escape_cdata(cbuf *cb,
                       char *str)
 {
     int   retval = -1;
-    int   i;
-    size_t len;
+    char *s0;
     
-    len = strlen(str);
-    for (i=0; i<len; i++)
-        switch (str[i]){
+    /* Append runs of characters not needing escape in one go */
+    for (s0 = str; *str != '\0'; str++){
+        switch (*str){
         case '\n':
-            cprintf(cb, "\\n");
-            break;
         case '\"':
-            cprintf(cb, "\\\"");
-            break;
         case '\\':
-            cprintf(cb, "\\\\");
+            if (str > s0)
+                cbuf_append_buf(cb, s0, str - s0);
+            cbuf_append(cb, '\\');
+            cbuf_append(cb, *str == '\n' ? 'n' : *str);
+            s0 = str + 1;
             break;
-        default: /* fall thru */
-            cprintf(cb, "%c", str[i]);
+        default:
             break;
         }
+    }
+    if (str > s0)
+        cbuf_append_buf(cb, s0, str - s0);
     retval = 0;
     // done:
     return retval;
@@ -524,7 +556,7 @@ xml2json_encode_leafs(cxobj     *xb,
     }
     body = xb?xml_value(xb):NULL;
     if (yp == NULL){
-        cprintf(cb, "%s", body?body:"null"); 
+        cbuf_append_str(cb, body?body:"null");
         goto ok; /* unknown */
     }
     keyword = yang_keyword_get(yp);
@@ -546,11 +578,11 @@ xml2json_encode_leafs(cxobj     *xb,
                         goto done;
                 }
                 else{
-                    cprintf(cb, "%s", body);
+                    cbuf_append_str(cb, body);
                 }
             }
             else
-                cprintf(cb, "%s", body);
+                cbuf_append_str(cb, body);
             break;
         case CGV_INT64:
         case CGV_UINT64:
@@ -589,7 +621,7 @@ xml2json_encode_leafs(cxobj     *xb,
             break;
         default:
             if (body)
-                cprintf(cb, "%s", body);
+                cbuf_append_str(cb, body);
             else
                 cprintf(cb, "{}"); /* dont know */
         }
@@ -603,13 +635,12 @@ xml2json_encode_leafs(cxobj     *xb,
      * includign quoting and encoding 
      */
     if (quote){
-        cprintf(cb0, "\"");
+        cbuf_append(cb0, '"');
         json_str_escape_cdata(cb0, cbuf_get(cb));
+        cbuf_append(cb0, '"');
     }
     else
-        cprintf(cb0, "%s", cbuf_get(cb));
-    if (quote)
-        cprintf(cb0, "\"");
+        cbuf_append_str(cb0, cbuf_get(cb));
     retval = 0;
  done:
     if (cb)
@@ -772,6 +803,32 @@ xml2json_encode_attr(cxobj     *xa,
     return retval;
 }
 
+/*! Print JSON object member name: "module:name":
+ * @param[out]   cb       Cligen text buffer
+ * @param[in]    x        XML node
+ * @param[in]    level    Indentation level
+ * @param[in]    pretty   Pretty-print output
+ * @param[in]    modname  Module name qualifier, or NULL
+ */
+static int
+json_name_print(cbuf  *cb,
+                cxobj *x,
+                int    level,
+                int    pretty,
+                char  *modname)
+{
+    if (pretty)
+        cprintf(cb, "%*s", level*PRETTYPRINT_INDENT, "");
+    cbuf_append(cb, '"');
+    if (modname){
+        cbuf_append_str(cb, modname);
+        cbuf_append(cb, ':');
+    }
+    cbuf_append_str(cb, xml_name(x));
+    cbuf_append_str(cb, pretty?"\": ":"\":");
+    return 0;
+}
+
 /*! Do the actual work of translating XML to JSON 
  * @param[out]   cb        Cligen text buffer containing json on exit
  * @param[in]    x         XML tree structure containing XML to translate
@@ -780,7 +837,7 @@ xml2json_encode_attr(cxobj     *xa,
  * @param[in]    pretty    Pretty-print output (2 means debug)
  * @param[in]    flat      Dont print NO_ARRAY object name (for _vec call)
  * @param[in]    modname0
- * @param[out]   metacbp   Meta encoding of attribute
+ * @param[in,out] metacbp  Meta encoding of attributes, allocated on first use. If NULL skip
  *
  * @note Does not work with XML attributes
  * The following matrix explains how the mapping is done.
@@ -818,7 +875,7 @@ xml2json1_cbuf(cbuf                   *cb,
                int                     pretty,
                int                     flat,
                char                   *modname0,
-               cbuf                   *metacbp)
+               cbuf                  **metacbp)
 {
     int              retval = -1;
     int              i;
@@ -831,6 +888,9 @@ xml2json1_cbuf(cbuf                   *cb,
     int              commas;
     char            *modname = NULL;
     cbuf            *metacbc = NULL;
+    int              nr;
+    int              first = 0;
+    int              last = -1;
 
     if ((ys = xml_spec(x)) != NULL){
         if (ys_real_module(ys, &ymod) < 0)
@@ -838,7 +898,7 @@ xml2json1_cbuf(cbuf                   *cb,
         modname = yang_argument_get(ymod);
         /* Special case for ietf-netconf -> ietf-restconf translation 
          * A special case is for return data on the form {"data":...}
-         * See also json_xmlns_translate()
+         * See also jr_element() in clixon_json_read.c
          */
         if (strcmp(modname, "ietf-netconf") == 0)
             modname = "ietf-restconf";
@@ -847,7 +907,10 @@ xml2json1_cbuf(cbuf                   *cb,
         else
             modname0 = modname; /* modname0 is ancestor ns passed to child */
     }
-    childt = child_type(x);
+    nr = xml_child_nr(x);
+    commas = xml_child_nr_notype(x, CX_ATTR);
+    childt = child_type(x, commas);
+    commas--;
     if (pretty==2)
         cprintf(cb, "#%s_array, %s_child ", 
                 arraytype2str(arraytype),
@@ -859,12 +922,8 @@ xml2json1_cbuf(cbuf                   *cb,
             goto done;
         break;
     case NO_ARRAY:
-        if (!flat){
-            cprintf(cb, "%*s\"", pretty?(level*PRETTYPRINT_INDENT):0, "");
-            if (modname) 
-                cprintf(cb, "%s:", modname);
-            cprintf(cb, "%s\":%s", xml_name(x), pretty?" ":"");
-        }
+        if (!flat)
+            json_name_print(cb, x, level, pretty, modname);
         switch (childt){
         case NULL_CHILD:
             if (nullchild(cb, x, ys) < 0)
@@ -881,10 +940,7 @@ xml2json1_cbuf(cbuf                   *cb,
         break;
     case FIRST_ARRAY:
     case SINGLE_ARRAY:
-        cprintf(cb, "%*s\"", pretty?(level*PRETTYPRINT_INDENT):0, "");
-        if (modname)
-            cprintf(cb, "%s:", modname);
-        cprintf(cb, "%s\":%s", xml_name(x), pretty?" ":"");
+        json_name_print(cb, x, level, pretty, modname);
         level++;
         cprintf(cb, "[%s%*s", 
                 pretty?"\n":"",
@@ -925,39 +981,43 @@ xml2json1_cbuf(cbuf                   *cb,
     default:
         break;
     }
-    if ((metacbc = cbuf_new()) == NULL){
-        clicon_err(OE_UNIX, errno, "cbuf_new");
-        goto done;
-    }
     /* Check for typed sub-body if:
      * arraytype=* but child-type is BODY_CHILD 
      * This is code for writing <a>42</a> as "a":42 and not "a":"42"
      */
-    commas = xml_child_nr_notype(x, CX_ATTR) - 1;
-    for (i=0; i<xml_child_nr(x); i++){
+    for (i=0; i<nr; i++){
         xc = xml_child_i(x, i);
         if (xml_type(xc) == CX_ATTR){
-            if (metacbp &&
-                xml2json_encode_attr(xc, x, ys, level, pretty, modname, metacbp) < 0)
-                goto done;
-            continue;
+            if (metacbp){
+                if (*metacbp == NULL &&
+                    (*metacbp = cbuf_new()) == NULL){
+                    clicon_err(OE_UNIX, errno, "cbuf_new");
+                    goto done;
+                }
+                if (xml2json_encode_attr(xc, x, ys, level, pretty, modname, *metacbp) < 0)
+                    goto done;
+            }
         }
-        xc_arraytype = array_eval(i?xml_child_i(x,i-1):NULL, 
-                                xc, 
-                                xml_child_i(x, i+1));
-        if (xml2json1_cbuf(cb, 
-                           xc, 
-                           xc_arraytype,
-                           level+1, pretty, 0, modname0,
-                           metacbc) < 0)
-            goto done;
-        if (commas > 0) {
-            cprintf(cb, ",%s", pretty?"\n":"");
-            --commas;
+        else {
+            if (i > last){ /* Start of next span of equal elements */
+                first = i;
+                last = xml_type(xc) == CX_ELMNT ? array_span(x, i, nr) : i;
+            }
+            xc_arraytype = array_eval(xc, i, first, last);
+            if (xml2json1_cbuf(cb, 
+                               xc, 
+                               xc_arraytype,
+                               level+1, pretty, 0, modname0,
+                               &metacbc) < 0)
+                goto done;
+            if (commas > 0) {
+                cprintf(cb, ",%s", pretty?"\n":"");
+                --commas;
+            }
         }
     }
-    if (cbuf_len(metacbc)){
-        cprintf(cb, "%s", cbuf_get(metacbc));
+    if (metacbc && cbuf_len(metacbc)){
+        cbuf_append_str(cb, cbuf_get(metacbc));
     }
 
     switch (arraytype){
@@ -1317,75 +1377,9 @@ xml2json_vec(FILE      *f,
     return retval;
 }
 
-/*! Translate from JSON module:name to XML default ns: xmlns="uri" recursively
- * Assume an xml tree where prefix:name have been split into "module":"name"
- * In other words, from JSON to XML namespace trees
- * 
- * @param[in]     yspec Yang spec
- * @param[in,out] x     XML tree. Translate it in-line
- * @param[out]    xerr  Reason for invalid tree returned as netconf err msg or NULL
- * @retval        1     OK 
- * @retval        0     Invalid, wrt namespace.  xerr set
- * @retval       -1     Error
- * @note the opposite - xml2ns is made inline in xml2json1_cbuf
- * Example: <top><module:input> --> <top><input xmlns="">
- * @see RFC7951 Sec 4
- */
-static int
-json_xmlns_translate(yang_stmt *yspec,
-                     cxobj     *x,
-                     cxobj    **xerr)
-{
-    int        retval = -1;
-    yang_stmt *ymod;
-    char      *namespace;
-    char      *modname = NULL;
-    cxobj     *xc;
-    int        ret;
-    
-    if ((modname = xml_prefix(x)) != NULL){ /* prefix is here module name */
-        /* Special case for ietf-netconf -> ietf-restconf translation 
-         * A special case is for return data on the form {"data":...}
-         * See also xml2json1_cbuf
-         */
-        if (strcmp(modname, "ietf-restconf") == 0)
-            modname = "ietf-netconf";
-        if ((ymod = yang_find_module_by_name(yspec, modname)) == NULL){
-            if (xerr &&
-                netconf_unknown_namespace_xml(xerr, "application",
-                                              modname,
-                                              "No yang module found corresponding to prefix") < 0)
-                goto done;
-            goto fail;
-        }
-        namespace = yang_find_mynamespace(ymod);
-        /* It would be possible to use canonical prefixes here, but probably not
-         * necessary or even right. Therefore, the namespace given by the JSON prefix / module
-         * is always the default namespace with prefix NULL.
-         * If not, this would be the prefix to pass instead of NULL
-         * prefix = yang_find_myprefix(ymod);
-         */
-        if (xml_namespace_change(x, namespace, NULL) < 0)
-            goto done;
-    }
-    xc = NULL;
-    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
-        if ((ret = json_xmlns_translate(yspec, xc, xerr)) < 0)
-            goto done;
-        if (ret == 0)
-            goto fail;
-    }
-    retval = 1;
- done:
-    return retval;
- fail:
-    retval = 0;
-    goto done;
-}
-
 /*! Parse a string containing JSON and return an XML tree
  *
- * Parsing using yacc according to JSON syntax. Names with <prefix>:<id>
+ * Parsing using a single-pass reader according to JSON syntax. Names with <prefix>:<id>
  * are split and interpreted as in RFC7951
  *
  * @param[in]  str    Input string containing JSON
@@ -1410,36 +1404,33 @@ _json_parse(char      *str,
             cxobj     *xt,
             cxobj    **xerr)
 {
-    int              retval = -1;
-    clixon_json_yacc jy = {0,};
-    int              ret;
-    cxobj           *x;
-    cbuf            *cberr = NULL;
-    int              i;
-    int              failed = 0; /* yang assignment */
+    int     retval = -1;
+    int     ret;
+    cxobj  *x;
+    cbuf   *cberr = NULL;
+    cxobj **xvec = NULL;
+    int     xlen = 0;
+    int     i;
+    int     failed = 0; /* yang assignment */
+    int     unqualified;
     
     clicon_debug(1, "%s %d %s", __FUNCTION__, yb, str);
-    jy.jy_parse_string = str;
-    jy.jy_linenum = 1;
-    jy.jy_current = xt;
-    jy.jy_xtop = xt;
-    if (json_scan_init(&jy) < 0)
-        goto done;
-    if (json_parse_init(&jy) < 0)
-        goto done;
-    if (clixon_json_parseparse(&jy) != 0) { /* yacc returns 1 on error */
-        clicon_log(LOG_NOTICE, "JSON error: line %d", jy.jy_linenum);
-        if (clicon_errno == 0)
-            clicon_err(OE_JSON, 0, "JSON parser error with no error code (should not happen)");
+    /* Parse and translate module names to namespaces */
+    if ((ret = clixon_json_read(str, yspec, xt, &xvec, &xlen, xerr)) < 0){
+        clicon_log(LOG_NOTICE, "JSON error: %s", clicon_err_reason);
         goto done;
     }
+    if (ret == 0)
+        goto fail;
     /* Traverse new objects */
-    for (i = 0; i < jy.jy_xlen; i++) {
-        x = jy.jy_xvec[i];
+    for (i = 0; i < xlen; i++) {
+        x = xvec[i];
+        unqualified = xml_flag(x, XML_FLAG_TRANSIENT);
+        xml_flag_reset(x, XML_FLAG_TRANSIENT);
         /* RFC 7951 Section 4: A namespace-qualified member name MUST be used for all 
          * members of a top-level JSON object 
          */
-        if (rfc7951 && xml_prefix(x) == NULL){
+        if (rfc7951 && unqualified){
             /* XXX: For top-level config file: */
             if (yb != YB_NONE || strcmp(xml_name(x),DATASTORE_TOP_SYMBOL)!=0){
                 if ((cberr = cbuf_new()) == NULL){
@@ -1452,11 +1443,6 @@ _json_parse(char      *str,
                 goto fail;
             }
         }
-        /* Names are split into name/prefix, but now add namespace info */
-        if ((ret = json_xmlns_translate(yspec, x, xerr)) < 0)
-            goto done;
-        if (ret == 0)
-            goto fail;
         /* Now assign yang stmts to each XML node 
          * XXX should be xml_bind_yang0_parent() sometimes.
          */
@@ -1507,10 +1493,8 @@ _json_parse(char      *str,
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
     if (cberr)
         cbuf_free(cberr);
-    json_parse_exit(&jy);
-    json_scan_exit(&jy);
-    if (jy.jy_xvec)
-        free(jy.jy_xvec);
+    if (xvec)
+        free(xvec);
     return retval; 
  fail: /* invalid */
     retval = 0;
@@ -1605,61 +1589,44 @@ clixon_json_parse_file(FILE      *fp,
 {
     int       retval = -1;
     int       ret;
-    char     *jsonbuf = NULL;
-    int       jsonbuflen = BUFLEN; /* start size */
-    int       oldjsonbuflen;
-    char     *ptr;
-    char      ch;
-    int       len = 0;
+    cbuf     *cb = NULL;
+    char      buf[BUFLEN];
+    size_t    len;
 
     if (xt==NULL){
         clicon_err(OE_JSON, EINVAL, "xt is NULL");
         return -1;
     }
-    if ((jsonbuf = malloc(jsonbuflen)) == NULL){
-        clicon_err(OE_JSON, errno, "malloc");
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_JSON, errno, "cbuf_new");
         goto done;
     }
-    memset(jsonbuf, 0, jsonbuflen);
-    ptr = jsonbuf;
-    while (1){
-        if ((ret = fread(&ch, 1, 1, fp)) < 0){
-            clicon_err(OE_JSON, errno, "read");
-            break;
-        }
-        if (ret != 0)
-            jsonbuf[len++] = ch;
-        if (ret == 0){
-            if (*xt == NULL)
-                if ((*xt = xml_new(JSON_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
-                    goto done;
-            if (len){
-                if ((ret = _json_parse(ptr, rfc7951, yb, yspec, *xt, xerr)) < 0)
-                    goto done;
-                if (ret == 0)
-                    goto fail;
-            }
-            break;
-        }
-        if (len >= jsonbuflen-1){ /* Space: one for the null character */
-            oldjsonbuflen = jsonbuflen;
-            jsonbuflen *= 2;
-            if ((jsonbuf = realloc(jsonbuf, jsonbuflen)) == NULL){
-                clicon_err(OE_JSON, errno, "realloc");
-                goto done;
-            }
-            memset(jsonbuf+oldjsonbuflen, 0, jsonbuflen-oldjsonbuflen);
-            ptr = jsonbuf;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        if (cbuf_append_buf(cb, buf, len) < 0){
+            clicon_err(OE_JSON, errno, "cbuf_append_buf");
+            goto done;
         }
+    if (ferror(fp)){
+        clicon_err(OE_JSON, errno, "read");
+        goto done;
+    }
+    if (*xt == NULL)
+        if ((*xt = xml_new(JSON_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+    if (cbuf_len(cb)){
+        if ((ret = _json_parse(cbuf_get(cb), rfc7951, yb, yspec, *xt, xerr)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
     }
     retval = 1;
  done:
     if (retval < 0 && *xt){
-        free(*xt);
+        xml_free(*xt);
         *xt = NULL;
     }
-    if (jsonbuf)
-        free(jsonbuf);
+    if (cb)
+        cbuf_free(cb);
     return retval;    
  fail:
     retval = 0;
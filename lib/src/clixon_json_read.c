@@ -0,0 +1,695 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
+  Copyright (C) 2020-2022 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * JSON reader
+ * Hand-written single-pass JSON parser creating an XML tree.
+ * Member names on the form <module>:<name> are resolved to XML namespaces while parsing
+ * according to RFC 7951 Sec 4, instead of a second pass over the created tree.
+ * Strings are decoded into one scratch buffer and nodes are created directly, there are no
+ * intermediate tokens.
+ *
+ * XML translation:
+ *   { "a": "34" }          <a>34</a>
+ *   { "a": [1,2] }         <a>1</a><a>2</a>
+ *   { "a": [] }            <a/>
+ *   { "m:a": {"b": null} } <a xmlns="urn:m"><b/></a>
+ * @see http://www.ecma-international.org/publications/files/ECMA-ST/ECMA-404.pdf
+ * @see RFC 7951 JSON Encoding of Data Modeled with YANG
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_queue.h"
+#include "clixon_string.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_yang_module.h"
+#include "clixon_xml_map.h"
+#include "clixon_xml_nsctx.h"
+#include "clixon_netconf_lib.h"
+#include "clixon_json_read.h"
+
+/* Max nesting of JSON objects and arrays */
+#define JSON_DEPTH_MAX 10000
+
+/*! JSON reader state
+ */
+struct json_reader {
+    const char *jr_str;      /* Input string */
+    size_t      jr_i;        /* Current position in jr_str */
+    int         jr_linenum;  /* Number of \n in parsed input */
+    int         jr_depth;    /* Current nesting */
+    yang_stmt  *jr_yspec;    /* Yang spec for module name to namespace translation */
+    yang_stmt  *jr_ymod;     /* Cache of last found module */
+    cxobj      *jr_xtop;     /* cxobj top element (fixed) */
+    cxobj     **jr_xvec;     /* Vector of created top-level nodes */
+    int         jr_xlen;     /* Length of jr_xvec */
+    cbuf       *jr_cb;       /* Decoded string scratch buffer */
+    cxobj     **jr_xerr;     /* Reason for invalid tree */
+};
+typedef struct json_reader json_reader;
+
+static int jr_value(json_reader *jr, cxobj *x, char *ns);
+
+/*! Register syntax error
+ * @param[in]  jr      JSON reader
+ * @param[in]  reason  Error reason
+ */
+static int
+jr_error(json_reader *jr,
+         char        *reason)
+{
+    char c = jr->jr_str[jr->jr_i];
+
+    if (c == '\0')
+        clicon_err(OE_JSON, XMLPARSE_ERRNO, "json_parse: line %d: %s at end of input",
+                   jr->jr_linenum, reason);
+    else
+        clicon_err(OE_JSON, XMLPARSE_ERRNO, "json_parse: line %d: %s at or before: '%c'",
+                   jr->jr_linenum, reason, c);
+    return -1;
+}
+
+/*! Skip whitespace
+ */
+static void
+jr_ws(json_reader *jr)
+{
+    const char *s = jr->jr_str;
+    size_t      i = jr->jr_i;
+
+    while (1){
+        switch (s[i]){
+        case '\n':
+            jr->jr_linenum++;
+        case ' ': /* fall thru */
+        case '\t':
+        case '\r':
+            i++;
+            continue;
+        default:
+            break;
+        }
+        break;
+    }
+    jr->jr_i = i;
+}
+
+/*! Append unicode code point as UTF-8
+ */
+static int
+jr_utf8(cbuf    *cb,
+        uint32_t u)
+{
+    if (u < 0x80)
+        return cbuf_append(cb, u);
+    if (u < 0x800){
+        cbuf_append(cb, 0xc0 | (u >> 6));
+        return cbuf_append(cb, 0x80 | (u & 0x3f));
+    }
+    if (u < 0x10000){
+        cbuf_append(cb, 0xe0 | (u >> 12));
+        cbuf_append(cb, 0x80 | ((u >> 6) & 0x3f));
+        return cbuf_append(cb, 0x80 | (u & 0x3f));
+    }
+    cbuf_append(cb, 0xf0 | (u >> 18));
+    cbuf_append(cb, 0x80 | ((u >> 12) & 0x3f));
+    cbuf_append(cb, 0x80 | ((u >> 6) & 0x3f));
+    return cbuf_append(cb, 0x80 | (u & 0x3f));
+}
+
+/*! Parse four hex digits of \uXXXX escape
+ * @retval  u   Code unit
+ * @retval -1   Invalid
+ */
+static int32_t
+jr_hex4(const char *s)
+{
+    int32_t u = 0;
+    int     i;
+    char    c;
+
+    for (i=0; i<4; i++){
+        c = s[i];
+        u <<= 4;
+        if (c >= '0' && c <= '9')
+            u |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            u |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            u |= c - 'A' + 10;
+        else
+            return -1;
+    }
+    return u;
+}
+
+/*! Parse JSON string and decode it into jr_cb
+ * Current position is at the starting double quote
+ */
+static int
+jr_string(json_reader *jr)
+{
+    const char *s = jr->jr_str;
+    size_t      i = jr->jr_i + 1;
+    size_t      i0;
+    int32_t     u;
+    int32_t     u2;
+
+    cbuf_reset(jr->jr_cb);
+    while (1){
+        i0 = i;
+        while (s[i] != '"' && s[i] != '\\' && (unsigned char)s[i] >= 0x20)
+            i++;
+        if (i > i0)
+            cbuf_append_buf(jr->jr_cb, (void*)&s[i0], i-i0);
+        if (s[i] == '"')
+            break;
+        if (s[i] == '\0'){
+            jr->jr_i = i;
+            return jr_error(jr, "unterminated string");
+        }
+        if (s[i] != '\\'){ /* RFC 8259: control characters must be escaped */
+            jr->jr_i = i;
+            return jr_error(jr, "unescaped control character in string");
+        }
+        i++; /* backslash */
+        switch (s[i]){
+        case 'b':
+            cbuf_append(jr->jr_cb, '\b');
+            break;
+        case 'f':
+            cbuf_append(jr->jr_cb, '\f');
+            break;
+        case 'n':
+            cbuf_append(jr->jr_cb, '\n');
+            break;
+        case 'r':
+            cbuf_append(jr->jr_cb, '\r');
+            break;
+        case 't':
+            cbuf_append(jr->jr_cb, '\t');
+            break;
+        case 'u':
+            if ((u = jr_hex4(&s[i+1])) < 0){
+                jr->jr_i = i;
+                return jr_error(jr, "invalid unicode escape");
+            }
+            i += 4;
+            /* Surrogate pair */
+            if (u >= 0xd800 && u <= 0xdbff && s[i+1] == '\\' && s[i+2] == 'u' &&
+                (u2 = jr_hex4(&s[i+3])) >= 0xdc00 && u2 <= 0xdfff){
+                u = 0x10000 + ((u - 0xd800) << 10) + (u2 - 0xdc00);
+                i += 6;
+            }
+            jr_utf8(jr->jr_cb, u);
+            break;
+        case '\0':
+            jr->jr_i = i;
+            return jr_error(jr, "unterminated string");
+        default: /* " \ / and others: the character itself */
+            cbuf_append(jr->jr_cb, s[i]);
+            break;
+        }
+        i++;
+    }
+    jr->jr_i = i + 1;
+    return 0;
+}
+
+/*! Add body with value to XML node
+ * @param[in]  x      XML node
+ * @param[in]  value  Body value, or NULL for JSON null
+ * @param[in]  len    Length of value
+ */
+static int
+jr_body(cxobj      *x,
+        const char *value,
+        size_t      len)
+{
+    cxobj *xb;
+    char  *v;
+
+    if ((xb = xml_new("body", x, CX_BODY)) == NULL)
+        return -1;
+    if (value == NULL)
+        return 0;
+    if ((v = strndup(value, len)) == NULL){
+        clicon_err(OE_UNIX, errno, "strndup");
+        return -1;
+    }
+    if (xml_value_set(xb, v) < 0){
+        free(v);
+        return -1;
+    }
+    free(v);
+    return 0;
+}
+
+/*! Find namespace of a module name used as JSON member name prefix
+ * @param[in]  jr      JSON reader
+ * @param[in]  modname Module name
+ * @param[out] ns      Namespace
+ * @retval     1       OK, ns set
+ * @retval     0       Module not found, jr_xerr set
+ * @retval    -1       Error
+ */
+static int
+jr_module_ns(json_reader *jr,
+             char        *modname,
+             char       **ns)
+{
+    yang_stmt *ymod;
+
+    /* Special case for ietf-netconf -> ietf-restconf translation 
+     * A special case is for return data on the form {"data":...}
+     * See also xml2json1_cbuf
+     */
+    if (strcmp(modname, "ietf-restconf") == 0)
+        modname = "ietf-netconf";
+    if ((ymod = jr->jr_ymod) == NULL ||
+        strcmp(yang_argument_get(ymod), modname) != 0){
+        if (jr->jr_yspec == NULL ||
+            (ymod = yang_find_module_by_name(jr->jr_yspec, modname)) == NULL){
+            if (jr->jr_xerr &&
+                netconf_unknown_namespace_xml(jr->jr_xerr, "application",
+                                              modname,
+                                              "No yang module found corresponding to prefix") < 0)
+                return -1;
+            return 0;
+        }
+        jr->jr_ymod = ymod;
+    }
+    *ns = yang_find_mynamespace(ymod);
+    return 1;
+}
+
+/*! Create XML element from JSON member name
+ *
+ * Split name into module:name (RFC7951) and translate module to default namespace if it
+ * differs from the namespace of the parent.
+ * @param[in]  jr      JSON reader
+ * @param[in]  xp      XML parent
+ * @param[in]  nsp     Default namespace of parent
+ * @param[in]  name    JSON member name
+ * @param[out] xp1     New XML element
+ * @param[out] ns1     Default namespace of new element
+ * @retval     1       OK
+ * @retval     0       Invalid, jr_xerr set
+ * @retval    -1       Error
+ */
+static int
+jr_element(json_reader *jr,
+           cxobj       *xp,
+           char        *nsp,
+           char        *name,
+           cxobj      **xp1,
+           char       **ns1)
+{
+    int    retval = -1;
+    char  *prefix = NULL;
+    char  *id = NULL;
+    char  *ns = nsp;
+    cxobj *x;
+    int    ret;
+
+    if (nodeid_split(name, &prefix, &id) < 0)
+        goto done;
+    if (prefix != NULL){ /* prefix is here module name */
+        if ((ret = jr_module_ns(jr, prefix, &ns)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+    }
+    if ((x = xml_new(id, xp, CX_ELMNT)) == NULL)
+        goto done;
+    /* It would be possible to use canonical prefixes here, but probably not
+     * necessary or even right. Therefore, the namespace given by the JSON prefix / module
+     * is always the default namespace with prefix NULL.
+     */
+    if (prefix != NULL && clicon_strcmp(ns, nsp) != 0){
+        if (xml_namespace_change(x, ns, NULL) < 0)
+            goto done;
+        /* An existing declaration may have been reused, then the default is unchanged */
+        if (xml_prefix(x) != NULL)
+            ns = nsp;
+    }
+    /* If topmost, add to top-list created list */
+    if (xp == jr->jr_xtop){
+        if (cxvec_append(x, &jr->jr_xvec, &jr->jr_xlen) < 0)
+            goto done;
+        /* Mark unqualified top-level names, see RFC 7951 Sec 4 */
+        if (prefix == NULL)
+            xml_flag_set(x, XML_FLAG_TRANSIENT);
+    }
+    *xp1 = x;
+    *ns1 = ns;
+    retval = 1;
+ done:
+    if (prefix)
+        free(prefix);
+    if (id)
+        free(id);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Parse JSON object, current position is at '{'
+ * @param[in]  jr   JSON reader
+ * @param[in]  x    XML node where object members are added as children
+ * @param[in]  ns   Default namespace of x
+ */
+static int
+jr_object(json_reader *jr,
+          cxobj       *x,
+          char        *ns)
+{
+    int    retval = -1;
+    char  *name = NULL;
+    cxobj *xc;
+    char  *nsc;
+    int    ret;
+    int    empty;
+
+    jr->jr_i++; /* { */
+    jr_ws(jr);
+    if (jr->jr_str[jr->jr_i] == '}'){
+        jr->jr_i++;
+        goto ok;
+    }
+    while (1){
+        if (jr->jr_str[jr->jr_i] != '"'){
+            jr_error(jr, "syntax error: expected member name");
+            goto done;
+        }
+        if (jr_string(jr) < 0)
+            goto done;
+        if ((name = strdup(cbuf_get(jr->jr_cb))) == NULL){
+            clicon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+        jr_ws(jr);
+        if (jr->jr_str[jr->jr_i] != ':'){
+            jr_error(jr, "syntax error: expected ':'");
+            goto done;
+        }
+        jr->jr_i++;
+        jr_ws(jr);
+        if (jr->jr_str[jr->jr_i] == '['){
+            /* Array is a sequence of elements with same name, empty array is one element */
+            jr->jr_i++;
+            jr_ws(jr);
+            empty = (jr->jr_str[jr->jr_i] == ']');
+            while (1){
+                if ((ret = jr_element(jr, x, ns, name, &xc, &nsc)) < 0)
+                    goto done;
+                if (ret == 0)
+                    goto fail;
+                if (empty)
+                    break;
+                if ((ret = jr_value(jr, xc, nsc)) < 0)
+                    goto done;
+                if (ret == 0)
+                    goto fail;
+                jr_ws(jr);
+                if (jr->jr_str[jr->jr_i] != ',')
+                    break;
+                jr->jr_i++;
+                jr_ws(jr);
+            }
+            if (jr->jr_str[jr->jr_i] != ']'){
+                jr_error(jr, "syntax error: expected ',' or ']'");
+                goto done;
+            }
+            jr->jr_i++;
+        }
+        else {
+            if ((ret = jr_element(jr, x, ns, name, &xc, &nsc)) < 0)
+                goto done;
+            if (ret == 0)
+                goto fail;
+            if ((ret = jr_value(jr, xc, nsc)) < 0)
+                goto done;
+            if (ret == 0)
+                goto fail;
+        }
+        free(name);
+        name = NULL;
+        jr_ws(jr);
+        if (jr->jr_str[jr->jr_i] == '}'){
+            jr->jr_i++;
+            break;
+        }
+        if (jr->jr_str[jr->jr_i] != ','){
+            jr_error(jr, "syntax error: expected ',' or '}'");
+            goto done;
+        }
+        jr->jr_i++;
+        jr_ws(jr);
+    }
+ ok:
+    retval = 1;
+ done:
+    if (name)
+        free(name);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Parse JSON value and add it to XML node
+ * @param[in]  jr   JSON reader
+ * @param[in]  x    XML node
+ * @param[in]  ns   Default namespace of x
+ * @retval     1    OK
+ * @retval     0    Invalid, jr_xerr set
+ * @retval    -1    Error
+ */
+static int
+jr_value(json_reader *jr,
+         cxobj       *x,
+         char        *ns)
+{
+    int         retval = -1;
+    const char *s = jr->jr_str;
+    size_t      i = jr->jr_i;
+    int         ret;
+
+    if (++jr->jr_depth > JSON_DEPTH_MAX){
+        jr_error(jr, "too deep nesting");
+        goto done;
+    }
+    switch (s[i]){
+    case '{':
+        if ((ret = jr_object(jr, x, ns)) <= 0){
+            retval = ret;
+            goto done;
+        }
+        break;
+    case '[': /* Array not as object member, elements are added to x itself */
+        jr->jr_i++;
+        jr_ws(jr);
+        if (s[jr->jr_i] != ']')
+            while (1){
+                if ((ret = jr_value(jr, x, ns)) <= 0){
+                    retval = ret;
+                    goto done;
+                }
+                jr_ws(jr);
+                if (s[jr->jr_i] != ',')
+                    break;
+                jr->jr_i++;
+                jr_ws(jr);
+            }
+        if (s[jr->jr_i] != ']'){
+            jr_error(jr, "syntax error: expected ',' or ']'");
+            goto done;
+        }
+        jr->jr_i++;
+        break;
+    case '"':
+        if (jr_string(jr) < 0)
+            goto done;
+        if (jr_body(x, cbuf_get(jr->jr_cb), cbuf_len(jr->jr_cb)) < 0)
+            goto done;
+        break;
+    case 't':
+        if (strncmp(&s[i], "true", 4) != 0){
+            jr_error(jr, "syntax error");
+            goto done;
+        }
+        if (jr_body(x, "true", 4) < 0)
+            goto done;
+        jr->jr_i += 4;
+        break;
+    case 'f':
+        if (strncmp(&s[i], "false", 5) != 0){
+            jr_error(jr, "syntax error");
+            goto done;
+        }
+        if (jr_body(x, "false", 5) < 0)
+            goto done;
+        jr->jr_i += 5;
+        break;
+    case 'n':
+        if (strncmp(&s[i], "null", 4) != 0){
+            jr_error(jr, "syntax error");
+            goto done;
+        }
+        if (jr_body(x, NULL, 0) < 0)
+            goto done;
+        jr->jr_i += 4;
+        break;
+    default: /* Number: -?int(.int)?([eE][+-]?int)? */
+        if (s[i] == '-')
+            i++;
+        if (!(s[i] >= '0' && s[i] <= '9')){
+            jr_error(jr, "syntax error");
+            goto done;
+        }
+        while (s[i] >= '0' && s[i] <= '9')
+            i++;
+        if (s[i] == '.'){
+            i++;
+            if (!(s[i] >= '0' && s[i] <= '9')){
+                jr->jr_i = i;
+                jr_error(jr, "syntax error: expected digit after '.'");
+                goto done;
+            }
+            while (s[i] >= '0' && s[i] <= '9')
+                i++;
+        }
+        if ((s[i] == 'e' || s[i] == 'E') &&
+            ((s[i+1] >= '0' && s[i+1] <= '9') ||
+             ((s[i+1] == '+' || s[i+1] == '-') && s[i+2] >= '0' && s[i+2] <= '9'))){
+            i += 2;
+            while (s[i] >= '0' && s[i] <= '9')
+                i++;
+        }
+        if (jr_body(x, &s[jr->jr_i], i - jr->jr_i) < 0)
+            goto done;
+        jr->jr_i = i;
+        break;
+    }
+    retval = 1;
+ done:
+    jr->jr_depth--;
+    return retval;
+}
+
+/*! Parse a string containing JSON into an XML tree
+ *
+ * Names with <module>:<id> are split and the module is translated to a default XML namespace
+ * as in RFC7951.
+ * Top-level nodes whose names are not namespace-qualified are marked with XML_FLAG_TRANSIENT,
+ * the caller is expected to check and reset the flag.
+ * @param[in]  str    Input string containing JSON
+ * @param[in]  yspec  Yang spec for module to namespace translation, or NULL
+ * @param[in]  xt     XML top of tree. Created by caller. Holds new tree.
+ * @param[out] xvec   Vector of created top-level nodes, free with free()
+ * @param[out] xlen   Length of xvec
+ * @param[out] xerr   Reason for invalid returned as netconf err msg
+ * @retval     1      OK
+ * @retval     0      Invalid: unknown module, xerr set
+ * @retval    -1      Error with clicon_err called. Includes parse error
+ */
+int
+clixon_json_read(const char *str,
+                 yang_stmt  *yspec,
+                 cxobj      *xt,
+                 cxobj    ***xvec,
+                 int        *xlen,
+                 cxobj     **xerr)
+{
+    int          retval = -1;
+    json_reader  jr = {0,};
+    char        *ns = NULL;
+    int          ret;
+
+    jr.jr_str = str;
+    jr.jr_linenum = 1;
+    jr.jr_yspec = yspec;
+    jr.jr_xtop = xt;
+    jr.jr_xerr = xerr;
+    if ((jr.jr_cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (xml2ns(xt, NULL, &ns) < 0)
+        goto done;
+    jr_ws(&jr);
+    if (str[jr.jr_i] == '\0'){
+        jr_error(&jr, "syntax error");
+        goto done;
+    }
+    if ((ret = jr_value(&jr, xt, ns)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+    jr_ws(&jr);
+    if (str[jr.jr_i] != '\0'){
+        jr_error(&jr, "syntax error: trailing characters");
+        goto done;
+    }
+    retval = 1;
+ done:
+    if (jr.jr_cb)
+        cbuf_free(jr.jr_cb);
+    *xvec = jr.jr_xvec;
+    *xlen = jr.jr_xlen;
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
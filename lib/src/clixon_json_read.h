@@ -1,8 +1,9 @@
 /*
  *
   ***** BEGIN LICENSE BLOCK *****
- 
-  Copyright (C) 2009-2019 Olof Hagsand
+
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
   Copyright (C) 2020-2022 Olof Hagsand and Rubicon Communications, LLC(Netgate)
 
   This file is part of CLIXON.
@@ -24,7 +25,7 @@
   in which case the provisions of the GPL are applicable instead
   of those above. If you wish to allow use of your version of this file only
   under the terms of the GPL, and not to allow others to
-  use your version of this file under the terms of Apache License version 2, 
+  use your version of this file under the terms of Apache License version 2,
   indicate your decision by deleting the provisions above and replace them with
   the  notice and other provisions required by the GPL. If you do not delete
   the provisions above, a recipient may use your version of this file under
@@ -32,41 +33,15 @@
 
   ***** END LICENSE BLOCK *****
 
+ * JSON reader, single-pass JSON to XML parser
+ * @see clixon_json_read.c
  */
-#ifndef _CLIXON_JSON_PARSE_H_
-#define _CLIXON_JSON_PARSE_H_
-
-/*
- * Types
- */
-
-struct clixon_json_yacc { 
-    int        jy_linenum;      /* Number of \n in parsed buffer */
-    char      *jy_parse_string; /* original (copy of) parse string */
-    void      *jy_lexbuf;       /* internal parse buffer from lex */
-    cxobj     *jy_xtop;         /* cxobj top element (fixed) */
-    cxobj     *jy_current;      /* cxobj active element (changes with parse context) */
-    cxobj    **jy_xvec;         /* Vector of created top-level nodes (to know which are created) */
-    int        jy_xlen;         /* Length of jy_xvec */
-};
-typedef struct clixon_json_yacc clixon_json_yacc;
-
-/*
- * Variables
- */
-extern char *clixon_json_parsetext;
+#ifndef _CLIXON_JSON_READ_H_
+#define _CLIXON_JSON_READ_H_
 
 /*
  * Prototypes
  */
-int json_scan_init(clixon_json_yacc *jy);
-int json_scan_exit(clixon_json_yacc *jy);
-
-int json_parse_init(clixon_json_yacc *jy);
-int json_parse_exit(clixon_json_yacc *jy);
-
-int clixon_json_parselex(void *);
-int clixon_json_parseparse(void *);
-void clixon_json_parseerror(void *, char*);
+int clixon_json_read(const char *str, yang_stmt *yspec, cxobj *xt, cxobj ***xvec, int *xlen, cxobj **xerr);
 
-#endif  /* _CLIXON_JSON_PARSE_H_ */
+#endif  /* _CLIXON_JSON_READ_H_ */
@@ -73,6 +73,7 @@
 #include "clixon_xml_map.h"
 #include "clixon_path.h"
 #include "clixon_xml_vec.h"
+#include "clixon_yang_schema_mount.h"
 #include "clixon_nacm.h"
 
 /* NACM namespace for use with xml namespace contexts and xpath */
@@ -353,45 +354,247 @@ prepvec_add(prepvec  **pv_listp,
     return pv;
 }
 
-/*! Prepare datastructures before running through XML tree
- * Save rules in a "cache"
- * These rules match:
- *  - user/group
- *  - have read access-op, etc
- * Also make instance-id lookups on top object for each rule. Assume at most one result
+/* Compiled NACM data node rule, see nacm_user_compile */
+struct nacm_rule{
+    qelem_t      nr_q;
+    cxobj       *nr_xrule;   /* Rule in NACM tree copy of policy */
+    int          nr_access;  /* Access-operations as bitmask of (1<<enum nacm_access) */
+    int          nr_haspath; /* Rule-type is data-node */
+    clixon_path *nr_path;    /* Parsed and YANG resolved path (NULL is top) */
+};
+typedef struct nacm_rule nacm_rule;
+
+/* Read access of a YANG data node given by the compiled rules of a user
+ * @see nacm_yang_class
+ */
+enum nacm_yclass{
+    NACM_Y_NONE = 0,   /* No rule matches instances of node */
+    NACM_Y_PERMIT,     /* First matching rule permits all instances */
+    NACM_Y_DENY,       /* First matching rule denies all instances */
+    NACM_Y_CHECK       /* Depends on instance, check rules for every XML node */
+};
+
+/* Flags of YANG node descendants */
+#define NACM_Y_SUBDENY 0x01 /* Some descendant may be denied */
+#define NACM_Y_SUBMARK 0x02 /* Some descendant may be permitted */
+
+/* YANG node read access of a user, entry in open-addressing hash on yang_stmt pointer */
+struct nacm_ynode{
+    yang_stmt   *yn_ys;      /* YANG data node, NULL if entry is free */
+    uint8_t      yn_class;   /* enum nacm_yclass */
+    uint8_t      yn_sub;     /* NACM_Y_SUB* flags of descendants */
+};
+typedef struct nacm_ynode nacm_ynode;
+
+/* Compiled NACM data node rules of one user */
+struct nacm_user{
+    qelem_t      nu_q;
+    char        *nu_name;    /* User name */
+    size_t       nu_glen;    /* Nr of groups user is a member of */
+    nacm_rule   *nu_rules;   /* Data node rules of user's rule-lists, in order */
+    nacm_ynode  *nu_yvec;    /* YANG node read access, computed on demand */
+    size_t       nu_ysize;   /* Size of nu_yvec, power of two */
+    size_t       nu_ylen;    /* Nr of used entries in nu_yvec */
+};
+typedef struct nacm_user nacm_user;
+
+/* Compiled NACM policy, valid as long as the NACM config does not change */
+struct nacm_policy{
+    cxobj       *np_xnacm;   /* Copy of NACM tree, compiled rules point into it */
+    yang_stmt   *np_yspec;   /* YANG spec compiled paths are resolved against */
+    nacm_user   *np_users;   /* Per-user compiled rules, built on demand */
+};
+typedef struct nacm_policy nacm_policy;
+
+/*! Free per-user compiled rules
  */
 static int
-nacm_datanode_prepare(clicon_handle     h,
-                      cxobj            *xt,
-                      enum nacm_access  access,
-                      cxobj           **gvec,
-                      size_t            glen,
-                      cxobj           **rlistvec,
-                      size_t            rlistlen,
-                      cvec             *nsc,
-                      prepvec         **pv_listp)
+nacm_users_free(nacm_user *nu_list)
 {
-    int        retval = -1;
-    cxobj     *rlist;
-    int        i;
-    int        j;
-    int        k;
-    char      *gname;
-    cxobj    **rvec = NULL; /* rules */
-    size_t     rlen;    
-    cxobj     *xrule;
-    cxobj     *pathobj;
-    char      *access_operations;
-    char      *path0;         /* Non-canonical path */
-    char      *path=NULL;     /* Canonical path */
-    cvec      *nsc0 = NULL;   /* Non-canonical namespace context */
-    yang_stmt *yspec;
-    cxobj   **xvec = NULL;
-    int       xlen = 0;
-    int       ret;
-    prepvec *pv;
+    nacm_user *nu;
+    nacm_rule *nr;
+
+    while ((nu = nu_list) != NULL) {
+        DELQ(nu, nu_list, nacm_user *);
+        while ((nr = nu->nu_rules) != NULL) {
+            DELQ(nr, nu->nu_rules, nacm_rule *);
+            if (nr->nr_path)
+                clixon_path_free(nr->nr_path);
+            free(nr);
+        }
+        if (nu->nu_name)
+            free(nu->nu_name);
+        if (nu->nu_yvec)
+            free(nu->nu_yvec);
+        free(nu);
+    }
+    return 0;
+}
+
+/*! Compare two NACM trees
+ * @retval  1  Equal: same names, bodies and attributes, in same order
+ * @retval  0  Not equal
+ */
+static int
+nacm_tree_equal(cxobj *x1,
+                cxobj *x2)
+{
+    int    i;
+    int    len;
+    cxobj *c1;
+    cxobj *c2;
+    char  *v1;
+    char  *v2;
+
+    if (xml_type(x1) != xml_type(x2))
+        return 0;
+    if (strcmp(xml_name(x1), xml_name(x2)) != 0)
+        return 0;
+    if (xml_type(x1) != CX_ELMNT){
+        v1 = xml_value(x1);
+        v2 = xml_value(x2);
+        if (v1 == NULL || v2 == NULL)
+            return v1 == v2;
+        return strcmp(v1, v2) == 0;
+    }
+    if ((len = xml_child_nr(x1)) != xml_child_nr(x2))
+        return 0;
+    for (i=0; i<len; i++){
+        c1 = xml_child_i(x1, i);
+        c2 = xml_child_i(x2, i);
+        if (!nacm_tree_equal(c1, c2))
+            return 0;
+    }
+    return 1;
+}
+
+/*! Check NACM config against compiled NACM policy and invalidate if changed
+ *
+ * The policy keeps a copy of the NACM tree. If the new tree differs from the copy, all
+ * compiled rules are removed and compiled again on demand.
+ * @param[in]  h      Clicon handle
+ * @param[in]  xnacm  NACM XML tree, root should be "nacm", or NULL
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see clicon_nacm_cache_set  where this is called when a new NACM tree is set
+ */
+int
+nacm_policy_update(clicon_handle h,
+                   cxobj        *xnacm)
+{
+    int          retval = -1;
+    nacm_policy *np = NULL;
+    yang_stmt   *yspec;
 
+    if (clicon_ptr_get(h, "nacm_policy", (void**)&np) < 0 || np == NULL){
+        if (xnacm == NULL)
+            goto ok;
+        if ((np = malloc(sizeof(*np))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        memset(np, 0, sizeof(*np));
+        if (clicon_ptr_set(h, "nacm_policy", np) < 0){
+            free(np);
+            goto done;
+        }
+    }
+    if (xnacm == NULL) /* Keep compiled policy until next tree is checked */
+        goto ok;
     yspec = clicon_dbspec_yang(h);
+    if (np->np_xnacm != NULL &&
+        np->np_yspec == yspec &&
+        nacm_tree_equal(np->np_xnacm, xnacm))
+        goto ok;
+    clicon_debug(CLIXON_DBG_DEFAULT, "%s NACM config changed, recompile", __FUNCTION__);
+    nacm_users_free(np->np_users);
+    np->np_users = NULL;
+    if (np->np_xnacm){
+        xml_free(np->np_xnacm);
+        np->np_xnacm = NULL;
+    }
+    if ((np->np_xnacm = xml_dup(xnacm)) == NULL)
+        goto done;
+    np->np_yspec = yspec;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Free compiled NACM policy
+ * @param[in]  h      Clicon handle
+ */
+int
+nacm_policy_free(clicon_handle h)
+{
+    nacm_policy *np = NULL;
+
+    if (clicon_ptr_get(h, "nacm_policy", (void**)&np) < 0 || np == NULL)
+        return 0;
+    nacm_users_free(np->np_users);
+    if (np->np_xnacm)
+        xml_free(np->np_xnacm);
+    free(np);
+    clicon_ptr_del(h, "nacm_policy");
+    return 0;
+}
+
+/*! Compile NACM data node rules of a user
+ *
+ * Find groups of user, the rule-lists of those groups, and the data node rules of those
+ * rule-lists. Compute access-operations bits and parse and resolve paths.
+ * Rules whose path does not resolve to YANG never match and are skipped.
+ * @param[in]  np       Policy with NACM tree
+ * @param[in]  username User name
+ * @param[out] nup      Compiled user rules
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_user_compile(nacm_policy *np,
+                  char        *username,
+                  nacm_user  **nup)
+{
+    int          retval = -1;
+    nacm_user   *nu = NULL;
+    nacm_rule   *nr;
+    cvec        *nsc = NULL;
+    cxobj      **gvec = NULL; /* groups */
+    size_t       glen;
+    cxobj      **rlistvec = NULL; /* rule-list */
+    size_t       rlistlen;
+    cxobj      **rvec = NULL; /* rules */
+    size_t       rlen;
+    cxobj       *rlist;
+    cxobj       *xrule;
+    cxobj       *pathobj;
+    char        *gname;
+    char        *ops;
+    char        *path;
+    clixon_path *cplist = NULL;
+    int          i;
+    int          j;
+    int          ret;
+
+    if ((nu = malloc(sizeof(*nu))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(nu, 0, sizeof(*nu));
+    if ((nu->nu_name = strdup(username)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    /* Create namespace context for with nacm namespace as default */
+    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+        goto done;
+    /* User's group */
+    if (xpath_vec(np->np_xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
+        goto done;
+    nu->nu_glen = glen;
+    if (xpath_vec(np->np_xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+        goto done;
     for (i=0; i<rlistlen; i++){         /* Loop through rule list */
         rlist = rlistvec[i];
         /* Loop through user's group to find match in this rule-list */
@@ -402,113 +605,411 @@ nacm_datanode_prepare(clicon_handle     h,
         }
         if (j==glen) /* not found */
             continue;
-        /* 6. For each rule-list entry found, process all rules, in order,
-           until a rule that matches the requested access operation is
-           found. (see 6 sub rules in nacm_rule_datanode
-        */
         if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
             goto done;
         for (j=0; j<rlen; j++){ /* Loop through rules */
             xrule = rvec[j];
-            /* 6c) For a "read" access operation, the rule's "access-operations"
-               leaf has the "read" bit set or has the special value "*" */
-            access_operations = xml_find_body(xrule, "access-operations");
-            switch (access){
-            case NACM_READ: 
-                /* 6c) For a "read" access operation, the rule's "access-operations"
-                   leaf has the "read" bit set or has the special value "*" */
-                if (!match_access(access_operations, "read", NULL))
-                    continue;
-                break;
-            case NACM_CREATE:
-                /* 6d) For a "create" access operation, the rule's "access-operations" 
-                   leaf has the "create" bit set or has the special value "*". */
-                if (!match_access(access_operations, "create", "write"))
-                    continue;
-                break;
-            case NACM_DELETE:
-                /* 6e) For a "delete" access operation, the rule's "access-operations" 
-                   leaf has the "delete" bit set or has the  special value "*". */
-                if (!match_access(access_operations, "delete", "write"))
+            if ((pathobj = xml_find_type(xrule, NULL, "path", CX_ELMNT)) == NULL){
+                if (xml_find_body(xrule, "rpc-name") || xml_find_body(xrule, "notification-name"))
                     continue;
-                break;
-            case NACM_UPDATE:
-                /* 6f) For an "update" access operation, the rule's "access-operations"
-                   leaf has the "update" bit set or has the special value "*". */ 
-                if (!match_access(access_operations, "update", "write"))
+            }
+            else {
+                path = clixon_trim2(xml_body(pathobj), " \t\n");
+                if ((ret = clixon_instance_id_parse(np->np_yspec, &cplist, NULL, "%s", path)) < 0)
+                    goto done;
+                if (ret == 0){
+                    clicon_err_reset();
                     continue;
-                break;
-            default:
-                clicon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
+                }
+            }
+            if ((nr = malloc(sizeof(*nr))) == NULL){
+                clicon_err(OE_UNIX, errno, "malloc");
                 goto done;
-                break;
             }
+            memset(nr, 0, sizeof(*nr));
+            nr->nr_xrule = xrule;
+            nr->nr_haspath = (pathobj != NULL);
+            nr->nr_path = cplist;
+            cplist = NULL;
+            ops = xml_find_body(xrule, "access-operations");
+            if (match_access(ops, "read", NULL))
+                nr->nr_access |= (1<<NACM_READ);
+            if (match_access(ops, "create", "write"))
+                nr->nr_access |= (1<<NACM_CREATE);
+            if (match_access(ops, "delete", "write"))
+                nr->nr_access |= (1<<NACM_DELETE);
+            if (match_access(ops, "update", "write"))
+                nr->nr_access |= (1<<NACM_UPDATE);
+            ADDQ(nr, nu->nu_rules);
+        }
+        if (rvec){
+            free(rvec);
+            rvec = NULL;
+        }
+    }
+    *nup = nu;
+    nu = NULL;
+    retval = 0;
+ done:
+    if (nu)
+        nacm_users_free(nu);
+    if (cplist)
+        clixon_path_free(cplist);
+    if (nsc)
+        xml_nsctx_free(nsc);
+    if (gvec)
+        free(gvec);
+    if (rlistvec)
+        free(rlistvec);
+    if (rvec)
+        free(rvec);
+    return retval;
+}
+
+/*! Get compiled NACM data node rules of a user, compile if not found
+ * @param[in]  h        Clicon handle
+ * @param[in]  xnacm    NACM XML tree, root should be "nacm"
+ * @param[in]  username User name
+ * @param[out] nup      Compiled user rules, valid until NACM config changes
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @note xnacm is always compared with the policy copy, since it may have been modified in
+ *       place, eg the NACM subtree of a datastore cache
+ */
+static int
+nacm_policy_user(clicon_handle h,
+                 cxobj        *xnacm,
+                 char         *username,
+                 nacm_user   **nup)
+{
+    int          retval = -1;
+    nacm_policy *np = NULL;
+    nacm_user   *nu;
+
+    if (nacm_policy_update(h, xnacm) < 0)
+        goto done;
+    if (clicon_ptr_get(h, "nacm_policy", (void**)&np) < 0 || np == NULL){
+        clicon_err(OE_XML, ENOENT, "No NACM policy");
+        goto done;
+    }
+    if ((nu = np->np_users) != NULL){
+        do {
+            if (strcmp(nu->nu_name, username) == 0)
+                goto ok;
+            nu = NEXTQ(nacm_user *, nu);
+        } while (nu && nu != np->np_users);
+    }
+    if (nacm_user_compile(np, username, &nu) < 0)
+        goto done;
+    ADDQ(nu, np->np_users);
+ ok:
+    *nup = nu;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Hash of yang_stmt pointer into YANG node vector
+ */
+static size_t
+nacm_yhash(yang_stmt *ys,
+           size_t     size)
+{
+    return (((uintptr_t)ys >> 4) * 2654435761u) & (size - 1);
+}
+
+/*! Find YANG node read access entry of user
+ * @param[in]  nu   Compiled user rules
+ * @param[in]  ys   YANG data node
+ * @retval     yn   Entry
+ * @retval     NULL Not found
+ */
+static nacm_ynode *
+nacm_ynode_find(nacm_user *nu,
+                yang_stmt *ys)
+{
+    size_t      i;
+    nacm_ynode *yn;
+
+    if (nu->nu_yvec == NULL)
+        return NULL;
+    i = nacm_yhash(ys, nu->nu_ysize);
+    while ((yn = &nu->nu_yvec[i])->yn_ys != NULL){
+        if (yn->yn_ys == ys)
+            return yn;
+        i = (i + 1) & (nu->nu_ysize - 1);
+    }
+    return NULL;
+}
+
+/*! Add YANG node read access entry of user, grow vector if half full
+ * @param[in]  nu     Compiled user rules
+ * @param[in]  ys     YANG data node
+ * @param[in]  class  enum nacm_yclass
+ * @param[in]  sub    NACM_Y_SUB* flags
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_ynode_add(nacm_user *nu,
+               yang_stmt *ys,
+               int        class,
+               int        sub)
+{
+    nacm_ynode *yvec0;
+    size_t      size0;
+    size_t      i;
+    size_t      j;
+
+    if (2*(nu->nu_ylen + 1) > nu->nu_ysize){
+        yvec0 = nu->nu_yvec;
+        size0 = nu->nu_ysize;
+        nu->nu_ysize = size0 ? 2*size0 : 64;
+        if ((nu->nu_yvec = calloc(nu->nu_ysize, sizeof(nacm_ynode))) == NULL){
+            clicon_err(OE_UNIX, errno, "calloc");
+            nu->nu_yvec = yvec0;
+            nu->nu_ysize = size0;
+            return -1;
+        }
+        for (j=0; j<size0; j++){
+            if (yvec0[j].yn_ys == NULL)
+                continue;
+            i = nacm_yhash(yvec0[j].yn_ys, nu->nu_ysize);
+            while (nu->nu_yvec[i].yn_ys != NULL)
+                i = (i + 1) & (nu->nu_ysize - 1);
+            nu->nu_yvec[i] = yvec0[j];
+        }
+        if (yvec0)
+            free(yvec0);
+    }
+    i = nacm_yhash(ys, nu->nu_ysize);
+    while (nu->nu_yvec[i].yn_ys != NULL)
+        i = (i + 1) & (nu->nu_ysize - 1);
+    nu->nu_yvec[i].yn_ys = ys;
+    nu->nu_yvec[i].yn_class = class;
+    nu->nu_yvec[i].yn_sub = sub;
+    nu->nu_ylen++;
+    return 0;
+}
+
+/*! Read access of a YANG data node given by the first read rule that may match it
+ *
+ * A rule matches all instances of the node if its module matches and it either has no
+ * path or a path without keys whose target is the node or an ancestor of it.
+ * A rule with keys in its path whose target is the node or an ancestor may match some
+ * instances and the rules need to be checked for every instance.
+ * @param[in]  nu     Compiled user rules
+ * @param[in]  ys     YANG data node
+ * @param[in]  yspec  YANG spec
+ * @retval     class  enum nacm_yclass
+ */
+static int
+nacm_yang_own(nacm_user *nu,
+              yang_stmt *ys,
+              yang_stmt *yspec)
+{
+    nacm_rule   *nr;
+    char        *ns;
+    char        *modname = NULL;
+    char        *pattern;
+    char        *action;
+    yang_stmt   *ymod;
+    yang_stmt   *yt;
+    yang_stmt   *yp;
+    clixon_path *cp;
+    int          keys;
+
+    if ((ns = yang_find_mynamespace(ys)) != NULL &&
+        (ymod = yang_find_module_by_namespace(yspec, ns)) != NULL)
+        modname = yang_argument_get(ymod);
+    if ((nr = nu->nu_rules) == NULL)
+        return NACM_Y_NONE;
+    do {
+        if ((nr->nr_access & (1<<NACM_READ)) == 0)
+            goto next;
+        /* 6a) module-name is "*" or the module of the node */
+        if ((pattern = xml_find_body(nr->nr_xrule, "module-name")) == NULL)
+            goto next;
+        if (strcmp(pattern, "*") != 0){
+            if (modname == NULL)
+                return NACM_Y_CHECK;
+            if (strcmp(pattern, modname) != 0)
+                goto next;
+        }
+        /* 6b) no path or path target is node or ancestor */
+        keys = 0;
+        if (nr->nr_haspath){
+            if ((cp = nr->nr_path) == NULL) /* Top: never matches, see nacm_datanode_prepare */
+                goto next;
+            do {
+                if (cp->cp_cvk)
+                    keys++;
+                cp = NEXTQ(clixon_path *, cp);
+            } while (cp && cp != nr->nr_path);
+            yt = PREVQ(clixon_path *, nr->nr_path)->cp_yang;
+            for (yp = ys; yp != NULL; yp = yang_parent_get(yp))
+                if (yp == yt)
+                    break;
+            if (yp == NULL)
+                goto next;
+        }
+        if (keys)
+            return NACM_Y_CHECK;
+        if ((action = xml_find_body(nr->nr_xrule, "action")) != NULL){
+            if (strcmp(action, "deny") == 0)
+                return NACM_Y_DENY;
+            if (strcmp(action, "permit") == 0)
+                return NACM_Y_PERMIT;
+        }
+        return NACM_Y_NONE;
+    next:
+        nr = NEXTQ(nacm_rule *, nr);
+    } while (nr && nr != nu->nu_rules);
+    return NACM_Y_NONE;
+}
+
+/*! Get read access of a YANG data node and its descendants for a user, compute if not found
+ *
+ * The result is cached in the compiled user rules, and the descendants are computed
+ * recursively in the same pass.
+ * @param[in]  nu     Compiled user rules
+ * @param[in]  ys     YANG data node
+ * @param[in]  yspec  YANG spec
+ * @param[out] class  enum nacm_yclass of node
+ * @param[out] sub    NACM_Y_SUB* flags of descendants
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_yang_class(nacm_user *nu,
+                yang_stmt *ys,
+                yang_stmt *yspec,
+                int       *class,
+                int       *sub)
+{
+    int         retval = -1;
+    nacm_ynode *yn;
+    yang_stmt  *yc;
+    int         cclass;
+    int         csub;
+    int         ret;
+
+    if ((yn = nacm_ynode_find(nu, ys)) != NULL){
+        *class = yn->yn_class;
+        *sub = yn->yn_sub;
+        goto ok;
+    }
+    *class = nacm_yang_own(nu, ys, yspec);
+    *sub = 0;
+    if ((ret = yang_schema_mount_point(ys)) < 0)
+        goto done;
+    if (ret == 1) /* Mounted nodes are not children, assume anything */
+        *sub = NACM_Y_SUBDENY | NACM_Y_SUBMARK;
+    yc = NULL;
+    while ((yc = yn_each(ys, yc)) != NULL) {
+        switch (yang_keyword_get(yc)){
+        case Y_CHOICE: /* Choice and case are not data nodes, but their children are */
+        case Y_CASE:
+            if (nacm_yang_class(nu, yc, yspec, &cclass, &csub) < 0)
+                goto done;
+            *sub |= csub;
+            break;
+        default:
+            if (!yang_datanode(yc))
+                continue;
+            if (nacm_yang_class(nu, yc, yspec, &cclass, &csub) < 0)
+                goto done;
+            if (cclass == NACM_Y_DENY || cclass == NACM_Y_CHECK)
+                *sub |= NACM_Y_SUBDENY;
+            if (cclass == NACM_Y_PERMIT || cclass == NACM_Y_CHECK)
+                *sub |= NACM_Y_SUBMARK;
+            *sub |= csub;
+            break;
+        }
+    }
+    if (nacm_ynode_add(nu, ys, *class, *sub) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Prepare datastructures before running through XML tree
+ * Save rules in a "cache"
+ * These rules are the compiled rules of the user that:
+ *  - have read access-op, etc
+ * Also make instance-id lookups on top object for each rule. Assume at most one result
+ */
+static int
+nacm_datanode_prepare(clicon_handle     h,
+                      cxobj            *xt,
+                      enum nacm_access  access,
+                      nacm_user        *nu,
+                      prepvec         **pv_listp)
+{
+    int          retval = -1;
+    nacm_rule   *nr;
+    yang_stmt   *yspec;
+    clixon_xvec *xv = NULL;
+    int          k;
+    int          ret;
+    prepvec     *pv;
+
+    switch (access){
+    case NACM_READ:
+    case NACM_CREATE:
+    case NACM_DELETE:
+    case NACM_UPDATE:
+        break;
+    default:
+        clicon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
+        goto done;
+        break;
+    }
+    yspec = clicon_dbspec_yang(h);
+    /* 6. For each rule-list entry found, process all rules, in order,
+       until a rule that matches the requested access operation is
+       found. (see 6 sub rules in nacm_rule_datanode
+    */
+    if ((nr = nu->nu_rules) != NULL){
+        do {
+            /* 6c-f) The rule's "access-operations" leaf has the access bit set or
+               has the special value "*" */
+            if ((nr->nr_access & (1<<access)) == 0)
+                goto next;
             /*  6b) Either (1) the rule does not have a "rule-type" defined or
                 (2) the "rule-type" is "data-node" and the "path" matches the
                 requested data node, action node, or notification node. */    
-            if ((pathobj = xml_find_type(xrule, NULL, "path", CX_ELMNT)) == NULL){
-                if (xml_find_body(xrule, "rpc-name") || xml_find_body(xrule, "notification-name"))
-                    continue;
+            if (!nr->nr_haspath){
                 /* Here a new xrule is found, add it */
-                if (prepvec_add(pv_listp, xrule) == NULL)
+                if (prepvec_add(pv_listp, nr->nr_xrule) == NULL)
                     goto done;
+                goto next;
             }
-            else{
-                path0 = clixon_trim2(xml_body(pathobj), " \t\n");
-                /* Get canonical namespace context for nacm paths */
-                if ((path = strdup(path0)) == NULL){
-                    clicon_err(OE_UNIX, errno, "strdup");
-                    goto done;
-                }
-#if 0
-                /* See https://github.com/clicon/clixon/issues/129:
-                 * If this is enabled, you are back to the problem of JSON encodings
-                 */
-                /* Create namespace context for with nacm namespace as default */
-                if (xml_nsctx_node(pathobj, &nsc0) < 0)
-                    goto done;
-                /* instance-id requires canonical paths */
-                if (xpath2canonical(path0, nsc0, yspec, &path, NULL) < 0)
-                    goto done;
-#endif
-                if ((ret = clixon_xml_find_instance_id(xt, yspec, &xvec, &xlen, "%s", path)) < 0)
-                    goto done;
-                if (ret == 0)
-                    continue;
-                /* Here a new xrule is found, add it */
-                if ((pv = prepvec_add(pv_listp, xrule)) == NULL)
+            if ((ret = clixon_path_search(xt, yspec, nr->nr_path, &xv)) < 0)
+                goto done;
+            if (ret == 0)
+                goto next;
+            /* Here a new xrule is found, add it */
+            if ((pv = prepvec_add(pv_listp, nr->nr_xrule)) == NULL)
+                goto done;
+            for (k=0; xv && k<clixon_xvec_len(xv); k++){
+                if (clixon_xvec_append(pv->pv_xpathvec, clixon_xvec_i(xv, k)) < 0)
                     goto done;
-                for (k=0; k<xlen; k++){
-                    if (clixon_xvec_append(pv->pv_xpathvec, xvec[k]) < 0)
-                        goto done;
-                }
-                if (xvec){
-                    free(xvec);
-                    xvec = NULL;
-                }
-                if (nsc0){
-                    cvec_free(nsc0);
-                    nsc0 = NULL;
-                }
-                if (path){
-                    free(path);
-                    path = NULL;
-                }
             }
-        }
-        if (rvec){
-            free(rvec);
-            rvec=NULL;
-        }       
+        next:
+            if (xv){
+                clixon_xvec_free(xv);
+                xv = NULL;
+            }
+            nr = NEXTQ(nacm_rule *, nr);
+        } while (nr && nr != nu->nu_rules);
     }
     retval = 0;
  done:
-    if (xvec)
-        free(xvec);
-    if (path)
-        free(path);
-    if (nsc0)
-        cvec_free(nsc0);
+    if (xv)
+        clixon_xvec_free(xv);
     return retval;
 }
 
@@ -684,19 +1185,11 @@ nacm_datanode_write(clicon_handle    h,
                     cbuf            *cbret)
 {
     int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
-    cxobj         **rvec = NULL; /* rules */
     char           *write_default = NULL;
-    cvec           *nsc = NULL;
+    nacm_user      *nu = NULL;
     int             ret;
     prepvec        *pv_list = NULL;
 
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-        goto done;
     if (xnacm == NULL)
         goto permit;
     /* write-default (create, update, or delete) has default deny so should never be NULL */
@@ -711,21 +1204,19 @@ nacm_datanode_write(clicon_handle    h,
        transport layer.)               */
     if (username == NULL)
         goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
+    /* User's groups and rules, compiled once per NACM config */
+    if (nacm_policy_user(h, xnacm, username, &nu) < 0)
         goto done;
     /* 4. If no groups are found, continue with step 9. */
-    if (glen == 0)
+    if (nu->nu_glen == 0)
         goto step9;
     /* 5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
-        goto done;
-    /* First run through rules and cache rules as well as lookup objects in xt. 
+        entry. 
+       First run through rules and cache rules as well as lookup objects in xt. 
      */
-    if (nacm_datanode_prepare(h, xt, access, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    if (nacm_datanode_prepare(h, xt, access, nu, &pv_list) < 0)
         goto done;
     /* Then recursivelyy traverse all requested nodes */
     if ((ret = nacm_datanode_write_recurse(h, xreq, pv_list,
@@ -762,14 +1253,6 @@ nacm_datanode_write(clicon_handle    h,
     clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
     if (pv_list)
         prepvec_free(pv_list);
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (gvec)
-        free(gvec);
-    if (rlistvec)
-        free(rlistvec);
-    if (rvec)
-        free(rvec);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -868,10 +1351,15 @@ nacm_data_read_xrule_xml(cxobj        *xn,
 }
 
 /*! Recursive check for NACM read rules among all XML nodes
+ *
+ * The read access of the YANG node of each XML node is first looked up. Only if it depends
+ * on the instance are the rules checked. A subtree is not visited if no descendant can be
+ * denied and permit marks of descendants are not needed.
  * @param[in]  h        Clicon handle
  * @param[in]  xn       XML node (requested node)
- * @param[in]  rulevec  Precomputed rules that apply to this user group
- * @param[in]  xpathvec Precomputed xpath results that apply to this XML tree
+ * @param[in]  pv_list  Precomputed rules and xpath results that apply to this user and tree
+ * @param[in]  nu       Compiled rules of user
+ * @param[in]  readdeny Read-default is deny
  * @param[in]  yspec    YANG spec
  * @retval  0  OK
  * @retval -1  Error
@@ -880,43 +1368,64 @@ static int
 nacm_datanode_read_recurse(clicon_handle h,
                            cxobj        *xn,
                            prepvec      *pv_list,
+                           nacm_user    *nu,
+                           int           readdeny,
                            yang_stmt    *yspec)
 {
-    int      retval = -1;
-    cxobj   *x;
-    cxobj   *xprev;
-    int      ret;
-    prepvec *pv;
+    int        retval = -1;
+    cxobj     *x;
+    cxobj     *xprev;
+    int        ret;
+    prepvec   *pv;
+    yang_stmt *ys;
+    int        class;
+    int        sub;
     
-    if (xml_spec(xn)){ /* Check this node */
-        pv = pv_list;
-        if (pv){
-            do {
-                if ((ret = nacm_data_read_xrule_xml(xn,
-                                                    pv->pv_xrule,
-                                                    pv->pv_xpathvec,
-                                                    yspec)) < 0) 
-                    goto done;      
-                if (ret == 1)
-                    break; /* stop at first match */                
-                pv = NEXTQ(prepvec *, pv);
-            } while (pv && pv != pv_list);
+    if ((ys = xml_spec(xn)) != NULL){ /* Check this node */
+        if (nacm_yang_class(nu, ys, yspec, &class, &sub) < 0)
+            goto done;
+        switch (class){
+        case NACM_Y_DENY:
+            xml_flag_set(xn, XML_FLAG_DEL);
+            break;
+        case NACM_Y_PERMIT:
+            xml_flag_set(xn, XML_FLAG_MARK);
+            break;
+        case NACM_Y_CHECK:
+            pv = pv_list;
+            if (pv){
+                do {
+                    if ((ret = nacm_data_read_xrule_xml(xn,
+                                                        pv->pv_xrule,
+                                                        pv->pv_xpathvec,
+                                                        yspec)) < 0) 
+                        goto done;      
+                    if (ret == 1)
+                        break; /* stop at first match */                
+                    pv = NEXTQ(prepvec *, pv);
+                } while (pv && pv != pv_list);
+            }
+            break;
+        default:
+            break;
         }
-
 #if 0 /* 6(A) in algorithm 
        * If N did not match any rule R, and default rule is deny, remove that subtree */
         if (strcmp(read_default, "deny") == 0)
             if (xml_tree_prune_flagged_sub(xt, XML_FLAG_MARK, 1, NULL) < 0)
                 goto done;
 #endif
+        /* Nothing below can be denied, and marks below are not used or not set */
+        if ((sub & NACM_Y_SUBDENY) == 0 &&
+            (!readdeny || xml_flag(xn, XML_FLAG_MARK) || (sub & NACM_Y_SUBMARK) == 0))
+            goto ok;
     }
-
     /* If node should be purged, dont recurse and defer removal to caller */
     if (xml_flag(xn, XML_FLAG_DEL) == 0){
         x = NULL;       /* Recursively check XML */
         xprev = NULL;
         while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-            if (nacm_datanode_read_recurse(h, x, pv_list, yspec) < 0)
+            if (nacm_datanode_read_recurse(h, x, pv_list, nu, readdeny, yspec) < 0)
                 goto done;
             /* check for delayed remove */
             if (xml_flag(x, XML_FLAG_DEL)){
@@ -926,6 +1435,7 @@ nacm_datanode_read_recurse(clicon_handle h,
             }
         }
     }
+ ok:
     retval = 0;
  done:
     return retval;
@@ -988,18 +1498,11 @@ nacm_datanode_read(clicon_handle h,
                    cxobj        *xnacm)
 {
     int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
     int             i;
     char           *read_default = NULL;
-    cvec           *nsc = NULL;
+    nacm_user      *nu = NULL;
     prepvec        *pv_list = NULL;
     
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-        goto done;
     /* 3.   Check all the "group" entries to see if any of them contain a
        "user-name" entry that equals the username for the session
        making the request.  (If the "enable-external-groups" leaf is
@@ -1007,16 +1510,14 @@ nacm_datanode_read(clicon_handle h,
        transport layer.)               */
     if (username == NULL)
         goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-        goto done;
-    /* 4. If no groups are found (glen=0), continue and check read-default 
-          in step 11. */
-    /* 5. Process all rule-list entries, in the order they appear in the
-        configuration.  If a rule-list's "group" leaf-list does not
-        match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
+    /* User's groups and rules, compiled once per NACM config
+     * 4. If no groups are found (no rules), continue and check read-default 
+     *    in step 11. 
+     * 5. Process all rule-list entries, in the order they appear in the
+     *    configuration.  If a rule-list's "group" leaf-list does not
+     *    match any of the user's groups, proceed to the next rule-list
+     *    entry. */
+    if (nacm_policy_user(h, xnacm, username, &nu) < 0)
         goto done;
     /* read-default has default permit so should never be NULL */
     if ((read_default = xml_find_body(xnacm, "read-default")) == NULL){
@@ -1026,10 +1527,12 @@ nacm_datanode_read(clicon_handle h,
     /* First run through rules and cache rules as well as lookup objects in xt. 
      * DANGER: objects could be stale if they are removed?
      */
-    if (nacm_datanode_prepare(h, xt, NACM_READ, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    if (nacm_datanode_prepare(h, xt, NACM_READ, nu, &pv_list) < 0)
         goto done;
     /* Then recursivelyy traverse all nodes */
-    if (nacm_datanode_read_recurse(h, xt, pv_list, clicon_dbspec_yang(h)) < 0)
+    if (nacm_datanode_read_recurse(h, xt, pv_list, nu,
+                                   strcmp(read_default, "deny") == 0,
+                                   clicon_dbspec_yang(h)) < 0)
         goto done;
 #if 1
     /* Step 8(B) above:
@@ -1062,12 +1565,6 @@ nacm_datanode_read(clicon_handle h,
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
     if (pv_list)
         prepvec_free(pv_list);
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (gvec)
-        free(gvec);
-    if (rlistvec)
-        free(rlistvec);
     return retval;
 }
 
@@ -1516,7 +1516,7 @@ instance_id_resolve(clixon_path *cplist,
  * @retval     0        Fail  fail: eg no yang 
  * @retval     1        OK with found xml nodes in xvec (if any)
  */
-static int
+int
 clixon_path_search(cxobj        *xt,
                    yang_stmt    *yt,
                    clixon_path  *cplist,
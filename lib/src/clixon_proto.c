@@ -393,62 +393,79 @@ clicon_msg_rcv(int                s,
     ssize_t   len2;
     sigfn_t   oldhandler;
     uint32_t  mlen;
+    int       more;
+    size_t    blen = 0; /* Length of received body of all chunks */
+    struct clicon_msg *m = NULL; /* Assembled message */
+    struct clicon_msg *m1;
 
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     *eof = 0;
     if (0)
         set_signal(SIGINT, atomicio_sig_handler, &oldhandler);
-
-    if ((hlen = atomicio(read, s, &hdr, sizeof(hdr))) < 0){ 
-        clicon_err(OE_CFG, errno, "atomicio");
-        goto done;
-    }
-    msg_hex(CLIXON_DBG_EXTRA, (char*)&hdr, hlen, __FUNCTION__);
-    if (hlen == 0){
-        *eof = 1;
-        goto ok;
-    }
-    if (hlen != sizeof(hdr)){
-        clicon_err(OE_PROTO, errno, "header too short (%d)", hlen);
-        goto done;
-    }
-
-    mlen = ntohl(hdr.op_len);
-    clicon_debug(16, "op-len:%u op-id:%u",
-                 mlen, ntohl(hdr.op_id));
-    clicon_debug(CLIXON_DBG_DETAIL, "%s: rcv msg len=%d",  
-                 __FUNCTION__, mlen);
-    if (mlen <= sizeof(hdr)){
-        clicon_err(OE_PROTO, 0, "op_len:%u too short", mlen);
-        *eof = 1;
-        assert(0);
-        goto ok;
-    }
-    if ((*msg = (struct clicon_msg *)malloc(mlen+1)) == NULL){
-        clicon_err(OE_PROTO, errno, "malloc");
-        goto done;
-    }
-    memcpy(*msg, &hdr, hlen);
-    if ((len2 = atomicio(read, s, (*msg)->op_body, mlen - sizeof(hdr))) < 0){ 
-        clicon_err(OE_PROTO, errno, "read");
-        goto done;
-    }
-    if (len2)
-        msg_hex(CLIXON_DBG_EXTRA, (*msg)->op_body, len2, __FUNCTION__);
-    if (len2 != mlen - sizeof(hdr)){
-        clicon_err(OE_PROTO, 0, "body too short");
-        *eof = 1;
-        goto ok;
-    }
-    if (((char*)*msg)[mlen-1] != '\0'){
+    do {
+        if ((hlen = atomicio(read, s, &hdr, sizeof(hdr))) < 0){ 
+            clicon_err(OE_CFG, errno, "atomicio");
+            goto done;
+        }
+        msg_hex(CLIXON_DBG_EXTRA, (char*)&hdr, hlen, __FUNCTION__);
+        if (hlen == 0){
+            if (m != NULL){
+                clicon_err(OE_PROTO, 0, "eof in chunked message");
+                free(m);
+                m = NULL;
+            }
+            *eof = 1;
+            goto ok;
+        }
+        if (hlen != sizeof(hdr)){
+            clicon_err(OE_PROTO, errno, "header too short (%d)", hlen);
+            goto done;
+        }
+        mlen = ntohl(hdr.op_len);
+        more = (mlen & CLICON_MSG_MORE) != 0;
+        mlen &= ~CLICON_MSG_MORE;
+        clicon_debug(16, "op-len:%u op-id:%u more:%d",
+                     mlen, ntohl(hdr.op_id), more);
+        clicon_debug(CLIXON_DBG_DETAIL, "%s: rcv msg len=%d",  
+                     __FUNCTION__, mlen);
+        if (mlen <= sizeof(hdr)){
+            clicon_err(OE_PROTO, 0, "op_len:%u too short", mlen);
+            *eof = 1;
+            assert(0);
+            goto ok;
+        }
+        /* Append chunk body to message */
+        if ((m1 = (struct clicon_msg *)realloc(m, blen + mlen + 1)) == NULL){
+            clicon_err(OE_PROTO, errno, "realloc");
+            goto done;
+        }
+        if (m == NULL)
+            memcpy(m1, &hdr, hlen);
+        m = m1;
+        if ((len2 = atomicio(read, s, m->op_body + blen, mlen - sizeof(hdr))) < 0){ 
+            clicon_err(OE_PROTO, errno, "read");
+            goto done;
+        }
+        if (len2)
+            msg_hex(CLIXON_DBG_EXTRA, m->op_body + blen, len2, __FUNCTION__);
+        if (len2 != mlen - sizeof(hdr)){
+            clicon_err(OE_PROTO, 0, "body too short");
+            *eof = 1;
+            goto ok;
+        }
+        blen += len2;
+    } while (more);
+    m->op_len = htonl(sizeof(hdr) + blen);
+    if (m->op_body[blen-1] != '\0'){
         clicon_err(OE_PROTO, 0, "body not NULL terminated");
         *eof = 1;
         goto ok;
     }
-    clicon_debug(CLIXON_DBG_MSG, "Recv: %s", (*msg)->op_body);
+    clicon_debug(CLIXON_DBG_MSG, "Recv: %s", m->op_body);
  ok:
     retval = 0;
   done:
+    *msg = m;
     clicon_debug(CLIXON_DBG_DETAIL, "%s retval:%d", __FUNCTION__, retval);
     if (0)
         set_signal(SIGINT, oldhandler, NULL);
@@ -750,6 +767,56 @@ send_msg_reply(int      s,
     return retval;
 }
 
+/*! Start a message chunk in a buffer by reserving space for the header
+ *
+ * Append chunk body to cb after this call, then call clicon_msg_chunk_end
+ * @param[in,out] cb   Buffer, typically empty
+ * @retval        0    OK
+ * @retval       -1    Error
+ * @see clicon_msg_chunk_end
+ */
+int
+clicon_msg_chunk_begin(cbuf *cb)
+{
+    struct clicon_msg hdr = {0,};
+
+    if (cbuf_append_buf(cb, &hdr, sizeof(hdr)) < 0){
+        clicon_err(OE_PROTO, errno, "cbuf_append_buf");
+        return -1;
+    }
+    return 0;
+}
+
+/*! Finish a message chunk started with clicon_msg_chunk_begin by setting the header
+ *
+ * The last chunk is NULL-terminated
+ * @param[in,out] cb    Buffer with header space and chunk body
+ * @param[in]     more  If set, more chunks of the message follow, else this is the last
+ * @retval        0     OK
+ * @retval       -1     Error
+ * @see clicon_msg_rcv  Assembles chunks
+ */
+int
+clicon_msg_chunk_end(cbuf *cb,
+                     int   more)
+{
+    struct clicon_msg *hdr;
+    uint32_t           len;
+
+    if (!more && cbuf_append(cb, '\0') < 0){
+        clicon_err(OE_PROTO, errno, "cbuf_append");
+        return -1;
+    }
+    if ((len = cbuf_len(cb)) & CLICON_MSG_MORE){
+        clicon_err(OE_PROTO, EFBIG, "Message chunk too large: %u", len);
+        return -1;
+    }
+    hdr = (struct clicon_msg *)cbuf_get(cb);
+    hdr->op_len = htonl(len | (more?CLICON_MSG_MORE:0));
+    hdr->op_id = 0;
+    return 0;
+}
+
 /*! Send a clicon_msg NOTIFY message asynchronously to client
  *
  * @param[in]  s       Socket to communicate with client
@@ -49,6 +49,8 @@
 #include <errno.h>
 #include <assert.h>
 #include <unistd.h>
+#include <inttypes.h>
+#include <sys/time.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
@@ -1061,6 +1063,198 @@ clicon_rpc_get(clicon_handle   h,
     return retval;
 }
 
+/*! Conditional get of running configuration using datastore generations
+ *
+ * Same as clicon_rpc_get with content=config, but data is only returned if it is modified,
+ * ie its generation differs from ifgen, or it is changed after ifsince.
+ * @param[in]  h        Clicon handle
+ * @param[in]  xpath    XPath (or "")
+ * @param[in]  nsc      Namespace context for filter
+ * @param[in]  depth    Nr of XML levels to get, -1 is all, 0 is none
+ * @param[in]  defaults Value of the with-defaults mode, rfc6243, or NULL
+ * @param[in]  ifgen    Generation of data client has, or 0
+ * @param[in]  ifsince  Get data only if changed after this time, or NULL. Not used if ifgen is set
+ * @param[out] gen      Generation of data
+ * @param[out] lastmod  Time of last change of data
+ * @param[out] xt       XML tree. Free with xml_free. Either <config> or <rpc-error>. 
+ * @retval     1        OK, data is modified (or error) and returned in xt
+ * @retval     0        Not modified, no data
+ * @retval    -1        Error, fatal or xml
+ * @code
+ *   uint64_t       gen;
+ *   struct timeval tv;
+ *   cxobj         *xt = NULL;
+ *
+ *   if ((ret = clicon_rpc_get_cond(h, "/hello/world", nsc, -1, NULL,
+ *                                  gen0, NULL, &gen, &tv, &xt)) < 0)
+ *       err;
+ *   if (ret == 0)
+ *       // not modified since gen0
+ * @endcode
+ * @see clicon_rpc_get
+ * @see xmldb_generation_get   Backend generations
+ */
+int
+clicon_rpc_get_cond(clicon_handle   h, 
+                    char           *xpath,
+                    cvec           *nsc,
+                    int32_t         depth,
+                    char           *defaults,
+                    uint64_t        ifgen,
+                    struct timeval *ifsince,
+                    uint64_t       *gen,
+                    struct timeval *lastmod,
+                    cxobj         **xt)
+{
+    int                retval = -1;
+    struct clicon_msg *msg = NULL;
+    cbuf              *cb = NULL;
+    cxobj             *xret = NULL;
+    cxobj             *xerr = NULL;    
+    cxobj             *xd = NULL;
+    cxobj             *xa;
+    uint32_t           session_id;
+    int                ret;
+    yang_stmt         *yspec;
+    cvec              *nscd = NULL;
+    char              *username;
+    char              *str;
+    char              *reason = NULL;
+    char               timestr[28];
+    int                notmod = 0;
+
+    *gen = 0;
+    memset(lastmod, 0, sizeof(*lastmod));
+    if (session_id_check(h, &session_id) < 0)
+        goto done;
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_XML, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "<rpc xmlns=\"%s\"", NETCONF_BASE_NAMESPACE);
+    cprintf(cb, " xmlns:%s=\"%s\"", CLIXON_LIB_PREFIX, CLIXON_LIB_NS);
+    if ((username = clicon_username_get(h)) != NULL)
+        cprintf(cb, " %s:username=\"%s\"", CLIXON_LIB_PREFIX, username);
+    cprintf(cb, " xmlns:%s=\"%s\"",
+            NETCONF_BASE_PREFIX, NETCONF_BASE_NAMESPACE);
+    cprintf(cb, " %s", NETCONF_MESSAGE_ID_ATTR); /* XXX: use incrementing sequence */
+    cprintf(cb, "><get");
+    /* Clixon extension, content=config */
+    cprintf(cb, " %s:content=\"%s\"", CLIXON_LIB_PREFIX, netconf_content_int2str(CONTENT_CONFIG));
+    /* Clixon extension, depth=<level> */
+    if (depth != -1)
+        cprintf(cb, " %s:depth=\"%d\"", CLIXON_LIB_PREFIX, depth);
+    /* Clixon extension, if-generation=<gen> or if-modified-since=<time> */
+    if (ifgen != 0 || ifsince == NULL)
+        cprintf(cb, " %s:if-generation=\"%" PRIu64 "\"", CLIXON_LIB_PREFIX, ifgen);
+    else {
+        if (time2str(*ifsince, timestr, sizeof(timestr)) < 0){
+            clicon_err(OE_UNIX, errno, "time2str");
+            goto done;
+        }
+        cprintf(cb, " %s:if-modified-since=\"%s\"", CLIXON_LIB_PREFIX, timestr);
+    }
+    cprintf(cb, ">"); /* get */
+    if (xpath && strlen(xpath)){
+        cprintf(cb, "<%s:filter %s:type=\"xpath\" %s:select=\"%s\"",
+                NETCONF_BASE_PREFIX, NETCONF_BASE_PREFIX, NETCONF_BASE_PREFIX,
+                xpath);
+        if (xml_nsctx_cbuf(cb, nsc) < 0)
+            goto done;
+        cprintf(cb, "/>");
+    }
+    if (defaults != NULL)
+        cprintf(cb, "<with-defaults xmlns=\"%s\">%s</with-defaults>",
+                IETF_NETCONF_WITH_DEFAULTS_YANG_NAMESPACE,
+                defaults);
+    cprintf(cb, "</get></rpc>");
+    if ((msg = clicon_msg_encode(session_id, "%s", cbuf_get(cb))) == NULL)
+        goto done;
+    if (clicon_rpc_msg(h, msg, &xret) < 0)
+        goto done;
+    yspec = clicon_dbspec_yang(h);
+    /* Send xml error back: first check error, then ok */
+    if ((xd = xpath_first(xret, NULL, "/rpc-reply/rpc-error")) != NULL)
+        xd = xml_parent(xd); /* point to rpc-reply */
+    else if ((xd = xpath_first(xret, NULL, "/rpc-reply/data")) == NULL){
+        if ((xd = xml_new(NETCONF_OUTPUT_DATA, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if (xml_bind_special(xd, yspec, "/nc:get/output/data") < 0)
+            goto done;
+    }
+    else{
+        /* Generation attributes, remove them from data */
+        if ((str = xml_find_type_value(xd, CLIXON_LIB_PREFIX, "generation", CX_ATTR)) != NULL &&
+            parse_uint64(str, gen, &reason) < 1){
+            clicon_err(OE_XML, EINVAL, "Invalid generation: %s", str);
+            goto done;
+        }
+        if ((str = xml_find_type_value(xd, CLIXON_LIB_PREFIX, "last-modified", CX_ATTR)) != NULL &&
+            str2time(str, lastmod) < 0){
+            clicon_err(OE_XML, EINVAL, "Invalid last-modified: %s", str);
+            goto done;
+        }
+        if ((str = xml_find_type_value(xd, CLIXON_LIB_PREFIX, "not-modified", CX_ATTR)) != NULL &&
+            strcmp(str, "true") == 0)
+            notmod++;
+        xa = NULL;
+        while ((xa = xml_child_each(xd, xa, CX_ATTR)) != NULL) {
+            if ((xml_prefix(xa) && strcmp(xml_prefix(xa), CLIXON_LIB_PREFIX) == 0) ||
+                (xml_prefix(xa) && strcmp(xml_prefix(xa), "xmlns") == 0 &&
+                 strcmp(xml_name(xa), CLIXON_LIB_PREFIX) == 0)){
+                if (xml_purge(xa) < 0)
+                    goto done;
+                xa = NULL;
+            }
+        }
+        if (notmod)
+            goto notmodified;
+        if (xml_bind_special(xd, yspec, "/nc:get/output/data") < 0)
+            goto done;
+        if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
+            goto done;
+        if (ret == 0){
+            if (clixon_netconf_internal_error(xerr,
+                                              ". Internal error, backend returned invalid XML.",
+                                              NULL) < 0)
+                goto done;
+            if ((xd = xpath_first(xerr, NULL, "rpc-error")) == NULL){
+                clicon_err(OE_XML, ENOENT, "Expected rpc-error tag but none found(internal)");
+                goto done;
+            }
+        }
+    }
+    if (xt && xd){
+        /* Sync namespaces, ie explicitly set all xmlns attributes to xd */
+        if (xml_nsctx_node(xd, &nscd) < 0)
+            goto done;
+        if (xml_rm(xd) < 0)
+            goto done;
+        if (xmlns_set_all(xd, nscd) < 0)
+            goto done;
+        xml_sort(xd); /* Ensure attr is first */
+        *xt = xd;
+    }
+    retval = 1;
+  done:
+    if (reason)
+        free(reason);
+    if (nscd)
+        cvec_free(nscd);
+    if (cb)
+        cbuf_free(cb);
+    if (xerr)
+        xml_free(xerr);
+    if (xret)
+        xml_free(xret);
+    if (msg)
+        free(msg);
+    return retval;
+ notmodified:
+    retval = 0;
+    goto done;
+}
+
 /*! Get database configuration and state data collection
  *
  * @param[in]  h         Clicon handle
@@ -1075,6 +1269,9 @@ clicon_rpc_get(clicon_handle   h,
  * @param[in]  direction Collection/clixon extension
  * @param[in]  sort      Collection/clixon extension
  * @param[in]  where     Collection/clixon extension
+ * @param[in]  cursor    Clixon extension: cursor token of list snapshot, "" for new, or NULL
+ * @param[out] next      Cursor token of next page if cursor is given and there are more
+ *                       entries, or NULL. Free with free
  * @param[out] xt        XML tree. Free with xml_free. 
  *                       Either <config> or <rpc-error>. 
  * @retval    0          OK
@@ -1096,6 +1293,8 @@ clicon_rpc_get_pageable_list(clicon_handle   h,
                              char           *direction,
                              char           *sort,
                              char           *where,
+                             char           *cursor,
+                             char          **next,
                              cxobj         **xt)
 {
     int                retval = -1;
@@ -1109,11 +1308,19 @@ clicon_rpc_get_pageable_list(clicon_handle   h,
     int                ret;
     yang_stmt         *yspec;
     cvec              *nscd = NULL;
+    char              *str;
     
+    if (next)
+        *next = NULL;
     if (datastore == NULL){
         clicon_err(OE_XML, EINVAL, "datastore not given");
         goto done;
     }
+    /* Cursor is given by client, eg restconf query, and is inserted as an attribute value */
+    if (cursor != NULL && strspn(cursor, CLIXON_CURSOR_CHARS) != strlen(cursor)){
+        clicon_err(OE_XML, EINVAL, "Invalid list pagination cursor");
+        goto done;
+    }
     if (session_id_check(h, &session_id) < 0)
         goto done;
     if ((cb = cbuf_new()) == NULL){
@@ -1141,6 +1348,12 @@ clicon_rpc_get_pageable_list(clicon_handle   h,
                 CLIXON_LIB_PREFIX, 
                 depth,
                 CLIXON_LIB_PREFIX, CLIXON_LIB_NS);
+    /* Clixon extension, cursor=<token> */
+    if (cursor != NULL)
+        cprintf(cb, " %s:cursor=\"%s\" xmlns:%s=\"%s\"",
+                CLIXON_LIB_PREFIX, 
+                cursor,
+                CLIXON_LIB_PREFIX, CLIXON_LIB_NS);
     /* declare lp prefix in get, so sub-elements dont need to */
     cprintf(cb, ">"); /* get */
     /* If xpath, add a filter */
@@ -1176,6 +1389,14 @@ clicon_rpc_get_pageable_list(clicon_handle   h,
     if (clicon_rpc_msg(h, msg, &xret) < 0)
         goto done;
     yspec = clicon_dbspec_yang(h);
+    /* Cursor token of next page */
+    if (next &&
+        (xd = xpath_first(xret, NULL, "/rpc-reply")) != NULL &&
+        (str = xml_find_value(xd, "next-cursor")) != NULL &&
+        (*next = strdup(str)) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
     /* Send xml error back: first check error, then ok */
     if ((xd = xpath_first(xret, NULL, "/rpc-reply/rpc-error")) != NULL)
         xd = xml_parent(xd); /* point to rpc-reply */
@@ -1214,6 +1435,10 @@ clicon_rpc_get_pageable_list(clicon_handle   h,
     }
     retval = 0;
   done:
+    if (retval < 0 && next && *next){
+        free(*next);
+        *next = NULL;
+    }
     if (nscd)
         cvec_free(nscd);
     if (cb)
@@ -65,6 +65,7 @@
 #include <inttypes.h>
 #include <syslog.h>
 #include <sys/time.h>
+#include <sys/socket.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -80,7 +81,9 @@
 #include "clixon_yang.h"
 #include "clixon_xml.h"
 #include "clixon_xml_io.h"
+#include "clixon_xml_nsctx.h"
 #include "clixon_netconf_lib.h"
+#include "clixon_proto.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_xpath_ctx.h"
@@ -90,6 +93,335 @@
 /* Go through and timeout subscription timers [s] */
 #define STREAM_TIMER_TIMEOUT_S 5
 
+/* Marks of subscriptions during dispatch of one or several events, see ss_pending */
+#define STREAM_SS_FLUSH   0x01 /* Events delivered, flush when dispatch is done */
+#define STREAM_SS_EXPIRED 0x02 /* Stoptime has passed, remove when dispatch is done */
+
+/* Name of handle pointer to serialized event cache */
+#define STREAM_EVENT_CACHE "stream-event-cache"
+
+/* Serialized form of the event currently distributed to subscribers, so that an event
+ * is only serialized once regardless of the number of subscribers
+ * @see stream_event_cache
+ */
+struct stream_event_cache{
+    cxobj             *sec_xevent; /* Event, only used for identity */
+    cbuf              *sec_cb;     /* Event as XML string */
+    struct clicon_msg *sec_msg;    /* Event encoded as notify message, or NULL */
+};
+
+/*! Get name of the notification child a parsed filter requires to match
+ *
+ * A filter matches if it evaluates to a non-empty node-set with the notification as
+ * context. If the first step of the filter selects children by name, such as
+ * "event/severity" or "/ex:event[ex:severity='major']", a notification can only match if
+ * it has a child with that name.
+ * @param[in]  xpt   Parsed xpath
+ * @retval     name  Name of required notification child (points into xpt)
+ * @retval     NULL  Filter may match any notification
+ */
+static char *
+stream_filter_key(xpath_tree *xpt)
+{
+    xpath_tree *xs = xpt;
+
+    /* Skip expression levels with only one operand */
+    while (xs && xs->xs_c1 == NULL &&
+           (xs->xs_type == XP_EXP ||
+            xs->xs_type == XP_AND ||
+            xs->xs_type == XP_RELEX ||
+            xs->xs_type == XP_ADD ||
+            xs->xs_type == XP_UNION ||
+            xs->xs_type == XP_PATHEXPR ||
+            xs->xs_type == XP_LOCPATH))
+        xs = xs->xs_c0;
+    if (xs == NULL)
+        return NULL;
+    if (xs->xs_type == XP_ABSPATH){
+        if (xs->xs_int != A_ROOT)
+            return NULL;
+        xs = xs->xs_c0;
+    }
+    /* Leftmost step of relative location path */
+    while (xs && xs->xs_type == XP_RELLOCPATH)
+        xs = xs->xs_c0;
+    if (xs == NULL || xs->xs_type != XP_STEP || xs->xs_int != A_CHILD)
+        return NULL;
+    if ((xs = xs->xs_c0) == NULL ||
+        xs->xs_type != XP_NODE ||
+        xs->xs_s1 == NULL ||
+        strcmp(xs->xs_s1, "*") == 0)
+        return NULL;
+    return xs->xs_s1;
+}
+
+/*! Get head of filter list in a stream given an index key
+ *
+ * @param[in]  es     Event stream
+ * @param[in]  key    Index key, or NULL for filters without key
+ * @param[in]  create If set, create index entry if not found
+ * @retval     head   Pointer to head of filter list
+ * @retval     NULL   Not found, or error if create is set
+ */
+static struct stream_filter **
+stream_filter_head(event_stream_t *es,
+                   char           *key,
+                   int             create)
+{
+    struct stream_filter *sf = NULL;
+    void                 *p;
+
+    if (key == NULL)
+        return &es->es_wildcard;
+    if (es->es_index == NULL){
+        if (!create)
+            return NULL;
+        if ((es->es_index = clicon_hash_init()) == NULL)
+            return NULL;
+    }
+    if ((p = clicon_hash_value(es->es_index, key, NULL)) == NULL){
+        if (!create)
+            return NULL;
+        if (clicon_hash_add(es->es_index, key, &sf, sizeof(sf)) == NULL)
+            return NULL;
+        p = clicon_hash_value(es->es_index, key, NULL);
+    }
+    return (struct stream_filter **)p;
+}
+
+/*! Free a stream filter
+ */
+static int
+stream_filter_free(struct stream_filter *sf)
+{
+    if (sf->sf_xpath)
+        free(sf->sf_xpath);
+    if (sf->sf_xptree)
+        xpath_tree_free(sf->sf_xptree);
+    if (sf->sf_key)
+        free(sf->sf_key);
+    if (sf->sf_vec)
+        free(sf->sf_vec);
+    free(sf);
+    return 0;
+}
+
+/*! Free all filters and the filter index of a stream
+ * @param[in]  es   Event stream
+ */
+static int
+stream_filter_free_all(event_stream_t *es)
+{
+    struct stream_filter  *sf;
+    struct stream_filter **head;
+    char                 **keys = NULL;
+    size_t                 klen = 0;
+    int                    i;
+
+    if (es->es_index){
+        if (clicon_hash_keys(es->es_index, &keys, &klen) == 0)
+            for (i=0; i<klen; i++){
+                if ((head = stream_filter_head(es, keys[i], 0)) == NULL)
+                    continue;
+                while ((sf = *head) != NULL){
+                    *head = sf->sf_next;
+                    stream_filter_free(sf);
+                }
+            }
+        if (keys)
+            free(keys);
+        clicon_hash_free(es->es_index);
+        es->es_index = NULL;
+    }
+    while ((sf = es->es_wildcard) != NULL){
+        es->es_wildcard = sf->sf_next;
+        stream_filter_free(sf);
+    }
+    return 0;
+}
+
+/*! Find or create a compiled filter in a stream and add a subscription to it
+ *
+ * Subscriptions with the same filter selector share the filter, so that the xpath is
+ * parsed once and evaluated once per event.
+ * @param[in]  es     Event stream
+ * @param[in]  ss     Subscription, ss_xpath is the filter selector
+ * @retval     0      OK, ss_filter set
+ * @retval    -1      Error, eg invalid xpath
+ */
+static int
+stream_filter_add(event_stream_t             *es,
+                  struct stream_subscription *ss)
+{
+    int                          retval = -1;
+    char                        *xpath = ss->ss_xpath;
+    xpath_tree                  *xpt = NULL;
+    char                        *key = NULL;
+    struct stream_filter       **head;
+    struct stream_filter        *sf;
+    struct stream_subscription **vec;
+
+    if (xpath && strlen(xpath) == 0)
+        xpath = NULL;
+    if (xpath != NULL){
+        if (xpath_parse(xpath, &xpt) < 0)
+            goto done;
+        key = stream_filter_key(xpt);
+    }
+    if ((head = stream_filter_head(es, key, 1)) == NULL)
+        goto done;
+    for (sf = *head; sf; sf = sf->sf_next)
+        if (clicon_strcmp(sf->sf_xpath, xpath) == 0)
+            break;
+    if (sf == NULL){
+        if ((sf = malloc(sizeof(*sf))) == NULL){
+            clicon_err(OE_CFG, errno, "malloc");
+            goto done;
+        }
+        memset(sf, 0, sizeof(*sf));
+        if ((xpath && (sf->sf_xpath = strdup(xpath)) == NULL) ||
+            (key && (sf->sf_key = strdup(key)) == NULL)){
+            clicon_err(OE_CFG, errno, "strdup");
+            stream_filter_free(sf);
+            goto done;
+        }
+        sf->sf_xptree = xpt;
+        xpt = NULL;
+        sf->sf_next = *head;
+        *head = sf;
+    }
+    if ((vec = realloc(sf->sf_vec, (sf->sf_len+1)*sizeof(*vec))) == NULL){
+        clicon_err(OE_CFG, errno, "realloc");
+        goto done;
+    }
+    sf->sf_vec = vec;
+    sf->sf_vec[sf->sf_len++] = ss;
+    ss->ss_filter = sf;
+    retval = 0;
+ done:
+    if (xpt)
+        xpath_tree_free(xpt);
+    return retval;
+}
+
+/*! Remove a subscription from its filter, and free the filter if not used anymore
+ * @param[in]  es   Event stream
+ * @param[in]  ss   Subscription
+ */
+static int
+stream_filter_rm(event_stream_t             *es,
+                 struct stream_subscription *ss)
+{
+    struct stream_filter  *sf;
+    struct stream_filter **head;
+    struct stream_filter **sfp;
+    int                    i;
+
+    if ((sf = ss->ss_filter) == NULL)
+        return 0;
+    ss->ss_filter = NULL;
+    for (i=0; i<sf->sf_len; i++)
+        if (sf->sf_vec[i] == ss){
+            memmove(&sf->sf_vec[i], &sf->sf_vec[i+1], (sf->sf_len-i-1)*sizeof(*sf->sf_vec));
+            sf->sf_len--;
+            break;
+        }
+    if (sf->sf_len > 0)
+        return 0;
+    if ((head = stream_filter_head(es, sf->sf_key, 0)) != NULL){
+        for (sfp = head; *sfp; sfp = &(*sfp)->sf_next)
+            if (*sfp == sf){
+                *sfp = sf->sf_next;
+                break;
+            }
+        if (*head == NULL && sf->sf_key)
+            clicon_hash_del(es->es_index, sf->sf_key);
+    }
+    stream_filter_free(sf);
+    return 0;
+}
+
+/*! Get a replay buffer event given its position
+ * @param[in]  es   Event stream
+ * @param[in]  i    Position of event, 0 is the oldest
+ * @param[out] idx  Index of event in returned segment
+ * @retval     r    Replay buffer segment
+ */
+static struct stream_replay *
+stream_replay_at(event_stream_t *es,
+                 size_t          i,
+                 int            *idx)
+{
+    /* Only the first segment has dropped events and only the last is not full */
+    i += es->es_replay[0]->r_first;
+    *idx = i % STREAM_REPLAY_SEGMENT;
+    return es->es_replay[i / STREAM_REPLAY_SEGMENT];
+}
+
+/*! Find position of the first replay buffer event at or after a time using binary search
+ * @param[in]  es   Event stream
+ * @param[in]  tv   Timestamp
+ * @retval     i    Position of event, es_replay_len if no such event
+ */
+static size_t
+stream_replay_find(event_stream_t *es,
+                   struct timeval *tv)
+{
+    size_t                lo = 0;
+    size_t                hi = es->es_replay_len;
+    size_t                mid;
+    struct stream_replay *r;
+    int                   idx;
+
+    while (lo < hi){
+        mid = lo + (hi - lo)/2;
+        r = stream_replay_at(es, mid, &idx);
+        if (timercmp(&r->r_tv[idx], tv, <))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/*! Drop the oldest event from the replay buffer of a stream
+ * @param[in]  es   Event stream
+ */
+static int
+stream_replay_drop(event_stream_t *es)
+{
+    struct stream_replay *r;
+
+    if (es->es_replay_len == 0)
+        return 0;
+    r = es->es_replay[0];
+    es->es_replay_bytes -= strlen(r->r_str[r->r_first]);
+    free(r->r_str[r->r_first]);
+    r->r_str[r->r_first++] = NULL;
+    es->es_replay_len--;
+    if (r->r_first == r->r_len){ /* Segment is empty */
+        free(r);
+        es->es_replay_nr--;
+        memmove(&es->es_replay[0], &es->es_replay[1], es->es_replay_nr*sizeof(r));
+    }
+    return 0;
+}
+
+/*! Free the replay buffer of a stream
+ * @param[in]  es   Event stream
+ */
+static int
+stream_replay_free(event_stream_t *es)
+{
+    while (es->es_replay_len)
+        stream_replay_drop(es);
+    if (es->es_replay){
+        free(es->es_replay);
+        es->es_replay = NULL;
+    }
+    return 0;
+}
+
 /*! Find an event notification stream given name
  * @param[in]  h    Clicon handle
  * @param[in]  name Name of stream
@@ -148,6 +480,10 @@ stream_add(clicon_handle   h,
     es->es_replay_enabled = replay_enabled;
     if (retention)
         es->es_retention = *retention;
+    if (clicon_option_exists(h, "CLICON_STREAM_REPLAY_MAX"))
+        es->es_replay_max = clicon_option_int(h, "CLICON_STREAM_REPLAY_MAX");
+    if (clicon_option_exists(h, "CLICON_STREAM_REPLAY_BYTES"))
+        es->es_replay_maxbytes = clicon_option_int(h, "CLICON_STREAM_REPLAY_BYTES");
     clicon_stream_append(h, es);
  ok:
     retval = 0;
@@ -163,7 +499,6 @@ int
 stream_delete_all(clicon_handle h,
                   int           force)
 {
-    struct stream_replay *r;
     struct stream_subscription *ss;
     event_stream_t       *es;
     event_stream_t       *head = clicon_stream(h);
@@ -177,14 +512,11 @@ stream_delete_all(clicon_handle h,
             free(es->es_description);
         while ((ss = es->es_subscription) != NULL)
             stream_ss_rm(h, es, ss, force); /* XXX in some cases leaks memory due to DONT clause in stream_ss_rm() */
-        while ((r = es->es_replay) != NULL){
-            DELQ(r, es->es_replay, struct stream_replay *);
-            if (r->r_xml)
-                xml_free(r->r_xml);
-            free(r);
-        }
+        stream_filter_free_all(es);
+        stream_replay_free(es);
         free(es);
     }
+    stream_event_cache_clear(h);
     return 0;
 }
 
@@ -248,8 +580,7 @@ stream_timer_setup(int   fd,
     event_stream_t              *es;
     struct stream_subscription  *ss;
     struct stream_subscription  *ss1;
-    struct stream_replay        *r;
-    struct stream_replay        *r1;
+    size_t                       n;
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     /* Go thru callbacks and see if any have timed out, if so remove them 
@@ -277,21 +608,11 @@ stream_timer_setup(int   fd,
                         ss = NEXTQ(struct stream_subscription *, ss);
                 } while (ss && ss != es->es_subscription);
   /* 2) Go throughreplay buffer and remove entries with passed retention time */
-            if (timerisset(&es->es_retention) &&
-                (r = es->es_replay) != NULL){
+            if (timerisset(&es->es_retention) && es->es_replay_len){
                 timersub(&now, &es->es_retention, &tret);
-                do {
-                    if (timercmp(&r->r_tv, &tret, <)){
-                        r1 = NEXTQ(struct stream_replay *, r);
-                        DELQ(r, es->es_replay, struct stream_replay *);
-                        if (r->r_xml)
-                            xml_free(r->r_xml);
-                        free(r);
-                        r = r1;
-                    }
-                    else
-                        r = NEXTQ(struct stream_replay *, r);
-                } while (r && r!=es->es_replay);
+                n = stream_replay_find(es, &tret);
+                while (n--)
+                    stream_replay_drop(es);
             }
             es = NEXTQ(struct event_stream *, es);
         } while (es && es != clicon_stream(h));
@@ -327,8 +648,9 @@ stream_del()
  * @param[in]  stoptime If set, dont continue past this time
  * @param[in]  fn       Callback when event occurs
  * @param[in]  arg      Argument to use with callback. Also handle when deleting
- * @retval     0        OK
- * @retval     -1       Error, ie no such stream 
+ * @retval     ss       Subscription
+ * @retval     NULL     Error, ie no such stream or invalid filter xpath
+ * The filter is parsed here and shared with other subscriptions with the same filter.
  */
 struct stream_subscription *
 stream_ss_add(clicon_handle     h,
@@ -366,11 +688,18 @@ stream_ss_add(clicon_handle     h,
     }
     ss->ss_fn     = fn;
     ss->ss_arg    = arg;
+    if (stream_filter_add(es, ss) < 0)
+        goto done;
     ADDQ(ss, es->es_subscription);
     return ss;
   done:
-    if (ss)
+    if (ss){
+        if (ss->ss_stream)
+            free(ss->ss_stream);
+        if (ss->ss_xpath)
+            free(ss->ss_xpath);
         free(ss);
+    }
     return NULL;
 }
 
@@ -390,6 +719,7 @@ stream_ss_rm(clicon_handle                h,
 {
     clicon_debug(1, "%s", __FUNCTION__);
     DELQ(ss, es->es_subscription, struct stream_subscription *);
+    stream_filter_rm(es, ss);
     /* Remove from upper layers - close socket etc. */
     (*ss->ss_fn)(h, 1, NULL, ss->ss_arg);
     if (force){
@@ -483,49 +813,457 @@ stream_ss_delete(clicon_handle     h,
     return retval;
 }
 
+/*! Evaluate a compiled filter on an event and add its subscriptions if it matches
+ * @param[in]     sf     Stream filter
+ * @param[in]     xevent Notification as xml tree
+ * @param[in,out] vecp   Vector of matching subscriptions
+ * @param[in,out] lenp   Length of vector
+ * @retval        0      OK
+ * @retval       -1      Error
+ */
+static int
+stream_filter_match(struct stream_filter          *sf,
+                    cxobj                         *xevent,
+                    struct stream_subscription  ***vecp,
+                    size_t                        *lenp)
+{
+    struct stream_subscription **vec;
+
+    if (sf->sf_len == 0)
+        return 0;
+    if (sf->sf_xptree != NULL &&
+        xpath_first_tree(xevent, NULL, sf->sf_xptree) == NULL)
+        return 0;
+    if ((vec = realloc(*vecp, (*lenp+sf->sf_len)*sizeof(*vec))) == NULL){
+        clicon_err(OE_UNIX, errno, "realloc");
+        return -1;
+    }
+    memcpy(&vec[*lenp], sf->sf_vec, sf->sf_len*sizeof(*vec));
+    *vecp = vec;
+    *lenp += sf->sf_len;
+    return 0;
+}
+
+/*! Check if a subscription is still registered in a stream
+ */
+static int
+stream_ss_exists(event_stream_t             *es,
+                 struct stream_subscription *ss)
+{
+    struct stream_subscription *ss1;
+
+    if ((ss1 = es->es_subscription) != NULL)
+        do {
+            if (ss1 == ss)
+                return 1;
+            ss1 = NEXTQ(struct stream_subscription *, ss1);
+        } while (ss1 && ss1 != es->es_subscription);
+    return 0;
+}
+
+/*! Get serialized event cache, create it if it does not exist
+ * @param[in]  h      Clicon handle
+ * @retval     sec    Serialized event cache
+ * @retval     NULL   Error
+ */
+static struct stream_event_cache *
+stream_event_cache_get(clicon_handle h)
+{
+    struct stream_event_cache *sec = NULL;
+
+    if (clicon_ptr_get(h, STREAM_EVENT_CACHE, (void**)&sec) == 0 && sec != NULL)
+        return sec;
+    if ((sec = malloc(sizeof(*sec))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(sec, 0, sizeof(*sec));
+    if ((sec->sec_cb = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        free(sec);
+        return NULL;
+    }
+    if (clicon_ptr_set(h, STREAM_EVENT_CACHE, sec) < 0){
+        cbuf_free(sec->sec_cb);
+        free(sec);
+        return NULL;
+    }
+    return sec;
+}
+
+/*! Set serialized form of an event already serialized, eg from the replay buffer
+ * @param[in]  h      Clicon handle
+ * @param[in]  xevent Notification as xml tree
+ * @param[in]  str    Notification as XML string
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+stream_event_cache_set(clicon_handle h,
+                       cxobj        *xevent,
+                       char         *str)
+{
+    struct stream_event_cache *sec;
+
+    if ((sec = stream_event_cache_get(h)) == NULL)
+        return -1;
+    cbuf_reset(sec->sec_cb);
+    if (sec->sec_msg){
+        free(sec->sec_msg);
+        sec->sec_msg = NULL;
+    }
+    cbuf_append_str(sec->sec_cb, str);
+    sec->sec_xevent = xevent;
+    return 0;
+}
+
+/*! Get serialized form of an event being distributed to subscribers
+ *
+ * The event is serialized once and the same buffers are shared by all subscribers
+ * the event is sent to. The cache is cleared after an event is distributed.
+ * @param[in]  h      Clicon handle
+ * @param[in]  xevent Notification as xml tree
+ * @param[out] cbp    Event as XML string, or NULL (owned by the cache)
+ * @param[out] msgp   Event encoded as clicon notify message, or NULL (owned by the cache)
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @code
+ *   struct clicon_msg *msg;
+ *   if (stream_event_cache(h, xevent, NULL, &msg) < 0)
+ *      err;
+ *   if (clicon_msg_send(s, msg) < 0)
+ *      err;
+ * @endcode
+ * @see stream_event_cache_clear
+ */
+int
+stream_event_cache(clicon_handle       h,
+                   cxobj              *xevent,
+                   cbuf              **cbp,
+                   struct clicon_msg **msgp)
+{
+    int                       retval = -1;
+    struct stream_event_cache *sec;
+
+    if ((sec = stream_event_cache_get(h)) == NULL)
+        goto done;
+    if (sec->sec_xevent != xevent){
+        sec->sec_xevent = NULL;
+        cbuf_reset(sec->sec_cb);
+        if (sec->sec_msg){
+            free(sec->sec_msg);
+            sec->sec_msg = NULL;
+        }
+        if (clixon_xml2cbuf(sec->sec_cb, xevent, 0, 0, -1, 0) < 0)
+            goto done;
+        sec->sec_xevent = xevent;
+    }
+    if (msgp && sec->sec_msg == NULL &&
+        (sec->sec_msg = clicon_msg_encode(0, "%s", cbuf_get(sec->sec_cb))) == NULL)
+        goto done;
+    if (cbp)
+        *cbp = sec->sec_cb;
+    if (msgp)
+        *msgp = sec->sec_msg;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Clear serialized event cache
+ * @param[in]  h      Clicon handle
+ * @see stream_event_cache
+ */
+int
+stream_event_cache_clear(clicon_handle h)
+{
+    struct stream_event_cache *sec = NULL;
+
+    if (clicon_ptr_get(h, STREAM_EVENT_CACHE, (void**)&sec) < 0 || sec == NULL)
+        return 0;
+    if (sec->sec_cb)
+        cbuf_free(sec->sec_cb);
+    if (sec->sec_msg)
+        free(sec->sec_msg);
+    free(sec);
+    clicon_ptr_del(h, STREAM_EVENT_CACHE);
+    return 0;
+}
+
+/*! Mark a subscription for action when dispatch is done
+ * @param[in]     ss     Subscription
+ * @param[in]     flag   STREAM_SS_FLUSH or STREAM_SS_EXPIRED
+ * @param[in,out] vecp   Vector of marked subscriptions
+ * @param[in,out] lenp   Length of vector
+ */
+static int
+stream_ss_mark(struct stream_subscription   *ss,
+               int                           flag,
+               struct stream_subscription ***vecp,
+               size_t                       *lenp)
+{
+    struct stream_subscription **vec;
+
+    if (ss->ss_pending == 0){
+        if ((vec = realloc(*vecp, (*lenp+1)*sizeof(*vec))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+        vec[(*lenp)++] = ss;
+        *vecp = vec;
+    }
+    ss->ss_pending |= flag;
+    return 0;
+}
+
 /*! Stream notify event and distribute to all registered callbacks
- * @param[in]  h       Clicon handle
- * @param[in]  stream  Name of event stream. CLICON is predefined as LOG stream
- * @param[in]  tv      Timestamp. Dont notify if subscription has stoptime<tv
- * @param[in]  event   Notification as xml tree
+ *
+ * Matching subscriptions are called with the event, and are marked to be flushed, or
+ * removed if their stoptime has passed, when all events are dispatched.
+ * @param[in]     h       Clicon handle
+ * @param[in]     es      Event stream
+ * @param[in]     tv      Timestamp. Dont notify if subscription has stoptime<tv
+ * @param[in]     xevent  Notification as xml tree
+ * @param[in,out] pvecp   Vector of marked subscriptions, see stream_dispatch_done
+ * @param[in,out] plenp   Length of vector
  * @retval  0  OK
  * @retval -1  Error with clicon_err called
  * @see stream_notify
+ * @see stream_dispatch_done
  * @see stream_ss_timeout where subscriptions are removed if stoptime<now
  */
 static int
-stream_notify1(clicon_handle   h, 
-               event_stream_t *es,
-               struct timeval *tv,
-               cxobj          *xevent)
+stream_notify1(clicon_handle                 h, 
+               event_stream_t               *es,
+               struct timeval               *tv,
+               cxobj                        *xevent,
+               struct stream_subscription ***pvecp,
+               size_t                       *plenp)
 {
-    int                         retval = -1;
-    struct stream_subscription *ss;
+    int                          retval = -1;
+    struct stream_subscription **vec = NULL;
+    size_t                       len = 0;
+    struct stream_subscription  *ss;
+    struct stream_filter        *sf;
+    cxobj                       *xc;
+    cxobj                       *xp;
+    void                        *p;
+    int                          i;
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
-    /* Go thru all subscriptions and find matches */
-    if ((ss = es->es_subscription) != NULL)
-        do {
-            if (timerisset(&ss->ss_stoptime) && /* stoptime has passed */
-                timercmp(&ss->ss_stoptime, tv, <)){
-                struct stream_subscription *ss1;
-                ss1 = NEXTQ(struct stream_subscription *, ss);
-                /* Signal to remove stream for upper levels */
-                if (stream_ss_rm(h, es, ss, 1) < 0)
+    /* Find matching subscriptions, first filters indexed on a child name of the event */
+    if (es->es_index){
+        xc = NULL;
+        while ((xc = xml_child_each(xevent, xc, CX_ELMNT)) != NULL){
+            /* Only look up a name once */
+            xp = NULL;
+            while ((xp = xml_child_each(xevent, xp, CX_ELMNT)) != xc &&
+                   strcmp(xml_name(xp), xml_name(xc)) != 0)
+                ;
+            if (xp != xc)
+                continue;
+            if ((p = clicon_hash_value(es->es_index, xml_name(xc), NULL)) == NULL)
+                continue;
+            for (sf = *(struct stream_filter **)p; sf; sf = sf->sf_next)
+                if (stream_filter_match(sf, xevent, &vec, &len) < 0)
                     goto done;
-                ss = ss1;
-            }
-            else{  /* xpath match */
-                if (ss->ss_xpath == NULL ||
-                    strlen(ss->ss_xpath)==0 ||
-                    xpath_first(xevent, NULL, "%s", ss->ss_xpath) != NULL)
-                    if ((*ss->ss_fn)(h, 0, xevent, ss->ss_arg) < 0)
-                        goto done;
-                ss = NEXTQ(struct stream_subscription *, ss);
-            }
-        } while (es->es_subscription && ss != es->es_subscription);
+        }
+    }
+    /* Then filters that may match any event */
+    for (sf = es->es_wildcard; sf; sf = sf->sf_next)
+        if (stream_filter_match(sf, xevent, &vec, &len) < 0)
+            goto done;
+    /* Notify matching subscriptions whose stoptime has not passed */
+    for (i=0; i<len; i++){
+        ss = vec[i];
+        if (timerisset(&ss->ss_stoptime) && timercmp(&ss->ss_stoptime, tv, <)){
+            if (stream_ss_mark(ss, STREAM_SS_EXPIRED, pvecp, plenp) < 0)
+                goto done;
+            continue;
+        }
+        if ((*ss->ss_fn)(h, 0, xevent, ss->ss_arg) < 0)
+            goto done;
+        if (stream_ss_mark(ss, STREAM_SS_FLUSH, pvecp, plenp) < 0)
+            goto done;
+    }
     retval = 0;
   done:
+    stream_event_cache_clear(h);
+    if (vec)
+        free(vec);
+    return retval;
+}
+
+/*! Finish dispatch of one or several events
+ *
+ * Subscriptions that got events are flushed, and subscriptions whose stoptime has passed
+ * are removed.
+ * @param[in]  h      Clicon handle
+ * @param[in]  es     Event stream
+ * @param[in]  vec    Vector of marked subscriptions, see stream_notify1
+ * @param[in]  len    Length of vector
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+stream_dispatch_done(clicon_handle                h,
+                     event_stream_t              *es,
+                     struct stream_subscription **vec,
+                     size_t                       len)
+{
+    int                         retval = -1;
+    struct stream_subscription *ss;
+    size_t                      i;
+    size_t                      n = 0;
+
+    /* Subscriptions are not removed by flush */
+    for (i=0; i<len; i++){
+        ss = vec[i];
+        if ((ss->ss_pending & STREAM_SS_FLUSH) &&
+            (*ss->ss_fn)(h, 2, NULL, ss->ss_arg) < 0)
+            goto done;
+    }
+    /* Clear marks and keep subscriptions to remove */
+    for (i=0; i<len; i++){
+        ss = vec[i];
+        if (ss->ss_pending & STREAM_SS_EXPIRED)
+            vec[n++] = ss;
+        ss->ss_pending = 0;
+    }
+    len = 0;
+    /* Signal to remove subscriptions whose stoptime has passed for upper levels.
+     * Removing a subscription may remove others, so check it still exists */
+    for (i=0; i<n; i++){
+        ss = vec[i];
+        if (stream_ss_exists(es, ss) &&
+            stream_ss_rm(h, es, ss, 1) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    for (i=0; i<len; i++)
+        vec[i]->ss_pending = 0;
+    return retval;
+}
+
+/*! Create a notification given an event and timestamp
+ *
+ * @param[in]  xev   Event, is moved into the notification
+ * @param[in]  tv    Timestamp
+ * @param[out] xnp   Notification, free with xml_free
+ * @retval     0     OK
+ * @retval    -1     Error, xev is not moved
+ */
+static int
+stream_notification_new(cxobj          *xev,
+                        struct timeval *tv,
+                        cxobj         **xnp)
+{
+    int    retval = -1;
+    cxobj *xn = NULL;
+    cxobj *xt;
+    cxobj *xb;
+    char   timestr[28];
+
+    if (time2str(*tv, timestr, sizeof(timestr)) < 0){
+        clicon_err(OE_UNIX, errno, "time2str");
+        goto done;
+    }
+    /* From RFC5277 */
+    if ((xn = xml_new("notification", NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (xmlns_set(xn, NULL, NETCONF_NOTIFICATION_NAMESPACE) < 0)
+        goto done;
+    if ((xt = xml_new("eventTime", xn, CX_ELMNT)) == NULL)
+        goto done;
+    if ((xb = xml_new("body", xt, CX_BODY)) == NULL)
+        goto done;
+    if (xml_value_set(xb, timestr) < 0)
+        goto done;
+    if (xml_addsub(xn, xev) < 0)
+        goto done;
+    *xnp = xn;
+    xn = NULL;
+    retval = 0;
+ done:
+    if (xn)
+        xml_free(xn);
+    return retval;
+}
+
+/*! Stream notify a batch of events and distribute to all registered callbacks
+ *
+ * Events are given as XML trees and are not formatted and parsed as in stream_notify.
+ * Subscribers are flushed once when all events are distributed.
+ * @param[in]  h       Clicon handle
+ * @param[in]  stream  Name of event stream
+ * @param[in]  events  Vector of events, eg <event xmlns="urn:example">..</event>
+ *                     The events are taken over and freed, the vector itself is not
+ * @param[in]  tvs     Vector of event timestamps, or NULL for current time
+ * @param[in]  len     Number of events
+ * @retval  0  OK
+ * @retval -1  Error with clicon_err called
+ * @code
+ *  cxobj *vec[2];
+ *  // Create event trees with namespace declarations
+ *  if (stream_notify_vec(h, "EXAMPLE", vec, NULL, 2) < 0)
+ *    err;
+ * @endcode
+ * @see stream_notify  printf-style single event
+ */
+int
+stream_notify_vec(clicon_handle   h,
+                  char           *stream,
+                  cxobj         **events,
+                  struct timeval *tvs,
+                  size_t          len)
+{
+    int                          retval = -1;
+    event_stream_t              *es;
+    struct stream_subscription **vec = NULL;
+    size_t                       vlen = 0;
+    struct timeval               now;
+    struct timeval              *tv;
+    cxobj                       *xn = NULL;
+    size_t                       i = 0;
+    size_t                       n;
+
+    clicon_debug(CLIXON_DBG_DETAIL, "%s %zu", __FUNCTION__, len);
+    if ((es = stream_find(h, stream)) == NULL)
+        goto ok;
+    gettimeofday(&now, NULL);
+    for (i=0; i<len; i++){
+        tv = tvs ? &tvs[i] : &now;
+        if (stream_notification_new(events[i], tv, &xn) < 0)
+            goto done;
+        events[i] = NULL;
+        /* Add to replay buffer first, the serialized event is then reused by subscribers */
+        if (es->es_replay_enabled &&
+            stream_replay_add(h, es, tv, xn) < 0)
+            goto done;
+        if (stream_notify1(h, es, tv, xn, &vec, &vlen) < 0)
+            goto done;
+        xml_free(xn);
+        xn = NULL;
+    }
+    /* Marks are cleared by stream_dispatch_done */
+    n = vlen;
+    vlen = 0;
+    if (stream_dispatch_done(h, es, vec, n) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    stream_event_cache_clear(h);
+    for (; i<len; i++)
+        if (events[i])
+            xml_free(events[i]);
+    for (i=0; i<vlen; i++)
+        vec[i]->ss_pending = 0;
+    if (vec)
+        free(vec);
+    if (xn)
+        xml_free(xn);
     return retval;
 }
 
@@ -556,6 +1294,10 @@ stream_notify(clicon_handle h,
     char       timestr[28];
     struct timeval tv;
     event_stream_t *es;
+    struct stream_subscription **vec = NULL;
+    size_t     vlen = 0;
+    size_t     n;
+    size_t     i;
 
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     if ((es = stream_find(h, stream)) == NULL)
@@ -591,16 +1333,25 @@ stream_notify(clicon_handle h,
         goto done;
     if (xml_rootchild(xev, 0, &xev) < 0)
         goto done;
-    if (stream_notify1(h, es, &tv, xev) < 0)
+    /* Add to replay buffer first, the serialized event is then reused by subscribers */
+    if (es->es_replay_enabled &&
+        stream_replay_add(h, es, &tv, xev) < 0)
+        goto done;
+    if (stream_notify1(h, es, &tv, xev, &vec, &vlen) < 0)
+        goto done;
+    /* Marks are cleared by stream_dispatch_done */
+    n = vlen;
+    vlen = 0;
+    if (stream_dispatch_done(h, es, vec, n) < 0)
         goto done;
-    if (es->es_replay_enabled){
-        if (stream_replay_add(es, &tv, xev) < 0)
-            goto done;
-        xev = NULL; /* xml stored in replay_add and should not be freed */
-    }
  ok:
     retval = 0;
   done:
+    stream_event_cache_clear(h);
+    for (i=0; i<vlen; i++)
+        vec[i]->ss_pending = 0;
+    if (vec)
+        free(vec);
     if (cb)
         cbuf_free(cb);
     if (xev)
@@ -610,73 +1361,25 @@ stream_notify(clicon_handle h,
     return retval;
 }
 
-/*! Backward compatible function
+/*! Stream notify event given as XML and distribute to all registered callbacks
  * @param[in]  h       Clicon handle
  * @param[in]  stream  Name of event stream. CLICON is predefined as LOG stream
- * @param[in]  xml     Notification as XML stream. Is copied.
+ * @param[in]  xml     Event as XML. Is copied.
  * @retval  0  OK
  * @retval -1  Error with clicon_err called
- * @see  stream_notify  Should be merged with this
+ * @see  stream_notify_vec  Batch of events, not copied
  */
 int
 stream_notify_xml(clicon_handle h, 
                   char         *stream, 
                   cxobj        *xml)
 {
-    int        retval = -1;
-    cxobj     *xev = NULL;
-    cxobj     *xml2; /* copy */
-    yang_stmt *yspec = NULL;
-    char      *str = NULL; /* XXX: never set */
-    cbuf      *cb = NULL;
-    char       timestr[28];
-    struct timeval tv;
-    event_stream_t *es;
+    cxobj *xev;
 
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
-    if ((es = stream_find(h, stream)) == NULL)
-        goto ok;
-    if ((yspec = clicon_dbspec_yang(h)) == NULL){
-        clicon_err(OE_YANG, 0, "No yang spec");
-        goto done;
-    }
-    if ((cb = cbuf_new()) == NULL){
-        clicon_err(OE_UNIX, errno, "cbuf_new");
-        goto done;
-    }
-    gettimeofday(&tv, NULL);
-    if (time2str(tv, timestr, sizeof(timestr)) < 0){
-        clicon_err(OE_UNIX, errno, "time2str");
-        goto done;
-    }
-    cprintf(cb, "<notification xmlns=\"%s\"><eventTime>%s</eventTime>NULL</notification>",
-            NETCONF_NOTIFICATION_NAMESPACE,
-            timestr); /* XXX str is always NULL */
-    if (clixon_xml_parse_string(cbuf_get(cb), YB_NONE, yspec, &xev, NULL) < 0)
-        goto done;
-    if (xml_rootchild(xev, 0, &xev) < 0)
-        goto done;
-    if ((xml2 = xml_dup(xml)) == NULL)
-        goto done;
-    if (xml_addsub(xev, xml2) < 0)
-        goto done;
-    if (stream_notify1(h, es, &tv, xev) < 0)
-        goto done;
-    if (es->es_replay_enabled){
-        if (stream_replay_add(es, &tv, xev) < 0)
-            goto done;
-        xev = NULL; /* xml stored in replay_add and should not be freed */
-    }
- ok:
-    retval = 0;
-  done:
-    if (cb)
-        cbuf_free(cb);
-    if (xev)
-        xml_free(xev);
-    if (str)
-        free(str);
-    return retval;
+    if ((xev = xml_dup(xml)) == NULL)
+        return -1;
+    return stream_notify_vec(h, stream, &xev, NULL, 1);
 }
 
 
@@ -712,59 +1415,104 @@ stream_replay_notify(clicon_handle               h,
 {
     int                   retval = -1;
     struct stream_replay *r;
+    int                   idx;
+    size_t                i;
+    cxobj                *xt = NULL;
+    cxobj                *xev;
+    int                   flush = 0;
 
     /* If <startTime> is not present, this is not a replay */
     if (!timerisset(&ss->ss_starttime))
         goto ok;
     if (!es->es_replay_enabled)
         goto ok;
-    /* Get replay linked list */
-    if ((r = es->es_replay) == NULL)
-        goto ok;
-    /* First loop to skip until start */
-    do {
-        if (timercmp(&r->r_tv, &ss->ss_starttime, >=))
-            break;
-        r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
-    if (r == NULL)
-        goto ok; /* No samples to replay */
-    /* Then notify until stop */
-    do {
+    /* Skip until start using time index, then notify until stop */
+    for (i = stream_replay_find(es, &ss->ss_starttime); i < es->es_replay_len; i++){
+        r = stream_replay_at(es, i, &idx);
         if (timerisset(&ss->ss_stoptime) &&
-            timercmp(&r->r_tv, &ss->ss_stoptime, >))
+            timercmp(&r->r_tv[idx], &ss->ss_stoptime, >))
             break;
-        if ((*ss->ss_fn)(h, 0, r->r_xml, ss->ss_arg) < 0)
+        if (clixon_xml_parse_string(r->r_str[idx], YB_NONE, NULL, &xt, NULL) < 0)
             goto done;
-        r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
+        if (xml_rootchild(xt, 0, &xt) < 0)
+            goto done;
+        xev = xt;
+        /* Subscribers send the stored event instead of serializing it again */
+        if (stream_event_cache_set(h, xev, r->r_str[idx]) < 0)
+            goto done;
+        if ((*ss->ss_fn)(h, 0, xev, ss->ss_arg) < 0)
+            goto done;
+        stream_event_cache_clear(h);
+        xml_free(xt);
+        xt = NULL;
+        flush++;
+    }
+    if (flush &&
+        (*ss->ss_fn)(h, 2, NULL, ss->ss_arg) < 0)
+        goto done;
  ok:
     retval = 0;
  done:
+    stream_event_cache_clear(h);
+    if (xt)
+        xml_free(xt);
     return retval;
 }
 
 /*! Add replay sample to stream with timestamp
+ *
+ * The event is stored serialized. The oldest events are dropped if the number or
+ * size of events exceeds CLICON_STREAM_REPLAY_MAX or CLICON_STREAM_REPLAY_BYTES.
+ * @param[in] h    Clicon handle
  * @param[in] es   Stream
- * @param[in] tv   Timestamp
- * @param[in] xv   XML
+ * @param[in] tv   Timestamp, not earlier than previously added samples
+ * @param[in] xv   Event as XML, not consumed
+ * @retval    0    OK
+ * @retval   -1    Error
  */
 int
-stream_replay_add(event_stream_t *es,
+stream_replay_add(clicon_handle   h,
+                  event_stream_t *es,
                   struct timeval *tv,
                   cxobj          *xv)
 {
-    int                   retval = -1;
-    struct stream_replay *new;
+    int                    retval = -1;
+    struct stream_replay  *r = NULL;
+    struct stream_replay **vec;
+    cbuf                  *cb = NULL;
+    char                  *str;
 
-    if ((new = malloc(sizeof *new)) == NULL){
-        clicon_err(OE_UNIX, errno, "malloc");
+    if (stream_event_cache(h, xv, &cb, NULL) < 0)
+        goto done;
+    if ((str = strdup(cbuf_get(cb))) == NULL){
+        clicon_err(OE_UNIX, errno, "strdup");
         goto done;
     }
-    memset(new, 0, (sizeof *new));
-    new->r_tv = *tv;
-    new->r_xml = xv;
-    ADDQ(new, es->es_replay);
+    if (es->es_replay_nr)
+        r = es->es_replay[es->es_replay_nr-1];
+    if (r == NULL || r->r_len == STREAM_REPLAY_SEGMENT){
+        if ((vec = realloc(es->es_replay, (es->es_replay_nr+1)*sizeof(*vec))) == NULL){
+            clicon_err(OE_UNIX, errno, "realloc");
+            free(str);
+            goto done;
+        }
+        es->es_replay = vec;
+        if ((r = malloc(sizeof(*r))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            free(str);
+            goto done;
+        }
+        memset(r, 0, sizeof(*r));
+        es->es_replay[es->es_replay_nr++] = r;
+    }
+    r->r_tv[r->r_len] = *tv;
+    r->r_str[r->r_len++] = str;
+    es->es_replay_len++;
+    es->es_replay_bytes += strlen(str);
+    while ((es->es_replay_max && es->es_replay_len > es->es_replay_max) ||
+           (es->es_replay_maxbytes && es->es_replay_bytes > es->es_replay_maxbytes &&
+            es->es_replay_len > 1))
+        stream_replay_drop(es);
     retval = 0;
  done:
     return retval;
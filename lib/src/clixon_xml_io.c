@@ -460,6 +460,278 @@ clixon_xml2cbuf(cbuf   *cb,
     return retval;
 }
 
+/*
+ * Chunked XML serialization
+ * Same output as clixon_xml2cbuf() without pretty-print, but produced a bounded amount at a
+ * time so that a large tree can be written to a socket without first encoding all of it.
+ */
+
+/* One open element in chunked serialization */
+struct xml_chunk_frame {
+    cxobj  *xf_x;      /* Open element */
+    int     xf_i;      /* Index of next child to serialize */
+    int32_t xf_depth;  /* Depth of children */
+};
+
+/* Element whose children are produced while serializing, see clixon_xml_chunk_fill */
+struct xml_chunk_fill {
+    cxobj                   *xl_x;    /* Element */
+    clixon_xml_chunk_fill_t *xl_fn;   /* Fill callback */
+    void                    *xl_arg;  /* Callback argument */
+    int                      xl_done; /* Callback returned 0 */
+};
+
+/*! Chunked XML serializer handle
+ */
+struct clixon_xml_chunk {
+    cxobj                  *xc_top;     /* Tree to serialize */
+    int                     xc_skiptop; /* Only serialize element children of xc_top */
+    int32_t                 xc_depth;   /* Nr of levels to print, -1 is all */
+    int                     xc_started; /* First call made */
+    struct xml_chunk_frame *xc_stack;   /* Stack of open elements */
+    int                     xc_len;     /* Number of frames in xc_stack */
+    int                     xc_max;     /* Allocated frames in xc_stack */
+    struct xml_chunk_fill  *xc_fill;    /* Vector of elements with fill callbacks */
+    int                     xc_nfill;   /* Length of xc_fill */
+};
+
+/*! Find fill callback of element, if any
+ */
+static struct xml_chunk_fill *
+xml_chunk_fill_find(clixon_xml_chunk *xc,
+                    cxobj            *x)
+{
+    int i;
+
+    for (i=0; i<xc->xc_nfill; i++)
+        if (xc->xc_fill[i].xl_x == x)
+            return &xc->xc_fill[i];
+    return NULL;
+}
+
+/*! Push element frame on chunked serialization stack
+ */
+static int
+xml_chunk_push(clixon_xml_chunk *xc,
+               cxobj            *x,
+               int32_t           depth)
+{
+    struct xml_chunk_frame *xf;
+
+    if (xc->xc_len == xc->xc_max){
+        xc->xc_max = xc->xc_max ? 2*xc->xc_max : 16;
+        if ((xf = realloc(xc->xc_stack, xc->xc_max*sizeof(*xf))) == NULL){
+            clicon_err(OE_XML, errno, "realloc");
+            return -1;
+        }
+        xc->xc_stack = xf;
+    }
+    xf = &xc->xc_stack[xc->xc_len++];
+    xf->xf_x = x;
+    xf->xf_i = 0;
+    xf->xf_depth = depth;
+    return 0;
+}
+
+/*! Print start tag of element including attributes, and push it if it has children
+ * @param[in]  xc     Chunked serializer handle
+ * @param[in]  cb     Output buffer
+ * @param[in]  x      XML element
+ * @param[in]  depth  Depth of x, 0 means print nothing
+ */
+static int
+xml_chunk_open(clixon_xml_chunk *xc,
+               cbuf             *cb,
+               cxobj            *x,
+               int32_t           depth)
+{
+    cxobj *xa;
+    int    children = 0;
+    char  *prefix;
+
+    if (depth == 0)
+        return 0;
+    if (xml_type(x) != CX_ELMNT)
+        return clixon_xml2cbuf1(cb, x, 0, 0, depth);
+    cbuf_append(cb, '<');
+    if ((prefix = xml_prefix(x)) != NULL){
+        cbuf_append_str(cb, prefix);
+        cbuf_append(cb, ':');
+    }
+    cbuf_append_str(cb, xml_name(x));
+    xa = NULL;
+    while ((xa = xml_child_each(x, xa, -1)) != NULL){
+        if (xml_type(xa) == CX_ATTR){
+            if (clixon_xml2cbuf1(cb, xa, 0, 0, -1) < 0)
+                return -1;
+        }
+        else
+            children++;
+    }
+    if (children == 0 && xml_chunk_fill_find(xc, x) == NULL){
+        cbuf_append_str(cb, "/>");
+        return 0;
+    }
+    cbuf_append(cb, '>');
+    return xml_chunk_push(xc, x, depth-1);
+}
+
+/*! Create a chunked XML serializer
+ *
+ * @param[in]  x        XML tree, must not be modified until serializer is freed
+ * @param[in]  depth    Nr of levels to print, -1 is all, 0 is none
+ * @param[in]  skiptop  0: Include top object 1: Skip top-object, only children
+ * @retval     xc       Serializer handle, free with clixon_xml_chunk_free
+ * @retval     NULL     Error
+ * @code
+ *   clixon_xml_chunk *xc;
+ *   if ((xc = clixon_xml_chunk_new(xt, -1, 0)) == NULL)
+ *     err;
+ *   do {
+ *     cbuf_reset(cb);
+ *     if ((ret = clixon_xml_chunk_next(xc, cb, 65536)) < 0)
+ *       err;
+ *     write(s, cbuf_get(cb), cbuf_len(cb));
+ *   } while (ret == 1);
+ *   clixon_xml_chunk_free(xc);
+ * @endcode
+ * @see clixon_xml2cbuf  Serialize all of a tree at once
+ */
+clixon_xml_chunk *
+clixon_xml_chunk_new(cxobj  *x,
+                     int32_t depth,
+                     int     skiptop)
+{
+    clixon_xml_chunk *xc;
+
+    if ((xc = malloc(sizeof(*xc))) == NULL){
+        clicon_err(OE_XML, errno, "malloc");
+        return NULL;
+    }
+    memset(xc, 0, sizeof(*xc));
+    xc->xc_top = x;
+    xc->xc_depth = depth;
+    xc->xc_skiptop = skiptop;
+    return xc;
+}
+
+/*! Free chunked XML serializer, the tree is not freed
+ * @param[in]  xc   Serializer handle
+ */
+int
+clixon_xml_chunk_free(clixon_xml_chunk *xc)
+{
+    if (xc->xc_stack)
+        free(xc->xc_stack);
+    if (xc->xc_fill)
+        free(xc->xc_fill);
+    free(xc);
+    return 0;
+}
+
+/*! Register a callback producing children of an element while it is serialized
+ *
+ * When all children of x have been serialized, fn is called to append more children to x,
+ * which are then serialized in turn, until fn returns 0. This makes it possible to serialize
+ * a large list in constant memory: fn may remove the children it appended in the previous
+ * call, since they have been serialized, but must not modify x otherwise.
+ * @param[in]  xc   Serializer handle
+ * @param[in]  x    XML element in the serialized tree
+ * @param[in]  fn   Fill callback
+ * @param[in]  arg  Argument to fn
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+int
+clixon_xml_chunk_fill(clixon_xml_chunk        *xc,
+                      cxobj                   *x,
+                      clixon_xml_chunk_fill_t *fn,
+                      void                    *arg)
+{
+    struct xml_chunk_fill *xl;
+
+    if ((xl = realloc(xc->xc_fill, (xc->xc_nfill+1)*sizeof(*xl))) == NULL){
+        clicon_err(OE_XML, errno, "realloc");
+        return -1;
+    }
+    xc->xc_fill = xl;
+    xl = &xc->xc_fill[xc->xc_nfill++];
+    xl->xl_x = x;
+    xl->xl_fn = fn;
+    xl->xl_arg = arg;
+    xl->xl_done = 0;
+    return 0;
+}
+
+/*! Serialize the next part of an XML tree
+ *
+ * Appends XML to cb until at least max bytes have been appended or the tree is done. 
+ * A single node (eg a long body) is never split, so more than max may be appended.
+ * @param[in]  xc   Serializer handle
+ * @param[out] cb   Output buffer, appended to
+ * @param[in]  max  Approximate number of bytes to append
+ * @retval     1    More remains, call again
+ * @retval     0    Done, all of tree serialized
+ * @retval    -1    Error
+ */
+int
+clixon_xml_chunk_next(clixon_xml_chunk *xc,
+                      cbuf             *cb,
+                      size_t            max)
+{
+    struct xml_chunk_frame *xf;
+    struct xml_chunk_fill  *xl;
+    size_t                  len0 = cbuf_len(cb);
+    cxobj                  *x;
+    char                   *prefix;
+    int                     n;
+
+    if (!xc->xc_started){
+        xc->xc_started++;
+        if (xc->xc_skiptop){
+            /* Top is a frame without tags, only element children are printed */
+            if (xml_chunk_push(xc, xc->xc_top, xc->xc_depth) < 0)
+                return -1;
+        }
+        else if (xml_chunk_open(xc, cb, xc->xc_top, xc->xc_depth) < 0)
+            return -1;
+    }
+    while (xc->xc_len > 0 && cbuf_len(cb) - len0 < max){
+        xf = &xc->xc_stack[xc->xc_len-1];
+        x = xml_child_i(xf->xf_x, xf->xf_i++);
+        if (x == NULL && xf->xf_depth != 0 && xc->xc_nfill &&
+            (xl = xml_chunk_fill_find(xc, xf->xf_x)) != NULL && !xl->xl_done){
+            /* Ask for more children */
+            if ((n = xl->xl_fn(xf->xf_x, xl->xl_arg)) < 0)
+                return -1;
+            if (n == 0)
+                xl->xl_done++;
+            xf->xf_i = xml_child_nr(xf->xf_x) - n;
+            continue;
+        }
+        if (x == NULL){ /* No more children, end tag */
+            xc->xc_len--;
+            if (xc->xc_skiptop && xc->xc_len == 0)
+                break;
+            cbuf_append_str(cb, "</");
+            if ((prefix = xml_prefix(xf->xf_x)) != NULL){
+                cbuf_append_str(cb, prefix);
+                cbuf_append(cb, ':');
+            }
+            cbuf_append_str(cb, xml_name(xf->xf_x));
+            cbuf_append(cb, '>');
+            continue;
+        }
+        if (xml_type(x) == CX_ATTR)
+            continue;
+        if (xc->xc_skiptop && xc->xc_len == 1 && xml_type(x) != CX_ELMNT)
+            continue; /* Only element children of skipped top */
+        if (xml_chunk_open(xc, cb, x, xf->xf_depth) < 0)
+            return -1;
+    }
+    return xc->xc_len > 0 ? 1 : 0;
+}
+
 /*! Print actual xml tree datastructures (not xml), mainly for debugging
  * @param[in,out] cb          Cligen buffer to write to
  * @param[in]     xn          Clicon xml tree
@@ -502,71 +774,41 @@ xmltree2cbuf(cbuf  *cb,
 /*--------------------------------------------------------------------
  * XML parsing functions. Create XML parse tree from string and file.
  *--------------------------------------------------------------------*/
-/*! Common internal xml parsing function string to parse-tree
+/*! Post-processing of a parsed XML tree: namespace check, yang bind and sort
  *
- * Given a string containing XML, parse into existing XML tree and return
- * @param[in]     str   Pointer to string containing XML definition. 
+ * Shared by the bison parser (_xml_parse) and the incremental push parser
  * @param[in]     yb    How to bind yang to XML top-level when parsing
  * @param[in]     yspec Yang specification (only if bind is TOP or CONFIG)
- * @param[in,out] xtop  Top of XML parse tree. Assume created. Holds new tree.
+ * @param[in,out] xt    Top of XML parse tree
+ * @param[in]     xvec  Vector of created top-level nodes
+ * @param[in]     xlen  Length of xvec
  * @param[out]    xerr  Reason for failure (yang assignment not made)
- * @retval        1     Parse OK and all yang assignment made
- * @retval        0     Parse OK but yang assigment not made (or only partial) and xerr set
- * @retval       -1     Error with clicon_err called. Includes parse error
- * @see clixon_xml_parse_file
- * @see clixon_xml_parse_string
- * @see _json_parse
- * @note special case is empty XML where the parser is not invoked.
- * It is questionable empty XML is legal. From https://www.w3.org/TR/2008/REC-xml-20081126 Sec 2.1:
- *    A well-formed document ... contains one or more elements.
- * But in clixon one can invoke a parser on a sub-part of a document where it makes sense to accept
- * an empty XML. For example where an empty config: <config></config> is parsed.
- * In other cases, such as receiving netconf ]]>]]> it should represent a complete document and 
- * therefore not well-formed.
- * Therefore checking for empty XML must be done by a calling function which knows wether the 
- * the XML represents a full document or not.
- * @note may be called recursively, some yang-bind (eg rpc) semantic checks may trigger error message
+ * @retval        1     OK and all yang assignment made
+ * @retval        0     Yang assigment not made (or only partial) and xerr set
+ * @retval       -1     Error with clicon_err called
+ * @see clixon_xml_push_done
  */
-static int 
-_xml_parse(const char *str, 
-           yang_bind   yb,
-           yang_stmt  *yspec,
-           cxobj      *xt,
-           cxobj     **xerr)
+int
+clixon_xml_parse_post(yang_bind   yb,
+                      yang_stmt  *yspec,
+                      cxobj      *xt,
+                      cxobj     **xvec,
+                      int         xlen,
+                      cxobj     **xerr)
 {
-    int             retval = -1;
-    clixon_xml_yacc xy = {0,};
-    cxobj          *x;
-    int             ret;
-    int             failed = 0; /* yang assignment */
-    int             i;
+    int    retval = -1;
+    cxobj *x;
+    int    ret;
+    int    failed = 0; /* yang assignment */
+    int    i;
 
-    clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
-    if (strlen(str) == 0){
-        return 1; /* OK */
-    }
-    if (xt == NULL){
-        clicon_err(OE_XML, errno, "Unexpected NULL XML");
-        return -1;      
-    }
-    if ((xy.xy_parse_string = strdup(str)) == NULL){
-        clicon_err(OE_XML, errno, "strdup");
-        return -1;
-    }
-    xy.xy_xtop = xt;
-    xy.xy_xparent = xt;
-    xy.xy_yspec = yspec;
-    if (clixon_xml_parsel_init(&xy) < 0)
-        goto done;    
-    if (clixon_xml_parseparse(&xy) != 0)  /* yacc returns 1 on error */
-        goto done;
     /* Purge all top-level body objects */
     x = NULL;
     while ((x = xml_find_type(xt, NULL, "body", CX_BODY)) != NULL)
         xml_purge(x);
     /* Traverse new objects */
-    for (i = 0; i < xy.xy_xlen; i++) {
-        x = xy.xy_xvec[i];
+    for (i = 0; i < xlen; i++) {
+        x = xvec[i];
         /* Verify namespaces after parsing */
         if (xml2ns_recurse(x) < 0)
             goto done;
@@ -619,16 +861,93 @@ _xml_parse(const char *str,
         if (xml_sort_recurse(xt) < 0)
             goto done;
     retval = 1;
+ done:
+    return retval;
+ fail: /* invalid */
+    retval = 0;
+    goto done;
+}
+
+/*! Common internal xml parsing function string to parse-tree
+ *
+ * Given a string containing XML, parse into existing XML tree and return
+ * @param[in]     str   Pointer to string containing XML definition. 
+ * @param[in]     yb    How to bind yang to XML top-level when parsing
+ * @param[in]     yspec Yang specification (only if bind is TOP or CONFIG)
+ * @param[in,out] xtop  Top of XML parse tree. Assume created. Holds new tree.
+ * @param[out]    xerr  Reason for failure (yang assignment not made)
+ * @retval        1     Parse OK and all yang assignment made
+ * @retval        0     Parse OK but yang assigment not made (or only partial) and xerr set
+ * @retval       -1     Error with clicon_err called. Includes parse error
+ * @see clixon_xml_parse_file
+ * @see clixon_xml_parse_string
+ * @see _json_parse
+ * @note special case is empty XML where the parser is not invoked.
+ * It is questionable empty XML is legal. From https://www.w3.org/TR/2008/REC-xml-20081126 Sec 2.1:
+ *    A well-formed document ... contains one or more elements.
+ * But in clixon one can invoke a parser on a sub-part of a document where it makes sense to accept
+ * an empty XML. For example where an empty config: <config></config> is parsed.
+ * In other cases, such as receiving netconf ]]>]]> it should represent a complete document and 
+ * therefore not well-formed.
+ * Therefore checking for empty XML must be done by a calling function which knows wether the 
+ * the XML represents a full document or not.
+ * @note may be called recursively, some yang-bind (eg rpc) semantic checks may trigger error message
+ * @note If configured with --enable-xml-fast-parser, the hand-written parser in clixon_xml_push.c
+ *       is used instead of flex/bison
+ */
+static int 
+_xml_parse(const char *str, 
+           yang_bind   yb,
+           yang_stmt  *yspec,
+           cxobj      *xt,
+           cxobj     **xerr)
+{
+    int              retval = -1;
+#ifdef CLIXON_XML_FAST_PARSER
+    clixon_xml_push *xp = NULL;
+#else
+    clixon_xml_yacc  xy = {0,};
+#endif
+
+    clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
+    if (strlen(str) == 0){
+        return 1; /* OK */
+    }
+    if (xt == NULL){
+        clicon_err(OE_XML, errno, "Unexpected NULL XML");
+        return -1;      
+    }
+#ifdef CLIXON_XML_FAST_PARSER
+    /* Hand-written parser, no copy of str is made */
+    if ((xp = clixon_xml_push_new(yb, yspec, xt)) == NULL)
+        goto done;
+    if (clixon_xml_push_feed(xp, str, strlen(str)) < 0)
+        goto done;
+    retval = clixon_xml_push_done(xp, xerr);
+  done:
+    if (xp)
+        clixon_xml_push_free(xp);
+#else
+    if ((xy.xy_parse_string = strdup(str)) == NULL){
+        clicon_err(OE_XML, errno, "strdup");
+        return -1;
+    }
+    xy.xy_xtop = xt;
+    xy.xy_xparent = xt;
+    xy.xy_yspec = yspec;
+    if (clixon_xml_parsel_init(&xy) < 0)
+        goto done;    
+    if (clixon_xml_parseparse(&xy) != 0)  /* yacc returns 1 on error */
+        goto done;
+    retval = clixon_xml_parse_post(yb, yspec, xt, xy.xy_xvec, xy.xy_xlen, xerr);
   done:
     clixon_xml_parsel_exit(&xy);
     if (xy.xy_parse_string != NULL)
         free(xy.xy_parse_string);
     if (xy.xy_xvec)
         free(xy.xy_xvec);
+#endif /* CLIXON_XML_FAST_PARSER */
     return retval; 
- fail: /* invalid */
-    retval = 0;
-    goto done;
 }
 
 /*! Read an XML definition from file and parse it into a parse-tree, advanced API
@@ -656,6 +975,7 @@ _xml_parse(const char *str,
  * @see clixon_json_parse_file
  * @note, If xt empty, a top-level symbol will be added so that <tree../> will be:  <top><tree.../></tree></top>
  * @note May block on file I/O
+ * @note The file is parsed incrementally with the push parser, see clixon_xml_push_feed
  */
 int 
 clixon_xml_parse_file(FILE      *fp, 
@@ -664,15 +984,11 @@ clixon_xml_parse_file(FILE      *fp,
                       cxobj    **xt,
                       cxobj    **xerr)
 {
-    int   retval = -1;
-    int   ret;
-    int   len = 0;
-    char  ch;
-    char *xmlbuf = NULL;
-    char *ptr;
-    int   xmlbuflen = BUFLEN; /* start size */
-    int   oldxmlbuflen;
-    int   failed = 0;
+    int              retval = -1;
+    int              ret;
+    size_t           len;
+    char            *xmlbuf = NULL;
+    clixon_xml_push *xp = NULL;
 
     if (xt==NULL || fp == NULL){
         clicon_err(OE_XML, EINVAL, "arg is NULL");
@@ -682,47 +998,34 @@ clixon_xml_parse_file(FILE      *fp,
         clicon_err(OE_XML, EINVAL, "yspec is required if yb == YB_MODULE");
         return -1;
     }
-    if ((xmlbuf = malloc(xmlbuflen)) == NULL){
+    if ((xmlbuf = malloc(BUFLEN)) == NULL){
         clicon_err(OE_XML, errno, "malloc");
         goto done;
     }
-    memset(xmlbuf, 0, xmlbuflen);
-    ptr = xmlbuf;
-    while (1){
-        if ((ret = fread(&ch, 1, 1, fp)) < 0){
-            clicon_err(OE_XML, errno, "read");
-            break;
-        }
-        if (ret != 0){
-            xmlbuf[len++] = ch;
-        }
-        if (ret == 0) {
-            if (*xt == NULL)
-                if ((*xt = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
-                    goto done;
-            if ((ret = _xml_parse(ptr, yb, yspec, *xt, xerr)) < 0)
-                goto done;
-            if (ret == 0)
-                failed++;
-            break;
-        }
-        if (len >= xmlbuflen-1){ /* Space: one for the null character */
-            oldxmlbuflen = xmlbuflen;
-            xmlbuflen *= 2;
-            if ((xmlbuf = realloc(xmlbuf, xmlbuflen)) == NULL){
-                clicon_err(OE_XML, errno, "realloc");
-                goto done;
-            }
-            memset(xmlbuf+oldxmlbuflen, 0, xmlbuflen-oldxmlbuflen);
-            ptr = xmlbuf;
-        }
-    } /* while */
-    retval = (failed==0) ? 1 : 0;
+    if (*xt == NULL)
+        if ((*xt = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+    /* Parse incrementally: the file text is never held in memory as a whole */
+    if ((xp = clixon_xml_push_new(yb, yspec, *xt)) == NULL)
+        goto done;
+    while ((len = fread(xmlbuf, 1, BUFLEN, fp)) > 0){
+        if (clixon_xml_push_feed(xp, xmlbuf, len) < 0)
+            goto done;
+    }
+    if (ferror(fp)){
+        clicon_err(OE_XML, errno, "read");
+        goto done;
+    }
+    if ((ret = clixon_xml_push_done(xp, xerr)) < 0)
+        goto done;
+    retval = ret;
  done:
     if (retval < 0 && *xt){
-        free(*xt);
+        xml_free(*xt);
         *xt = NULL;
     }
+    if (xp)
+        clixon_xml_push_free(xp);
     if (xmlbuf)
         free(xmlbuf);
     return retval;
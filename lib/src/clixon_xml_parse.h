@@ -73,4 +73,6 @@ int clixon_xml_parsel_linenr(void);
 int clixon_xml_parselex(void *);
 int clixon_xml_parseparse(void *);
 
+int clixon_xml_parse_post(yang_bind yb, yang_stmt *yspec, cxobj *xt, cxobj **xvec, int xlen, cxobj **xerr);
+
 #endif  /* _CLIXON_XML_PARSE_H_ */
@@ -0,0 +1,969 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
+  Copyright (C) 2020-2022 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Incremental (push) XML parser
+ * An alternative to the flex/bison XML parser (clixon_xml_parse.[ly]) where the input is fed
+ * in chunks of arbitrary size as it arrives, eg from a socket, and the XML tree is built
+ * while parsing. The complete XML text is never buffered, only tokens that span chunk
+ * boundaries.
+ * The resulting tree is the same as from clixon_xml_parse_string().
+ * @see https://www.w3.org/TR/2008/REC-xml-20081126
+ *      https://www.w3.org/TR/2009/REC-xml-names-20091208
+ *
+ * @code
+ *   clixon_xml_push *xp;
+ *   cxobj           *xt;
+ *
+ *   xt = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT);
+ *   xp = clixon_xml_push_new(YB_MODULE, yspec, xt);
+ *   while ((len = read(s, buf, sizeof(buf))) > 0)
+ *      if (clixon_xml_push_feed(xp, buf, len) < 0)
+ *         err;
+ *   if ((ret = clixon_xml_push_done(xp, &xerr)) < 0)
+ *      err;
+ *   clixon_xml_push_free(xp);
+ * @endcode
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_string.h"
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_xml_io.h"
+#include "clixon_xml_parse.h"
+#include "clixon_xml_scan.h"
+
+/* Max length of an entity reference, eg &#x10FFFF; */
+#define XP_ENTITY_MAX 16
+
+/*! Push parser states
+ */
+enum xp_state{
+    XP_CONTENT = 0, /* Character data between tags */
+    XP_LT,          /* After '<' */
+    XP_STAG_NAME,   /* Element name in start-tag */
+    XP_STAG,        /* In start-tag, between attributes */
+    XP_ATTR_NAME,   /* Attribute name */
+    XP_ATTR_EQ,     /* After attribute name, expect '=' */
+    XP_ATTR_QUOTE,  /* After '=', expect quote */
+    XP_ATTR_VALUE,  /* Attribute value */
+    XP_EMPTY,       /* After '/' in start-tag, expect '>' */
+    XP_ETAG_NAME,   /* Element name in end-tag */
+    XP_ETAG,        /* After name in end-tag, expect '>' */
+    XP_ENTITY,      /* After '&' in content */
+    XP_BANG,        /* After "<!" */
+    XP_COMMENT,     /* Comment */
+    XP_CDATA,       /* CDATA section */
+    XP_PI,          /* Processing instruction or XML declaration */
+};
+
+/*! Push parser handle
+ * @see clixon_xml_yacc  for the corresponding bison parser struct
+ */
+struct clixon_xml_push {
+    enum xp_state xp_state;     /* Parser state */
+    cbuf         *xp_tok;       /* Pending token: name, attribute value, text run, etc */
+    int           xp_ws;        /* Pending text run in xp_tok is whitespace */
+    char         *xp_attr;      /* Pending attribute qname */
+    char          xp_quote;     /* Quote character of pending attribute value */
+    int           xp_cr;        /* Last content char was \r */
+    int           xp_dash;      /* Consecutive '-' in comment or ']' in CDATA */
+    int           xp_depth;     /* Number of open elements */
+    int           xp_err;       /* Parse error encountered, further input ignored */
+    int           xp_linenum;   /* Number of \n in parsed input */
+    size_t        xp_len;       /* Total number of bytes fed */
+    yang_bind     xp_yb;        /* How to bind yang to XML top-level */
+    yang_stmt    *xp_yspec;     /* If set, top-level yang-spec */
+    cxobj        *xp_xtop;      /* cxobj top element (fixed) */
+    cxobj        *xp_xelement;  /* Active element or body (changes with parse context) */
+    cxobj        *xp_xparent;   /* Innermost open element (changes with parse context) */
+    cxobj       **xp_xvec;      /* Vector of created top-level nodes */
+    int           xp_xlen;      /* Length of xp_xvec */
+};
+
+/*! Parse error: register error and enter error state
+ * @param[in]  xp   Push parser handle
+ * @param[in]  c    Character at or before error
+ * @param[in]  reason
+ */
+static int
+xp_error(clixon_xml_push *xp,
+         char             c,
+         char            *reason)
+{
+    clicon_err(OE_XML, XMLPARSE_ERRNO, "xml_parse: line %d: %s: at or before: %c",
+               xp->xp_linenum, reason, c);
+    xp->xp_err = 1;
+    return -1;
+}
+
+/*! XML name start character, see NCName in clixon_xml_parse.l
+ */
+static inline int
+xp_namestart(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
+}
+
+/*! XML name character, also accept ':' as prefix separator (checked in xp_qname_split)
+ */
+static inline int
+xp_namechar(char c)
+{
+    return xp_namestart(c) || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == ':';
+}
+
+/*! Number of leading name characters in buf
+ */
+static inline size_t
+xp_span_name(const char *buf,
+             size_t      len)
+{
+    size_t i;
+
+    for (i=0; i<len; i++)
+        if (!xp_namechar(buf[i]))
+            break;
+    return i;
+}
+
+static inline int
+xp_whitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/*! Split a qualified name in prefix and name, both malloced
+ * @param[in]  qname   Qualified name on the form [prefix:]name
+ * @param[out] prefix  Malloced prefix or NULL
+ * @param[out] name    Malloced name
+ * @retval     1       OK
+ * @retval     0       Invalid qname
+ * @retval    -1       Error
+ */
+static int
+xp_qname_split(char  *qname,
+               char **prefix,
+               char **name)
+{
+    char *p;
+
+    *prefix = NULL;
+    *name = NULL;
+    if ((p = strchr(qname, ':')) != NULL){
+        if (p == qname || strchr(p+1, ':') != NULL || !xp_namestart(*(p+1)))
+            return 0;
+        if ((*prefix = strndup(qname, p-qname)) == NULL){
+            clicon_err(OE_XML, errno, "strndup");
+            return -1;
+        }
+        p++;
+    }
+    else
+        p = qname;
+    if ((*name = strdup(p)) == NULL){
+        clicon_err(OE_XML, errno, "strdup");
+        return -1;
+    }
+    return 1;
+}
+
+/*! Add character data to body of current element
+ * @param[in]  xp       Push parser handle
+ * @param[in]  encoded  Set if ampersand encoded
+ * @param[in]  str      Body string
+ * @see xml_parse_content in clixon_xml_parse.y
+ */
+static int
+xp_content(clixon_xml_push *xp,
+           int              encoded,
+           char            *str)
+{
+    int    retval = -1;
+    cxobj *xn = xp->xp_xelement;
+
+    xp->xp_xelement = NULL; /* init */
+    if (xn == NULL){
+        if ((xn = xml_new("body", xp->xp_xparent, CX_BODY)) == NULL)
+            goto done;
+    }
+    if (encoded)
+        if (xml_value_append(xn, "&") < 0)
+            goto done;
+    if (xml_value_append(xn, str) < 0)
+        goto done;
+    xp->xp_xelement = xn;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Add whitespace to body of current element, unless it has element children
+ * @param[in]  xp   Push parser handle
+ * @param[in]  str  Whitespace string
+ * @see xml_parse_whitespace in clixon_xml_parse.y
+ */
+static int
+xp_ws_content(clixon_xml_push *xp,
+              char            *str)
+{
+    cxobj *xc;
+
+    xc = NULL;
+    while ((xc = xml_child_each(xp->xp_xparent, xc, CX_ELMNT)) != NULL){
+        xp->xp_xelement = NULL;
+        return 0; /* Skip if already element */
+    }
+    return xp_content(xp, 0, str);
+}
+
+/*! Flush pending text run as body
+ * @param[in]  xp   Push parser handle
+ */
+static int
+xp_text_flush(clixon_xml_push *xp)
+{
+    int retval = -1;
+
+    if (cbuf_len(xp->xp_tok) == 0)
+        goto ok;
+    if (xp->xp_ws){
+        if (xp_ws_content(xp, cbuf_get(xp->xp_tok)) < 0)
+            goto done;
+    }
+    else if (xp_content(xp, 0, cbuf_get(xp->xp_tok)) < 0)
+        goto done;
+    cbuf_reset(xp->xp_tok);
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Append to pending text run, flush first if run changes between whitespace and chardata
+ * @param[in]  xp   Push parser handle
+ * @param[in]  ws   Set if str is whitespace
+ * @param[in]  str  String
+ * @param[in]  len  Length of str
+ */
+static int
+xp_text_append(clixon_xml_push *xp,
+               int              ws,
+               const char      *str,
+               size_t           len)
+{
+    if (xp->xp_ws != ws){
+        if (xp_text_flush(xp) < 0)
+            return -1;
+        xp->xp_ws = ws;
+    }
+    return cbuf_append_buf(xp->xp_tok, (void*)str, len);
+}
+
+/*! Start-tag name complete: create new element
+ * @param[in]  xp   Push parser handle
+ * @param[in]  c    Current char (for error message)
+ * @see xml_parse_prefixed_name in clixon_xml_parse.y
+ */
+static int
+xp_element_new(clixon_xml_push *xp,
+               char             c)
+{
+    int    retval = -1;
+    char  *prefix = NULL;
+    char  *name = NULL;
+    cxobj *x;
+    int    ret;
+
+    if ((ret = xp_qname_split(cbuf_get(xp->xp_tok), &prefix, &name)) < 0)
+        goto done;
+    if (ret == 0){
+        xp_error(xp, c, "Invalid element name");
+        goto done;
+    }
+    cbuf_reset(xp->xp_tok);
+    if ((x = xml_new(name, xp->xp_xparent, CX_ELMNT)) == NULL)
+        goto done;
+    /* Cant check namespaces here since local xmlns attributes loaded after */
+    if (xml_prefix_set(x, prefix) < 0)
+        goto done;
+    xp->xp_xelement = x;
+    /* If topmost, add to top-list created list */
+    if (xp->xp_xparent == xp->xp_xtop){
+        if (cxvec_append(x, &xp->xp_xvec, &xp->xp_xlen) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    if (prefix)
+        free(prefix);
+    if (name)
+        free(name);
+    return retval;
+}
+
+/*! Attribute value complete: add attribute to element
+ * @param[in]  xp   Push parser handle
+ * @param[in]  c    Current char (for error message)
+ * @see xml_parse_attr in clixon_xml_parse.y
+ */
+static int
+xp_attr_new(clixon_xml_push *xp,
+            char             c)
+{
+    int    retval = -1;
+    char  *prefix = NULL;
+    char  *name = NULL;
+    cxobj *xa;
+    int    ret;
+
+    if ((ret = xp_qname_split(xp->xp_attr, &prefix, &name)) < 0)
+        goto done;
+    if (ret == 0){
+        xp_error(xp, c, "Invalid attribute name");
+        goto done;
+    }
+    if ((xa = xml_find_type(xp->xp_xelement, prefix, name, CX_ATTR)) == NULL){
+        if ((xa = xml_new(name, xp->xp_xelement, CX_ATTR)) == NULL)
+            goto done;
+        if (xml_prefix_set(xa, prefix) < 0)
+            goto done;
+    }
+    if (xml_value_set(xa, cbuf_get(xp->xp_tok)) < 0)
+        goto done;
+    cbuf_reset(xp->xp_tok);
+    free(xp->xp_attr);
+    xp->xp_attr = NULL;
+    retval = 0;
+ done:
+    if (prefix)
+        free(prefix);
+    if (name)
+        free(name);
+    return retval;
+}
+
+/*! End-tag complete: check name and close element
+ * @param[in]  xp   Push parser handle
+ * @param[in]  c    Current char (for error message)
+ * @see xml_parse_bslash in clixon_xml_parse.y
+ */
+static int
+xp_element_end(clixon_xml_push *xp,
+               char             c)
+{
+    int    retval = -1;
+    cxobj *x = xp->xp_xparent;
+    cxobj *xc;
+    char  *prefix = NULL;
+    char  *name = NULL;
+    char  *prefix0;
+    int    ret;
+
+    if (xp->xp_depth == 0){
+        xp_error(xp, c, "End-tag without start-tag");
+        goto done;
+    }
+    if ((ret = xp_qname_split(cbuf_get(xp->xp_tok), &prefix, &name)) < 0)
+        goto done;
+    cbuf_reset(xp->xp_tok);
+    prefix0 = xml_prefix(x);
+    /* Check name or prefix unequal from begin-tag */
+    if (ret == 0 ||
+        clicon_strcmp(xml_name(x), name) ||
+        clicon_strcmp(prefix0, prefix)){
+        clicon_err(OE_XML, XMLPARSE_ERRNO, "Sanity check failed: %s%s%s vs %s%s%s",
+                   prefix0?prefix0:"", prefix0?":":"", xml_name(x),
+                   prefix?prefix:"", prefix?":":"", name?name:"");
+        xp->xp_err = 1;
+        goto done;
+    }
+    /* Strip pretty-print, see xml_parse_bslash */
+    xc = NULL;
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+        break;
+    if (xc != NULL){ /* at least one element */
+        if (xml_rm_children(x, CX_BODY) < 0) /* remove all bodies */
+            goto done;
+    }
+    xp->xp_xparent = xml_parent(x);
+    xp->xp_xelement = NULL;
+    xp->xp_depth--;
+    retval = 0;
+ done:
+    if (prefix)
+        free(prefix);
+    if (name)
+        free(name);
+    return retval;
+}
+
+/*! Entity reference complete, eg &amp; or &#10;
+ * @param[in]  xp   Push parser handle
+ * @param[in]  c    Current char (for error message)
+ * @see AMPERSAND state in clixon_xml_parse.l
+ */
+static int
+xp_entity(clixon_xml_push *xp,
+          char             c)
+{
+    char  *str;
+    char  *s;
+    size_t i;
+
+    str = cbuf_get(xp->xp_tok);
+    s = NULL;
+    if (strcmp(str, "amp;") == 0)
+        s = "&";
+    else if (strcmp(str, "lt;") == 0)
+        s = "<";
+    else if (strcmp(str, "gt;") == 0)
+        s = ">";
+    else if (strcmp(str, "apos;") == 0)
+        s = "'";
+    else if (strcmp(str, "quot;") == 0)
+        s = "\"";
+    if (s != NULL){
+        if (xp_content(xp, 0, s) < 0)
+            return -1;
+    }
+    else { /* ISO/IEC 10646: &#[0-9]+; or &#x[0-9a-fA-F]+; kept encoded */
+        if (str[0] != '#' || strlen(str) < 3)
+            return xp_error(xp, c, "Unknown entity");
+        i = (str[1] == 'x')?2:1;
+        if (str[i] == ';')
+            return xp_error(xp, c, "Unknown entity");
+        for (; str[i] != ';'; i++)
+            if (!((str[i] >= '0' && str[i] <= '9') ||
+                  (str[1] == 'x' && ((str[i] >= 'a' && str[i] <= 'f') ||
+                                     (str[i] >= 'A' && str[i] <= 'F')))))
+                return xp_error(xp, c, "Unknown entity");
+        if (xp_content(xp, 1, str) < 0)
+            return -1;
+    }
+    cbuf_reset(xp->xp_tok);
+    return 0;
+}
+
+/*! Processing instruction complete. If XML declaration, check version and encoding
+ *
+ * Pseudo-attributes are on the form: version="1.0" encoding="UTF-8" standalone="yes"
+ * @param[in]  xp   Push parser handle
+ * @param[in]  c    Current char (for error message)
+ * @see xml_parse_version, xml_parse_encoding in clixon_xml_parse.y
+ */
+static int
+xp_pi(clixon_xml_push *xp,
+      char             c)
+{
+    int    retval = -1;
+    char  *str;
+    char  *name;
+    char  *val;
+    char   q;
+    int    version = 0;
+
+    str = cbuf_get(xp->xp_tok);
+    str[cbuf_len(xp->xp_tok)-1] = '\0'; /* strip '?' */
+    if (!xp_namestart(*str)){
+        xp_error(xp, c, "Invalid processing instruction");
+        goto done;
+    }
+    /* Only XML declaration if first in document, otherwise treat as PI (ignore) */
+    if (strncmp(str, "xml", 3) != 0 || !(str[3] == '\0' || xp_whitespace(str[3])) ||
+        xp->xp_xlen != 0 || xp->xp_depth != 0)
+        goto ok;
+    str += 3;
+    while (1){
+        while (xp_whitespace(*str))
+            str++;
+        if (*str == '\0')
+            break;
+        name = str;
+        while (xp_namestart(*str))
+            str++;
+        if (name == str || *str != '='){
+            xp_error(xp, c, "Invalid XML declaration");
+            goto done;
+        }
+        *str++ = '\0';
+        if ((q = *str) != '"' && q != '\''){
+            xp_error(xp, c, "Invalid XML declaration");
+            goto done;
+        }
+        val = ++str;
+        if ((str = strchr(str, q)) == NULL){
+            xp_error(xp, c, "Invalid XML declaration");
+            goto done;
+        }
+        *str++ = '\0';
+        if (strcmp(name, "version") == 0){
+            if (strcmp(val, "1.0")){
+                clicon_err(OE_XML, XMLPARSE_ERRNO, "Unsupported XML version: %s expected 1.0", val);
+                xp->xp_err = 1;
+                goto done;
+            }
+            version++;
+        }
+        else if (strcmp(name, "encoding") == 0){
+            if (strcasecmp(val, "UTF-8")){
+                clicon_err(OE_XML, XMLPARSE_ERRNO, "Unsupported XML encoding: %s expected UTF-8", val);
+                xp->xp_err = 1;
+                goto done;
+            }
+        }
+        else if (strcmp(name, "standalone") != 0){
+            xp_error(xp, c, "Invalid XML declaration");
+            goto done;
+        }
+    }
+    if (version == 0){
+        xp_error(xp, c, "XML declaration without version");
+        goto done;
+    }
+ ok:
+    cbuf_reset(xp->xp_tok);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Create an incremental XML parser
+ *
+ * @param[in]  yb     How to bind yang to XML top-level when parsing
+ * @param[in]  yspec  Yang specification (only if bind is TOP or CONFIG)
+ * @param[in]  xt     Top of XML parse tree. Created by caller. Holds new tree.
+ * @retval     xp     Push parser handle, free with clixon_xml_push_free
+ * @retval     NULL   Error
+ * @see clixon_xml_parse_string  for the non-incremental variant
+ */
+clixon_xml_push *
+clixon_xml_push_new(yang_bind  yb,
+                    yang_stmt *yspec,
+                    cxobj     *xt)
+{
+    clixon_xml_push *xp = NULL;
+
+    if (xt == NULL){
+        clicon_err(OE_XML, EINVAL, "xt is NULL");
+        goto done;
+    }
+    if (yb == YB_MODULE && yspec == NULL){
+        clicon_err(OE_XML, EINVAL, "yspec is required if yb == YB_MODULE");
+        goto done;
+    }
+    if ((xp = malloc(sizeof(*xp))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(xp, 0, sizeof(*xp));
+    if ((xp->xp_tok = cbuf_new()) == NULL){
+        clicon_err(OE_UNIX, errno, "cbuf_new");
+        free(xp);
+        xp = NULL;
+        goto done;
+    }
+    xp->xp_yb = yb;
+    xp->xp_yspec = yspec;
+    xp->xp_xtop = xt;
+    xp->xp_xparent = xt;
+ done:
+    return xp;
+}
+
+/*! Free an incremental XML parser, but not the parsed XML tree
+ *
+ * @param[in]  xp   Push parser handle
+ */
+int
+clixon_xml_push_free(clixon_xml_push *xp)
+{
+    if (xp == NULL)
+        return 0;
+    if (xp->xp_tok)
+        cbuf_free(xp->xp_tok);
+    if (xp->xp_attr)
+        free(xp->xp_attr);
+    if (xp->xp_xvec)
+        free(xp->xp_xvec);
+    free(xp);
+    return 0;
+}
+
+/*! Feed a chunk of XML text to an incremental parser
+ *
+ * The chunk may end anywhere, eg in the middle of a tag or a name. Nodes are added to the
+ * tree as they are parsed.
+ * @param[in]  xp   Push parser handle
+ * @param[in]  buf  XML text chunk, not necessarily null-terminated
+ * @param[in]  len  Length of buf
+ * @retval     0    OK
+ * @retval    -1    Error with clicon_err called. Includes parse error. Further input is ignored
+ */
+int
+clixon_xml_push_feed(clixon_xml_push *xp,
+                     const char      *buf,
+                     size_t           len)
+{
+    int    retval = -1;
+    size_t i;
+    size_t n;
+    char  *p;
+    char   c;
+
+    if (xp->xp_err)
+        goto done;
+    xp->xp_len += len;
+    i = 0;
+    while (i < len){
+        c = buf[i];
+        switch (xp->xp_state){
+        case XP_CONTENT:
+            if ((n = clixon_xml_scan_chardata(&buf[i], len-i)) > 0){
+                xp->xp_cr = 0;
+                if (xp_text_append(xp, 0, &buf[i], n) < 0)
+                    goto err;
+                i += n;
+                continue;
+            }
+            if ((n = clixon_xml_scan_space(&buf[i], len-i)) > 0){ /* eg indentation */
+                xp->xp_cr = 0;
+                if (xp_text_append(xp, 1, &buf[i], n) < 0)
+                    goto err;
+                i += n;
+                continue;
+            }
+            switch (c){
+            case '<':
+                if (xp_text_flush(xp) < 0)
+                    goto err;
+                xp->xp_state = XP_LT;
+                break;
+            case '&':
+                if (xp_text_flush(xp) < 0)
+                    goto err;
+                xp->xp_state = XP_ENTITY;
+                break;
+            case '\r': /* \r and \r\n are both translated to \n */
+                if (xp_text_append(xp, 1, "\n", 1) < 0)
+                    goto err;
+                break;
+            case '\n':
+                xp->xp_linenum++;
+                if (!xp->xp_cr && xp_text_append(xp, 1, "\n", 1) < 0)
+                    goto err;
+                break;
+            default:
+                break;
+            }
+            xp->xp_cr = (c == '\r');
+            i++;
+            continue;
+        case XP_LT:
+            if (c == '/')
+                xp->xp_state = XP_ETAG_NAME;
+            else if (c == '!')
+                xp->xp_state = XP_BANG;
+            else if (c == '?')
+                xp->xp_state = XP_PI;
+            else if (xp_namestart(c)){
+                cbuf_append(xp->xp_tok, c);
+                xp->xp_state = XP_STAG_NAME;
+            }
+            else if (!xp_whitespace(c))
+                goto perr;
+            break;
+        case XP_STAG_NAME:
+            if ((n = xp_span_name(&buf[i], len-i)) > 0){
+                cbuf_append_buf(xp->xp_tok, (void*)&buf[i], n);
+                i += n;
+                continue;
+            }
+            if (xp_element_new(xp, c) < 0)
+                goto err;
+            xp->xp_state = XP_STAG;
+            continue; /* reprocess c */
+        case XP_STAG:
+            if (c == '>'){
+                xp->xp_xparent = xp->xp_xelement;
+                xp->xp_xelement = NULL;
+                xp->xp_depth++;
+                xp->xp_state = XP_CONTENT;
+            }
+            else if (c == '/')
+                xp->xp_state = XP_EMPTY;
+            else if (xp_namestart(c)){
+                cbuf_append(xp->xp_tok, c);
+                xp->xp_state = XP_ATTR_NAME;
+            }
+            else if (xp_whitespace(c)){
+                if (c == '\n')
+                    xp->xp_linenum++;
+            }
+            else
+                goto perr;
+            break;
+        case XP_ATTR_NAME:
+            if ((n = xp_span_name(&buf[i], len-i)) > 0){
+                cbuf_append_buf(xp->xp_tok, (void*)&buf[i], n);
+                i += n;
+                continue;
+            }
+            if ((xp->xp_attr = strdup(cbuf_get(xp->xp_tok))) == NULL){
+                clicon_err(OE_UNIX, errno, "strdup");
+                goto err;
+            }
+            cbuf_reset(xp->xp_tok);
+            xp->xp_state = XP_ATTR_EQ;
+            continue; /* reprocess c */
+        case XP_ATTR_EQ:
+            if (c == '=')
+                xp->xp_state = XP_ATTR_QUOTE;
+            else if (!xp_whitespace(c))
+                goto perr;
+            break;
+        case XP_ATTR_QUOTE:
+            if (c == '"' || c == '\''){
+                xp->xp_quote = c;
+                xp->xp_state = XP_ATTR_VALUE;
+            }
+            else if (!xp_whitespace(c))
+                goto perr;
+            break;
+        case XP_ATTR_VALUE:
+            if ((p = memchr(&buf[i], xp->xp_quote, len-i)) == NULL){
+                cbuf_append_buf(xp->xp_tok, (void*)&buf[i], len-i);
+                i = len;
+                continue;
+            }
+            n = p - &buf[i];
+            cbuf_append_buf(xp->xp_tok, (void*)&buf[i], n);
+            i += n;
+            if (xp_attr_new(xp, c) < 0)
+                goto err;
+            xp->xp_state = XP_STAG;
+            break;
+        case XP_EMPTY:
+            if (c != '>')
+                goto perr;
+            xp->xp_xelement = NULL;
+            xp->xp_state = XP_CONTENT;
+            break;
+        case XP_ETAG_NAME:
+            if ((n = xp_span_name(&buf[i], len-i)) > 0){
+                cbuf_append_buf(xp->xp_tok, (void*)&buf[i], n);
+                i += n;
+                continue;
+            }
+            if (cbuf_len(xp->xp_tok) == 0){
+                if (!xp_whitespace(c))
+                    goto perr;
+                break;
+            }
+            if (xp_element_end(xp, c) < 0)
+                goto err;
+            xp->xp_state = XP_ETAG;
+            continue; /* reprocess c */
+        case XP_ETAG:
+            if (c == '>')
+                xp->xp_state = XP_CONTENT;
+            else if (!xp_whitespace(c))
+                goto perr;
+            break;
+        case XP_ENTITY:
+            cbuf_append(xp->xp_tok, c);
+            if (c == ';'){
+                if (xp_entity(xp, c) < 0)
+                    goto err;
+                xp->xp_state = XP_CONTENT;
+            }
+            else if (cbuf_len(xp->xp_tok) > XP_ENTITY_MAX)
+                goto perr;
+            break;
+        case XP_BANG:
+            cbuf_append(xp->xp_tok, c);
+            p = cbuf_get(xp->xp_tok);
+            if (strcmp(p, "--") == 0){
+                cbuf_reset(xp->xp_tok);
+                xp->xp_dash = 0;
+                xp->xp_state = XP_COMMENT;
+            }
+            else if (strcmp(p, "[CDATA[") == 0){
+                cbuf_reset(xp->xp_tok);
+                /* CDATA is kept as-is in body, see CDATA in clixon_xml_parse.l */
+                if (xp_content(xp, 0, "<![CDATA[") < 0)
+                    goto err;
+                xp->xp_dash = 0;
+                xp->xp_state = XP_CDATA;
+            }
+            else if (strncmp("--", p, cbuf_len(xp->xp_tok)) != 0 &&
+                     strncmp("[CDATA[", p, cbuf_len(xp->xp_tok)) != 0)
+                goto perr;
+            break;
+        case XP_COMMENT:
+            if (c == '>' && xp->xp_dash >= 2)
+                xp->xp_state = XP_CONTENT;
+            else if (c == '-')
+                xp->xp_dash++;
+            else{
+                if (c == '\n')
+                    xp->xp_linenum++;
+                xp->xp_dash = 0;
+            }
+            break;
+        case XP_CDATA:
+            cbuf_append(xp->xp_tok, c);
+            if (c == '>' && xp->xp_dash >= 2){
+                if (xp_content(xp, 0, cbuf_get(xp->xp_tok)) < 0)
+                    goto err;
+                cbuf_reset(xp->xp_tok);
+                xp->xp_state = XP_CONTENT;
+            }
+            else if (c == ']')
+                xp->xp_dash++;
+            else{
+                if (c == '\n')
+                    xp->xp_linenum++;
+                xp->xp_dash = 0;
+            }
+            break;
+        case XP_PI:
+            cbuf_append(xp->xp_tok, c);
+            if (c == '>' && cbuf_len(xp->xp_tok) > 1 &&
+                cbuf_get(xp->xp_tok)[cbuf_len(xp->xp_tok)-2] == '?'){
+                cbuf_trunc(xp->xp_tok, cbuf_len(xp->xp_tok)-1);
+                if (xp_pi(xp, c) < 0)
+                    goto err;
+                xp->xp_state = XP_CONTENT;
+            }
+            break;
+        } /* switch state */
+        i++;
+    } /* while */
+    /* Flush text runs and CDATA to bound memory to one chunk */
+    if (xp->xp_state == XP_CONTENT){
+        if (xp_text_flush(xp) < 0)
+            goto err;
+    }
+    else if (xp->xp_state == XP_CDATA && cbuf_len(xp->xp_tok)){
+        if (xp_content(xp, 0, cbuf_get(xp->xp_tok)) < 0)
+            goto err;
+        cbuf_reset(xp->xp_tok);
+    }
+    retval = 0;
+ done:
+    return retval;
+ perr: /* Syntax error */
+    xp_error(xp, c, "syntax error");
+ err:
+    xp->xp_err = 1;
+    goto done;
+}
+
+/*! Signal end of input to an incremental XML parser and bind yang
+ *
+ * Check that the document is complete, and then make the same yang binding and sorting as
+ * clixon_xml_parse_string.
+ * @param[in]  xp    Push parser handle
+ * @param[out] xerr  Reason for failure (yang assignment not made)
+ * @retval     1     Parse OK and all yang assignment made
+ * @retval     0     Parse OK but yang assigment not made (or only partial) and xerr set
+ * @retval    -1     Error with clicon_err called. Includes parse error
+ * @note empty input is accepted, see _xml_parse
+ */
+int
+clixon_xml_push_done(clixon_xml_push *xp,
+                     cxobj          **xerr)
+{
+    int retval = -1;
+
+    if (xp->xp_err)
+        goto done;
+    if (xp->xp_len == 0){
+        retval = 1;
+        goto done;
+    }
+    if (xp->xp_state != XP_CONTENT || xp->xp_depth != 0){
+        clicon_err(OE_XML, XMLPARSE_ERRNO, "xml_parse: line %d: syntax error: unexpected end of input",
+                   xp->xp_linenum);
+        xp->xp_err = 1;
+        goto done;
+    }
+    if (xp_text_flush(xp) < 0)
+        goto done;
+    retval = clixon_xml_parse_post(xp->xp_yb, xp->xp_yspec, xp->xp_xtop,
+                                   xp->xp_xvec, xp->xp_xlen, xerr);
+ done:
+    return retval;
+}
+
+/*! Get top of XML parse tree of an incremental XML parser
+ * @param[in]  xp    Push parser handle
+ * @retval     xt    Top of XML parse tree as given in clixon_xml_push_new
+ */
+cxobj *
+clixon_xml_push_top(clixon_xml_push *xp)
+{
+    return xp->xp_xtop;
+}
+
+/*! Get number of bytes fed to an incremental XML parser
+ * @param[in]  xp    Push parser handle
+ * @retval     len   Number of bytes
+ */
+size_t
+clixon_xml_push_len(clixon_xml_push *xp)
+{
+    return xp->xp_len;
+}
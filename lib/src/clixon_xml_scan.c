@@ -0,0 +1,266 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2009-2016 Olof Hagsand and Benny Holmgren
+  Copyright (C) 2017-2019 Olof Hagsand
+  Copyright (C) 2020-2022 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * XML lexical scanning of character data spans
+ * Find the length of runs of character data and whitespace in XML content, ie where the
+ * incremental parser can skip ahead without examining each byte in its state machine.
+ * On x86 the scan is made 16 or 32 bytes at a time using SSE2 or AVX2, selected at runtime
+ * from what the CPU supports. Otherwise, or on other architectures, a scalar loop is used.
+ * Spans are returned as lengths into the input buffer, the input is not copied.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define XML_SCAN_X86
+#include <immintrin.h>
+#endif
+
+#include "clixon_xml_scan.h"
+
+/* Scan function type: return length of span starting at buf */
+typedef size_t (xml_scan_fn)(const char *buf, size_t len);
+
+/* Selected scan functions, set on first use, see xml_scan_select */
+static xml_scan_fn *_scan_chardata = NULL;
+static xml_scan_fn *_scan_space = NULL;
+static const char  *_scan_impl = NULL;
+
+/*! Scalar: length of character data, stop at markup, entity or whitespace
+ * @see STATEA [^&\r\n \t\<]+ in clixon_xml_parse.l
+ */
+static size_t
+xml_scan_chardata_scalar(const char *buf,
+                         size_t      len)
+{
+    size_t i;
+
+    for (i=0; i<len; i++)
+        switch (buf[i]){
+        case '<': case '&': case ' ': case '\t': case '\r': case '\n':
+            return i;
+        default:
+            break;
+        }
+    return i;
+}
+
+/*! Scalar: length of space and tab run
+ * @see STATEA [ \t]+ in clixon_xml_parse.l
+ */
+static size_t
+xml_scan_space_scalar(const char *buf,
+                      size_t      len)
+{
+    size_t i;
+
+    for (i=0; i<len; i++)
+        if (buf[i] != ' ' && buf[i] != '\t')
+            break;
+    return i;
+}
+
+#ifdef XML_SCAN_X86
+/*! SSE2: length of character data, 16 bytes at a time
+ * @see xml_scan_chardata_scalar
+ */
+__attribute__ ((target ("sse2")))
+static size_t
+xml_scan_chardata_sse2(const char *buf,
+                       size_t      len)
+{
+    size_t  i = 0;
+    __m128i v;
+    __m128i m;
+    int     mask;
+
+    for (; i+16 <= len; i += 16){
+        v = _mm_loadu_si128((const __m128i*)(buf+i));
+        m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('<')),
+                                      _mm_cmpeq_epi8(v, _mm_set1_epi8('&'))),
+                         _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                      _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+        m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        if ((mask = _mm_movemask_epi8(m)) != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return i + xml_scan_chardata_scalar(buf+i, len-i);
+}
+
+/*! SSE2: length of space and tab run, 16 bytes at a time
+ * @see xml_scan_space_scalar
+ */
+__attribute__ ((target ("sse2")))
+static size_t
+xml_scan_space_sse2(const char *buf,
+                    size_t      len)
+{
+    size_t  i = 0;
+    __m128i v;
+    __m128i m;
+    int     mask;
+
+    for (; i+16 <= len; i += 16){
+        v = _mm_loadu_si128((const __m128i*)(buf+i));
+        m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+        if ((mask = ~_mm_movemask_epi8(m) & 0xffff) != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return i + xml_scan_space_scalar(buf+i, len-i);
+}
+
+/*! AVX2: length of character data, 32 bytes at a time
+ * @see xml_scan_chardata_scalar
+ */
+__attribute__ ((target ("avx2")))
+static size_t
+xml_scan_chardata_avx2(const char *buf,
+                       size_t      len)
+{
+    size_t   i = 0;
+    __m256i  v;
+    __m256i  m;
+    uint32_t mask;
+
+    for (; i+32 <= len; i += 32){
+        v = _mm256_loadu_si256((const __m256i*)(buf+i));
+        m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')),
+                                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('&'))),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+        m = _mm256_or_si256(m, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        if ((mask = (uint32_t)_mm256_movemask_epi8(m)) != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return i + xml_scan_chardata_sse2(buf+i, len-i);
+}
+
+/*! AVX2: length of space and tab run, 32 bytes at a time
+ * @see xml_scan_space_scalar
+ */
+__attribute__ ((target ("avx2")))
+static size_t
+xml_scan_space_avx2(const char *buf,
+                    size_t      len)
+{
+    size_t   i = 0;
+    __m256i  v;
+    __m256i  m;
+    uint32_t mask;
+
+    for (; i+32 <= len; i += 32){
+        v = _mm256_loadu_si256((const __m256i*)(buf+i));
+        m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+        if ((mask = ~(uint32_t)_mm256_movemask_epi8(m)) != 0)
+            return i + __builtin_ctz(mask);
+    }
+    return i + xml_scan_space_sse2(buf+i, len-i);
+}
+#endif /* XML_SCAN_X86 */
+
+/*! Select scan functions from CPU features
+ */
+static void
+xml_scan_select(void)
+{
+    _scan_chardata = xml_scan_chardata_scalar;
+    _scan_space = xml_scan_space_scalar;
+    _scan_impl = "scalar";
+#ifdef XML_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")){
+        _scan_chardata = xml_scan_chardata_avx2;
+        _scan_space = xml_scan_space_avx2;
+        _scan_impl = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2")){
+        _scan_chardata = xml_scan_chardata_sse2;
+        _scan_space = xml_scan_space_sse2;
+        _scan_impl = "sse2";
+    }
+#endif
+}
+
+/*! Length of character data at start of buffer
+ *
+ * Character data ends at '<', '&' or whitespace (which the parser handles separately)
+ * @param[in]  buf  Input buffer, not necessarily null-terminated
+ * @param[in]  len  Length of buf
+ * @retval     n    Number of leading character data bytes in buf, 0 <= n <= len
+ */
+size_t
+clixon_xml_scan_chardata(const char *buf,
+                         size_t      len)
+{
+    if (_scan_chardata == NULL)
+        xml_scan_select();
+    return _scan_chardata(buf, len);
+}
+
+/*! Length of space and tab run at start of buffer
+ *
+ * @param[in]  buf  Input buffer, not necessarily null-terminated
+ * @param[in]  len  Length of buf
+ * @retval     n    Number of leading space and tab bytes in buf, 0 <= n <= len
+ */
+size_t
+clixon_xml_scan_space(const char *buf,
+                      size_t      len)
+{
+    if (_scan_space == NULL)
+        xml_scan_select();
+    return _scan_space(buf, len);
+}
+
+/*! Name of selected scan implementation: "avx2", "sse2" or "scalar"
+ */
+const char *
+clixon_xml_scan_impl(void)
+{
+    if (_scan_impl == NULL)
+        xml_scan_select();
+    return _scan_impl;
+}
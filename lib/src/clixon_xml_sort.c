@@ -1111,6 +1111,98 @@ xml_insert(cxobj           *xp,
     return retval;
 }
 
+/*! Compare two new xml nodes in system order, qsort callback for xml_insert_vec
+ * @note args are pointer to pointers, to fit into qsort cmp function
+ * @note same=0 since new nodes are not enumerated
+ */
+static int
+xml_cmp_qsort_new(const void* arg1,
+                  const void* arg2)
+{
+    return xml_cmp(*(struct xml**)arg1, *(struct xml**)arg2, 0, 0, NULL);
+}
+
+/*! Insert a vector of children into a parent in sorted order using a single merge pass
+ *
+ * Bulk variant of xml_insert for large loads: instead of a binary search and an array
+ * shift for every new child, the new children are sorted once and then merge-joined with
+ * the existing (sorted) children of xp.
+ * @param[in] xp   Parent xml node. Its existing children are assumed to be sorted
+ * @param[in] xv   Vector of yang-bound xml nodes without parents
+ * @retval    0    OK
+ * @retval   -1    Error
+ * @note Only for children ordered-by system, use xml_insert for ordered-by user
+ * @see xml_insert
+ */
+int
+xml_insert_vec(cxobj       *xp,
+               clixon_xvec *xv)
+{
+    int     retval = -1;
+    cxobj **xvec0 = NULL; /* existing children */
+    cxobj **xvec1 = NULL; /* new children */
+    int     len0;
+    int     len1;
+    int     i0;
+    int     i1;
+    int     i;
+    cxobj  *x;
+
+    if ((len1 = clixon_xvec_len(xv)) == 0)
+        goto ok;
+    if ((xvec1 = malloc(len1*sizeof(cxobj *))) == NULL){
+        clicon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    for (i1=0; i1<len1; i1++){
+        x = clixon_xvec_i(xv, i1);
+        if (xml_parent(x) != NULL){
+            clicon_err(OE_XML, 0, "XML node %s should not have parent", xml_name(x));
+            goto done;
+        }
+        if (xml_spec(x) == NULL){
+            clicon_err(OE_XML, 0, "No spec found %s", xml_name(x));
+            goto done;
+        }
+        xvec1[i1] = x;
+    }
+    qsort(xvec1, len1, sizeof(cxobj *), xml_cmp_qsort_new);
+    len0 = xml_child_nr(xp);
+    if (len0){
+        if ((xvec0 = malloc(len0*sizeof(cxobj *))) == NULL){
+            clicon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        memcpy(xvec0, xml_childvec_get(xp), len0*sizeof(cxobj *));
+    }
+    if (xml_childvec_set(xp, len0 + len1) < 0)
+        goto done;
+    i = i0 = i1 = 0;
+    /* Assume if there are any attributes, they are first in the list, see xml_insert */
+    while (i0 < len0 && xml_type(xvec0[i0]) == CX_ATTR)
+        xml_child_i_set(xp, i++, xvec0[i0++]);
+    while (i0 < len0 || i1 < len1){
+        if (i1 == len1 ||
+            (i0 < len0 && xml_cmp(xvec0[i0], xvec1[i1], 0, 0, NULL) <= 0))
+            x = xvec0[i0++];
+        else{
+            x = xvec1[i1++];
+            xml_parent_set(x, xp);
+            /* clear namespace context cache of child */
+            nscache_clear(x);
+        }
+        xml_child_i_set(xp, i++, x);
+    }
+ ok:
+    retval = 0;
+ done:
+    if (xvec0)
+        free(xvec0);
+    if (xvec1)
+        free(xvec1);
+    return retval;
+}
+
 /*! Verify all children of XML node are sorted according to xml_sort()
  * @param[in]   x    XML node. Check its children
  * @param[in]   arg  Dummy. Ensures xml_apply can be used with this fn
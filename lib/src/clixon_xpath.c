@@ -600,11 +600,42 @@ xpath_vec_ctx(cxobj      *xcur,
 {
     int         retval = -1;
     xpath_tree *xptree = NULL;
-    xp_ctx      xc = {0,};
     
     clicon_debug(CLIXON_DBG_DETAIL, "%s", __FUNCTION__);
     if (xpath_parse(xpath, &xptree) < 0)
         goto done;
+    if (xpath_tree_vec_ctx(xcur, nsc, xptree, localonly, xrp) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xptree)
+        xpath_tree_free(xptree);
+    return retval;
+}
+
+/*! Evaluate an already parsed xpath and return a context
+ *
+ * Same as xpath_vec_ctx but with a parse-tree, so that an xpath evaluated many times
+ * only needs to be parsed once.
+ * @param[in]  xcur      XML-tree where to search
+ * @param[in]  nsc       External XML namespace context, or NULL
+ * @param[in]  xptree    XPath parse-tree, see xpath_parse
+ * @param[in]  localonly Skip prefix and namespace tests (non-standard)
+ * @param[out] xrp       Return XPATH context
+ * @retval     0         OK
+ * @retval    -1         Error
+ * @see xpath_vec_ctx
+ */
+int
+xpath_tree_vec_ctx(cxobj      *xcur, 
+                   cvec       *nsc,
+                   xpath_tree *xptree,
+                   int         localonly,
+                   xp_ctx    **xrp)
+{
+    int         retval = -1;
+    xp_ctx      xc = {0,};
+    
     xc.xc_type = XT_NODESET;
     xc.xc_node = xcur;
     xc.xc_initial = xcur;
@@ -618,8 +649,6 @@ xpath_vec_ctx(cxobj      *xcur,
         free(xc.xc_nodeset);
         xc.xc_nodeset = NULL;
     }
-    if (xptree)
-        xpath_tree_free(xptree);
     return retval;
 }
 
@@ -684,6 +713,34 @@ xpath_first(cxobj      *xcur,
     return cx;
 }
 
+/*! XPath nodeset function using a parsed xpath where only the first matching entry is returned
+ *
+ * @param[in]  xcur      XML tree where to search
+ * @param[in]  nsc       External XML namespace context, or NULL
+ * @param[in]  xptree    XPath parse-tree, see xpath_parse
+ * @retval     xml-tree  XML tree of first match
+ * @retval     NULL      Error or not found
+ * @note return value does not see difference between error and not found
+ * @see xpath_first
+ */
+cxobj *
+xpath_first_tree(cxobj      *xcur, 
+                 cvec       *nsc,
+                 xpath_tree *xptree)
+{
+    cxobj  *cx = NULL;
+    xp_ctx *xr = NULL;
+
+    if (xpath_tree_vec_ctx(xcur, nsc, xptree, 0, &xr) < 0)
+        goto done;
+    if (xr && xr->xc_type == XT_NODESET && xr->xc_size)
+        cx = xr->xc_nodeset[0];
+ done:
+    if (xr)
+        ctx_free(xr);
+    return cx;
+}
+
 /*! XPath nodeset function where prefixes are skipped, only first matching is returned
  *
  * Reason for skipping prefix/namespace check may be with incomplete tree, for example.
@@ -120,6 +120,9 @@ chmod 660 $dir/www/data/noread.html
 # bitmap
 cp ./clixon.png  $dir/www/data/
 
+# Larger than HTTP_DATA_CACHE_FILE_MAX, is sent from file
+dd if=/dev/urandom of=$dir/www/data/large.bin bs=1024 count=300 2> /dev/null
+
 # Http test routine with arguments:
 # 1. proto:http/https
 function testrun()
@@ -233,6 +236,33 @@ EOF
             err1 "$dir/foo.png $dir/www/data/example.css should be equal" "Not equal"
         fi
 
+        new "WWW large file"
+        curl $CURLOPTS2 -X GET $proto://localhost/data/large.bin -o $dir/foo.bin
+        cmp $dir/foo.bin $dir/www/data/large.bin
+        if [ $? -ne 0 ]; then
+            err1 "$dir/foo.bin $dir/www/data/large.bin should be equal" "Not equal"
+        fi
+
+        new "WWW head large file"
+        expectpart "$(curl $CURLOPTS --head $proto://localhost/data/large.bin)" 0 "HTTP/$HVER 200" "Content-Length: 307200" "ETag: "
+
+        new "WWW get css etag"
+        etag=$(curl $CURLOPTS -X GET $proto://localhost/data/example.css | grep -i "^etag:" | sed 's/^[^:]*: *//' | tr -d '\r')
+        if [ -z "$etag" ]; then
+            err "ETag" "none"
+        fi
+
+        new "WWW get css If-None-Match expect 304"
+        expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag" $proto://localhost/data/example.css)" 0 "HTTP/$HVER 304" "ETag: $etag" --not-- "display: inline;"
+
+        new "WWW get css If-None-Match other etag"
+        expectpart "$(curl $CURLOPTS -X GET -H 'If-None-Match: "0-0-0"' $proto://localhost/data/example.css)" 0 "HTTP/$HVER 200" "display: inline;"
+
+        new "WWW modify css, get new contents"
+        sleep 1
+        echo "p.modified { color: red; }" >> $dir/www/data/example.css
+        expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag" $proto://localhost/data/example.css)" 0 "HTTP/$HVER 200" "display: inline;" "p.modified" --not-- "ETag: $etag"
+
         # negative errors
         new "WWW get http not found"
         expectpart "$(curl $CURLOPTS -X GET -H 'Accept: text/html' $proto://localhost/data/notfound.html)" 0 "HTTP/$HVER 404" "Content-Type: text/html" "<title>404 Not Found</title>"
@@ -304,6 +334,7 @@ for proto in $protos; do
 done
 
 # unset conditional parameters
+unset etag
 unset RCPROTO
 unset RESTCONFIG
 
@@ -138,11 +138,30 @@ JSON='{"json:c":{"s":"<![CDATA[  z > x  & x < y ]]>"}}'
 new "json parse cdata xml"
 expecteofx "$clixon_util_json -j -y $fyang" 0 "$JSON" "$JSON"
 
+JSON='{"json:c":{"s":"a\nb \"q\" c\\d"}}'
+new "json parse escaped string back to json"
+expecteofx "$clixon_util_json -j -y $fyang" 0 "$JSON" "$JSON"
+
+new "json parse unicode escape to xml"
+expecteofx "$clixon_util_json" 0 '{"foo":"\u0041\u00e5"}' "<foo>Aå</foo>"
+
+new "json parse real and exponent numbers"
+expecteofx "$clixon_util_json" 0 '{"a":[-1.25,0.5e-3,7E+2]}' "<a>-1.25</a><a>0.5e-3</a><a>7E+2</a>"
+
+for n in 1.2.3 1..2 -.5 .5 1. 1e; do
+    new "json parse invalid number $n"
+    expecteofx "$clixon_util_json" 255 "{\"a\":$n}" "" 2> /dev/null
+done
+
+new "json parse unescaped control character in string"
+expecteofx "$clixon_util_json" 255 $'{"foo":"a\tb"}' "" 2> /dev/null
+
 rm -rf $dir
 
 # unset conditional parameters 
 unset clixon_util_json
 unset clixon_util_xml
+unset n
 
 new "endtest"
 endtest
@@ -0,0 +1,178 @@
+#!/usr/bin/env bash
+# Authentication and authorization and IETF NACM
+# NACM data node read rules are compiled per user and cached until the NACM config changes.
+# Read a subtree where some nodes are permitted and some are denied, by a rule on a schema
+# node and a rule on a list entry. Then change the rules between reads and check that the
+# new rules apply.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/nacm-example.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
+  <CLICON_NACM_DISABLED_ON_EMPTY>true</CLICON_NACM_DISABLED_ON_EMPTY>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module nacm-example{
+  yang-version 1.1;
+  namespace "urn:example:nacm";
+  prefix ex;
+  import ietf-netconf-acm {
+    prefix nacm;
+  }
+  container table{
+    list parameter{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf value{
+        type string;
+      }
+      leaf secret{
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+RULES=$(cat <<EOF
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+
+     $NGROUPS
+
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>secret</name>
+         <module-name>*</module-name>
+         <access-operations>read</access-operations>
+         <path xmlns:ex="urn:example:nacm">/ex:table/ex:parameter/ex:secret</path>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>entry-b</name>
+         <module-name>*</module-name>
+         <access-operations>read</access-operations>
+         <path xmlns:ex="urn:example:nacm">/ex:table/ex:parameter[ex:name='b']</path>
+         <action>deny</action>
+       </rule>
+     </rule-list>
+
+     $NADMIN
+
+   </nacm>
+EOF
+)
+
+CONFIG=$(cat <<EOF
+   <table xmlns="urn:example:nacm">
+     <parameter><name>a</name><value>1</value><secret>x</secret></parameter>
+     <parameter><name>b</name><value>2</value><secret>y</secret></parameter>
+     <parameter><name>c</name><value>3</value><secret>z</secret></parameter>
+   </table>
+EOF
+)
+
+# Read table as limited user wilma
+# 1: Expected table
+function readtable()
+{
+    expecteof_netconf "$clixon_netconf -U wilma -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table\" xmlns:ex=\"urn:example:nacm\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data>$1</data></rpc-reply>"
+}
+
+# Edit NACM rules of limited-acl as admin user andy and commit
+# 1: Rule edits
+function editrules()
+{
+    expecteof_netconf "$clixon_netconf -U andy -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><nacm xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-acm\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><rule-list><name>limited-acl</name>$1</rule-list></nacm></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    expecteof_netconf "$clixon_netconf -U andy -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "set nacm rules and config"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$RULES$CONFIG</config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "commit it"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "admin reads all"
+expecteof_netconf "$clixon_netconf -U andy -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:table\" xmlns:ex=\"urn:example:nacm\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value><secret>x</secret></parameter><parameter><name>b</name><value>2</value><secret>y</secret></parameter><parameter><name>c</name><value>3</value><secret>z</secret></parameter></table></data></rpc-reply>"
+
+new "limited reads table without secret leafs and entry b"
+readtable "<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value></parameter><parameter><name>c</name><value>3</value></parameter></table>"
+
+new "limited reads table again, same result"
+readtable "<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value></parameter><parameter><name>c</name><value>3</value></parameter></table>"
+
+new "change secret rule to permit"
+editrules "<rule><name>secret</name><action>permit</action></rule>"
+
+new "limited reads table with secret leafs, without entry b"
+readtable "<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value><secret>x</secret></parameter><parameter><name>c</name><value>3</value><secret>z</secret></parameter></table>"
+
+new "delete entry-b rule"
+editrules "<rule nc:operation=\"delete\"><name>entry-b</name></rule>"
+
+new "limited reads whole table"
+readtable "<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value><secret>x</secret></parameter><parameter><name>b</name><value>2</value><secret>y</secret></parameter><parameter><name>c</name><value>3</value><secret>z</secret></parameter></table>"
+
+new "change secret rule back to deny"
+editrules "<rule><name>secret</name><action>deny</action></rule>"
+
+new "limited reads table without secret leafs"
+readtable "<table xmlns=\"urn:example:nacm\"><parameter><name>a</name><value>1</value></parameter><parameter><name>b</name><value>2</value></parameter><parameter><name>c</name><value>3</value></parameter></table>"
+
+if [ $BE -ne 0 ]; then     # Bring your own backend
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
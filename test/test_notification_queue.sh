@@ -0,0 +1,254 @@
+#!/usr/bin/env bash
+# Per-client notification output queue of the backend
+# First check that a batch of events sent with stream_notify_vec is delivered in order.
+# Then a slow subscriber does not read its notifications while the example backend sends bursts of
+# events on the EXAMPLE stream. Check for each CLICON_NOTIFICATION_QUEUE_POLICY that the
+# queue overflows, that the dropped counter in netconf-monitoring accounts for all events
+# the subscriber did not get, or that the subscriber is disconnected.
+# @see test_netconf_notifications.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Dont run this test with valgrind
+if [ $valgrindtest -ne 0 ]; then
+    echo "...skipped "
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+flog=$dir/backend.log
+
+# Max number of queued notifications per client
+: ${queuemax:=100}
+
+# Number of bursts and events per burst, about 1MB, more than socket and pipe buffers hold
+: ${nrbursts:=40}
+nr=$queuemax
+
+# Create config
+# 1: CLICON_NOTIFICATION_QUEUE_POLICY
+function config()
+{
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_RETENTION>60</CLICON_STREAM_RETENTION>
+  <CLICON_NETCONF_MONITORING>true</CLICON_NETCONF_MONITORING>
+  <CLICON_NOTIFICATION_QUEUE_MAX>$queuemax</CLICON_NOTIFICATION_QUEUE_MAX>
+  <CLICON_NOTIFICATION_QUEUE_POLICY>$1</CLICON_NOTIFICATION_QUEUE_POLICY>
+</clixon-config>
+EOF
+}
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   notification event {
+      leaf event-class {
+         type string;
+      }
+      container reportingEntity {
+         leaf card {
+            type string;
+         }
+      }
+      leaf severity {
+         type string;
+      }
+   }
+   rpc notify-burst {
+      input {
+         leaf count {
+            type uint32;
+         }
+      }
+   }
+}
+EOF
+
+# Start backend with example stream without periodic events
+# 1: CLICON_NOTIFICATION_QUEUE_POLICY
+function testinit()
+{
+    config $1
+    new "test params: -f $cfg -l f$flog -- -N"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        rm -f $flog
+        new "start backend -s init -f $cfg -l f$flog -- -N"
+        start_backend -s init -f $cfg -l f$flog -- -N
+    fi
+
+    new "wait backend"
+    wait_backend
+}
+
+function testexit()
+{
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+# Subscribe to EXAMPLE stream in background, save notifications in $dir/sub.out
+# 1: Seconds to stay subscribed
+# 2: Seconds before subscriber starts reading notifications
+function subscribe()
+{
+    sleep $1 | cat <(echo "$HELLONO11<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream></create-subscription></rpc>]]>]]>") - | $clixon_netconf -qef $cfg | (sleep $2; cat) > $dir/sub.out &
+    # Wait for subscription
+    sleep 1
+}
+
+# Send bursts of events in one netconf session
+# 1: Number of bursts
+# 2: Number of events per burst
+function bursts()
+{
+    rpcs=""
+    for i in $(seq 1 $1); do
+        rpcs="$rpcs<rpc $DEFAULTNS message-id=\"$i\"><notify-burst xmlns=\"urn:example:clixon\"><count>$2</count></notify-burst></rpc>]]>]]>"
+    done
+    new "send $1 bursts of $2 events"
+    ret=$(echo "$HELLONO11$rpcs" | $clixon_netconf -qef $cfg)
+    n=$(echo "$ret" | grep -o "<ok/>" | wc -l)
+    if [ $n -ne $1 ]; then
+        err "$1 ok" "$ret"
+    fi
+}
+
+# Get max out-notifications-dropped of all sessions
+function dropped()
+{
+    ret=$(echo "$HELLONO11<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ncm:netconf-state/ncm:sessions\" xmlns:ncm=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\"/></get></rpc>]]>]]>" | $clixon_netconf -qef $cfg)
+    echo "$ret" | grep -o "<out-notifications-dropped[^>]*>[0-9]*<" | sed 's/<[^>]*>//; s/<//' | sort -n | tail -1
+}
+
+total=$((nrbursts*nr))
+
+new "batch delivery"
+testinit drop-oldest
+
+new "subscriber"
+subscribe 4 0
+
+bursts 1 $nr
+
+new "check no notifications are dropped"
+d=$(dropped)
+if [ -z "$d" ] || [ $d -ne 0 ]; then
+    err "0" "$d"
+fi
+
+new "check batch of $nr events is delivered in order"
+wait
+cards=$(grep -o "<card>[0-9]*</card>" $dir/sub.out | sed 's/<[^>]*>//g' | tr '\n' ' ')
+expect="$(seq -s ' ' 1 $nr) "
+if [ "$cards" != "$expect" ]; then
+    err "$expect" "$cards"
+fi
+
+testexit
+
+for policy in drop-oldest coalesce; do
+    new "policy $policy"
+    testinit $policy
+
+    new "slow subscriber"
+    subscribe 12 3
+
+    bursts $nrbursts $nr
+
+    # Let the subscriber catch up
+    sleep 5
+
+    new "check notifications are dropped"
+    d=$(dropped)
+    if [ -z "$d" ] || [ $d -eq 0 ]; then
+        err "dropped > 0" "$d"
+    fi
+
+    wait
+
+    new "check received and dropped are all $total events"
+    n=$(grep -o "<notification " $dir/sub.out | wc -l)
+    if [ $((n+d)) -ne $total ]; then
+        err "$total" "received $n + dropped $d"
+    fi
+
+    new "check last event is received"
+    last=$(grep -o "<card>[0-9]*</card>" $dir/sub.out | tail -1)
+    if [ "$last" != "<card>$nr</card>" ]; then
+        err "<card>$nr</card>" "$last"
+    fi
+
+    testexit
+done
+
+new "policy disconnect"
+testinit disconnect
+
+new "slow subscriber"
+subscribe 12 3
+
+bursts $nrbursts $nr
+
+new "check subscriber is disconnected"
+wait
+n=$(grep -o "<notification " $dir/sub.out | wc -l)
+if [ $n -ge $total ]; then
+    err "less than $total" "$n"
+fi
+
+if [ $BE -ne 0 ]; then
+    new "check disconnect is logged"
+    expectpart "$(cat $flog)" 0 "notification queue full, disconnecting"
+fi
+
+new "check there are no dropped counters left"
+d=$(dropped)
+if [ -n "$d" ] && [ $d -ne 0 ]; then
+    err "0" "$d"
+fi
+
+testexit
+
+unset queuemax
+unset nrbursts
+unset nr
+unset total
+unset rpcs
+unset policy
+unset last
+unset cards
+unset expect
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -6,6 +6,7 @@
 # No test of ordered-by system is done yet
 # (we may want to sort them alphabetically for better performance).
 # Also: ordered-by-user and "insert" and "key"/"value" attributes
+# Also: bulk merge of system ordered entries into existing entries, see CLICON_XMLDB_BULK_THRESHOLD
 
 # Magic line must be first in script (see README.md)
 s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
@@ -43,6 +44,7 @@ cat <<EOF > $cfg
   <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
   <CLICON_XMLDB_DIR>$dbdir</CLICON_XMLDB_DIR>
   <CLICON_XMLDB_FORMAT>$format</CLICON_XMLDB_FORMAT>
+  <CLICON_XMLDB_BULK_THRESHOLD>5</CLICON_XMLDB_BULK_THRESHOLD>
 </clixon-config>
 EOF
 
@@ -444,6 +446,16 @@ expecteof_netconf "$clixon_netconf -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS
 new "check ordered-by-user: e,a,71,b,42,c,d"
 expecteof_netconf "$clixon_netconf -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><y2 xmlns=\"urn:example:order\"><k>e</k><a>bar</a></y2><y2 xmlns=\"urn:example:order\"><k>a</k><a>foo</a></y2><y2 xmlns=\"urn:example:order\"><k>71</k><a>fie</a></y2><y2 xmlns=\"urn:example:order\"><k>b</k><a>bar</a></y2><y2 xmlns=\"urn:example:order\"><k>42</k><a>fum</a></y2><y2 xmlns=\"urn:example:order\"><k>c</k><a>foo</a></y2><y2 xmlns=\"urn:example:order\"><k>d</k><a>fie</a></y2></data></rpc-reply>"
 
+# Bulk merge, see CLICON_XMLDB_BULK_THRESHOLD
+new "add entries (c,m) to list and (c) to leaf-list system order"
+expecteof_netconf "$clixon_netconf -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><y3 xmlns=\"urn:example:order\"><k>c</k></y3><y3 xmlns=\"urn:example:order\"><k>m</k></y3><y1 xmlns=\"urn:example:order\">c</y1></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "add more entries than bulk threshold, interleaved with existing entries"
+expecteof_netconf "$clixon_netconf -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><y3 xmlns=\"urn:example:order\"><k>q</k></y3><y1 xmlns=\"urn:example:order\">b</y1><y3 xmlns=\"urn:example:order\"><k>a</k></y3><y3 xmlns=\"urn:example:order\"><k>n</k></y3><y1 xmlns=\"urn:example:order\">a</y1><y3 xmlns=\"urn:example:order\"><k>b</k></y3><y3 xmlns=\"urn:example:order\"><k>z</k></y3><y3 xmlns=\"urn:example:order\"><k>d</k></y3></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "check system order after bulk merge: y1 a,b,c y2 unchanged y3 a,b,c,d,m,n,q,z"
+expecteof_netconf "$clixon_netconf -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><y1 xmlns=\"urn:example:order\">a</y1><y1 xmlns=\"urn:example:order\">b</y1><y1 xmlns=\"urn:example:order\">c</y1><y2 xmlns=\"urn:example:order\"><k>e</k><a>bar</a></y2><y2 xmlns=\"urn:example:order\"><k>a</k><a>foo</a></y2><y2 xmlns=\"urn:example:order\"><k>71</k><a>fie</a></y2><y2 xmlns=\"urn:example:order\"><k>b</k><a>bar</a></y2><y2 xmlns=\"urn:example:order\"><k>42</k><a>fum</a></y2><y2 xmlns=\"urn:example:order\"><k>c</k><a>foo</a></y2><y2 xmlns=\"urn:example:order\"><k>d</k><a>fie</a></y2><y3 xmlns=\"urn:example:order\"><k>a</k></y3><y3 xmlns=\"urn:example:order\"><k>b</k></y3><y3 xmlns=\"urn:example:order\"><k>c</k></y3><y3 xmlns=\"urn:example:order\"><k>d</k></y3><y3 xmlns=\"urn:example:order\"><k>m</k></y3><y3 xmlns=\"urn:example:order\"><k>n</k></y3><y3 xmlns=\"urn:example:order\"><k>q</k></y3><y3 xmlns=\"urn:example:order\"><k>z</k></y3></data></rpc-reply>"
+
 if [ $BE -ne 0 ]; then
     new "Kill backend"
     # Check if premature kill
@@ -0,0 +1,174 @@
+#!/usr/bin/env bash
+# Cursor-based list pagination of a config list
+# The first page is requested with an empty clixon-lib cursor attribute, which creates
+# a snapshot of the list in the backend. Following pages are read from the snapshot using
+# the next-cursor token of the previous reply. Check that pages are stable when the list
+# is changed, that the snapshot is removed after the last page, and restconf cursor links.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example-cursor.yang
+
+# Number of list entries
+: ${nr:=12}
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config none false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>ietf-netconf:startup</CLICON_FEATURE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_BACKEND_PAGINATION_CURSORS>4</CLICON_BACKEND_PAGINATION_CURSORS>
+  <CLICON_BACKEND_PAGINATION_CURSOR_TTL>60</CLICON_BACKEND_PAGINATION_CURSOR_TTL>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example-cursor {
+   namespace "urn:example:cursor";
+   prefix "ex";
+   container c {
+      list entry {
+         key name;
+         leaf name { type string; }
+         leaf value { type uint32; }
+      }
+   }
+}
+EOF
+
+# Startup with nr entries
+echo "<config><c xmlns=\"urn:example:cursor\">" > $dir/startup_db
+for (( i=0; i<$nr; i++ )); do
+    echo "<entry><name>e$(printf "%02d" $i)</name><value>$i</value></entry>" >> $dir/startup_db
+done
+echo "</c></config>" >> $dir/startup_db
+
+# Get a page of the list using a cursor and set next to the next cursor token
+# 1: cursor token, empty for new snapshot
+# 2: first entry of page
+# 3: last entry of page
+function get_page()
+{
+    cursor=$1
+    first=$2
+    last=$3
+
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><get cl:cursor=\"$cursor\" xmlns:cl=\"http://clicon.org/lib\"><filter type=\"xpath\" select=\"/ex:c/ex:entry\" xmlns:ex=\"urn:example:cursor\"/><list-pagination xmlns=\"urn:ietf:params:xml:ns:yang:ietf-list-pagination-nc\"><limit>4</limit></list-pagination></get></rpc>")
+    ret=$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qf $cfg)
+    match=$(echo "$ret" | grep --null -Go "<data><c xmlns=\"urn:example:cursor\"><entry><name>$first</name>")
+    if [ -z "$match" ]; then
+        err "<data><c xmlns=\"urn:example:cursor\"><entry><name>$first</name>" "$ret"
+    fi
+    match=$(echo "$ret" | grep --null -Go "<entry><name>$last</name><value>[0-9]*</value></entry></c></data>")
+    if [ -z "$match" ]; then
+        err "<entry><name>$last</name>...</entry></c></data>" "$ret"
+    fi
+    next=$(echo "$ret" | grep -o "next-cursor=\"[^\"]*\"" | sed -e 's/next-cursor="\(.*\)"/\1/')
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s startup -f $cfg"
+    start_backend -s startup -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "first page, new snapshot"
+get_page "" e00 e03
+if [ -z "$next" ]; then
+    err "next-cursor" "$ret"
+fi
+
+new "delete e05 and add e04a in running"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:cursor\"><entry nc:operation=\"delete\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><name>e05</name></entry><entry><name>e04a</name></entry></c></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "commit"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "second page from snapshot, not changed"
+get_page "$next" e04 e07
+if [ -z "$next" ]; then
+    err "next-cursor" "$ret"
+fi
+cursor2=$next
+
+new "last page from snapshot"
+get_page "$next" e08 e11
+if [ -n "$next" ]; then
+    err "no next-cursor" "$ret"
+fi
+
+new "snapshot removed after last page"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get cl:cursor=\"$cursor2\" xmlns:cl=\"http://clicon.org/lib\"><filter type=\"xpath\" select=\"/ex:c/ex:entry\" xmlns:ex=\"urn:example:cursor\"/><list-pagination xmlns=\"urn:ietf:params:xml:ns:yang:ietf-list-pagination-nc\"><limit>4</limit></list-pagination></get></rpc>" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag><error-severity>error</error-severity><error-message>List pagination cursor not found or expired</error-message></rpc-error></rpc-reply>"
+
+new "invalid cursor"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get cl:cursor=\"xyz\" xmlns:cl=\"http://clicon.org/lib\"><filter type=\"xpath\" select=\"/ex:c/ex:entry\" xmlns:ex=\"urn:example:cursor\"/><list-pagination xmlns=\"urn:ietf:params:xml:ns:yang:ietf-list-pagination-nc\"><limit>4</limit></list-pagination></get></rpc>" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag><error-severity>error</error-severity><error-message>List pagination cursor not found or expired</error-message></rpc-error></rpc-reply>"
+
+new "new snapshot sees changed list"
+get_page "" e00 e03
+
+new "cursor with other with-defaults"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get cl:cursor=\"$next\" xmlns:cl=\"http://clicon.org/lib\"><filter type=\"xpath\" select=\"/ex:c/ex:entry\" xmlns:ex=\"urn:example:cursor\"/><with-defaults xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-with-defaults\">report-all</with-defaults><list-pagination xmlns=\"urn:ietf:params:xml:ns:yang:ietf-list-pagination-nc\"><limit>4</limit></list-pagination></get></rpc>" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag><error-severity>error</error-severity><error-message>List pagination cursor not found or expired</error-message></rpc-error></rpc-reply>"
+
+get_page "$next" e04 e07
+
+new "restconf first page returns next link"
+expectpart "$(curl $CURLOPTS -X GET -H "Accept: application/yang-data+json" "$RCPROTO://localhost/restconf/data/example-cursor:c/entry?cursor=&limit=4")" 0 "HTTP/$HVER 200" "Link: <?cursor=" "&limit=4>; rel=\"next\"" '"name":"e03"'
+
+new "restconf cursor with invalid characters"
+expectpart "$(curl $CURLOPTS -X GET -H "Accept: application/yang-data+json" "$RCPROTO://localhost/restconf/data/example-cursor:c/entry?cursor=1.2%22%20a=%22&limit=4")" 0 "HTTP/$HVER 400" "Invalid list pagination cursor"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,189 @@
+#!/usr/bin/env bash
+# Native restconf backend session pool, see CLICON_RESTCONF_BACKEND_SESSIONS
+# A restconf client connection is bound to a backend session. Lock candidate from one
+# connection that is kept open, and check that other connections get lock-denied.
+# When the connection is closed its session is closed and the lock is released.
+# With one backend session, all connections share it, and the lock stays with the session
+# after the connection is closed, until it is unlocked.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Only works with native http/1, the open connection is made with bash /dev/tcp
+if [ "${WITH_RESTCONF}" != "native" -o ${HAVE_HTTP1} = false ]; then
+    echo "...skipped: must run with native http/1"
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+# Pin to http/1
+if [ ${HAVE_LIBNGHTTP2} = true ]; then
+    HAVE_LIBNGHTTP2=false
+    CURLOPTS=${CURLOPTS/http2/http1.1}
+    HVER=1.1
+fi
+
+# No SSL due to /dev/tcp
+RCPROTO=http
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+: ${sessions:=4}
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config none false)
+
+# Create config
+# 1: CLICON_RESTCONF_BACKEND_SESSIONS
+function config()
+{
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_RESTCONF_BACKEND_SESSIONS>$1</CLICON_RESTCONF_BACKEND_SESSIONS>
+  $RESTCONFIG
+</clixon-config>
+EOF
+}
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container table{
+      list parameter{
+         key name;
+         leaf name{
+            type string;
+         }
+         leaf value{
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+lock='{"ietf-netconf:input":{"target":{"candidate":[null]}}}'
+
+# Start restconf, lock candidate on an open connection, make requests on other connections
+# and close the connection with the lock
+# 1: CLICON_RESTCONF_BACKEND_SESSIONS
+function testlock()
+{
+    n=$1
+    config $n
+
+    if [ $RC -ne 0 ]; then
+        new "kill old restconf daemon"
+        stop_restconf_pre
+
+        new "start restconf daemon"
+        start_restconf -f $cfg
+    fi
+
+    new "wait restconf"
+    wait_restconf
+
+    new "restconf PUT on other connections"
+    expectpart "$(curl $CURLOPTS -X PUT -H "Content-Type: application/yang-data+json" -d '{"example:parameter":[{"name":"A","value":"42"}]}' $RCPROTO://localhost/restconf/data/example:table/parameter=A)" 0 "HTTP/$HVER 20"
+
+    new "lock candidate on open connection"
+    exec 3<>/dev/tcp/127.0.0.1/80
+    printf "POST /restconf/operations/ietf-netconf:lock HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/yang-data+json\r\nContent-Length: ${#lock}\r\n\r\n${lock}" >&3
+    read -t 5 ret <&3
+    expectpart "$ret" 0 "HTTP/1.1 204"
+
+    new "lock candidate on other connection is denied"
+    expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d "$lock" $RCPROTO://localhost/restconf/operations/ietf-netconf:lock)" 0 "HTTP/$HVER 409" "lock-denied"
+
+    new "restconf GET on other connections"
+    for i in $(seq 1 $((n*2))); do
+        expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:table/parameter=A)" 0 "HTTP/$HVER 200" '{"example:parameter":\[{"name":"A","value":"42"}\]}'
+    done
+
+    new "close connection with lock"
+    exec 3>&-
+    sleep 1
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    sudo pkill -f clixon_backend # to be sure
+
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "$sessions backend sessions"
+testlock $sessions
+
+new "lock candidate on other connection after close"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d "$lock" $RCPROTO://localhost/restconf/operations/ietf-netconf:lock)" 0 "HTTP/$HVER 204"
+
+new "lock released when connection is closed"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d "$lock" $RCPROTO://localhost/restconf/operations/ietf-netconf:lock)" 0 "HTTP/$HVER 204"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+new "1 backend session"
+testlock 1
+
+new "lock stays with shared session after close"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d "$lock" $RCPROTO://localhost/restconf/operations/ietf-netconf:lock)" 0 "HTTP/$HVER 409" "lock-denied"
+
+new "unlock candidate on other connection"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d "$lock" $RCPROTO://localhost/restconf/operations/ietf-netconf:unlock)" 0 "HTTP/$HVER 204"
+
+new "lock candidate after unlock"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d "$lock" $RCPROTO://localhost/restconf/operations/ietf-netconf:lock)" 0 "HTTP/$HVER 204"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+unset sessions
+unset lock
+unset ret
+unset n
+
+rm -rf $dir
+
+new "endtest"
+endtest
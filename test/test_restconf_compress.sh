@@ -0,0 +1,162 @@
+#!/usr/bin/env bash
+# Native restconf reply compression with Accept-Encoding, see compression-min-size
+# Get a large config with gzip and deflate and check it is compressed and is the same as
+# the uncompressed reply. Small replies and clients not accepting compression get
+# uncompressed replies.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Only works with native restconf built with zlib
+if [ "${WITH_RESTCONF}" != "native" ] || ! ldd $(type -p clixon_restconf) | grep -q libz; then
+    echo "...skipped: must run with native restconf and zlib"
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+fdata=$dir/data.json
+
+# Number of list entries in large config
+: ${perfnr:=10000}
+
+# Curl options without -i, headers and body are saved in separate files
+CURLOPTS0=${CURLOPTS/-Ssik/-Ssk}
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config none false | sed "s#<debug>#<compression-min-size>1024</compression-min-size><compression-level>6</compression-level><debug>#")
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container table{
+      list parameter{
+         key name;
+         leaf name{
+            type string;
+         }
+         leaf value{
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    sudo pkill -f clixon_backend # to be sure
+
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "generate large config with $perfnr entries"
+echo -n '{"example:table":{"parameter":[' > $fdata
+for (( i=0; i<$perfnr; i++ )); do
+    if [ $i -ne 0 ]; then
+        echo -n "," >> $fdata
+    fi
+    echo -n "{\"name\":\"$i\",\"value\":\"value-of-parameter-$i\"}" >> $fdata
+done
+echo "]}}" >> $fdata
+
+new "restconf PUT large config"
+expectpart "$(curl $CURLOPTS -X PUT -H "Content-Type: application/yang-data+json" -d @$fdata $RCPROTO://localhost/restconf/data/example:table)" 0 "HTTP/$HVER 201"
+
+new "restconf GET large config uncompressed"
+curl $CURLOPTS0 -X GET -H "Accept: application/yang-data+json" -D $dir/hdrs0 -o $dir/body0 $RCPROTO://localhost/restconf/data/example:table
+if grep -qi "^content-encoding" $dir/hdrs0; then
+    err "no Content-Encoding" "$(grep -i "^content-encoding" $dir/hdrs0)"
+fi
+len0=$(stat -c %s $dir/body0)
+
+for coding in gzip deflate; do
+    new "restconf GET large config $coding"
+    curl $CURLOPTS0 -X GET -H "Accept: application/yang-data+json" -H "Accept-Encoding: $coding" -D $dir/hdrs1 -o $dir/body1 $RCPROTO://localhost/restconf/data/example:table
+    expectpart "$(cat $dir/hdrs1)" 0 "Content-Encoding: $coding" "Vary: Accept-Encoding"
+    len1=$(stat -c %s $dir/body1)
+    if [ $len1 -ge $len0 ]; then
+        err "$coding reply smaller than $len0" "$len1"
+    fi
+    echo "$coding: $len0 -> $len1 bytes"
+
+    new "restconf GET large config $coding decoded is same"
+    curl $CURLOPTS0 -X GET -H "Accept: application/yang-data+json" -H "Accept-Encoding: $coding" --compressed -o $dir/body2 $RCPROTO://localhost/restconf/data/example:table
+    if ! cmp -s $dir/body0 $dir/body2; then
+        err "$coding decoded reply same as uncompressed" "differs"
+    fi
+done
+
+new "restconf GET gzip not acceptable"
+expectpart "$(curl $CURLOPTS -X GET -H "Accept: application/yang-data+json" -H "Accept-Encoding: gzip;q=0, identity" $RCPROTO://localhost/restconf/data/example:table)" 0 "HTTP/$HVER 200" --not-- "Content-Encoding"
+
+new "restconf GET small reply is not compressed"
+expectpart "$(curl $CURLOPTS -X GET -H "Accept-Encoding: gzip" $RCPROTO://localhost/restconf/data/example:table/parameter=1)" 0 "HTTP/$HVER 200" '{"example:parameter":\[{"name":"1","value":"value-of-parameter-1"}\]}' --not-- "Content-Encoding"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+unset perfnr
+unset coding
+unset len0
+unset len1
+unset CURLOPTS0
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -242,6 +242,10 @@ Accept: application/yang-data+xml
 EOF
 )" 0 "HTTP/$HVER 405" # nginx uses "method not allowed" 
 
+    # Slow client: the daemon returns to its event loop and resumes when rest arrives
+    new "netcat restconf GET header split in two writes"
+    expectpart "$( (printf "GET /restconf/data/example:a=0 HTTP/$HVER\r\nHost: localhost\r\n"; sleep 1; printf "Accept: application/yang-data+xml\r\n\r\n") | ${netcat} 127.0.0.1 80)" 0 "HTTP/$HVER 200" "$XML"
+
 if false; then # XXX >50% does not work on docker alpine
     new "netcat restconf GET wrong http version raw"
     expectpart "$(${netcat} 127.0.0.1 80 <<EOF
@@ -0,0 +1,186 @@
+#!/usr/bin/env bash
+# Restconf conditional GET with ETag and Last-Modified, from datastore generations
+# Config data is replied with ETag and Last-Modified, and If-None-Match and If-Modified-Since
+# get 304 Not Modified until the data is changed. A change of one top-level subtree does not
+# change the ETag of another. Resources with state data have no ETag.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config none false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container table{
+      list parameter{
+         key name;
+         leaf name{
+            type string;
+         }
+         leaf value{
+            type string;
+         }
+      }
+      leaf counter{
+         config false;
+         type uint32;
+      }
+   }
+   container other{
+      leaf value{
+         type string;
+      }
+   }
+}
+EOF
+
+# Value of header in reply
+# 1: header name
+# 2: reply
+function hdrval()
+{
+    echo "$2" | grep -i "^$1:" | cut -d' ' -f2- | tr -d '\r'
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    sudo pkill -f clixon_backend # to be sure
+
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "restconf POST table"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d '{"example:parameter":[{"name":"A","value":"42"}]}' $RCPROTO://localhost/restconf/data/example:table)" 0 "HTTP/$HVER 201"
+
+new "restconf POST other"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d '{"example:value":"x"}' $RCPROTO://localhost/restconf/data/example:other)" 0 "HTTP/$HVER 201"
+
+new "restconf GET config has ETag and Last-Modified"
+ret=$(curl $CURLOPTS -X GET -H "Accept: application/yang-data+json" $RCPROTO://localhost/restconf/data/example:table?content=config)
+expectpart "$ret" 0 "HTTP/$HVER 200" 'ETag: W/"[0-9]*-json"' "Vary: Accept" "Last-Modified: " '{"example:table":{"parameter":\[{"name":"A","value":"42"}\]}}'
+etag=$(hdrval ETag "$ret")
+lastmod=$(hdrval Last-Modified "$ret")
+
+new "restconf GET If-None-Match is not modified"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag" $RCPROTO://localhost/restconf/data/example:table?content=config)" 0 "HTTP/$HVER 304" "ETag: $etag" --not-- "example:table"
+
+new "restconf GET If-None-Match other media is modified"
+expectpart "$(curl $CURLOPTS -X GET -H "Accept: application/yang-data+xml" -H "If-None-Match: $etag" $RCPROTO://localhost/restconf/data/example:table?content=config)" 0 "HTTP/$HVER 200" 'ETag: W/"[0-9]*-xml"' "<table xmlns=\"urn:example:clixon\"><parameter><name>A</name><value>42</value></parameter></table>"
+
+new "restconf GET If-None-Match list of entity-tags"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: W/\"1-json\", $etag" $RCPROTO://localhost/restconf/data/example:table?content=config)" 0 "HTTP/$HVER 304"
+
+new "restconf GET If-None-Match no match"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: W/\"1-json\"" $RCPROTO://localhost/restconf/data/example:table?content=config)" 0 "HTTP/$HVER 200" "ETag: $etag"
+
+new "restconf GET If-Modified-Since is not modified"
+expectpart "$(curl $CURLOPTS -X GET -H "If-Modified-Since: $lastmod" $RCPROTO://localhost/restconf/data/example:table?content=config)" 0 "HTTP/$HVER 304"
+
+new "restconf GET If-Modified-Since old date"
+expectpart "$(curl $CURLOPTS -X GET -H "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT" $RCPROTO://localhost/restconf/data/example:table?content=config)" 0 "HTTP/$HVER 200"
+
+new "restconf GET resource without state data has ETag"
+expectpart "$(curl $CURLOPTS -X GET -H "Accept: application/yang-data+json" $RCPROTO://localhost/restconf/data/example:table/parameter=A)" 0 "HTTP/$HVER 200" "ETag: $etag" '{"example:parameter":\[{"name":"A","value":"42"}\]}'
+
+new "restconf GET resource with state data has no ETag"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:table)" 0 "HTTP/$HVER 200" --not-- "ETag"
+
+new "restconf GET other"
+ret=$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:other)
+expectpart "$ret" 0 "HTTP/$HVER 200" 'ETag: W/"[0-9]*-[a-z]*"'
+etag2=$(hdrval ETag "$ret")
+
+new "restconf GET datastore root"
+ret=$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data?content=config)
+expectpart "$ret" 0 "HTTP/$HVER 200" 'ETag: W/"[0-9]*-[a-z]*"'
+etag3=$(hdrval ETag "$ret")
+
+new "restconf PUT modifies table"
+expectpart "$(curl $CURLOPTS -X PUT -H "Content-Type: application/yang-data+json" -d '{"example:parameter":[{"name":"A","value":"43"}]}' $RCPROTO://localhost/restconf/data/example:table/parameter=A)" 0 "HTTP/$HVER 204"
+
+new "restconf GET If-None-Match after change is modified"
+expectpart "$(curl $CURLOPTS -X GET -H "Accept: application/yang-data+json" -H "If-None-Match: $etag" $RCPROTO://localhost/restconf/data/example:table?content=config)" 0 "HTTP/$HVER 200" '{"example:table":{"parameter":\[{"name":"A","value":"43"}\]}}' --not-- "ETag: $etag"
+
+new "restconf GET other subtree is not modified"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag2" $RCPROTO://localhost/restconf/data/example:other)" 0 "HTTP/$HVER 304"
+
+new "restconf GET datastore root is modified"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag3" $RCPROTO://localhost/restconf/data?content=config)" 0 "HTTP/$HVER 200" --not-- "ETag: $etag3"
+
+new "restconf DELETE other"
+expectpart "$(curl $CURLOPTS -X DELETE $RCPROTO://localhost/restconf/data/example:other)" 0 "HTTP/$HVER 204"
+
+new "restconf GET other after delete"
+expectpart "$(curl $CURLOPTS -X GET -H "If-None-Match: $etag2" $RCPROTO://localhost/restconf/data/example:other)" 0 "HTTP/$HVER 404"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+unset etag
+unset etag2
+unset etag3
+unset lastmod
+unset ret
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,131 @@
+#!/usr/bin/env bash
+# Native restconf several concurrent HTTP/2 streams on one connection
+# Requests are sent in parallel by curl on one connection and are executed one at a time
+# when all frames are read. Check that the headers of each stream are kept with that stream
+# and that all streams get their own reply.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Only works with native http/2
+if [ "${WITH_RESTCONF}" != "native" -o ${HAVE_LIBNGHTTP2} = false ]; then
+    echo "...skipped: must run with native http/2"
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of parallel streams
+: ${nstreams:=20}
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config none false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container table{
+      list parameter{
+         key name;
+         leaf name{
+            type string;
+         }
+         leaf value{
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    sudo pkill -f clixon_backend # to be sure
+
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "restconf POST"
+expectpart "$(curl $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" -d '{"example:parameter":[{"name":"A","value":"42"}]}' $RCPROTO://localhost/restconf/data/example:table)" 0 "HTTP/$HVER 201"
+
+new "parallel streams with different Accept headers"
+ret=$(curl $CURLOPTS --parallel --parallel-immediate -X GET -H "Accept: application/yang-data+xml" $RCPROTO://localhost/restconf/data/example:table/parameter=A --next $CURLOPTS -X GET -H "Accept: application/yang-data+json" $RCPROTO://localhost/restconf/data/example:table/parameter=A --next $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:table/parameter=B)
+expectpart "$ret" 0 "HTTP/$HVER 200" "HTTP/$HVER 404" "Content-Type: application/yang-data+xml" "Content-Type: application/yang-data+json" '<parameter xmlns="urn:example:clixon"><name>A</name><value>42</value></parameter>' '{"example:parameter":\[{"name":"A","value":"42"}\]}'
+
+new "$nstreams parallel streams"
+urls=""
+for i in $(seq 1 $nstreams); do
+    urls="$urls $RCPROTO://localhost/restconf/data/example:table/parameter=A"
+done
+nr=$(curl $CURLOPTS --parallel --parallel-immediate --parallel-max $nstreams -X GET -H "Accept: application/yang-data+json" $urls | grep -c "HTTP/$HVER 200")
+if [ $nr -ne $nstreams ]; then
+    err "$nstreams replies" "$nr"
+fi
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+unset nstreams
+unset urls
+unset ret
+unset nr
+
+rm -rf $dir
+
+new "endtest"
+endtest
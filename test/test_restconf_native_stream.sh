@@ -0,0 +1,166 @@
+#!/usr/bin/env bash
+# Native restconf RFC 8040 event streams as server-sent events
+# Several clients subscribe to the EXAMPLE stream of the example backend in parallel and
+# share one backend subscription. Check that each client gets the event-stream reply and
+# the notifications sent every 5s. Then check stop-time and error replies.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Only works with native restconf
+if [ "${WITH_RESTCONF}" != "native" ]; then
+    echo "...skipped: must run with native restconf"
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+# Dont run this test with valgrind
+if [ $valgrindtest -ne 0 ]; then
+    echo "...skipped "
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/stream.yang
+
+# Number of parallel clients
+: ${nclients:=10}
+
+# Curl options with no buffering of the event stream
+CURLOPTS0="$CURLOPTS -N"
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config none false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_DISCOVERY_RFC8040>true</CLICON_STREAM_DISCOVERY_RFC8040>
+  <CLICON_STREAM_PATH>streams</CLICON_STREAM_PATH>
+  <CLICON_STREAM_URL>https://localhost</CLICON_STREAM_URL>
+  <CLICON_STREAM_RETENTION>60</CLICON_STREAM_RETENTION>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   notification event {
+      leaf event-class {
+         type string;
+      }
+      container reportingEntity {
+         leaf card {
+            type string;
+         }
+      }
+      leaf severity {
+         type string;
+      }
+   }
+   container state {
+      config false;
+      leaf-list op {
+         type string;
+      }
+   }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    sudo pkill -f clixon_backend # to be sure
+
+    new "start backend -s init -f $cfg -- -n"
+    start_backend -s init -f $cfg -- -n # create example notification stream
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+new "restconf subscribe EXAMPLE stream with $nclients clients"
+for i in $(seq 1 $nclients); do
+    curl $CURLOPTS0 -m 12 -X GET -H "Accept: text/event-stream" $RCPROTO://localhost/streams/EXAMPLE > $dir/stream$i 2>&1 &
+done
+wait
+
+for i in $(seq 1 $nclients); do
+    new "restconf stream client $i"
+    expectpart "$(cat $dir/stream$i)" 0 "HTTP/$HVER 200" "Content-Type: text/event-stream" "Cache-Control: no-cache" "data: <notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>" "<event xmlns=\"urn:example:clixon\"><event-class>fault</event-class>" --not-- "Content-Length"
+    nr=$(grep -c "^data: <notification" $dir/stream$i)
+    if [ $nr -lt 2 ]; then
+        err "at least 2 notifications" "$nr"
+    fi
+done
+
+new "restconf stream with stop-time ends"
+stop=$(date -u -d "+6 seconds" +"%Y-%m-%dT%H:%M:%SZ")
+expectpart "$(curl $CURLOPTS0 -m 20 -X GET -H "Accept: text/event-stream" "$RCPROTO://localhost/streams/EXAMPLE?stop-time=$stop")" 0 "HTTP/$HVER 200" "data: <notification"
+
+new "restconf stream nonexisting"
+expectpart "$(curl $CURLOPTS0 -m 2 -X GET -H "Accept: text/event-stream" $RCPROTO://localhost/streams/NOTEXIST)" 0 "HTTP/$HVER 400" "No such stream"
+
+new "restconf stream POST not allowed"
+expectpart "$(curl $CURLOPTS0 -m 2 -X POST -H "Accept: text/event-stream" $RCPROTO://localhost/streams/EXAMPLE)" 0 "HTTP/$HVER 405" "Allow: GET"
+
+new "restconf GET after streams"
+expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf)" 0 "HTTP/$HVER 200"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+unset nclients
+unset CURLOPTS0
+unset stop
+unset nr
+
+rm -rf $dir
+
+new "endtest"
+endtest
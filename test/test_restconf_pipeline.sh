@@ -0,0 +1,198 @@
+#!/usr/bin/env bash
+# Native restconf HTTP/1.1 pipelining
+# Several requests are sent in one write on a keep-alive connection, check that they are
+# all replied to in order, and that Connection: close and HTTP/1.0 close the connection.
+# Last, measure requests/sec of pipelined GETs, compare with RESTCONF_HTTP1_YACC
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Only works with native http/1 and netcat
+if [ "${WITH_RESTCONF}" != "native" -o ${HAVE_HTTP1} = false -o -z "$netcat" ]; then
+    echo "...skipped: must run with native http/1 and netcat"
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+# Pin to http/1
+if [ ${HAVE_LIBNGHTTP2} = true ]; then
+    HAVE_LIBNGHTTP2=false
+    CURLOPTS=${CURLOPTS/http2/http1.1}
+    HVER=1.1
+fi
+
+# Force to HTTP 1.1 no SSL due to netcat
+RCPROTO=http
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of pipelined requests in perf test
+: ${perfreq:=1000}
+
+# Define default restconfig config: RESTCONFIG
+RESTCONFIG=$(restconf_config none false)
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container table{
+      list parameter{
+         key name;
+         leaf name{
+            type string;
+         }
+         leaf value{
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+# Status lines of replies in order
+# 1: raw replies
+function status_lines()
+{
+    echo "$1" | grep "^HTTP/" | tr -d '\r' | cut -d' ' -f2 | tr '\n' ' '
+}
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    sudo pkill -f clixon_backend # to be sure
+
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+if [ $RC -ne 0 ]; then
+    new "kill old restconf daemon"
+    stop_restconf_pre
+
+    new "start restconf daemon"
+    start_restconf -f $cfg
+fi
+
+new "wait restconf"
+wait_restconf
+
+body='{"example:parameter":[{"name":"A","value":"42"}]}'
+
+new "pipelined POST, GET, GET not found and GET with close"
+ret=$(printf "POST /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/yang-data+json\r\nContent-Length: ${#body}\r\n\r\n${body}GET /restconf/data/example:table/parameter=A HTTP/1.1\r\nHost: localhost\r\nAccept: application/yang-data+json\r\n\r\nGET /restconf/data/example:table/parameter=B HTTP/1.1\r\nHost: localhost\r\n\r\nGET /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\nAccept: application/yang-data+json\r\nConnection: close\r\n\r\n" | ${netcat} 127.0.0.1 80)
+match=$(status_lines "$ret")
+if [ "$match" != "201 200 404 200 " ]; then
+    err "201 200 404 200 " "$match"
+fi
+expectpart "$ret" 0 '{"example:parameter":\[{"name":"A","value":"42"}\]}' "Connection: close"
+
+new "pipelined requests after close are not processed"
+ret=$(printf "GET /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\nGET /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\n\r\n" | ${netcat} 127.0.0.1 80)
+match=$(status_lines "$ret")
+if [ "$match" != "200 " ]; then
+    err "200 " "$match"
+fi
+
+new "HTTP/1.0 closes connection"
+ret=$(printf "GET /restconf/data/example:table HTTP/1.0\r\nHost: localhost\r\n\r\nGET /restconf/data/example:table HTTP/1.0\r\nHost: localhost\r\n\r\n" | ${netcat} 127.0.0.1 80)
+match=$(status_lines "$ret")
+if [ "$match" != "200 " ]; then
+    err "200 " "$match"
+fi
+
+new "pipelined malformed request"
+expectpart "$(printf "GET /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\n\r\nGET /restconf/data HTTP/x.1\r\nHost: localhost\r\n\r\n" | ${netcat} 127.0.0.1 80)" 0 "HTTP/1.1 200" "HTTP/1.1 400" "<error-tag>malformed-message</error-tag>"
+
+new "connection is closed after malformed request"
+ret=$(printf "GET /restconf/data HTTP/x.1\r\nHost: localhost\r\n\r\nGET /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\n\r\n" | ${netcat} 127.0.0.1 80)
+match=$(status_lines "$ret")
+if [ "$match" != "400 " ]; then
+    err "400 " "$match"
+fi
+expectpart "$ret" 0 "Connection: close"
+
+new "differing Content-Length after Content-Length: 0"
+expectpart "$(printf "POST /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/yang-data+json\r\nContent-Length: 0\r\nContent-Length: 100\r\n\r\n" | ${netcat} 127.0.0.1 80)" 0 "HTTP/1.1 400" "<error-tag>malformed-message</error-tag>"
+
+new "request with LF-only line endings"
+expectpart "$(printf "GET /restconf/data/example:table HTTP/1.1\nHost: localhost\nAccept: application/yang-data+json\nConnection: close\n\n" | ${netcat} 127.0.0.1 80)" 0 "HTTP/1.1 200" '{"example:table":'
+
+new "Transfer-Encoding is not supported"
+expectpart "$(printf "POST /restconf/data/example:table HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n" | ${netcat} 127.0.0.1 80)" 0 "HTTP/1.1 400"
+
+new "$perfreq pipelined GETs"
+req="GET /restconf/data/example:table/parameter=A HTTP/1.1\r\nHost: localhost\r\nAccept: application/yang-data+json\r\n\r\n"
+reqs=""
+for i in $(seq 1 $((perfreq-1))); do
+    reqs="${reqs}${req}"
+done
+reqs="${reqs}GET /restconf/data/example:table/parameter=A HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"
+t0=$(date +%s%N)
+nr=$(printf "$reqs" | ${netcat} 127.0.0.1 80 | grep -c "^HTTP/1.1 200")
+t1=$(date +%s%N)
+if [ $nr -ne $perfreq ]; then
+    err "$perfreq replies" "$nr"
+fi
+ms=$(((t1-t0)/1000000))
+if [ $ms -eq 0 ]; then
+    ms=1
+fi
+echo "$perfreq pipelined requests in $ms ms: $((perfreq*1000/ms)) requests/s"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+unset perfreq
+unset body
+unset req
+unset reqs
+unset match
+unset ret
+unset nr
+unset ms
+
+rm -rf $dir
+
+new "endtest"
+endtest
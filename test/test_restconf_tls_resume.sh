@@ -0,0 +1,184 @@
+#!/usr/bin/env bash
+# Native restconf TLS session resumption, with session cache and session tickets
+# Save the TLS session of one connection with openssl s_client and check it is resumed
+# by the next connection. Then disable session cache and tickets and check it is not.
+# Last, measure TLS handshakes/s with and without resumption using clixon_util_ssl
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Only works with native http/1 and openssl
+if [ "${WITH_RESTCONF}" != "native" -o ${HAVE_HTTP1} = false -o -z "$(type -p openssl)" ]; then
+    echo "...skipped: must run with native http/1 and openssl"
+    rm -rf $dir
+    if [ "$s" = $0 ]; then exit 0; else return 0; fi
+fi
+
+RCPROTO=https
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+sess=$dir/tls.sess
+
+# Number of connections in handshake benchmark
+: ${perfreq:=200}
+
+# Make certs
+restconf_config none false https > /dev/null
+
+cat <<EOF > $fyang
+module example{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container table{
+      list parameter{
+         key name;
+         leaf name{
+            type string;
+         }
+      }
+   }
+}
+EOF
+
+# Make one TLS connection with one HTTP/1.1 request
+# Session tickets are sent after the handshake in TLS 1.3, so read reply until close
+# 1: extra s_client options, eg -sess_out / -sess_in
+function tlsconn()
+{
+    printf "GET /restconf HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n" | openssl s_client -ign_eof -alpn http/1.1 -connect 127.0.0.1:443 $1 2>&1
+}
+
+# Write config with TLS session options
+# 1: tls-session-cache-size
+# 2: tls-session-tickets
+# 3: tls-ticket-key-rotation
+function tlscfg()
+{
+    cachesize=$1
+    tickets=$2
+    rotation=$3
+
+    RESTCONFIG=$(restconf_config none false https | sed "s#</server-ca-cert-path>#</server-ca-cert-path><tls-session-cache-size>$cachesize</tls-session-cache-size><tls-session-tickets>$tickets</tls-session-tickets><tls-ticket-key-rotation>$rotation</tls-ticket-key-rotation>#")
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_FEATURE>clixon-restconf:allow-auth-none</CLICON_FEATURE> <!-- Use auth-type=none -->
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>$dir/restconf.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  $RESTCONFIG
+</clixon-config>
+EOF
+}
+
+# Start restconf and wait for it
+function startrc()
+{
+    if [ $RC -ne 0 ]; then
+        new "kill old restconf daemon"
+        stop_restconf_pre
+
+        new "start restconf daemon"
+        start_restconf -f $cfg
+    fi
+
+    new "wait restconf"
+    wait_restconf
+}
+
+new "test params: -f $cfg"
+
+tlscfg 20480 true 3600
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    sudo pkill -f clixon_backend # to be sure
+
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+startrc
+
+new "tickets: first connection is a new session"
+expectpart "$(tlsconn "-sess_out $sess")" 0 "HTTP/1.1 200" "^New,"
+
+new "tickets: next connection is resumed"
+expectpart "$(tlsconn "-sess_in $sess")" 0 "HTTP/1.1 200" "^Reused,"
+
+new "session cache: first connection is a new session"
+expectpart "$(tlsconn "-no_ticket -tls1_2 -sess_out $sess")" 0 "HTTP/1.1 200" "^New,"
+
+new "session cache: next connection is resumed"
+expectpart "$(tlsconn "-no_ticket -tls1_2 -sess_in $sess")" 0 "HTTP/1.1 200" "^Reused,"
+
+# clixon_util_ssl is only built with http/2
+if [ ${HAVE_LIBNGHTTP2} = true ]; then
+    new "resumption: $perfreq TLS handshakes"
+    ret=$(clixon_util_ssl -H 127.0.0.1 -n $perfreq)
+    expectpart "$ret" 0 "resumed:$((perfreq-1))"
+    echo "$ret"
+
+    new "no resumption: $perfreq TLS handshakes"
+    ret=$(clixon_util_ssl -H 127.0.0.1 -n $perfreq -R)
+    expectpart "$ret" 0 "full:$perfreq resumed:0"
+    echo "$ret"
+fi
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+tlscfg 0 false 3600
+startrc
+
+new "no resumption: first connection is a new session"
+expectpart "$(tlsconn "-sess_out $sess")" 0 "HTTP/1.1 200" "^New,"
+
+new "no resumption: next connection is not resumed"
+expectpart "$(tlsconn "-sess_in $sess")" 0 "HTTP/1.1 200" "^New,"
+
+if [ $RC -ne 0 ]; then
+    new "Kill restconf daemon"
+    stop_restconf
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# Set by restconf_config
+unset RESTCONFIG
+unset perfreq
+unset cachesize
+unset tickets
+unset rotation
+unset sess
+unset ret
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,139 @@
+#!/usr/bin/env bash
+# State data provider cache
+# The example backend registers a state data provider on /example-events:events,
+# with -c <ms> the state of that provider is cached with a time-to-live.
+# Check that requests are served from the cache and that the provider is called
+# again when the cache has expired, using the clixon-lib stats rpc.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example-events.yang
+
+# Cache time-to-live in ms, long enough for the cache hit checks not to depend on timing
+: ${ttl:=60000}
+
+# Short cache time-to-live in ms for the expiry check
+: ${ttlshort:=1000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example-events {
+   namespace "urn:example:events";
+   prefix "ex";
+   container events {
+      list event {
+         key name;
+         leaf name { type string; }
+         leaf description { type string; }
+         leaf event-count {
+            type uint32;
+            config false;
+         }
+      }
+   }
+}
+EOF
+
+state='<events xmlns="urn:example:events"><event><name>interface-down</name><event-count>90</event-count></event><event><name>interface-up</name><event-count>77</event-count></event></events>'
+
+# Get events state and check reply
+function get_events()
+{
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:events\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<rpc-reply $DEFAULTNS><data>$state</data></rpc-reply>"
+}
+
+# Check state-cache stats
+# 1: ttl
+# 2: hits
+# 3: misses
+function check_stats()
+{
+    ttl=$1
+    hits=$2
+    misses=$3
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><stats $LIBNS/></rpc>" "<state-cache $LIBNS><path>/example-events:events</path><ttl>$ttl</ttl><hits>$hits</hits><misses>$misses</misses><nr>"
+}
+
+new "test params: -f $cfg -- -s -c $ttl"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -s -c $ttl"
+    start_backend -s init -f $cfg -- -s -c $ttl
+fi
+
+new "wait backend"
+wait_backend
+
+new "get events, cache miss"
+get_events
+
+new "get events, cache hit"
+get_events
+
+new "get events, cache hit"
+get_events
+
+new "check stats: 2 hits, 1 miss"
+check_stats $ttl 2 1
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    stop_backend -f $cfg
+
+    new "start backend -s init -f $cfg -- -s -c $ttlshort"
+    start_backend -s init -f $cfg -- -s -c $ttlshort
+
+    new "wait backend"
+    wait_backend
+
+    new "get events, cache miss"
+    get_events
+
+    new "wait for cache to expire"
+    sleep $(((ttlshort+999)/1000+1))
+
+    new "get events, cache expired"
+    get_events
+
+    new "check stats: 0 hits, 2 misses"
+    check_stats $ttlshort 0 2
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+unset ttl
+unset ttlshort
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,141 @@
+#!/usr/bin/env bash
+# State cursor provider of a large state list
+# The example backend registers a state cursor provider on /example-rib:rib/route with
+# -R <nr>, which returns generated routes a batch at a time.
+# Check that the whole list is streamed in a chunked reply, that specific entries are
+# selected when the provider is called for all entries, and list-pagination.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example-rib.yang
+
+# Number of routes
+: ${nr:=1000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_BACKEND_REPLY_CHUNK>1024</CLICON_BACKEND_REPLY_CHUNK>
+  <CLICON_BACKEND_STATE_BATCH>100</CLICON_BACKEND_STATE_BATCH>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example-rib {
+   namespace "urn:example:rib";
+   prefix "rib";
+   container rib {
+      config false;
+      list route {
+         key prefix;
+         leaf prefix { type string; }
+         leaf next-hop { type string; }
+      }
+   }
+}
+EOF
+
+# Get routes and check number of routes, first and last route
+# 1: xpath
+# 2: expected number of routes
+# 3: first route
+# 4: last route
+function get_routes()
+{
+    xpath=$1
+    n=$2
+    first=$3
+    last=$4
+
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"$xpath\" xmlns:rib=\"urn:example:rib\"/></get></rpc>")
+    ret=$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qf $cfg)
+    match=$(echo "$ret" | grep --null -Go "<rib xmlns=\"urn:example:rib\"><route><prefix>$first</prefix>")
+    if [ -z "$match" ]; then
+        err "<rib xmlns=\"urn:example:rib\"><route><prefix>$first</prefix>" "$ret"
+    fi
+    match=$(echo "$ret" | grep --null -Go "<route><prefix>$last</prefix><next-hop>[0-9.]*</next-hop></route></rib></data></rpc-reply>")
+    if [ -z "$match" ]; then
+        err "<route><prefix>$last</prefix>...</route></rib></data></rpc-reply>" "$ret"
+    fi
+    count=$(echo "$ret" | grep -o "<route>" | wc -l)
+    if [ $count -ne $n ]; then
+        err "$n routes" "$count routes"
+    fi
+}
+
+new "test params: -f $cfg -- -R $nr"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -R $nr"
+    start_backend -s init -f $cfg -- -R $nr
+fi
+
+new "wait backend"
+wait_backend
+
+new "get all routes, streamed"
+get_routes "/rib:rib" $nr r000000 $(printf "r%06d" $((nr-1)))
+
+new "get all routes, list path"
+get_routes "/rib:rib/rib:route" $nr r000000 $(printf "r%06d" $((nr-1)))
+
+new "get all state, routes streamed"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"/></rpc>" "<route><prefix>r000000</prefix><next-hop>10.0.0.0</next-hop></route>"
+
+new "get specific route, not streamed"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/rib:rib/rib:route[rib:prefix='r000300']\" xmlns:rib=\"urn:example:rib\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><rib xmlns=\"urn:example:rib\"><route><prefix>r000300</prefix><next-hop>10.0.1.44</next-hop></route></rib></data></rpc-reply>"
+
+new "list-pagination offset 150 limit 3"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get content=\"nonconfig\"><filter type=\"xpath\" select=\"/rib:rib/rib:route\" xmlns:rib=\"urn:example:rib\"/><list-pagination xmlns=\"urn:ietf:params:xml:ns:yang:ietf-list-pagination-nc\"><offset>150</offset><limit>3</limit></list-pagination></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><rib xmlns=\"urn:example:rib\"><route><prefix>r000150</prefix><next-hop>10.0.0.150</next-hop></route><route><prefix>r000151</prefix><next-hop>10.0.0.151</next-hop></route><route><prefix>r000152</prefix><next-hop>10.0.0.152</next-hop></route></rib></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+
+    new "start backend without chunked reply -f $cfg -- -R $nr"
+    start_backend -s init -f $cfg -o CLICON_BACKEND_REPLY_CHUNK=0 -- -R $nr
+fi
+
+new "wait backend"
+wait_backend
+
+new "get all routes, not streamed"
+get_routes "/rib:rib" $nr r000000 $(printf "r%06d" $((nr-1)))
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,144 @@
+#!/usr/bin/env bash
+# State data provider registered on a schema path
+# The example backend registers a state data provider on /example-events:events,
+# with -t every call of the provider is logged with its filter.
+# Check that the provider is not called for requests disjoint from its path, and that
+# the request path with keys is passed to it as filter.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example-events.yang
+flog=$dir/backend.log
+touch $flog
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example-events {
+   namespace "urn:example:events";
+   prefix "ex";
+   container events {
+      list event {
+         key name;
+         leaf name { type string; }
+         leaf description { type string; }
+         leaf event-count {
+            type uint32;
+            config false;
+         }
+      }
+   }
+   container settings {
+      leaf mode { type string; }
+   }
+}
+EOF
+
+# Check number of provider calls in log, and filter of last call
+# 1: number of calls
+# 2: filter of last call (if calls > 0)
+function check_calls()
+{
+    nr=$1
+    filter=$2
+    new "check $nr provider calls"
+    n=$(grep -c "example_statedata_events filter:" $flog)
+    if [ $n -ne $nr ]; then
+        err "$nr calls" "$n"
+    fi
+    if [ $nr -gt 0 ]; then
+        new "check provider filter: $filter"
+        f=$(grep "example_statedata_events filter:" $flog | tail -1 | sed 's/.*example_statedata_events filter://')
+        if [ "$f" != "$filter" ]; then
+            err "$filter" "$f"
+        fi
+    fi
+}
+
+new "test params: -f $cfg -l f$flog -- -s -t"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -l f$flog -- -s -t"
+    start_backend -s init -f $cfg -l f$flog -- -s -t
+fi
+
+new "wait backend"
+wait_backend
+
+new "get settings, disjoint from provider path"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:settings\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+check_calls 0
+
+new "get events"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:events\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<rpc-reply $DEFAULTNS><data><events xmlns=\"urn:example:events\"><event><name>interface-down</name><event-count>90</event-count></event><event><name>interface-up</name><event-count>77</event-count></event></events></data></rpc-reply>"
+
+check_calls 1 "/example-events:events"
+
+new "get one event with key"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:events/ex:event[ex:name='interface-up']\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<rpc-reply $DEFAULTNS><data><events xmlns=\"urn:example:events\"><event><name>interface-up</name><event-count>77</event-count></event></events></data></rpc-reply>"
+
+check_calls 2 "/example-events:events/example-events:event[name='interface-up']"
+
+new "get event-count leaf below key"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:events/ex:event[ex:name='interface-down']/ex:event-count\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<rpc-reply $DEFAULTNS><data><events xmlns=\"urn:example:events\"><event><name>interface-down</name><event-count>90</event-count></event></events></data></rpc-reply>"
+
+check_calls 3 "/example-events:events/example-events:event[name='interface-down']/example-events:event-count"
+
+new "get settings again, disjoint from provider path"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:settings/ex:mode\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+check_calls 3 "/example-events:events/example-events:event[name='interface-down']/example-events:event-count"
+
+new "get event with quote and bracket in key"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:events/ex:event[ex:name='x&quot;]y']\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+check_calls 4 "/example-events:events/example-events:event[name='x\"]y']"
+
+new "get descendant event-count, not a simple path"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"//ex:event-count\" xmlns:ex=\"urn:example:events\"/></get></rpc>" "<event-count>90</event-count>"
+
+check_calls 5 "none"
+
+new "get all, no filter"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get/></rpc>" "<events xmlns=\"urn:example:events\"><event><name>interface-down</name><event-count>90</event-count></event>"
+
+check_calls 6 "none"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+unset nr
+unset filter
+
+rm -rf $dir
+
+new "endtest"
+endtest
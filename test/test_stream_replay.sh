@@ -0,0 +1,155 @@
+#!/usr/bin/env bash
+# Stream replay buffer limits
+# The example backend sends a burst of numbered events on the EXAMPLE stream, more than
+# CLICON_STREAM_REPLAY_MAX or CLICON_STREAM_REPLAY_BYTES allows in the replay buffer.
+# Check that a replay subscription with startTime gets only the newest retained events,
+# in order.
+# @see test_netconf_notifications.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+# Number of events in burst
+nr=25
+
+# Max number of events in replay buffer
+: ${replaymax:=10}
+
+# Max size of events in replay buffer, an event is about 250 bytes
+: ${replaybytes:=2000}
+
+# Create config
+# 1: CLICON_STREAM_REPLAY_MAX
+# 2: CLICON_STREAM_REPLAY_BYTES
+function config()
+{
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_RETENTION>60</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_REPLAY_MAX>$1</CLICON_STREAM_REPLAY_MAX>
+  <CLICON_STREAM_REPLAY_BYTES>$2</CLICON_STREAM_REPLAY_BYTES>
+</clixon-config>
+EOF
+}
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   notification event {
+      leaf event-class {
+         type string;
+      }
+      container reportingEntity {
+         leaf card {
+            type string;
+         }
+      }
+      leaf severity {
+         type string;
+      }
+   }
+   rpc notify-burst {
+      input {
+         leaf count {
+            type uint32;
+         }
+      }
+   }
+}
+EOF
+
+# Send a burst of events, replay them with startTime and check which are returned
+# 1: CLICON_STREAM_REPLAY_MAX
+# 2: CLICON_STREAM_REPLAY_BYTES
+# 3: Min number of replayed events
+# 4: Max number of replayed events
+function testrun()
+{
+    min=$3
+    max=$4
+
+    config $1 $2
+
+    new "test params: -f $cfg -- -N"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s init -f $cfg -- -N"
+        start_backend -s init -f $cfg -- -N # example stream without periodic events
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    start=$(date -u +"%Y-%m-%dT%H:%M:%SZ")
+
+    new "send burst of $nr events"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><notify-burst xmlns=\"urn:example:clixon\"><count>$nr</count></notify-burst></rpc>" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    stop=$(date -u -d "+2 seconds" +"%Y-%m-%dT%H:%M:%SZ")
+
+    new "replay subscription startTime:$start stopTime:$stop"
+    sleep 4 | cat <(echo "$HELLONO11<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>$start</startTime><stopTime>$stop</stopTime></create-subscription></rpc>]]>]]>") - | $clixon_netconf -qef $cfg > $dir/replay.out
+    expectpart "$(cat $dir/replay.out)" 0 "<rpc-reply $DEFAULTNS><ok/></rpc-reply>" "<card>$nr</card>" --not-- "<card>1</card>"
+
+    new "check $min-$max newest events are replayed in order"
+    cards=$(grep -o "<card>[0-9]*</card>" $dir/replay.out | sed 's/<[^>]*>//g' | tr '\n' ' ')
+    n=$(echo $cards | wc -w)
+    if [ $n -lt $min -o $n -gt $max ]; then
+        err "$min-$max events" "$n"
+    fi
+    expect="$(seq -s ' ' $((nr-n+1)) $nr) "
+    if [ "$cards" != "$expect" ]; then
+        err "$expect" "$cards"
+    fi
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+new "replay buffer limited to $replaymax events"
+testrun $replaymax 0 $replaymax $replaymax
+
+new "replay buffer limited to $replaybytes bytes"
+testrun 0 $replaybytes 2 $((replaybytes/200))
+
+unset nr
+unset replaymax
+unset replaybytes
+unset start
+unset stop
+unset cards
+unset min
+unset max
+unset expect
+
+rm -rf $dir
+
+new "endtest"
+endtest
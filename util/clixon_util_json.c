@@ -50,6 +50,7 @@
 #include <stdint.h>
 #include <syslog.h>
 #include <signal.h>
+#include <sys/time.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -66,6 +67,79 @@
  * Example run:
     echo '{"foo": -23}' | ./json
 */
+/*! Throughput benchmark: read all input, then parse and serialize it a number of times
+ * @param[in]  fp     Input file
+ * @param[in]  yspec  Yang spec or NULL
+ * @param[in]  nr     Number of iterations
+ */
+static int
+bench_json(FILE      *fp,
+           yang_stmt *yspec,
+           int        nr)
+{
+    int            retval = -1;
+    cbuf          *cb = NULL;
+    cbuf          *cbout = NULL;
+    char           buf[BUFSIZ];
+    size_t         len;
+    int            j;
+    cxobj         *xt = NULL;
+    cxobj         *xerr = NULL;
+    struct timeval t0;
+    struct timeval t1;
+    struct timeval tp = {0,};
+    struct timeval ts = {0,};
+    double         secs;
+    int            ret;
+
+    if ((cb = cbuf_new()) == NULL || (cbout = cbuf_new()) == NULL){
+        clicon_err(OE_JSON, errno, "cbuf_new");
+        goto done;
+    }
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        if (cbuf_append_buf(cb, buf, len) < 0)
+            goto done;
+    for (j=0; j<nr; j++){
+        gettimeofday(&t0, NULL);
+        if ((ret = clixon_json_parse_string(cbuf_get(cb), yspec?1:0, yspec?YB_MODULE:YB_NONE,
+                                            yspec, &xt, &xerr)) < 0)
+            goto done;
+        if (ret == 0){
+            xml_print(stderr, xerr);
+            goto done;
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &t1);
+        timeradd(&tp, &t1, &tp);
+        cbuf_reset(cbout);
+        gettimeofday(&t0, NULL);
+        if (clixon_json2cbuf(cbout, xt, 0, 1, 0) < 0)
+            goto done;
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &t1);
+        timeradd(&ts, &t1, &ts);
+        xml_free(xt);
+        xt = NULL;
+    }
+    secs = tp.tv_sec + tp.tv_usec/1000000.0;
+    fprintf(stdout, "parse: %zu bytes x %d: %.3f s %.1f MB/s\n",
+            cbuf_len(cb), nr, secs, secs>0?(double)cbuf_len(cb)*nr/secs/1000000:0);
+    secs = ts.tv_sec + ts.tv_usec/1000000.0;
+    fprintf(stdout, "serialize: %zu bytes x %d: %.3f s %.1f MB/s\n",
+            cbuf_len(cbout), nr, secs, secs>0?(double)cbuf_len(cbout)*nr/secs/1000000:0);
+    retval = 0;
+ done:
+    if (xt)
+        xml_free(xt);
+    if (xerr)
+        xml_free(xerr);
+    if (cb)
+        cbuf_free(cb);
+    if (cbout)
+        cbuf_free(cbout);
+    return retval;
+}
+
 static int
 usage(char *argv0)
 {
@@ -76,7 +150,8 @@ usage(char *argv0)
             "\t-j \t\tOutput as JSON (default is as XML)\n"
             "\t-l <s|e|o> \tLog on (s)yslog, std(e)rr, std(o)ut (stderr is default)\n"
             "\t-p \t\tPretty-print output\n"
-            "\t-y <filename> \tyang filename to parse (must be stand-alone)\n"      ,
+            "\t-y <filename> \tyang filename to parse (must be stand-alone)\n"
+            "\t-b <nr> \tBenchmark: parse and serialize input <nr> times and print throughput\n",
             argv0);
     exit(0);
 }
@@ -97,10 +172,11 @@ main(int    argc,
     int        ret;
     int        pretty = 0;
     int        dbg = 0;
+    int        bench = 0;
     
     optind = 1;
     opterr = 0;
-    while ((c = getopt(argc, argv, "hD:jl:py:")) != -1)
+    while ((c = getopt(argc, argv, "hD:jl:py:b:")) != -1)
         switch (c) {
         case 'h':
             usage(argv[0]);
@@ -122,6 +198,10 @@ main(int    argc,
         case 'y':
             yang_filename = optarg;
             break;
+        case 'b':
+            if (sscanf(optarg, "%d", &bench) != 1 || bench <= 0)
+                usage(argv[0]);
+            break;
         default:
             usage(argv[0]);
             break;
@@ -137,6 +217,10 @@ main(int    argc,
             return -1;
         }
     }
+    if (bench){
+        retval = bench_json(stdin, yspec, bench);
+        goto done;
+    }
     if ((ret = clixon_json_parse_file(stdin, yspec?1:0, yspec?YB_MODULE:YB_NONE, yspec, &xt, &xerr)) < 0)
         goto done;
     if (ret == 0){
@@ -37,6 +37,8 @@
   * Ubuntu package:
   *    apt install libnghttp2-dev
   * Example run: clixon_util_ssl -H nghttp2.org
+  * Also a TLS handshake benchmark, with and without session resumption, using HTTP/1.1:
+  *    clixon_util_ssl -H 127.0.0.1 -n 1000 [-R]
  */
 
 #ifdef HAVE_CONFIG_H
@@ -48,11 +50,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <syslog.h>
 #include <signal.h>
 #include <netdb.h>      /* gethostbyname */
 #include <arpa/inet.h>  /* inet_pton */
 #include <netinet/tcp.h> /* TCP_NODELAY */
+#include <sys/time.h>
 
 #include <openssl/ssl.h>
 #ifdef HAVE_LIBNGHTTP2
@@ -65,7 +69,7 @@
 /* clixon */
 #include "clixon/clixon.h"
 
-#define UTIL_SSL_OPTS "hD:H:"
+#define UTIL_SSL_OPTS "hD:H:p:n:R"
 
 #define ARRLEN(x) (sizeof(x) / sizeof(x[0]))
 
@@ -413,6 +417,113 @@ InitCTX(void)
     return ctx;
 }
 
+/* Last session from server, used for resumption in handshake benchmark */
+static SSL_SESSION *_resume_session = NULL;
+
+/*! New session callback, save session for resumption of next connection
+ * Sessions are received after the handshake in TLS 1.3
+ */
+static int
+new_session_cb(SSL         *ssl,
+               SSL_SESSION *session)
+{
+    if (_resume_session)
+        SSL_SESSION_free(_resume_session);
+    _resume_session = session;
+    return 1; /* Keep reference */
+}
+
+/*! TLS handshake benchmark: make nr HTTP/1.1 connections, with or without session resumption
+ *
+ * Each connection makes a TLS handshake, sends one request with Connection: close and reads
+ * the reply until the server closes.
+ * @param[in]  ctx      SSL context
+ * @param[in]  hostname Host to connect to
+ * @param[in]  port     Port to connect to
+ * @param[in]  nr       Number of connections
+ * @param[in]  resume   If set, resume session from previous connection
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+ssl_handshake_bench(SSL_CTX  *ctx,
+                    char     *hostname,
+                    uint16_t  port,
+                    int       nr,
+                    int       resume)
+{
+    int            retval = -1;
+    int            s = -1;
+    SSL           *ssl = NULL;
+    char           req[256];
+    char           buf[1024];
+    int            i;
+    int            full = 0;
+    int            resumed = 0;
+    struct timeval t0;
+    struct timeval t1;
+    uint64_t       ms;
+
+    /* Restconf over HTTP/1.1, the server may also have http/2 */
+    SSL_CTX_set_alpn_protos(ctx, (const unsigned char *)"\x08http/1.1", 9);
+    if (resume){
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+        SSL_CTX_sess_set_new_cb(ctx, new_session_cb);
+    }
+    else
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    snprintf(req, sizeof(req), "GET /restconf HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", hostname);
+    gettimeofday(&t0, NULL);
+    for (i=0; i<nr; i++){
+        if (socket_connect_inet(hostname, port, &s) < 0)
+            goto done;
+        if ((ssl = SSL_new(ctx)) == NULL){
+            clicon_err(OE_SSL, 0, "SSL_new");
+            goto done;
+        }
+        SSL_set_fd(ssl, s);
+        SSL_set_tlsext_host_name(ssl, hostname);
+        if (resume && _resume_session)
+            SSL_set_session(ssl, _resume_session);
+        if (SSL_connect(ssl) != 1){
+            clicon_err(OE_SSL, 0, "SSL_connect");
+            goto done;
+        }
+        if (SSL_session_reused(ssl))
+            resumed++;
+        else
+            full++;
+        if (SSL_write(ssl, req, strlen(req)) <= 0){
+            clicon_err(OE_SSL, 0, "SSL_write");
+            goto done;
+        }
+        /* Read reply until close, TLS 1.3 session tickets are also read here */
+        while (SSL_read(ssl, buf, sizeof(buf)) > 0)
+            ;
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+        ssl = NULL;
+        close(s);
+        s = -1;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &t1);
+    ms = t1.tv_sec*1000 + t1.tv_usec/1000;
+    fprintf(stdout, "%d handshakes in %" PRIu64 " ms: %" PRIu64 " handshakes/s full:%d resumed:%d\n",
+            nr, ms, ms?nr*1000/ms:0, full, resumed);
+    retval = 0;
+ done:
+    if (ssl)
+        SSL_free(ssl);
+    if (s != -1)
+        close(s);
+    if (_resume_session){
+        SSL_SESSION_free(_resume_session);
+        _resume_session = NULL;
+    }
+    return retval;
+}
+
 static int
 ssl_input_cb(int   s, 
              void *arg)
@@ -458,6 +569,9 @@ usage(char *argv0)
             "\t-h \t\tHelp\n"
             "\t-D <level> \tDebug\n"
             "\t-H <hostname> \tURI hostname\n"
+            "\t-p <port> \tPort (default 443)\n"
+            "\t-n <nr> \tTLS handshake benchmark with <nr> HTTP/1.1 connections\n"
+            "\t-R \t\tNo session resumption in handshake benchmark\n"
             ,
             argv0);
     exit(0);
@@ -479,6 +593,8 @@ main(int    argc,
     nghttp2_session *session = NULL;
     session_data    *sd = NULL;
     int              dbg = 0;
+    int              nr = 0;
+    int              resume = 1;
 
     /* In the startup, logs to stderr & debug flag set later */
     clicon_log_init(__FILE__, LOG_INFO, CLICON_LOG_STDERR); 
@@ -497,6 +613,17 @@ main(int    argc,
         case 'H': /* hostname */
             hostname = optarg;
             break;
+        case 'p': /* port */
+            if (sscanf(optarg, "%hu", &port) != 1)
+                usage(argv[0]);
+            break;
+        case 'n': /* handshake benchmark */
+            if (sscanf(optarg, "%d", &nr) != 1 || nr <= 0)
+                usage(argv[0]);
+            break;
+        case 'R': /* no resumption */
+            resume = 0;
+            break;
         default:
             usage(argv[0]);
             break;
@@ -509,6 +636,12 @@ main(int    argc,
     SSL_library_init();
     if ((ctx = InitCTX()) == NULL)
         goto done;
+    if (nr){
+        if (ssl_handshake_bench(ctx, hostname, port, nr, resume) < 0)
+            goto done;
+        retval = 0;
+        goto done;
+    }
     if (socket_connect_inet(hostname, port, &ss) < 0)
         goto done;
     ssl = SSL_new(ctx);     /* create new SSL connection state */
@@ -67,7 +67,7 @@
 #include "clixon/clixon.h"
 
 /* Command line options passed to getopt(3) */
-#define UTIL_XML_OPTS "hD:f:JjXl:pvoy:Y:t:T:u"
+#define UTIL_XML_OPTS "hD:f:JjXl:pvoy:Y:t:T:ub:"
 
 static int
 validate_tree(clicon_handle h,
@@ -108,6 +108,93 @@ validate_tree(clicon_handle h,
     return retval;
 }
 
+/*! Parse throughput benchmark: read all input and parse it a number of times
+ *
+ * Parse with clixon_xml_parse_string (flex/bison, or the hand-written parser if configured
+ * with --enable-xml-fast-parser) and with the incremental parser fed in BUFSIZ chunks.
+ * @param[in]  fp     Input file
+ * @param[in]  yb     How to bind yang
+ * @param[in]  yspec  Yang spec
+ * @param[in]  nr     Number of iterations
+ */
+static int
+bench_parse(FILE      *fp,
+            yang_bind  yb,
+            yang_stmt *yspec,
+            int        nr)
+{
+    int              retval = -1;
+    cbuf            *cb = NULL;
+    char             buf[BUFSIZ];
+    size_t           len;
+    size_t           i;
+    size_t           n;
+    int              j;
+    int              k;
+    cxobj           *xt = NULL;
+    cxobj           *xerr = NULL;
+    clixon_xml_push *xp = NULL;
+    struct timeval   t0;
+    struct timeval   t1;
+    double           secs;
+
+    if ((cb = cbuf_new()) == NULL){
+        clicon_err(OE_XML, errno, "cbuf_new");
+        goto done;
+    }
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        if (cbuf_append_buf(cb, buf, len) < 0)
+            goto done;
+    len = cbuf_len(cb);
+    for (k=0; k<2; k++){
+        gettimeofday(&t0, NULL);
+        for (j=0; j<nr; j++){
+            if ((xt = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+                goto done;
+            if (k == 0){
+                if (clixon_xml_parse_string(cbuf_get(cb), yb, yspec, &xt, &xerr) < 0)
+                    goto done;
+            }
+            else {
+                if ((xp = clixon_xml_push_new(yb, yspec, xt)) == NULL)
+                    goto done;
+                for (i=0; i<len; i+=n){
+                    n = (len-i < BUFSIZ) ? len-i : BUFSIZ;
+                    if (clixon_xml_push_feed(xp, cbuf_get(cb)+i, n) < 0)
+                        goto done;
+                }
+                if (clixon_xml_push_done(xp, &xerr) < 0)
+                    goto done;
+                clixon_xml_push_free(xp);
+                xp = NULL;
+            }
+            xml_free(xt);
+            xt = NULL;
+            if (xerr){
+                xml_free(xerr);
+                xerr = NULL;
+            }
+        }
+        gettimeofday(&t1, NULL);
+        timersub(&t1, &t0, &t1);
+        secs = t1.tv_sec + t1.tv_usec/1000000.0;
+        fprintf(stdout, "%s: %zu bytes x %d: %.3f s %.1f MB/s\n",
+                k==0?"string":"push",
+                len, nr, secs, secs>0?(double)len*nr/secs/1000000:0);
+    }
+    retval = 0;
+ done:
+    if (xp)
+        clixon_xml_push_free(xp);
+    if (xt)
+        xml_free(xt);
+    if (xerr)
+        xml_free(xerr);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
 static int
 usage(char *argv0)
 {
@@ -128,6 +215,7 @@ usage(char *argv0)
             "\t-t <file>\tXML top input file (where base tree is pasted to)\n"
             "\t-T <path>\tXPath to where in top input file base should be pasted\n"
             "\t-u \t\tTreat unknown XML as anydata\n"
+            "\t-b <nr>\tBenchmark: parse XML input <nr> times and print throughput\n"
             ,
             argv0);
     exit(0);
@@ -166,6 +254,7 @@ main(int    argc,
     cvec         *nsc = NULL; 
     yang_bind     yb;
     int           dbg = 0;
+    int           bench = 0;
 
     /* In the startup, logs to stderr & debug flag set later */
     clicon_log_init(__FILE__, LOG_INFO, CLICON_LOG_STDERR); 
@@ -232,6 +321,10 @@ main(int    argc,
                 goto done;
             xml_bind_yang_unknown_anydata(1);
             break;
+        case 'b':
+            if (sscanf(optarg, "%d", &bench) != 1 || bench <= 0)
+                usage(argv[0]);
+            break;
         default:
             usage(argv[0]);
             break;
@@ -301,6 +394,12 @@ main(int    argc,
         }
     }
     /* 2. Parse data (xml/json) */
+    if (bench){
+        if (bench_parse(fp, yang_file_dir?YB_MODULE:YB_NONE, yspec, bench) < 0)
+            goto done;
+        retval = 0;
+        goto done;
+    }
     if (jsonin){
         if ((ret = clixon_json_parse_file(fp, 1, top_input_filename?YB_PARENT:YB_MODULE, yspec, &xt, &xerr)) < 0)
             goto done;